@@ -86,6 +86,7 @@ function( createSPIRV )
       set( LAYOUT_1 "layout[ \t\n]*\\([a-zA-Z_0-9,= \t\n]*location[ \t\n]*=[ \t\n]*[0-9]+[a-zA-Z_0-9,= \t\n]*\\)[ \t\n]*" )
       set( LAYOUT_2 "layout[ \t\n]*\\([a-zA-Z_0-9,= \t\n]*binding[ \t\n]*=[ \t\n]*[0-9]+[a-zA-Z_0-9,= \t\n]*\\)[ \t\n]*" )
       set( LAYOUT_3 "layout[ \t\n]*\\([ \t\n]*push_constant[ \t\n]*\\)[ \t\n]*" )
+      set( QUALIFIER "((readonly|writeonly|coherent|volatile|restrict)[ \t\n]+)*" )
       set( BLOCK "{([ \t\n]*[a-zA-Z_0-9]+[ \t\n]+[][a-zA-Z_0-9]+[ \t\n]*`[ \t\n]*)*}" )
 
       # parsing GLSL code
@@ -96,6 +97,7 @@ function( createSPIRV )
       string( REGEX MATCHALL "${LAYOUT_2}uniform[ \t\n]+[a-zA-Z_0-9]+[ \t\n]+[][a-zA-Z_0-9]+[ \t\n]*`" S_U1 "${RAW_DATA}" )
       string( REGEX MATCHALL "${LAYOUT_3}uniform[ \t\n]+[a-zA-Z_0-9]+[ \t\n]*${BLOCK}" S_PUSH    "${RAW_DATA}" )
       string( REGEX MATCHALL "${LAYOUT_2}uniform[ \t\n]+[a-zA-Z_0-9]+[ \t\n]*${BLOCK}" S_UNIFORM "${RAW_DATA}" )
+      string( REGEX MATCHALL "${LAYOUT_2}${QUALIFIER}buffer[ \t\n]+[a-zA-Z_0-9]+[ \t\n]*${BLOCK}" S_STORAGE "${RAW_DATA}" )
 
       foreach( J IN LISTS S_IN )
          set( ARRAY 1 )
@@ -188,9 +190,18 @@ function( createSPIRV )
          string( APPEND UNIFORM_B_${I_UPPER} "\n            }},\n" )
       endforeach( J IN LISTS S_UNIFORM )
 
+      # Only the bindings of storage blocks are needed (the data is written by the host / shaders)
+      foreach( J IN LISTS S_STORAGE )
+         string( REGEX REPLACE ".*\\)[ \t\n]*${QUALIFIER}buffer[ \t\n]+([a-zA-Z_0-9]+).*" "\\3" NAM  "${J}" )
+         string( REGEX REPLACE ".*binding[ \t\n]*=[ \t\n]*([0-9]+).*"                         "\\1" BIND "${J}" )
+
+         string( APPEND STORAGE_B_${I_UPPER} "            {\"${NAM}\", ${BIND}, {}},\n" )
+      endforeach( J IN LISTS S_STORAGE )
+
       string( REGEX REPLACE ",\n$" "" INPUT_${I_UPPER}     "${INPUT_${I_UPPER}}" )
       string( REGEX REPLACE ",\n$" "" OUTPUT_${I_UPPER}    "${OUTPUT_${I_UPPER}}" )
       string( REGEX REPLACE ",\n$" "" UNIFORM_B_${I_UPPER} "${UNIFORM_B_${I_UPPER}}" )
+      string( REGEX REPLACE ",\n$" "" STORAGE_B_${I_UPPER} "${STORAGE_B_${I_UPPER}}" )
    endforeach( I IN LISTS SHADER_TYPES )
 
    configure_file( "${TEMPLATES_DIR}/spirv.in.hpp" "${ARGV2}/${FILENAME_HPP}" @ONLY )
@@ -51,6 +51,9 @@ class @CLASSNAME@ : public rShaderBase {
          },
          { // Uniform Blocks
 @UNIFORM_B_VERT@
+         },
+         { // Storage Blocks
+@STORAGE_B_VERT@
          }
       };
    }
@@ -71,6 +74,9 @@ class @CLASSNAME@ : public rShaderBase {
          },
          { // Uniform Blocks
 @UNIFORM_B_TESC@
+         },
+         { // Storage Blocks
+@STORAGE_B_TESC@
          }
       };
    }
@@ -91,6 +97,9 @@ class @CLASSNAME@ : public rShaderBase {
          },
          { // Uniform Blocks
 @UNIFORM_B_TESE@
+         },
+         { // Storage Blocks
+@STORAGE_B_TESE@
          }
       };
    }
@@ -111,6 +120,9 @@ class @CLASSNAME@ : public rShaderBase {
          },
          { // Uniform Blocks
 @UNIFORM_B_GEOM@
+         },
+         { // Storage Blocks
+@STORAGE_B_GEOM@
          }
       };
    }
@@ -131,6 +143,9 @@ class @CLASSNAME@ : public rShaderBase {
          },
          { // Uniform Blocks
 @UNIFORM_B_FRAG@
+         },
+         { // Storage Blocks
+@STORAGE_B_FRAG@
          }
       };
    }
@@ -147,10 +162,13 @@ class @CLASSNAME@ : public rShaderBase {
 @UNIFORM_COMP@
          },
          { // Push constants
-@PUSH_COMPT@
+@PUSH_COMP@
          },
          { // Uniform Blocks
 @UNIFORM_B_COMP@
+         },
+         { // Storage Blocks
+@STORAGE_B_COMP@
          }
       };
    }
@@ -24,6 +24,7 @@
 #include "uLog.hpp"
 #include "iInit.hpp"
 
+#include <algorithm>
 #include <string.h>
 #include <vulkan/vulkan.h>
 
@@ -205,6 +206,14 @@ int iInit::initVulkan(std::vector<std::string> _layers) {
   if (lRet != 0)
     return lRet;
 
+#ifdef VK_EXT_memory_budget
+  // Optional: needed for the memory budget of the device (vkuDevice::getMemoryBudget)
+  const std::string lProps2 = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+  if (isExtensionSupported(lProps2) &&
+      std::find(vExtensionsToUse.begin(), vExtensionsToUse.end(), lProps2) == vExtensionsToUse.end())
+    vExtensionsToUse.emplace_back(lProps2);
+#endif
+
   const char **lExtensions = new const char *[vExtensionsToUse.size()];
 
   iLOG("Using ", vExtensionsToUse.size(), " extension: ");
@@ -445,8 +454,24 @@ int iInit::createDevice(std::vector<std::string> _layers, VkPhysicalDevice _pDev
     }
   }
 
+#ifdef VK_EXT_memory_budget
+  // Optional: the memory budget is used to limit the resident textures (rTextureStreamer)
+  const std::string lBudget = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+  const std::string lProps2 = VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME;
+
+  bool lHasProps2 = std::find(vExtensionsToUse.begin(), vExtensionsToUse.end(), lProps2) != vExtensionsToUse.end();
+  bool lIsAdded   = std::find(vDeviceExtensionsToUse.begin(), vDeviceExtensionsToUse.end(), lBudget) !=
+                  vDeviceExtensionsToUse.end();
+
+  if (lHasProps2 && !lIsAdded && isDeviceExtensionSupported(lBudget))
+    vDeviceExtensionsToUse.emplace_back(lBudget);
+#endif
+
   vDevice = std::make_shared<vkuDevice>(_pDeviceToUse, vDeviceLayersToUse, vDeviceExtensionsToUse, vSurface_vk);
 
+  if (vDevice->isCreated() && vDevice->enableMemoryBudget(vInstance_vk))
+    iLOG("Using the memory budget of the device (VK_EXT_memory_budget)");
+
   return vDevice->isCreated() ? 0 : -1;
 }
 } // namespace e_engine
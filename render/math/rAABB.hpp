@@ -0,0 +1,187 @@
+/*!
+ * \file rAABB.hpp
+ * \brief \b Classes: \a rAABB, \a rRay, \a rFrustum
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <limits>
+
+namespace e_engine {
+
+/*!
+ * \brief Axis aligned bounding box
+ *
+ * A default constructed box is empty (min > max) and can be grown with merge().
+ */
+struct rAABB {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+  rAABB() = default;
+  rAABB(glm::vec3 const &_min, glm::vec3 const &_max) : min(_min), max(_max) {}
+
+  inline bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+  inline glm::vec3 center() const { return (min + max) * 0.5f; }
+  inline glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+  inline void merge(glm::vec3 const &_p) {
+    min = glm::min(min, _p);
+    max = glm::max(max, _p);
+  }
+
+  inline void merge(rAABB const &_box) {
+    min = glm::min(min, _box.min);
+    max = glm::max(max, _box.max);
+  }
+
+  inline static rAABB merge(rAABB const &_a, rAABB const &_b) {
+    return rAABB(glm::min(_a.min, _b.min), glm::max(_a.max, _b.max));
+  }
+
+  //! Half of the surface area (enough for the SAH cost compare)
+  inline float area() const {
+    glm::vec3 d = max - min;
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  inline bool contains(rAABB const &_box) const {
+    return min.x <= _box.min.x && min.y <= _box.min.y && min.z <= _box.min.z && max.x >= _box.max.x &&
+           max.y >= _box.max.y && max.z >= _box.max.z;
+  }
+
+  inline bool overlaps(rAABB const &_box) const {
+    return min.x <= _box.max.x && max.x >= _box.min.x && min.y <= _box.max.y && max.y >= _box.min.y &&
+           min.z <= _box.max.z && max.z >= _box.min.z;
+  }
+
+  /*!
+   * \brief Returns the box enclosing this box after transforming it with _mat
+   *
+   * Uses the absolute matrix trick (Arvo) instead of transforming all 8 corners.
+   */
+  inline rAABB transform(glm::mat4 const &_mat) const {
+    glm::vec3 lCenter = glm::vec3(_mat * glm::vec4(center(), 1.0f));
+    glm::vec3 lExtent = extent();
+    glm::vec3 lNewExt;
+
+    for (int i = 0; i < 3; ++i)
+      lNewExt[i] = std::abs(_mat[0][i]) * lExtent.x + std::abs(_mat[1][i]) * lExtent.y +
+                   std::abs(_mat[2][i]) * lExtent.z;
+
+    return rAABB(lCenter - lNewExt, lCenter + lNewExt);
+  }
+};
+
+/*!
+ * \brief Ray with precomputed inverse direction for slab tests
+ */
+struct rRay {
+  glm::vec3 origin;
+  glm::vec3 dir;
+  glm::vec3 invDir;
+
+  rRay() = default;
+  rRay(glm::vec3 const &_origin, glm::vec3 const &_dir) : origin(_origin), dir(_dir), invDir(1.0f / _dir) {}
+
+  /*!
+   * \brief Slab test against _box
+   * \param[in]  _box  The box to test
+   * \param[in]  _tMax Ignore hits further away than this
+   * \param[out] _t    The distance (in units of dir) to the entry point
+   * \returns true if the ray hits the box
+   */
+  inline bool intersects(rAABB const &_box, float _tMax, float &_t) const {
+    glm::vec3 lT1 = (_box.min - origin) * invDir;
+    glm::vec3 lT2 = (_box.max - origin) * invDir;
+
+    glm::vec3 lTMin = glm::min(lT1, lT2);
+    glm::vec3 lTMax = glm::max(lT1, lT2);
+
+    float lNear = std::max(std::max(lTMin.x, lTMin.y), std::max(lTMin.z, 0.0f));
+    float lFar  = std::min(std::min(lTMax.x, lTMax.y), std::min(lTMax.z, _tMax));
+
+    _t = lNear;
+    return lNear <= lFar;
+  }
+};
+
+/*!
+ * \brief View frustum, extracted from a (view) projection matrix
+ *
+ * Expects a clip space depth range of [0, 1] (GLM_FORCE_DEPTH_ZERO_TO_ONE). The plane normals point
+ * into the frustum.
+ */
+struct rFrustum {
+  enum TEST_RESULT { OUTSIDE, INTERSECTS, INSIDE };
+
+  std::array<glm::vec4, 6> planes;
+
+  rFrustum() = default;
+  rFrustum(glm::mat4 const &_viewProj) {
+    glm::vec4 lRow0 = glm::vec4(_viewProj[0][0], _viewProj[1][0], _viewProj[2][0], _viewProj[3][0]);
+    glm::vec4 lRow1 = glm::vec4(_viewProj[0][1], _viewProj[1][1], _viewProj[2][1], _viewProj[3][1]);
+    glm::vec4 lRow2 = glm::vec4(_viewProj[0][2], _viewProj[1][2], _viewProj[2][2], _viewProj[3][2]);
+    glm::vec4 lRow3 = glm::vec4(_viewProj[0][3], _viewProj[1][3], _viewProj[2][3], _viewProj[3][3]);
+
+    planes[0] = lRow3 + lRow0; // left
+    planes[1] = lRow3 - lRow0; // right
+    planes[2] = lRow3 + lRow1; // bottom
+    planes[3] = lRow3 - lRow1; // top
+    planes[4] = lRow2;         // near (depth 0)
+    planes[5] = lRow3 - lRow2; // far
+
+    for (auto &i : planes)
+      i /= glm::length(glm::vec3(i));
+  }
+
+  inline TEST_RESULT test(rAABB const &_box) const {
+    glm::vec3   lCenter = _box.center();
+    glm::vec3   lExtent = _box.extent();
+    TEST_RESULT lRes    = INSIDE;
+
+    for (auto const &i : planes) {
+      float lDist   = i.x * lCenter.x + i.y * lCenter.y + i.z * lCenter.z + i.w;
+      float lRadius = std::abs(i.x) * lExtent.x + std::abs(i.y) * lExtent.y + std::abs(i.z) * lExtent.z;
+
+      if (lDist < -lRadius)
+        return OUTSIDE;
+
+      if (lDist < lRadius)
+        lRes = INTERSECTS;
+    }
+
+    return lRes;
+  }
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
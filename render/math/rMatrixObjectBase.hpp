@@ -59,8 +59,12 @@ class rMatrixObjectBase {
  protected:
   std::recursive_mutex vMatrixAccess;
 
+  //! Called (with vMatrixAccess locked) from updateFinalMatrix() when the model matrix changed
+  virtual void modelMatrixChanged() {}
+
  public:
   rMatrixObjectBase(rMatrixSceneBase<T> *_scene);
+  virtual ~rMatrixObjectBase() {}
 
   inline void              setPosition(const glm::tvec3<T, P> &_pos);
   inline void              getPosition(glm::tvec3<T, P> &_pos);
@@ -167,7 +171,9 @@ void rMatrixObjectBase<T, P>::addPositionDelta(const glm::tvec3<T, P> &_pos) {
 template <class T, glm::qualifier P>
 void rMatrixObjectBase<T, P>::updateFinalMatrix() {
   std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
-  vModelMatrix_MAT = vTranslationMatrix_MAT * vRotationMatrix_MAT * vScaleMatrix_MAT;
+  glm::tmat4x4<T, P> lModel        = vTranslationMatrix_MAT * vRotationMatrix_MAT * vScaleMatrix_MAT;
+  bool               lModelChanged = lModel != vModelMatrix_MAT;
+  vModelMatrix_MAT                 = lModel;
 
   if (vViewProjectionMatrix_MAT)
     vModelViewProjectionMatrix_MAT = *vViewProjectionMatrix_MAT * vModelMatrix_MAT;
@@ -176,6 +182,9 @@ void rMatrixObjectBase<T, P>::updateFinalMatrix() {
 
   vPositionModelView = vModelViewMatrix_MAT * glm::tvec4<T, P>(0, 0, 0, 1);
   vNormalMatrix      = glm::inverseTranspose(glm::tmat3x3<T, P>(vModelViewMatrix_MAT));
+
+  if (lModelChanged)
+    modelMatrixChanged();
 }
 } // namespace e_engine
 
@@ -21,52 +21,54 @@
 
 #include "defines.hpp"
 
-#include "rMatrixObjectBase.hpp"
-#include "rObjectBase.hpp"
+#include "rLightRenderBase.hpp"
+#include <glm/geometric.hpp>
 
 namespace e_engine {
 
 template <class T, glm::qualifier P = glm::qualifier::highp>
-class rDirectionalLight : public rObjectBase {
+class rDirectionalLight : public rLightRenderBase {
  private:
   glm::tvec3<T, P> vAmbientColor;
   glm::tvec3<T, P> vLightColor;
   glm::tvec3<T, P> vLightDirection;
 
-  bool isMesh() override { return false; }
-
  public:
-  rDirectionalLight(std::string _name) : rObjectBase(_name) { vLightColor.fill(0); }
+  rDirectionalLight(std::string _name) : rLightRenderBase(_name) {
+    vAmbientColor   = glm::tvec3<T, P>(0, 0, 0);
+    vLightColor     = glm::tvec3<T, P>(0, 0, 0);
+    vLightDirection = glm::tvec3<T, P>(0, -1, 0);
+    vIsLoaded_B     = true;
+  }
 
-  rDirectionalLight(std::string _name, glm::tvec3<T, P> _direction) : rObjectBase(_name) {
-    vLightDirection = _direction;
+  rDirectionalLight(std::string _name, glm::tvec3<T, P> _direction) : rLightRenderBase(_name) {
+    vAmbientColor   = glm::tvec3<T, P>(0, 0, 0);
+    vLightColor     = glm::tvec3<T, P>(1, 1, 1);
+    vLightDirection = glm::normalize(_direction);
     vIsLoaded_B     = true;
-    vLightDirection.normalize();
   }
 
   rDirectionalLight(std::string _name, glm::tvec3<T, P> _direction, glm::tvec3<T, P> _color, glm::tvec3<T, P> _ambient)
-      : rObjectBase(_name) {
-    vLightDirection = _direction;
+      : rLightRenderBase(_name) {
+    vLightDirection = glm::normalize(_direction);
     vLightColor     = _color;
     vAmbientColor   = _ambient;
     vIsLoaded_B     = true;
-
-    vLightDirection.normalize();
   }
 
   void setColor(glm::tvec3<T, P> _color, glm::tvec3<T, P> _ambient) {
     vLightColor   = _color;
     vAmbientColor = _ambient;
+    signalLightChanged();
   }
 
   void setDirection(glm::tvec3<T, P> _direction) {
-    vLightDirection = _direction;
-    vLightDirection.normalize();
+    vLightDirection = glm::normalize(_direction);
+    signalLightChanged();
   }
   glm::tvec3<T, P> *getColor() { return &vLightColor; }
 
   uint32_t getVector(glm::tvec3<T, P> **_vec, VECTOR_TYPES _type) override;
-  bool     checkIsCompatible(rPipeline *) override { return true; }
 };
 
 
@@ -21,22 +21,43 @@
 
 #include "defines.hpp"
 
+#include "rLightManager.hpp"
 #include "rObjectBase.hpp"
 #include <string>
 #include <vulkan.h>
 
 namespace e_engine {
 
+/*!
+ * \brief Base class for all light sources
+ *
+ * Lights are not drawn themselves. Their data (rObjectBase::getVector) is stored in the light buffer
+ * of the scene (rLightManager), which is read by the renderers. Subclasses must call
+ * signalLightChanged whenever their data changes.
+ */
 class rLightRenderBase : public rObjectBase {
  private:
+  rLightManager *vLightManager = nullptr;
+  uint32_t       vLightID      = UINT32_MAX;
+
   bool isMesh() override { return false; }
-  void recordLight(VkCommandBuffer _buf, vkuBuffer &_vertex, vkuBuffer &_index) override;
-  bool checkIsCompatible(rPipeline *_pipe) override;
-  void signalRenderReset(rRendererBase *_renderer) override;
+  bool checkIsCompatible(rPipeline *) override { return true; }
+
+ protected:
+  void signalLightChanged() {
+    if (vLightManager)
+      vLightManager->markDirty(vLightID);
+  }
 
  public:
   rLightRenderBase() = delete;
-  rLightRenderBase(vkuDevicePTR _device, std::string _name) : rObjectBase(_device, _name) {}
+  rLightRenderBase(std::string _name) : rObjectBase(nullptr, _name) {}
+
+  //! \brief Called by rLightManager::addLight
+  void setLightManager(rLightManager *_manager, uint32_t _id) {
+    vLightManager = _manager;
+    vLightID      = _id;
+  }
 };
 
 } // namespace e_engine
@@ -39,14 +39,17 @@ class rPointLight : public rLightRenderBase, public rMatrixObjectBase<T> {
   using rMatrixObjectBase<T>::getPosition;
 
   rPointLight(SCENE _scene, std::string _name) : rLightRenderBase(_name), rMatrixObjectBase<T>(_scene) {
-    vLightColor = glm::tvec3<T, P>(0, 0, 0);
-    vIsLoaded_B = true;
+    vAmbientColor = glm::tvec3<T, P>(0, 0, 0);
+    vLightColor   = glm::tvec3<T, P>(0, 0, 0);
+    vAttenuation  = glm::tvec3<T, P>(1, 0, 0);
+    vIsLoaded_B   = true;
   }
 
   rPointLight(SCENE _scene, std::string _name, glm::tvec3<T, P> _color, glm::tvec3<T, P> _ambient)
       : rLightRenderBase(_name), rMatrixObjectBase<T>(_scene) {
     vLightColor   = _color;
     vAmbientColor = _ambient;
+    vAttenuation  = glm::tvec3<T, P>(1, 0, 0);
     vIsLoaded_B   = true;
   }
 
@@ -61,19 +64,24 @@ class rPointLight : public rLightRenderBase, public rMatrixObjectBase<T> {
   void setColor(glm::tvec3<T, P> _color, glm::tvec3<T, P> _ambient) {
     vLightColor   = _color;
     vAmbientColor = _ambient;
+    signalLightChanged();
+  }
+  void setAttenuation(glm::tvec3<T, P> _att) {
+    vAttenuation = _att;
+    signalLightChanged();
   }
-  void setAttenuation(glm::tvec3<T, P> _att) { vAttenuation = _att; }
   void setAttenuation(T _const, T _linear, T _exp) {
     vAttenuation.x = _const;
     vAttenuation.y = _linear;
     vAttenuation.z = _exp;
+    signalLightChanged();
   }
   glm::tvec3<T, P> *getColor() { return &vLightColor; }
   glm::tvec3<T, P> *getAttenuation() { return &vAttenuation; }
 
   uint32_t getVector(glm::tvec3<T, P> **_vec, VECTOR_TYPES _type) override;
 
-  bool checkIsCompatible(rPipeline *) override { return true; }
+  void modelMatrixChanged() override { signalLightChanged(); }
 };
 
 
@@ -21,7 +21,10 @@
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
 #include "iInit.hpp"
+#include "rMeshOptimizer.hpp"
 #include "rPipeline.hpp"
+#include "rScene.hpp"
+#include "rTextureAtlas.hpp"
 #include <regex>
 
 using namespace e_engine;
@@ -43,12 +46,73 @@ bool rObjectBase::setPipeline(rPipeline *_pipe) {
   return true;
 }
 
-bool rObjectBase::setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_t _meshIndex, std::string _rootPath) {
+/*!
+ * \brief Registers the scene the object was added to
+ * \note This function SHOULD NOT be called directly! It is called by rSceneBase::addObject
+ */
+void rObjectBase::setScene(rSceneBase *_scene, uint32_t _index) {
+  vScene      = _scene;
+  vSceneIndex = _index;
+}
+
+/*!
+ * \brief Marks the object as static (it is expected to never move)
+ *
+ * Renderers may cache the results of static objects (i.e. distant shadow cascades in
+ * rRendererShadow). Moving a static object is allowed, but invalidates these caches.
+ */
+void rObjectBase::setIsStatic(bool _isStatic) {
+  if (vIsStatic == _isStatic)
+    return;
+
+  vIsStatic = _isStatic;
+  if (vScene)
+    vScene->staticGeometryChanged();
+}
+
+/*!
+ * \brief Tells the scene that the world space bounds of this object (may) have changed
+ */
+void rObjectBase::signalTransformChanged() {
+  if (!vScene)
+    return;
+
+  vScene->objectTransformChanged(vSceneIndex);
+  if (vIsStatic)
+    vScene->staticGeometryChanged();
+}
+
+/*!
+ * \brief Records the object into a command buffer that already contains other objects
+ *
+ * Objects that do not track the bound state just record everything and reset _state.
+ */
+void rObjectBase::record(VkCommandBuffer _buf, RecordState &_state) {
+  record(_buf);
+  _state = RecordState();
+}
+
+/*!
+ * \brief Records the upload of the mesh _meshIndex of _scene into _transfer and loads its materials
+ * \param _deferTextures Only configure the textures, the caller loads them (takePendingTextures())
+ * \param _atlas         The UVs are remapped into this atlas if it contains the texture of the mesh
+ *                       (rTextureAtlas::getPackablePath), the material then uses the atlas
+ */
+bool rObjectBase::setData(vkuTransfer &   _transfer,
+                          aiScene const * _scene,
+                          uint32_t        _meshIndex,
+                          std::string     _rootPath,
+                          rGeometryArena *_arena,
+                          uint32_t        _maxTextureExtent,
+                          bool            _deferTextures,
+                          rTextureAtlas * _atlas) {
   if (vIsLoaded_B || vPartialLoaded_B) {
     eLOG("Data already loaded! Object ", vName_str);
     return false;
   }
 
+  vArena = _arena;
+
   if (!_scene || _scene->mNumMeshes <= _meshIndex) {
     eLOG(L"Invalid mesh parameters");
     return false;
@@ -102,6 +166,10 @@ bool rObjectBase::setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_
   std::vector<uint32_t> lIndex;
   std::vector<float>    lData;
 
+  vLocalAABB = rAABB();
+  for (uint32_t i = 0; i < lMesh->mNumVertices; i++)
+    vLocalAABB.merge(glm::vec3(lMesh->mVertices[i].x, lMesh->mVertices[i].y, lMesh->mVertices[i].z));
+
   lIndex.resize(lIndexSize * lMesh->mNumFaces);
   for (uint32_t i = 0; i < lMesh->mNumFaces; i++)
     for (uint32_t j = 0; j < lIndexSize; j++)
@@ -109,10 +177,34 @@ bool rObjectBase::setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_
 
   switch (getDataLayout()) {
     case POS_NORM: setupVertexData_PN(lMesh, lData); break;
-    case POS_NORM_UV: setupVertexData_PNUV(lMesh, lData); break;
+    case POS_NORM_UV:
+    case POS_NORM_UV_COMPRESSED: setupVertexData_PNUV(lMesh, lData); break;
     default: eLOG("Data layout ", uEnum2Str::toStr(getDataLayout())); return false;
   }
 
+  bool lHasUVs = getDataLayout() == POS_NORM_UV || getDataLayout() == POS_NORM_UV_COMPRESSED;
+
+  rTextureAtlas::Region lAtlasRegion;
+  std::string           lAtlasPath;
+  bool                  lUseAtlas = false;
+
+  if (_atlas && lHasUVs && rTextureAtlas::getPackablePath(_scene, _meshIndex, _rootPath, lAtlasPath))
+    lUseAtlas = _atlas->find(lAtlasPath, lAtlasRegion);
+
+  // The UVs are in [0, 1], so they can be moved into the region of the texture in the atlas
+  if (lUseAtlas) {
+    for (size_t i = 0; i + 7 < lData.size(); i += 8) {
+      lData[i + 6] = lData[i + 6] * lAtlasRegion.transform.x + lAtlasRegion.transform.z;
+      lData[i + 7] = lData[i + 7] * lAtlasRegion.transform.y + lAtlasRegion.transform.w;
+    }
+  }
+
+  vMaterialIndex = lMesh->mMaterialIndex;
+
+  // Vertex cache, overdraw and vertex fetch order (replaces aiProcess_ImproveCacheLocality)
+  if (getMeshType() == MESH_3D && lMesh->mNumVertices > 0)
+    rMeshOptimizer::optimize(lIndex, lData, static_cast<uint32_t>(lData.size() / lMesh->mNumVertices), vName_str);
+
   for (uint32_t i = 0; i < _scene->mNumMaterials; ++i) {
     aiString name;
     float    opacity            = 1.0;
@@ -163,6 +255,12 @@ bool rObjectBase::setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_
       }
     }();
 
+    // All textures of the material are the packed texture
+    if (lUseAtlas && i == vMaterialIndex) {
+      lMatOBJ.setAtlas(lAtlasRegion.texture, lAtlasRegion.transform);
+      continue;
+    }
+
     for (aiTextureType j : {aiTextureType_NONE,
                             aiTextureType_DIFFUSE,
                             aiTextureType_SPECULAR,
@@ -239,12 +337,21 @@ bool rObjectBase::setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_
           }
         }();
 
-        lMatOBJ.addTexture(_rootPath + "/" + path.C_Str(), uvIndex, blend, texType, texOP, texMap, texMapMode);
+        lMatOBJ.addTexture(_rootPath + "/" + path.C_Str(),
+                           uvIndex,
+                           blend,
+                           texType,
+                           texOP,
+                           texMap,
+                           texMapMode,
+                           &_transfer,
+                           _maxTextureExtent,
+                           _deferTextures);
       }
     }
   }
 
-  vLoadBuffers = setData_IMPL(_buf, lIndex, lData);
+  vLoadBuffers = setData_IMPL(_transfer.getBuffer(), lIndex, lData);
 
   vPartialLoaded_B = true;
   return true;
@@ -265,13 +372,23 @@ bool rObjectBase::finishData() {
     i->destroyStagingBufferMemory();
   }
 
+  for (auto &i : vMaterials)
+    i.finishUploads();
+
   vLoadBuffers.clear();
   vIsLoaded_B = true;
+  signalTransformChanged();
   return true;
 }
 
 void rObjectBase::destroy() { destroy_IMPL(); }
 
+//! \brief Appends the textures deferred by setData to _out (see rMaterial::takePendingTextures)
+void rObjectBase::takePendingTextures(std::vector<std::pair<rTexture *, std::string>> &_out) {
+  for (auto &i : vMaterials)
+    i.takePendingTextures(_out);
+}
+
 bool rObjectBase::setupVertexData_PN(aiMesh const *_mesh, std::vector<float> &_out) {
   if (!_mesh->HasNormals()) {
     eLOG("Invalid data! Object ", vName_str);
@@ -22,6 +22,9 @@
 #include "defines.hpp"
 
 #include "vkuBuffer.hpp"
+#include "vkuTransfer.hpp"
+#include "rAABB.hpp"
+#include "rGeometryArena.hpp"
 #include "rMaterial.hpp"
 #include "rShaderBase.hpp"
 #include <array>
@@ -57,6 +60,8 @@ namespace e_engine {
 
 class rPipeline;
 class rRendererBase;
+class rSceneBase;
+class rTextureAtlas;
 
 /*!
  * \brief Base class for creating objects
@@ -110,6 +115,7 @@ class rObjectBase {
     POS_NORM_COLOR,
     POS_NORM_UV,
     POS_NORM_UV_COLOR,
+    POS_NORM_UV_COMPRESSED, //!< Float POS_NORM_UV data is passed to setData_IMPL, the object packs it
     UNDEFINED
   };
 
@@ -117,17 +123,41 @@ class rObjectBase {
   using UNIFORM_VAR    = rShaderBase::UniformBuffer::Var;
   using PUSH_CONSTANT  = rShaderBase::PushConstantVar;
 
+  //! Everything needed to draw the object with an indirect draw (rRendererIndirect)
+  struct IndirectDrawData {
+    rGeometryArena::Allocation geometry; //!< firstIndex / numIndexes of the drawn index range
+    glm::mat4                  model;    //!< Maps the vertex data to world space
+    rAABB                      bounds;   //!< Bounds of the vertex data (before model is applied)
+  };
+
+  //! State already bound in a command buffer (used to skip redundant binds while recording)
+  struct RecordState {
+    rPipeline *  pipeline     = nullptr;
+    rShaderBase *shader       = nullptr;
+    VkBuffer     vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer     indexBuffer  = VK_NULL_HANDLE;
+  };
+
  private:
   std::vector<vkuBuffer *> vLoadBuffers;
 
+  rSceneBase *vScene         = nullptr;
+  uint32_t    vSceneIndex    = 0;
+  uint32_t    vMaterialIndex = UINT32_MAX; //!< Material of the mesh in vMaterials (UINT32_MAX: unknown)
+  uint32_t    vRecordVersion = 0;          //!< Incremented when the recorded commands change
+  bool        vIsStatic      = false;
+
  protected:
   vkuDevicePTR vDevice;
   std::string  vName_str;
+  rAABB        vLocalAABB; //!< Object space bounds of the mesh data (empty for non mesh objects)
 
   bool       vPartialLoaded_B = false;
   bool       vIsLoaded_B      = false;
   rPipeline *vPipeline        = nullptr;
 
+  rGeometryArena *vArena = nullptr; //!< Shared geometry buffers of the scene (set in setData)
+
   std::vector<rMaterial> vMaterials;
 
   virtual std::vector<vkuBuffer *> setData_IMPL(vkuCommandBuffer &,
@@ -140,6 +170,9 @@ class rObjectBase {
   bool         setupVertexData_PNUV(aiMesh const *_mesh, std::vector<float> &_out);
   virtual void destroy_IMPL() {}
 
+  void signalTransformChanged();
+  void signalRecordChanged() { vRecordVersion++; } //!< The commands of record() changed (i.e. the LOD)
+
  public:
   rObjectBase(vkuDevicePTR _device, std::string _name) : vDevice(_device), vName_str(_name) {}
   rObjectBase() = delete;
@@ -157,7 +190,14 @@ class rObjectBase {
 
   virtual ~rObjectBase();
 
-  bool setData(vkuCommandBuffer &_buf, aiScene const *_scene, uint32_t _meshIndex, std::string _rootPath);
+  bool setData(vkuTransfer &   _transfer,
+               aiScene const * _scene,
+               uint32_t        _meshIndex,
+               std::string     _rootPath,
+               rGeometryArena *_arena            = nullptr,
+               uint32_t        _maxTextureExtent = 0,
+               bool            _deferTextures    = false,
+               rTextureAtlas * _atlas            = nullptr);
   void destroy();
 
   bool finishData();
@@ -166,8 +206,9 @@ class rObjectBase {
   virtual bool isMesh()                            = 0;
   virtual void updateUniforms() {}
   virtual void record(VkCommandBuffer) {}
-  virtual void recordLight(VkCommandBuffer, vkuBuffer &, vkuBuffer &) {}
+  virtual void record(VkCommandBuffer _buf, RecordState &_state);
   virtual void signalRenderReset(rRendererBase *) {}
+  virtual void signalTexturesChanged() {} //!< The image views of the textures changed (rTextureStreamer)
   virtual bool supportsPushConstants() { return false; }
 
   rPipeline *  getPipeline() { return vPipeline; }
@@ -175,6 +216,21 @@ class rObjectBase {
   bool         getIsDataLoaded() const { return vIsLoaded_B; }
   std::string  getName() const { return vName_str; }
   bool         setPipeline(rPipeline *_pipe);
+  void         setScene(rSceneBase *_scene, uint32_t _index);
+  rSceneBase * getScene() { return vScene; }
+  void         setIsStatic(bool _isStatic);
+  bool         getIsStatic() const { return vIsStatic; }
+  uint32_t     getRecordVersion() const { return vRecordVersion; } //!< Record again when this changes
+
+  std::vector<rMaterial> &getMaterials() { return vMaterials; }
+  uint32_t                getMaterialIndex() const { return vMaterialIndex; }
+  void                    takePendingTextures(std::vector<std::pair<rTexture *, std::string>> &_out);
+
+  rAABB const &getLocalAABB() const { return vLocalAABB; }
+  virtual bool getWorldAABB(rAABB &) { return false; }
+
+  virtual bool getIndirectDrawData(IndirectDrawData &) { return false; }
+  virtual bool getDrawData(IndirectDrawData &_out) { return getIndirectDrawData(_out); }
 
   virtual uint32_t getMatrix(glm::mat4 **_mat, MATRIX_TYPES _type);
   virtual uint32_t getMatrix(glm::dmat4 **_mat, MATRIX_TYPES _type);
@@ -19,20 +19,29 @@
  */
 
 #include "rSimpleMesh.hpp"
+#include "uConfig.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include "rMeshOptimizer.hpp"
 #include "rPipeline.hpp"
+#include "rScene.hpp"
 #include "rWorld.hpp"
+#include <algorithm>
 #include <glm/gtc/type_ptr.hpp>
 
 using namespace e_engine;
 using namespace glm;
 
-rSimpleMesh::rSimpleMesh(rMatrixSceneBase<float> *_scene, vkuDevicePTR _device, std::string _name)
-    : rMatrixObjectBase(_scene),
-      rObjectBase(_device, _name),
-      vIndex(_scene->getWorldPtr()->getDevice()),
-      vVertex(_scene->getWorldPtr()->getDevice()) {}
+/*!
+ * \brief Constructor
+ * \param _compressed Store 16 bit positions, octahedral normals and half float UVs (16 bytes per vertex)
+ *
+ * \note Compressed meshes need a shader that decodes the normals and applies the dequantize matrix
+ * \note (DEQUANTIZE_MATRIX uniform or push constant) to the positions before the model matrix, and a
+ * \note pipeline with the formats from getCompressedInputFormats()
+ */
+rSimpleMesh::rSimpleMesh(rMatrixSceneBase<float> *_scene, vkuDevicePTR _device, std::string _name, bool _compressed)
+    : rMatrixObjectBase(_scene), rObjectBase(_device, _name), vCompressed(_compressed) {}
 
 
 /*!
@@ -41,13 +50,27 @@ rSimpleMesh::rSimpleMesh(rMatrixSceneBase<float> *_scene, vkuDevicePTR _device,
  * \vkIntern
  */
 void rSimpleMesh::record(VkCommandBuffer _buf) {
+  RecordState lState;
+  record(_buf, lState);
+}
+
+/*!
+ * \brief Records the mesh and skips the binds that are already in _state
+ */
+void rSimpleMesh::record(VkCommandBuffer _buf, RecordState &_state) {
   VkDeviceSize lOffsets[] = {0};
-  VkBuffer     lVertex    = *vVertex;
 
-  if (vVertUniform)
-    vShader->cmdBindDescriptorSets(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+  // A different pipeline may have an incompatible layout (and vertex bind point) ==> rebind everything
+  if (_state.pipeline != vPipeline || _state.shader != vShader) {
+    if (vVertUniform)
+      vShader->cmdBindDescriptorSets(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    vPipeline->cmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
 
-  vPipeline->cmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    _state          = RecordState();
+    _state.pipeline = vPipeline;
+    _state.shader   = vShader;
+  }
 
   if (vHasMVPMatrix_PC) {
     std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
@@ -59,9 +82,63 @@ void rSimpleMesh::record(VkCommandBuffer _buf) {
     vShader->cmdUpdatePushConstant(_buf, vMatrixModelVar_PC, value_ptr(*getModelMatrix()));
   }
 
-  vkCmdBindVertexBuffers(_buf, vPipeline->getVertexBindPoint(), 1, &lVertex, &lOffsets[0]);
-  vkCmdBindIndexBuffer(_buf, *vIndex, 0, VK_INDEX_TYPE_UINT32);
-  vkCmdDrawIndexed(_buf, vIndexCount, 1, 0, 0, 1);
+  if (vHasDequantize_PC)
+    vShader->cmdUpdatePushConstant(_buf, vDequantize_PC, value_ptr(vDequantize));
+
+  if (vLODs.empty() || !vGeometry.isValid())
+    return;
+
+  auto const &lLOD = vLODs[std::min(vLOD, static_cast<uint32_t>(vLODs.size() - 1))];
+
+  if (_state.vertexBuffer != vGeometry.vertexBuffer) {
+    vkCmdBindVertexBuffers(_buf, vPipeline->getVertexBindPoint(), 1, &vGeometry.vertexBuffer, &lOffsets[0]);
+    _state.vertexBuffer = vGeometry.vertexBuffer;
+  }
+
+  if (_state.indexBuffer != vGeometry.indexBuffer) {
+    vkCmdBindIndexBuffer(_buf, vGeometry.indexBuffer, 0, vGeometry.indexType);
+    _state.indexBuffer = vGeometry.indexBuffer;
+  }
+
+  vkCmdDrawIndexed(_buf, lLOD.indexCount, 1, vGeometry.firstIndex + lLOD.firstIndex, vGeometry.vertexOffset, 1);
+}
+
+/*!
+ * \brief Selects the coarsest LOD whose error is below the LOD threshold on screen
+ *
+ * The bounding sphere of the mesh is projected with the scene projection matrix. The LOD error
+ * (relative to the mesh extent) times the projected diameter is the error in pixels.
+ *
+ * Called every frame by updateUniforms(). A new LOD changes the record version of the object
+ * (getRecordVersion()), so that the renderers record the object again.
+ */
+uint32_t rSimpleMesh::selectLOD() {
+  if (vLODs.size() <= 1 || vLODThreshold <= 0.0f || !vLocalAABB.isValid())
+    return 0;
+
+  std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
+
+  mat4 *lProj = getProjectionMatrix();
+  mat4 *lView = getViewMatrix();
+  if (!lProj || !lView)
+    return 0;
+
+  rAABB lWorld  = vLocalAABB.transform(*getModelMatrix());
+  float lRadius = length(lWorld.extent());
+  float lDist   = -(*lView * vec4(lWorld.center(), 1.0f)).z - lRadius;
+
+  // Camera inside the bounding sphere
+  if (lDist <= 0.0f)
+    return 0;
+
+  // 2 * r * P[1][1] / d is the diameter in NDC, the NDC range is 2
+  float lDiameterPx = lRadius * (*lProj)[1][1] * static_cast<float>(GlobConf.win.height) / lDist;
+
+  for (uint32_t i = static_cast<uint32_t>(vLODs.size()) - 1; i > 0; --i)
+    if (vLODs[i].error * lDiameterPx <= vLODThreshold)
+      return i;
+
+  return 0;
 }
 
 /*!
@@ -73,36 +150,77 @@ std::vector<vkuBuffer *> rSimpleMesh::setData_IMPL(vkuCommandBuffer &
                                                    const std::vector<float> &   _data) {
   iLOG("Initializing simple mesh object ", vName_str);
 
-  vIndexCount = static_cast<uint32_t>(_index.size());
+  // All LODs share the vertex data and live in one index buffer
+  std::vector<uint32_t> lIndex;
+  vLODs = rMeshSimplifier::generateLODs(_data, 3 + 3 + 2, _index, lIndex);
+
+  // The base LOD is already optimized (rObjectBase::setData), the simplified ones are not
+  for (size_t i = 1; i < vLODs.size(); ++i) {
+    auto                  lBegin = lIndex.begin() + vLODs[i].firstIndex;
+    std::vector<uint32_t> lLODIndex(lBegin, lBegin + vLODs[i].indexCount);
+
+    rMeshOptimizer::optimizeVertexCache(lLODIndex, static_cast<uint32_t>(_data.size() / 8));
+    std::copy(lLODIndex.begin(), lLODIndex.end(), lBegin);
+  }
+
+  dLOG("  -- ", vLODs.size(), " LODs (", _index.size() / 3, " -> ", vLODs.back().indexCount / 3, " triangles)");
 
-  vIndex->usage  = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-  vVertex->usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  if (!vArena) {
+    eLOG("No geometry arena! Objects must be initialized with rSceneBase::initObject");
+    return {};
+  }
 
-  vIndex.init(_index.size() * sizeof(uint32_t));
-  vVertex.init(_data.size() * sizeof(float));
+  // The LODs are generated from the float data, so compression happens afterwards
+  std::vector<uint16_t>                  lIndex16;
+  std::vector<rVertexPacker::PackedPNUV> lPacked;
+  void const *                           lIndexPtr  = lIndex.data();
+  void const *                           lVertexPtr = _data.data();
+  uint32_t                               lStride    = (3 + 3 + 2) * sizeof(float);
+  VkIndexType                            lIndexType = VK_INDEX_TYPE_UINT32;
 
-  {
-    auto lIndAccess  = vIndex.getBufferAccess();
-    auto lVertAccess = vVertex.getBufferAccess();
+  vDequantize = mat4(1.0f);
 
-    if (!lIndAccess || !lVertAccess) {
-      eLOG(L"Failed to bind vulkan memory");
-      return {};
+  if (vCompressed) {
+    if (_data.size() / 8 <= UINT16_MAX && rVertexPacker::packIndex16(lIndex, lIndex16)) {
+      lIndexType = VK_INDEX_TYPE_UINT16;
+      lIndexPtr  = lIndex16.data();
     }
 
-    memcpy(*lIndAccess, _index.data(), vIndex.size());
-    memcpy(*lVertAccess, _data.data(), vVertex.size());
+    vDequantize = rVertexPacker::packPNUV(_data, vLocalAABB, lPacked);
+    lVertexPtr  = lPacked.data();
+    lStride     = sizeof(rVertexPacker::PackedPNUV);
   }
 
-  vIndex.cmdSync(_buf);
-  vVertex.cmdSync(_buf);
+  vGeometry = vArena->allocate(_buf,
+                               getDataLayout(),
+                               lStride,
+                               lVertexPtr,
+                               static_cast<uint32_t>(_data.size() / 8),
+                               lIndexType,
+                               lIndexPtr,
+                               static_cast<uint32_t>(lIndex.size()));
+
+  if (!vGeometry.isValid()) {
+    eLOG("Failed to allocate geometry for ", vName_str);
+    return {};
+  }
+
+  if (vCompressed)
+    dLOG("  -- compressed: ",
+         lIndex.size() * sizeof(uint32_t) + _data.size() * sizeof(float),
+         " -> ",
+         lIndex.size() * (lIndexType == VK_INDEX_TYPE_UINT16 ? 2 : 4) + lPacked.size() * lStride,
+         " bytes");
 
-  return {&vIndex, &vVertex};
+  // Everything is uploaded by the arena
+  return {};
 }
 
 void rSimpleMesh::destroy_IMPL() {
-  vIndex.destroy();
-  vVertex.destroy();
+  if (vArena)
+    vArena->free(vGeometry);
+
+  vGeometry = rGeometryArena::Allocation();
 }
 
 void rSimpleMesh::signalRenderReset(rRendererBase *) {
@@ -123,14 +241,21 @@ void rSimpleMesh::signalRenderReset(rRendererBase *) {
       vMatrixModelVar_PC = i;
     }
 
-    if (i.guessedRole == rShaderBase::MODEL_VIEW_PROJECTION_MATRIX) {
+    if (i.guessedRole == rShaderBase::DEQUANTIZE_MATRIX) {
+      vHasDequantize_PC = true;
+      vDequantize_PC    = i;
+    }
+
+    if (i.guessedRole == rShaderBase::MODEL_VIEW_PROJECTION_MATRIX && !vHasMVPMatrix_PC) {
       vHasMVPMatrix_PC = true;
       vMatrixMVP_PC    = i;
-      break;
     }
   }
 
   if (!vVertUniform) {
+    if (vCompressed && !vHasDequantize_PC)
+      eLOG("Shader of the compressed mesh ", vName_str, " has no dequantize matrix");
+
     wLOG("No uniform buffers in shader");
     return;
   }
@@ -150,6 +275,12 @@ void rSimpleMesh::signalRenderReset(rRendererBase *) {
       continue;
     }
 
+    if (i.guessedRole == rShaderBase::MODEL_VIEW_MATRIX) {
+      vHasMVMatrix = true;
+      vMatrixMVVar = i;
+      continue;
+    }
+
     if (i.guessedRole == rShaderBase::NORMAL_MATRIX) {
       vHasNormalMatrix = true;
       vMatrixNormal    = i;
@@ -161,8 +292,17 @@ void rSimpleMesh::signalRenderReset(rRendererBase *) {
       vLODBias    = i;
       continue;
     }
+
+    if (i.guessedRole == rShaderBase::DEQUANTIZE_MATRIX) {
+      vHasDequantize = true;
+      vDequantizeVar = i;
+      continue;
+    }
   }
 
+  if (vCompressed && !vHasDequantize && !vHasDequantize_PC)
+    eLOG("Shader of the compressed mesh ", vName_str, " has no dequantize matrix");
+
   for (auto &i : vUniforms) {
     if (i.guessedRole == rShaderBase::TEXTURE_DIFFUSE_COLOR) {
       for (auto &j : vMaterials) {
@@ -173,35 +313,61 @@ void rSimpleMesh::signalRenderReset(rRendererBase *) {
           vTextureVar = i;
         }
       }
+
+      // The UVs were remapped into the atlas of the own material (rObjectBase::setData)
+      if (getMaterialIndex() < vMaterials.size() && vMaterials[getMaterialIndex()].getAtlas()) {
+        vTexture    = vMaterials[getMaterialIndex()].getAtlas();
+        vHasTexture = true;
+        vTextureVar = i;
+      }
     }
   }
 
-  if (vHasTexture) {
-    VkDescriptorSet lSet = vShader->getDescriptorSet(nullptr);
-    if (lSet == VK_NULL_HANDLE) {
-      eLOG(L"Failed to get descriptor set");
-      return;
-    }
+  writeTextureDescriptor();
+}
+
+/*!
+ * \brief Writes the image view and sampler of the texture into the descriptor set of the shader
+ *
+ * The placeholder texture of the scene is used while the texture is not loaded (yet).
+ */
+void rSimpleMesh::writeTextureDescriptor() {
+  if (!vHasTexture || !vShader)
+    return;
 
-    VkDescriptorImageInfo lImageInfo;
-    lImageInfo.sampler     = vTexture->getSampler();
-    lImageInfo.imageView   = vTexture->getImageView();
-    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-    VkWriteDescriptorSet lWriteSet;
-    lWriteSet.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    lWriteSet.pNext            = nullptr;
-    lWriteSet.dstSet           = lSet;
-    lWriteSet.dstBinding       = vTextureVar.binding;
-    lWriteSet.dstArrayElement  = 0;
-    lWriteSet.descriptorCount  = 1;
-    lWriteSet.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    lWriteSet.pImageInfo       = &lImageInfo;
-    lWriteSet.pBufferInfo      = nullptr;
-    lWriteSet.pTexelBufferView = nullptr;
-
-    vkUpdateDescriptorSets(**vDevice, 1, &lWriteSet, 0, nullptr);
+  VkDescriptorSet lSet = vShader->getDescriptorSet(nullptr);
+  if (lSet == VK_NULL_HANDLE) {
+    eLOG(L"Failed to get descriptor set");
+    return;
+  }
+
+  rTexture *lTexture = vTexture;
+  if (lTexture->getImageView() == VK_NULL_HANDLE && getScene())
+    lTexture = getScene()->getPlaceholderTexture();
+
+  if (lTexture->getImageView() == VK_NULL_HANDLE) {
+    wLOG(L"Texture of object ", vName_str, L" not loaded");
+    return;
   }
+
+  VkDescriptorImageInfo lImageInfo;
+  lImageInfo.sampler     = lTexture->getSampler();
+  lImageInfo.imageView   = lTexture->getImageView();
+  lImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkWriteDescriptorSet lWriteSet;
+  lWriteSet.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  lWriteSet.pNext            = nullptr;
+  lWriteSet.dstSet           = lSet;
+  lWriteSet.dstBinding       = vTextureVar.binding;
+  lWriteSet.dstArrayElement  = 0;
+  lWriteSet.descriptorCount  = 1;
+  lWriteSet.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  lWriteSet.pImageInfo       = &lImageInfo;
+  lWriteSet.pBufferInfo      = nullptr;
+  lWriteSet.pTexelBufferView = nullptr;
+
+  vkUpdateDescriptorSets(**vDevice, 1, &lWriteSet, 0, nullptr);
 }
 
 void rSimpleMesh::updateUniforms() {
@@ -210,6 +376,12 @@ void rSimpleMesh::updateUniforms() {
     return;
   }
 
+  uint32_t lLOD = selectLOD();
+  if (lLOD != vLOD) {
+    vLOD = lLOD;
+    signalRecordChanged();
+  }
+
   if (vHasVPMatrix) {
     std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
     vShader->updateUniform(vMatrixVPVar, value_ptr(*getViewProjectionMatrix()));
@@ -225,13 +397,75 @@ void rSimpleMesh::updateUniforms() {
     vShader->updateUniform(vLODBias, &lBias);
   }
 
+  // The model matrices do not contain the dequantization, so normals stay correct with mat3(modelView)
+  if (vHasDequantize)
+    vShader->updateUniform(vDequantizeVar, value_ptr(vDequantize));
+
+  if (vHasMVMatrix) {
+    std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
+    vShader->updateUniform(vMatrixMVVar, value_ptr(*getModelViewMatrix()));
+  }
+
   if (vHasMVPMatrix) {
     std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
     vShader->updateUniform(vMatrixMVPVar, value_ptr(*getModelViewProjectionMatrix()));
   }
 }
 
+/*!
+ * \brief Returns the world space bounds of the mesh
+ * \returns false if no data is loaded
+ */
+bool rSimpleMesh::getWorldAABB(rAABB &_out) {
+  if (!vIsLoaded_B || !vLocalAABB.isValid())
+    return false;
+
+  std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
+  _out = vLocalAABB.transform(*getModelMatrix());
+  return true;
+}
+
+/*!
+ * \brief Returns the data for indirect drawing (always the base LOD)
+ * \returns false if no data is loaded
+ */
+bool rSimpleMesh::getIndirectDrawData(IndirectDrawData &_out) {
+  if (!vIsLoaded_B || vLODs.empty() || !vGeometry.isValid() || !vLocalAABB.isValid())
+    return false;
+
+  _out.geometry            = vGeometry;
+  _out.geometry.firstIndex = vGeometry.firstIndex + vLODs[0].firstIndex;
+  _out.geometry.numIndexes = vLODs[0].indexCount;
+
+  // Compressed positions are in [0, 1] (vDequantize maps them to the local bounds)
+  _out.bounds = vCompressed ? rAABB(vec3(0.0f), vec3(1.0f)) : vLocalAABB;
+
+  std::lock_guard<std::recursive_mutex> lLock(vMatrixAccess);
+  _out.model = *getModelMatrix() * vDequantize;
+  return true;
+}
+
+/*!
+ * \brief Same as getIndirectDrawData, but with the LOD selected by updateUniforms() (drawn by record())
+ *
+ * Depth only passes must draw the same LOD as the main pass, else the depth does not match.
+ */
+bool rSimpleMesh::getDrawData(IndirectDrawData &_out) {
+  if (!getIndirectDrawData(_out))
+    return false;
+
+  if (vLOD < vLODs.size()) {
+    _out.geometry.firstIndex = vGeometry.firstIndex + vLODs[vLOD].firstIndex;
+    _out.geometry.numIndexes = vLODs[vLOD].indexCount;
+  }
+
+  return true;
+}
+
 bool rSimpleMesh::checkIsCompatible(rPipeline *_pipe) {
+  if (vCompressed)
+    return _pipe->checkInputCompatible({{4, sizeof(uint16_t)}, {2, sizeof(int16_t)}, {2, sizeof(uint16_t)}});
+
   return _pipe->checkInputCompatible({{3, sizeof(float)}, {3, sizeof(float)}, {2, sizeof(float)}});
 }
 
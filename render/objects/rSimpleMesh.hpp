@@ -23,18 +23,20 @@
 #include "defines.hpp"
 
 #include "rTexture.hpp"
+#include "rGeometryArena.hpp"
 #include "rMatrixObjectBase.hpp"
 #include "rMatrixSceneBase.hpp"
+#include "rMeshSimplifier.hpp"
 #include "rObjectBase.hpp"
 #include "rShaderBase.hpp"
+#include "rVertexPacker.hpp"
 #include <string>
 
 namespace e_engine {
 
 class rSimpleMesh final : public rMatrixObjectBase<float>, public rObjectBase {
  private:
-  vkuBuffer vIndex;
-  vkuBuffer vVertex;
+  rGeometryArena::Allocation vGeometry;
 
   rShaderBase *                        vShader      = nullptr;
   UNIFORM_BUFFER                       vVertUniform = nullptr;
@@ -42,20 +44,31 @@ class rSimpleMesh final : public rMatrixObjectBase<float>, public rObjectBase {
 
   UNIFORM_VAR             vMatrixMVPVar      = {};
   UNIFORM_VAR             vMatrixVPVar       = {};
+  UNIFORM_VAR             vMatrixMVVar       = {};
   UNIFORM_VAR             vMatrixNormal      = {};
   UNIFORM_VAR             vLODBias           = {};
+  UNIFORM_VAR             vDequantizeVar     = {};
   PUSH_CONSTANT           vMatrixModelVar_PC = {};
   PUSH_CONSTANT           vMatrixMVP_PC      = {};
+  PUSH_CONSTANT           vDequantize_PC     = {};
   bool                    vHasMVPMatrix      = false;
   bool                    vHasVPMatrix       = false;
+  bool                    vHasMVMatrix       = false;
   bool                    vHasMVPMatrix_PC   = false;
   bool                    vHasModelMatrix_PC = false;
   bool                    vHasNormalMatrix   = false;
   bool                    vHasLODBias        = false;
+  bool                    vHasDequantize     = false;
+  bool                    vHasDequantize_PC  = false;
   bool                    vHasTexture        = false;
   rTexture *              vTexture           = nullptr;
   rShaderBase::UniformVar vTextureVar        = {};
-  uint32_t                vIndexCount        = 0;
+  float                   vLODThreshold      = 1.0f;
+  bool                    vCompressed        = false;
+  glm::mat4               vDequantize        = glm::mat4(1.0f); //!< Applied in the shader (dequantize matrix)
+  uint32_t                vLOD               = 0;               //!< Selected by updateUniforms()
+
+  std::vector<rMeshSimplifier::LOD> vLODs;
 
   std::vector<vkuBuffer *> setData_IMPL(vkuCommandBuffer &           _buf,
                                         const std::vector<uint32_t> &_index,
@@ -63,11 +76,16 @@ class rSimpleMesh final : public rMatrixObjectBase<float>, public rObjectBase {
 
   void destroy_IMPL() override;
 
-  VERTEX_DATA_LAYOUT getDataLayout() const override { return POS_NORM_UV; }
+  VERTEX_DATA_LAYOUT getDataLayout() const override { return vCompressed ? POS_NORM_UV_COMPRESSED : POS_NORM_UV; }
   MESH_TYPES         getMeshType() const override { return MESH_3D; }
 
+  void modelMatrixChanged() override { signalTransformChanged(); }
+
+  uint32_t selectLOD();
+  void     writeTextureDescriptor();
+
  public:
-  rSimpleMesh(rMatrixSceneBase<float> *_scene, vkuDevicePTR _device, std::string _name);
+  rSimpleMesh(rMatrixSceneBase<float> *_scene, vkuDevicePTR _device, std::string _name, bool _compressed = false);
 
   ~rSimpleMesh() override { destroy_IMPL(); }
 
@@ -79,12 +97,24 @@ class rSimpleMesh final : public rMatrixObjectBase<float>, public rObjectBase {
   bool isMesh() override { return true; }
   bool supportsPushConstants() override { return vHasModelMatrix_PC || vHasMVPMatrix_PC; }
   void record(VkCommandBuffer _buf) override;
+  void record(VkCommandBuffer _buf, RecordState &_state) override;
   void updateUniforms() override;
   void signalRenderReset(rRendererBase *) override;
+  void signalTexturesChanged() override { writeTextureDescriptor(); }
 
   uint32_t getMatrix(glm::mat4 **_mat, rObjectBase::MATRIX_TYPES _type) override;
   uint32_t getMatrix(glm::mat3 **_mat, rObjectBase::MATRIX_TYPES _type) override;
   bool     checkIsCompatible(rPipeline *_pipe) override;
+  bool     getWorldAABB(rAABB &_out) override;
+  bool     getIndirectDrawData(IndirectDrawData &_out) override;
+  bool     getDrawData(IndirectDrawData &_out) override;
+
+  //! Sets the maximum allowed LOD error in pixels (<= 0 disables LOD selection)
+  void   setLODThreshold(float _pixels) { vLODThreshold = _pixels; }
+  size_t getNumLODs() const { return vLODs.size(); }
+  bool   isCompressed() const { return vCompressed; }
+
+  static std::vector<VkFormat> getCompressedInputFormats() { return rVertexPacker::getPNUVFormats(); }
 };
 } // namespace e_engine
 
@@ -28,7 +28,10 @@ rMaterial::rMaterial(rMaterial &&_old) {
 
   _old.vDevice = nullptr;
 
-  vTextures = std::move(_old.vTextures);
+  vTextures    = std::move(_old.vTextures);
+  vPending     = std::move(_old.vPending);
+  vAtlas       = _old.vAtlas;
+  vUVTransform = _old.vUVTransform;
 }
 
 rMaterial &rMaterial::operator=(rMaterial &&_old) {
@@ -37,25 +40,74 @@ rMaterial &rMaterial::operator=(rMaterial &&_old) {
 
   _old.vDevice = nullptr;
 
-  vTextures = std::move(_old.vTextures);
+  vTextures    = std::move(_old.vTextures);
+  vPending     = std::move(_old.vPending);
+  vAtlas       = _old.vAtlas;
+  vUVTransform = _old.vUVTransform;
   return *this;
 }
 
+/*!
+ * \brief Adds a texture and loads it from _path
+ *
+ * The texture is loaded and uploaded immediately (with _transfer if set). With _defer it is only
+ * configured and the caller loads it together with other textures (takePendingTextures() and
+ * rTexture::initParallel()).
+ */
 VkResult rMaterial::addTexture(std::string    _path,
                                uint32_t       _UVIndex,
                                float          _blend,
                                TextureType    _type,
                                TextureOP      _blendOP,
                                TextureMapping _mapping,
-                               TextureMapMode _mapMode) {
+                               TextureMapMode _mapMode,
+                               vkuTransfer *  _transfer,
+                               uint32_t       _maxExtent,
+                               bool           _defer) {
   vTextures.emplace_back(vDevice);
-  rTexture &lTex = vTextures.back();
-  lTex->UVIndex  = _UVIndex;
-  lTex->blend    = _blend;
-  lTex->type     = _type;
-  lTex->blendOP  = _blendOP;
-  lTex->mapping  = _mapping;
-  lTex->mapMode  = _mapMode;
-
-  return lTex.init(_path);
+  rTexture &lTex  = vTextures.back();
+  lTex->UVIndex   = _UVIndex;
+  lTex->blend     = _blend;
+  lTex->type      = _type;
+  lTex->blendOP   = _blendOP;
+  lTex->mapping   = _mapping;
+  lTex->mapMode   = _mapMode;
+  lTex->maxExtent = _maxExtent;
+
+  if (_defer) {
+    vPending.emplace_back(vTextures.size() - 1, _path);
+    return VK_SUCCESS;
+  }
+
+  return _transfer ? lTex.init(_path, *_transfer) : lTex.init(_path);
+}
+
+/*!
+ * \brief Appends the textures added with _defer (and their files) to _out
+ * \note The pointers are valid until the next addTexture()
+ */
+void rMaterial::takePendingTextures(std::vector<std::pair<rTexture *, std::string>> &_out) {
+  for (auto &i : vPending)
+    _out.emplace_back(&vTextures[i.first], std::move(i.second));
+
+  vPending.clear();
+}
+
+//! \brief Frees the staging data of all textures (after the transfer passed to addTexture is done)
+void rMaterial::finishUploads() {
+  for (auto &i : vTextures)
+    i.finishUpload();
+}
+
+/*!
+ * \brief Samples the textures of the material from a shared atlas instead of vTextures
+ *
+ * The UVs of the object must already be transformed with _UVTransform (see rTextureAtlas).
+ *
+ * \param _atlas       The atlas (rTextureAtlas::Region::texture)
+ * \param _UVTransform UV scale (xy) and offset (zw) of the textures in the atlas
+ */
+void rMaterial::setAtlas(rTexture *_atlas, glm::vec4 _UVTransform) {
+  vAtlas       = _atlas;
+  vUVTransform = _UVTransform;
 }
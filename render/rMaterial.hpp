@@ -20,7 +20,9 @@
 #include "defines.hpp"
 #include "rTexture.hpp"
 #include "vkuDevice.hpp"
+#include <glm/vec4.hpp>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace e_engine {
@@ -62,6 +64,11 @@ class rMaterial final {
 
   std::vector<rTexture> vTextures;
 
+  std::vector<std::pair<size_t, std::string>> vPending; //!< Index in vTextures and file of deferred textures
+
+  rTexture *vAtlas       = nullptr;                            //!< Shared texture that replaces vTextures
+  glm::vec4 vUVTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f); //!< UV scale (xy) and offset (zw) in vAtlas
+
  public:
   rMaterial() = delete;
   rMaterial(vkuDevicePTR _device, std::string _name) : vDevice(_device), vName(_name) {}
@@ -79,9 +86,17 @@ class rMaterial final {
                       TextureType    _type,
                       TextureOP      _blendOP,
                       TextureMapping _mapping,
-                      TextureMapMode _mapMode);
+                      TextureMapMode _mapMode,
+                      vkuTransfer *  _transfer  = nullptr,
+                      uint32_t       _maxExtent = 0,
+                      bool           _defer     = false);
+  void     takePendingTextures(std::vector<std::pair<rTexture *, std::string>> &_out);
+  void     finishUploads();
+  void     setAtlas(rTexture *_atlas, glm::vec4 _UVTransform);
 
   inline std::vector<rTexture> &getTextures() noexcept { return vTextures; }
+  inline rTexture *             getAtlas() const noexcept { return vAtlas; }
+  inline glm::vec4              getUVTransform() const noexcept { return vUVTransform; }
   inline std::string            getName() const noexcept { return vName; }
   inline Config                 getConfig() const noexcept { return cfg; }
   inline Config *               getConfigPTR() noexcept { return &cfg; }
@@ -175,9 +175,12 @@ bool rPipeline::create(VkDevice _device, VkRenderPass _renderPass, uint32_t _sub
 
   //    lDynStates.emplace_back( VK_DYNAMIC_STATE_LINE_WIDTH );
 
-  auto lShaderCreateInfo = vShader->getShaderStageInfo();
-  auto lVertexInfo1      = vShader->getVertexInputBindingDescription();
-  auto lVertexInfo2      = vShader->getVertexInputAttribureDescriptions();
+  auto                                           lShaderCreateInfo = vShader->getShaderStageInfo();
+  VkVertexInputBindingDescription                lVertexInfo1;
+  std::vector<VkVertexInputAttributeDescription> lVertexInfo2;
+
+  if (!getVertexInputDesc(lVertexInfo1, lVertexInfo2))
+    return false;
 
   vVertex.vertexBindingDescriptionCount   = 1;
   vVertex.pVertexBindingDescriptions      = &lVertexInfo1;
@@ -187,6 +190,11 @@ bool rPipeline::create(VkDevice _device, VkRenderPass _renderPass, uint32_t _sub
   vDynamic.dynamicStateCount = static_cast<uint32_t>(lDynStates.size());
   vDynamic.pDynamicStates    = lDynStates.data();
 
+  std::vector<VkPipelineColorBlendAttachmentState> lBlendAttachments(vNumColorAttachments, vBlendAttactch);
+
+  vColorBlend.attachmentCount = vNumColorAttachments;
+  vColorBlend.pAttachments    = lBlendAttachments.data();
+
   VkGraphicsPipelineCreateInfo lInfo = {};
   lInfo.sType                        = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
   lInfo.pNext                        = nullptr;
@@ -261,8 +269,11 @@ bool rPipeline::checkInputCompatible(std::vector<InputDesc> _inputs) {
 
   uint32_t lSum = 0;
 
-  auto lVertexInfo1 = vShader->getVertexInputBindingDescription();
-  auto lVertexInfo2 = vShader->getVertexInputAttribureDescriptions();
+  VkVertexInputBindingDescription                lVertexInfo1;
+  std::vector<VkVertexInputAttributeDescription> lVertexInfo2;
+
+  if (!getVertexInputDesc(lVertexInfo1, lVertexInfo2))
+    return false;
 
   if (_inputs.size() != lVertexInfo2.size())
     return false;
@@ -280,6 +291,69 @@ bool rPipeline::checkInputCompatible(std::vector<InputDesc> _inputs) {
   return true;
 }
 
+/*!
+ * \brief Returns the vertex input description of the shader with the formats from setVertexInputFormats applied
+ *
+ * Offsets and the stride are recalculated from the overridden formats (tightly packed, in location
+ * order).
+ */
+bool rPipeline::getVertexInputDesc(VkVertexInputBindingDescription &               _binding,
+                                   std::vector<VkVertexInputAttributeDescription> &_attributes) {
+  _binding    = vShader->getVertexInputBindingDescription();
+  _attributes = vShader->getVertexInputAttribureDescriptions();
+
+  if (vInputFormats.empty())
+    return true;
+
+  if (vInputFormats.size() != _attributes.size()) {
+    eLOG("Number of vertex input formats (",
+         vInputFormats.size(),
+         ") does not match the shader (",
+         _attributes.size(),
+         ")");
+    return false;
+  }
+
+  _binding.stride = 0;
+
+  for (size_t i = 0; i < _attributes.size(); ++i) {
+    uint32_t lSize = getFormatSize(vInputFormats[i]);
+    if (lSize == 0) {
+      eLOG("Unsupported vertex input format ", uEnum2Str::toStr(vInputFormats[i]));
+      return false;
+    }
+
+    _attributes[i].format = vInputFormats[i];
+    _attributes[i].offset = _binding.stride;
+    _binding.stride += lSize;
+  }
+
+  return true;
+}
+
+//! \returns the size of one element of _format in bytes (0 if unsupported)
+uint32_t rPipeline::getFormatSize(VkFormat _format) {
+  switch (_format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SNORM:
+    case VK_FORMAT_R8G8B8A8_UINT:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_A2B10G10R10_SNORM_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_R32_UINT: return 4;
+    case VK_FORMAT_R16G16B16A16_UNORM:
+    case VK_FORMAT_R16G16B16A16_SNORM:
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+    case VK_FORMAT_R32G32_SFLOAT: return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT: return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT: return 16;
+    default: return 0;
+  }
+}
+
 bool rPipeline::checkUniformCompatible(std::vector<rShaderBase::UNIFORM_ROLE> _uniforms) {
   if (vShader == nullptr) {
     eLOG("Shader not yet set!");
@@ -377,6 +451,25 @@ rPipeline *rPipeline::setDynamicScissors(uint32_t _val) {
   return this;
 }
 
+/*!
+ * \brief Overrides the vertex input formats (one per shader input, in location order)
+ *
+ * Needed for compressed vertex data, where the shader reads i.e. a vec4 from a
+ * VK_FORMAT_R16G16B16A16_UNORM attribute. An empty list restores the formats derived from the shader.
+ */
+rPipeline *rPipeline::setVertexInputFormats(std::vector<VkFormat> _formats) {
+  vInputFormats = _formats;
+  return this;
+}
+
+/*!
+ * \brief Sets the number of color attachments of the subpass (i.e. the G-buffer of a deferred renderer)
+ */
+rPipeline *rPipeline::setNumColorAttachments(uint32_t _val) {
+  vNumColorAttachments = _val;
+  return this;
+}
+
 rPipeline *rPipeline::setPolygonMode(VkPolygonMode _val) {
   vRasterization.polygonMode = _val;
   return this;
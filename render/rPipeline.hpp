@@ -48,6 +48,8 @@ class rWorld;
  *   depthBias               | OFF
  *   depthBoundTest          | OFF
  *   stencilTest             | OFF
+ *   Vertex input formats    | derived from the shader input types
+ *   Color attachments       | 1 (all with the same blend state)
  *
  * \todo Blending
  * \todo Better multi-sample control
@@ -73,8 +75,17 @@ class rPipeline {
   VkPipelineColorBlendStateCreateInfo    vColorBlend    = {};
   VkPipelineDynamicStateCreateInfo       vDynamic       = {};
 
+  std::vector<VkFormat> vInputFormats;
+
+  uint32_t vNumColorAttachments = 1;
+
   bool vIsCreated = false;
 
+  bool getVertexInputDesc(VkVertexInputBindingDescription &               _binding,
+                          std::vector<VkVertexInputAttributeDescription> &_attributes);
+
+  static uint32_t getFormatSize(VkFormat _format);
+
  public:
   rPipeline();
   rPipeline(const rPipeline &_obj) = delete;
@@ -108,6 +119,8 @@ class rPipeline {
   rPipeline *disableDepthBias();
   rPipeline *enableStencilTest();
   rPipeline *disableStencilTest();
+  rPipeline *setVertexInputFormats(std::vector<VkFormat> _formats = {});
+  rPipeline *setNumColorAttachments(uint32_t _val = 1);
 
   bool create(VkDevice _device, VkRenderPass _renderPass, uint32_t _subPass, VkPipelineCache _cache = VK_NULL_HANDLE);
 
@@ -23,6 +23,7 @@
 #include "rRenderLoop.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include "vkuBarriers.hpp"
 #include "vkuCommandPoolManager.hpp"
 #include "vkuFence.hpp"
 #include "vkuImageBuffer.hpp"
@@ -53,12 +54,14 @@ struct PresentImageLayoutChange {
     VkImageMemoryBarrier barrier;
   };
 
-  std::array<Info, 2>  infos;
-  VkPipelineStageFlags lSubmitWaitFlags = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT | VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  std::array<Info, 2> infos;
+
+  //! The acquire barrier starts at this stage (vkuBarriers maps PRESENT_SRC_KHR to it)
+  VkPipelineStageFlags lSubmitWaitFlags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 };
 
-enum class Semaphores : uint32_t { ACQUIRE = 0, PRESENT, NUM };
-enum class Fences : uint32_t { RENDER = 0, IMG1, IMG2, NUM };
+enum class Semaphores : uint32_t { ACQUIRE = 0, PRESENT, COMPUTE, NUM };
+enum class Fences : uint32_t { RENDER = 0, IMG1, IMG2, COMPUTE, NUM };
 
 typedef vkuSemaphores<static_cast<uint32_t>(Semaphores::NUM)> LoopSemaphores;
 typedef vkuFences<static_cast<uint32_t>(Fences::NUM)>         LoopFences;
@@ -81,6 +84,13 @@ rRenderLoop::rRenderLoop(vkuDevicePTR  _device,
   vUpdatePushConstantsCB = _updatePC;
   vQueue                 = vDevice->getQueue(VK_QUEUE_GRAPHICS_BIT, 1.0, &vQueueIndex);
   vPresentQueue          = vDevice->getQueue(0, 0.25, &vPresentQueueIndex, true);
+  vComputeQueue          = vDevice->getComputeQueue(1.0, &vComputeQueueIndex);
+
+  if (!vComputeQueue) {
+    wLOG(L"No compute queue found ==> submitting compute work to the graphics queue");
+    vComputeQueue      = vQueue;
+    vComputeQueueIndex = vQueueIndex;
+  }
 }
 
 rRenderLoop::~rRenderLoop() {
@@ -124,14 +134,20 @@ std::vector<PresentImageLayoutChange> rebuildPresentInfo(vkuCommandPool *_pool,
                                                                   _renderQueue,
                                                                   _presetnQueue);
 
-    VkPipelineStageFlags lFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    vkuBarriers lBarriers;
 
     acquire.cmdBuffer.begin();
-    vkCmdPipelineBarrier(*acquire.cmdBuffer, lFlags, lFlags, 0, 0, nullptr, 0, nullptr, 1, &acquire.barrier);
+    lBarriers.addImage(acquire.barrier,
+                       vkuBarriers::getLayoutSrcStages(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR),
+                       vkuBarriers::getLayoutDstStages(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+    lBarriers.cmdRecord(*acquire.cmdBuffer);
     acquire.cmdBuffer.end();
 
     present.cmdBuffer.begin();
-    vkCmdPipelineBarrier(*present.cmdBuffer, lFlags, lFlags, 0, 0, nullptr, 0, nullptr, 1, &present.barrier);
+    lBarriers.addImage(present.barrier,
+                       vkuBarriers::getLayoutSrcStages(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL),
+                       vkuBarriers::getLayoutDstStages(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+    lBarriers.cmdRecord(*present.cmdBuffer);
     present.cmdBuffer.end();
 
     acquire.submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -158,6 +174,31 @@ std::vector<PresentImageLayoutChange> rebuildPresentInfo(vkuCommandPool *_pool,
   return lPresentInfo;
 }
 
+/*!
+ * \brief Makes the first compute consumer of _frame (computeWait) also wait for _semaphore
+ * \returns the submit infos to use for the render submit (_frame.inf if nothing waits for compute)
+ */
+VkSubmitInfo *rRenderLoop::addComputeWait(internal::SubmitInfos::Infos &_frame, VkSemaphore _semaphore) {
+  if (_frame.compute.empty() || _frame.computeWait >= _frame.inf.size())
+    return _frame.inf.data();
+
+  VkSubmitInfo const &lConsumer = _frame.inf[_frame.computeWait];
+
+  vComputeWait.assign(lConsumer.pWaitSemaphores, lConsumer.pWaitSemaphores + lConsumer.waitSemaphoreCount);
+  vComputeWaitDst.assign(lConsumer.pWaitDstStageMask, lConsumer.pWaitDstStageMask + lConsumer.waitSemaphoreCount);
+  vComputeWait.push_back(_semaphore);
+  vComputeWaitDst.push_back(cfg.computeWaitStages);
+
+  vRenderSubmit = _frame.inf;
+
+  VkSubmitInfo &lInfo      = vRenderSubmit[_frame.computeWait];
+  lInfo.waitSemaphoreCount = static_cast<uint32_t>(vComputeWait.size());
+  lInfo.pWaitSemaphores    = vComputeWait.data();
+  lInfo.pWaitDstStageMask  = vComputeWaitDst.data();
+
+  return vRenderSubmit.data();
+}
+
 void rRenderLoop::renderLoop() {
   LOG.nameThread(L"RLoop");
   iLOG("Starting render thread");
@@ -206,6 +247,13 @@ void rRenderLoop::renderLoop() {
     lPresentInfo.pImageIndices      = nullptr; // set in render loop
     lPresentInfo.pResults           = nullptr;
 
+    // Signals the compute semaphore after all compute submits of a frame
+    VkSubmitInfo lComputeSignal         = {};
+    lComputeSignal.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    lComputeSignal.pNext                = nullptr;
+    lComputeSignal.signalSemaphoreCount = 1;
+    lComputeSignal.pSignalSemaphores    = &lSemaphores[static_cast<uint32_t>(Semaphores::COMPUTE)];
+
     //   ______               _             _
     //   | ___ \             | |           | |
     //   | |_/ /___ _ __   __| | ___ _ __  | |     ___   ___  _ __
@@ -255,6 +303,30 @@ void rRenderLoop::renderLoop() {
 
 
       // Render everything here
+      auto &lFrame = vSubmitInfos.frames[*lNextImg];
+
+      // Compute work runs on the compute queue in parallel to the graphics work before its first consumer.
+      // Without compute work nothing is submitted and the COMPUTE fence is not waited on.
+      bool lHasCompute = !lFrame.compute.empty();
+      if (lHasCompute) {
+        std::lock_guard<std::mutex> lLock(vDevice->getQueueMutex(vComputeQueue));
+
+        uint32_t lNumCompute = static_cast<uint32_t>(lFrame.compute.size());
+        bool     lSignal     = lFrame.computeWait < lFrame.inf.size();
+        VkFence  lFence      = lFences[static_cast<uint32_t>(Fences::COMPUTE)];
+
+        auto lRes = vkQueueSubmit(vComputeQueue, lNumCompute, lFrame.compute.data(), lSignal ? VK_NULL_HANDLE : lFence);
+        if (!lRes && lSignal)
+          lRes = vkQueueSubmit(vComputeQueue, 1, &lComputeSignal, lFence);
+
+        if (lRes) {
+          eLOG("'vkQueueSubmit' (compute) returned ", uEnum2Str::toStr(lRes));
+          break;
+        }
+      }
+
+      // Uploads (vkuTransfer) may submit to the same queue from other threads
+      std::unique_lock<std::mutex> lQueueLock(vDevice->getQueueMutex(vQueue));
 
       // VK_IMAGE_LAYOUT_PRESENT_SRC_KHR  -->  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
       auto lRes = vkQueueSubmit(vQueue, 1, &lLayoutAcquire.submitInfo, lFences[static_cast<uint32_t>(Fences::IMG1)]);
@@ -264,8 +336,8 @@ void rRenderLoop::renderLoop() {
       }
 
       // Render
-      uint32_t      lNumSubmitInfo = static_cast<uint32_t>(vSubmitInfos.frames[*lNextImg].inf.size());
-      VkSubmitInfo *lSubmitInfo    = vSubmitInfos.frames[*lNextImg].inf.data();
+      uint32_t      lNumSubmitInfo = static_cast<uint32_t>(lFrame.inf.size());
+      VkSubmitInfo *lSubmitInfo    = addComputeWait(lFrame, lSemaphores[static_cast<uint32_t>(Semaphores::COMPUTE)]);
       lRes = vkQueueSubmit(vQueue, lNumSubmitInfo, lSubmitInfo, lFences[static_cast<uint32_t>(Fences::RENDER)]);
       if (lRes) {
         eLOG("'vkQueueSubmit' returned ", uEnum2Str::toStr(lRes));
@@ -286,15 +358,20 @@ void rRenderLoop::renderLoop() {
 
       lPresentInfo.pSwapchains   = &lTempSc;
       lPresentInfo.pImageIndices = &lImgIndex;
-      lRes                       = vkQueuePresentKHR(vPresentQueue, &lPresentInfo);
+
+      lQueueLock.unlock();
+      {
+        std::lock_guard<std::mutex> lPresentLock(vDevice->getQueueMutex(vPresentQueue));
+        lRes = vkQueuePresentKHR(vPresentQueue, &lPresentInfo);
+      }
       if (lRes) {
         eLOG("'vkQueuePresentKHR' returned ", uEnum2Str::toStr(lRes));
         //         break;
       }
 
 
-      // Wait until rendering is done
-      lFences(0, static_cast<uint32_t>(Fences::NUM));
+      // Wait until rendering is done (COMPUTE is the last fence)
+      lFences(0, static_cast<uint32_t>(lHasCompute ? Fences::NUM : Fences::COMPUTE));
       lCmdAccessLock.unlock();
 
       vRenderedFrameCB();
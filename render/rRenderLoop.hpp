@@ -37,6 +37,8 @@ namespace internal {
 struct SubmitInfos {
   struct Infos {
     std::vector<VkSubmitInfo> inf;
+    std::vector<VkSubmitInfo> compute;                   //!< Submitted to the compute queue before inf
+    uint32_t                  computeWait = UINT32_MAX; //!< First element of inf that waits for compute
   };
 
   std::vector<Infos> frames;
@@ -69,8 +71,14 @@ class rRenderLoop {
 
   VkQueue  vQueue             = VK_NULL_HANDLE;
   VkQueue  vPresentQueue      = VK_NULL_HANDLE;
+  VkQueue  vComputeQueue      = VK_NULL_HANDLE;
   uint32_t vQueueIndex        = 0;
   uint32_t vPresentQueueIndex = 0;
+  uint32_t vComputeQueueIndex = 0;
+
+  std::vector<VkSubmitInfo>         vRenderSubmit;   //!< Render submit infos with the compute wait added
+  std::vector<VkSemaphore>          vComputeWait;    //!< Wait semaphores of the compute consumer
+  std::vector<VkPipelineStageFlags> vComputeWaitDst; //!< Wait stages of the compute consumer
 
   std::thread vRenderThread;
 
@@ -86,9 +94,16 @@ class rRenderLoop {
 
   struct Config {
     std::chrono::milliseconds condWaitTimeout = std::chrono::milliseconds(100);
+
+    //! Stages of the first compute consumer that wait for the compute submits of the frame
+    VkPipelineStageFlags computeWaitStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
   } cfg;
 
-  void renderLoop();
+  void          renderLoop();
+  VkSubmitInfo *addComputeWait(internal::SubmitInfos::Infos &_frame, VkSemaphore _semaphore);
 
  public:
   rRenderLoop() = delete;
@@ -105,6 +120,8 @@ class rRenderLoop {
 
   uint64_t *      getRenderedFramesPtr();
   inline uint32_t getQueueFamilyIndex() const noexcept { return vQueueIndex; }
+  inline uint32_t getComputeQueueFamilyIndex() const noexcept { return vComputeQueueIndex; }
+  inline bool     getHasAsyncCompute() const noexcept { return vComputeQueueIndex != vQueueIndex; }
 
   internal::SubmitInfos *      getCommandBufferReferences() noexcept;
   std::unique_lock<std::mutex> getRenderLoopLock() noexcept;
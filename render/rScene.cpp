@@ -20,9 +20,10 @@
 #include "rScene.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
-#include "vkuCommandPoolManager.hpp"
-#include "vkuFence.hpp"
 #include "iInit.hpp"
+#include "rLightRenderBase.hpp"
+#include "rTextureAtlas.hpp"
+#include "rTextureStreamer.hpp"
 #include "rWorld.hpp"
 #include <assimp/postprocess.h>
 
@@ -37,13 +38,42 @@ namespace fs = std::filesystem;
 namespace e_engine {
 
 
-rSceneBase::~rSceneBase() {}
+rSceneBase::~rSceneBase() {
+  {
+    std::lock_guard<std::mutex> lLock(vLoad_MUT);
+    vLoadStop = true;
+  }
+
+  vLoadCond.notify_all();
+
+  if (vLoader.joinable())
+    vLoader.join();
+
+  for (auto &i : vLoadRequests) {
+    i.visible.set_value(false);
+    i.loaded.set_value(false);
+  }
+
+  if (!vStreamer)
+    return;
+
+  for (auto &i : vObjects)
+    vStreamer->removeObject(i.get());
+}
 
 /*!
  * \brief Constructor
  * \note The pointer _world must be valid over the lifetime of the object!
  */
-rSceneBase::rSceneBase(std::string _name, rWorld *_world) : vWorldPtr(_world), vName_str(_name) {}
+rSceneBase::rSceneBase(std::string _name, rWorld *_world)
+    : vWorldPtr(_world),
+      vGeometry(_world->getDevice()),
+      vLights(_world->getDevice()),
+      vName_str(_name),
+      vInitTransfer(_world->getDevice()),
+      vPlaceholder(_world->getDevice()) {
+  vGeometry.setQueueFamilies({vInitTransfer.getTransferQueueFamily(), vInitTransfer.getDstQueueFamily()});
+}
 
 /*!
  * \brief Tests if it is safe to render the scene
@@ -86,6 +116,8 @@ bool rSceneBase::canRenderScene() {
  * \returns A vector of mesh names
  */
 std::vector<rSceneBase::MeshInfo> rSceneBase::loadFile(std::string _file) {
+  waitForLoader(); // The queued objects use the meshes of the current file
+
   std::lock_guard<std::recursive_mutex> lGuard(vObjectsInit_MUT);
 
   vImporter_assimp.FreeScene();
@@ -94,7 +126,7 @@ std::vector<rSceneBase::MeshInfo> rSceneBase::loadFile(std::string _file) {
       aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals |
           aiProcess_JoinIdenticalVertices | aiProcess_SortByPType | aiProcess_RemoveRedundantMaterials |
           aiProcess_GenUVCoords | aiProcess_FindDegenerates | aiProcess_FindInvalidData | aiProcess_FixInfacingNormals |
-          aiProcess_ImproveCacheLocality | aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph);
+          aiProcess_OptimizeMeshes | aiProcess_OptimizeGraph);
 
   fs::path lTempPath(_file);
   vLoadedFilePath = lTempPath.parent_path().string();
@@ -111,6 +143,17 @@ std::vector<rSceneBase::MeshInfo> rSceneBase::loadFile(std::string _file) {
     return {};
   }
 
+  if (vAtlas) {
+    std::vector<std::string> lPaths;
+    std::string              lPath;
+    for (uint32_t i = 0; i < vScene_assimp->mNumMeshes; i++)
+      if (rTextureAtlas::getPackablePath(vScene_assimp, i, vLoadedFilePath, lPath))
+        lPaths.push_back(lPath);
+
+    if (vAtlas->addTextures(lPaths) != VK_SUCCESS)
+      wLOG("Failed to pack the textures of ", _file, " into atlases");
+  }
+
   std::vector<MeshInfo> lInfos;
   MeshInfo              lTempInfo;
   for (uint32_t i = 0; i < vScene_assimp->mNumMeshes; i++) {
@@ -150,10 +193,37 @@ aiMesh const *rSceneBase::getAiMesh(uint32_t _objIndex) {
   return vScene_assimp->mMeshes[_objIndex];
 }
 
+/*!
+ * \brief Manages the textures of the objects initialized from now on with _streamer
+ *
+ * The objects only load the texture levels up to rTextureStreamer::Config::residentExtent and are
+ * registered in endInitObject(). They are removed from _streamer when the scene is destroyed.
+ *
+ * \note _streamer must outlive the scene
+ */
+void rSceneBase::setTextureStreamer(rTextureStreamer *_streamer) {
+  std::lock_guard<std::recursive_mutex> lGuard(vObjectsInit_MUT);
+  vStreamer = _streamer;
+}
+
+/*!
+ * \brief Packs the small textures of the files loaded from now on into _atlas
+ *
+ * loadFile() adds the textures that can be packed (rTextureAtlas::getPackablePath) to _atlas and the
+ * objects initialized afterwards sample them from the atlas with remapped UVs.
+ *
+ * \note _atlas must outlive the objects of the scene
+ */
+void rSceneBase::setTextureAtlas(rTextureAtlas *_atlas) {
+  std::lock_guard<std::recursive_mutex> lGuard(vObjectsInit_MUT);
+  vAtlas = _atlas;
+}
+
 /*!
  * \brief Objects can be initialized after calling this function
  *
- * Sets up internal command buffers and queues, needed to initialize objects
+ * Sets up internal command buffers and queues, needed to initialize objects. The uploads run on the
+ * transfer queue family (vkuDevice::getTransferQueueFamily) when the device has a dedicated one.
  *
  * \note calling this function will lock initializing for other threads, because only one thread can
  * \note initialize objects per scene
@@ -166,15 +236,7 @@ bool rSceneBase::beginInitObject() {
   }
   vObjectsInit_MUT.lock();
 
-  uint32_t lQueueFamily;
-
-  auto lDevice = vWorldPtr->getDevice();
-
-  vInitQueue_vk = lDevice->getQueue(VK_QUEUE_TRANSFER_BIT, 0.25f, &lQueueFamily);
-  vInitBuff_vk  = vkuCommandPoolManager::getBuffer(**lDevice, lQueueFamily);
-
-  if (vInitBuff_vk.begin() != VK_SUCCESS) {
-    vInitBuff_vk.destroy();
+  if (vInitTransfer.begin() != VK_SUCCESS) {
     vObjectsInit_MUT.unlock();
     return false;
   }
@@ -197,7 +259,8 @@ bool rSceneBase::initObject(std::shared_ptr<rObjectBase> _obj, uint32_t _objInde
 
   std::lock_guard<std::recursive_mutex> lGuard(vObjectsInit_MUT);
 
-  _obj->setData(vInitBuff_vk, vScene_assimp, _objIndex, vLoadedFilePath);
+  uint32_t lMaxExtent = vStreamer ? vStreamer->getConfig().residentExtent : 0;
+  _obj->setData(vInitTransfer, vScene_assimp, _objIndex, vLoadedFilePath, &vGeometry, lMaxExtent, true, vAtlas);
   vInitObjects.emplace_back(_obj);
   return true;
 }
@@ -205,7 +268,8 @@ bool rSceneBase::initObject(std::shared_ptr<rObjectBase> _obj, uint32_t _objInde
 /*!
  * \brief Finishes initializing all previously recorded objects
  *
- * Submits internal vulkan command buffer
+ * Loads the textures of all objects in parallel (rTexture::initParallel), submits internal vulkan
+ * command buffer and hands the geometry over to the graphics queue family
  */
 bool rSceneBase::endInitObject() {
   if (!vInitializingObjects) {
@@ -213,56 +277,216 @@ bool rSceneBase::endInitObject() {
     return false;
   }
 
-  vInitBuff_vk.end();
+  std::vector<std::pair<rTexture *, std::string>> lTextures;
+  for (auto const &i : vInitObjects)
+    i->takePendingTextures(lTextures);
 
-  VkSubmitInfo lInfo         = {};
-  lInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  lInfo.pNext                = nullptr;
-  lInfo.waitSemaphoreCount   = 0;
-  lInfo.pWaitSemaphores      = nullptr;
-  lInfo.pWaitDstStageMask    = nullptr;
-  lInfo.commandBufferCount   = 1;
-  lInfo.pCommandBuffers      = &vInitBuff_vk.get();
-  lInfo.signalSemaphoreCount = 0;
-  lInfo.pSignalSemaphores    = nullptr;
+  if (rTexture::initParallel(lTextures, vInitTransfer) != VK_SUCCESS)
+    wLOG("Failed to load some textures of scene ", vName_str);
 
-  auto lDevice = vWorldPtr->getDevice();
+  BASE_OBJS lObjects;
+  if (!submitInitObjects(lObjects))
+    return false;
 
-  vkuFence_t lFence(**lDevice);
+  if (vStreamer)
+    for (auto const &i : lObjects)
+      vStreamer->addObject(i.get());
 
-  VkResult lRes;
+  return true;
+}
 
-  {
-    std::lock_guard<std::mutex> lLock(lDevice->getQueueMutex(vInitQueue_vk));
-    lRes = vkQueueSubmit(vInitQueue_vk, 1, &lInfo, lFence[0]);
-  }
+/*!
+ * \brief Submits the uploads recorded since beginInitObject() and finishes the objects
+ *
+ * Also uploads the placeholder texture the first time.
+ *
+ * \param[out] _objects The finished objects
+ * \note Ends initializing (vObjectsInit_MUT is unlocked)
+ */
+bool rSceneBase::submitInitObjects(BASE_OBJS &_objects) {
+  if (vPlaceholder.getImageView() == VK_NULL_HANDLE && vPlaceholder.initColor(255, 255, 255, 255, vInitTransfer))
+    wLOG("Failed to create the placeholder texture of scene ", vName_str);
+
+  vGeometry.releaseUploads(vInitTransfer);
+
+  VkResult lRes = vInitTransfer.submit();
+  if (lRes == VK_SUCCESS)
+    lRes = vInitTransfer.wait();
+
+  vGeometry.finishUploads();
+  vPlaceholder.finishUpload();
 
   if (lRes) {
-    eLOG("'vkQueueSubmit' returned ", uEnum2Str::toStr(lRes));
+    eLOG("Failed to upload the objects: ", uEnum2Str::toStr(lRes));
     vInitObjects.clear();
+    vInitializingObjects = false;
     vObjectsInit_MUT.unlock();
     return false;
   }
 
-  lRes = lFence();
-  if (lRes) {
-    eLOG("Failed to wait for fence: ", uEnum2Str::toStr(lRes));
-  }
-
   for (auto i : vInitObjects)
     i->finishData();
 
-  vInitBuff_vk.destroy();
-
+  _objects = std::move(vInitObjects);
   vInitObjects.clear();
   vInitializingObjects = false;
   vObjectsInit_MUT.unlock();
   return true;
 }
 
+/*!
+ * \brief Initializes _obj in a background thread and adds it to the scene (and its renderers)
+ *
+ * The objects are uploaded in batches. An object is rendered as soon as its geometry is uploaded,
+ * with the placeholder texture (getPlaceholderTexture()) until its textures are loaded. The
+ * textures are swapped in with rWorld::updateTextures.
+ *
+ * \param _obj      The object (the pipeline must already be set)
+ * \param _objIndex Index of the mesh in the file loaded with loadFile()
+ * \returns futures that are fulfilled when the object is visible / completely loaded
+ *
+ * \note Do not add _obj with addObject()
+ */
+rSceneBase::LoadHandle rSceneBase::initObjectAsync(std::shared_ptr<rObjectBase> _obj, uint32_t _objIndex) {
+  LoadRequest lRequest;
+  lRequest.object = _obj;
+  lRequest.index  = _objIndex;
+
+  LoadHandle lHandle;
+  lHandle.object  = _obj;
+  lHandle.visible = lRequest.visible.get_future().share();
+  lHandle.loaded  = lRequest.loaded.get_future().share();
+
+  {
+    std::lock_guard<std::mutex> lLock(vLoad_MUT);
+
+    if (!vLoader.joinable())
+      vLoader = std::thread(&rSceneBase::loaderThread, this);
+
+    vLoadRequests.emplace_back(std::move(lRequest));
+  }
+
+  vLoadCond.notify_all();
+  return lHandle;
+}
+
+//! \brief Waits until all objects of initObjectAsync() are completely loaded
+void rSceneBase::waitForLoader() {
+  std::unique_lock<std::mutex> lLock(vLoad_MUT);
+  vLoadCond.wait(lLock, [this]() { return vLoadStop || (vLoadRequests.empty() && !vLoading); });
+}
+
+void rSceneBase::loaderThread() {
+  while (true) {
+    std::vector<LoadRequest> lBatch;
+
+    {
+      std::unique_lock<std::mutex> lLock(vLoad_MUT);
+      vLoadCond.wait(lLock, [this]() { return vLoadStop || !vLoadRequests.empty(); });
+
+      if (vLoadStop)
+        return; // The destructor fails the remaining requests
+
+      while (!vLoadRequests.empty() && lBatch.size() < MAX_LOAD_BATCH) {
+        lBatch.emplace_back(std::move(vLoadRequests.front()));
+        vLoadRequests.pop_front();
+      }
+
+      vLoading = true;
+    }
+
+    loadBatch(lBatch);
+
+    {
+      std::lock_guard<std::mutex> lLock(vLoad_MUT);
+      vLoading = false;
+    }
+
+    vLoadCond.notify_all();
+  }
+}
+
+/*!
+ * \brief Uploads the geometry of _batch, adds the objects to the scene and then loads their textures
+ */
+void rSceneBase::loadBatch(std::vector<LoadRequest> &_batch) {
+  std::lock_guard<std::recursive_mutex> lGuard(vObjectsInit_MUT);
+
+  auto lFail = [&_batch]() {
+    for (auto &i : _batch) {
+      i.visible.set_value(false);
+      i.loaded.set_value(false);
+    }
+  };
+
+  if (!beginInitObject()) {
+    lFail();
+    return;
+  }
+
+  for (auto &i : _batch)
+    initObject(i.object, i.index);
+
+  std::vector<std::pair<rTexture *, std::string>> lTextures;
+  for (auto const &i : vInitObjects)
+    i->takePendingTextures(lTextures);
+
+  BASE_OBJS lObjects;
+  if (!submitInitObjects(lObjects)) {
+    lFail();
+    return;
+  }
+
+  vWorldPtr->addSceneObjects(this, lObjects);
+
+  for (auto &i : _batch)
+    i.visible.set_value(true);
+
+  // The textures are uploaded as streams, so that they can replace the placeholder at once
+  bool     lTexturesOK = true;
+  VkResult lRes        = VK_SUCCESS;
+
+  if (!lTextures.empty()) {
+    lRes = vInitTransfer.begin();
+    if (lRes == VK_SUCCESS) {
+      if (rTexture::initParallel(lTextures, vInitTransfer, true) != VK_SUCCESS) {
+        wLOG("Failed to load some textures of scene ", vName_str);
+        lTexturesOK = false;
+      }
+
+      lRes = vInitTransfer.submit();
+      if (lRes == VK_SUCCESS)
+        lRes = vInitTransfer.wait();
+    }
+  }
+
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to upload the textures: ", uEnum2Str::toStr(lRes));
+    vInitTransfer.wait();
+    lTexturesOK = false;
+
+    for (auto &i : lTextures)
+      i.first->cancelStream();
+  } else if (!lTextures.empty()) {
+    vWorldPtr->updateTextures([&lTextures]() {
+      for (auto &i : lTextures)
+        i.first->commitStream();
+    });
+  }
+
+  if (vStreamer)
+    for (auto const &i : lObjects)
+      vStreamer->addObject(i.get());
+
+  for (auto &i : _batch)
+    i.loaded.set_value(lTexturesOK);
+}
+
 /*!
  * \brief Adds an object to render
  *
+ * Light sources (rLightRenderBase) are also registered in the light manager of the scene.
+ *
  * \todo Implement functions to remove / disable / enable objects
  *
  * \param[in] _obj Pointer to an object
@@ -273,19 +497,166 @@ unsigned rSceneBase::addObject(std::shared_ptr<rObjectBase> _obj) {
   std::lock_guard<std::mutex> lLockObjects(vObjects_MUT);
 
   vObjects.emplace_back(_obj);
+  _obj->setScene(this, static_cast<uint32_t>(vObjects.size() - 1));
+  objectTransformChanged(static_cast<uint32_t>(vObjects.size() - 1));
 
-#if 0
-   int64_t lFlags;
+  if (_obj->getIsStatic())
+    staticGeometryChanged();
 
-   _obj->getHints( rObjectBase::FLAGS, lFlags );
-   if ( lFlags & LIGHT_SOURCE )
-      vLightSourcesIndex.emplace_back( vObjects.size() - 1 );
-#endif
+  auto lLight = std::dynamic_pointer_cast<rLightRenderBase>(_obj);
+  if (lLight)
+    vLights.addLight(lLight);
 
   return static_cast<unsigned>(vObjects.size() - 1);
 }
 
 std::vector<std::shared_ptr<rObjectBase>> rSceneBase::getObjects() { return vObjects; }
+
+
+/*!
+ * \brief Marks the bounds of an object as outdated
+ *
+ * The BVH is refitted lazily (in updateBVH or the next query), so this function is cheap enough to
+ * be called on every transformation change.
+ *
+ * \param[in] _index The index of the object (returned by addObject)
+ */
+void rSceneBase::objectTransformChanged(uint32_t _index) {
+  std::lock_guard<std::mutex> lLock(vBVHDirty_MUT);
+
+  if (_index >= vBVHIsDirty.size())
+    vBVHIsDirty.resize(_index + 1, false);
+
+  if (vBVHIsDirty[_index])
+    return;
+
+  vBVHIsDirty[_index] = true;
+  vBVHDirty.emplace_back(_index);
+}
+
+/*!
+ * \brief Refits the BVH for all objects that changed since the last update
+ */
+void rSceneBase::updateBVH() {
+  std::lock_guard<std::mutex> lLock(vBVH_MUT);
+  updateBVH_IMPL();
+}
+
+//! \note vBVH_MUT must be locked
+void rSceneBase::updateBVH_IMPL() {
+  std::vector<uint32_t> lDirty;
+
+  {
+    std::lock_guard<std::mutex> lLock(vBVHDirty_MUT);
+    lDirty.swap(vBVHDirty);
+    for (auto i : lDirty)
+      vBVHIsDirty[i] = false;
+  }
+
+  if (lDirty.empty())
+    return;
+
+  BASE_OBJS lObjects;
+  lObjects.reserve(lDirty.size());
+
+  {
+    std::lock_guard<std::mutex> lLock(vObjects_MUT);
+    for (auto i : lDirty)
+      lObjects.emplace_back(vObjects[i]);
+
+    if (vBVHProxies.size() < vObjects.size())
+      vBVHProxies.resize(vObjects.size(), rBVH::NULL_NODE);
+  }
+
+  rAABB lBox;
+  for (size_t i = 0; i < lDirty.size(); ++i) {
+    uint32_t &lProxy = vBVHProxies[lDirty[i]];
+
+    if (!lObjects[i]->getWorldAABB(lBox)) {
+      // Not (yet) loaded or no bounds at all
+      if (lProxy != rBVH::NULL_NODE) {
+        vBVH.remove(lProxy);
+        lProxy = rBVH::NULL_NODE;
+      }
+
+      continue;
+    }
+
+    if (lProxy == rBVH::NULL_NODE)
+      lProxy = vBVH.insert(lBox, lDirty[i]);
+    else
+      vBVH.update(lProxy, lBox);
+  }
+}
+
+rSceneBase::BASE_OBJS rSceneBase::indexesToObjects(std::vector<uint32_t> const &_indexes) {
+  BASE_OBJS lRes;
+  lRes.reserve(_indexes.size());
+
+  std::lock_guard<std::mutex> lLock(vObjects_MUT);
+  for (auto i : _indexes)
+    lRes.emplace_back(vObjects[i]);
+
+  return lRes;
+}
+
+/*!
+ * \brief Returns all objects whose bounds are (partially) inside the frustum of _viewProj
+ */
+rSceneBase::BASE_OBJS rSceneBase::queryFrustum(glm::mat4 const &_viewProj) {
+  std::vector<uint32_t> lIndexes;
+
+  {
+    std::lock_guard<std::mutex> lLock(vBVH_MUT);
+    updateBVH_IMPL();
+    vBVH.queryFrustum(rFrustum(_viewProj), lIndexes);
+  }
+
+  return indexesToObjects(lIndexes);
+}
+
+/*!
+ * \brief Returns all objects whose bounds overlap _box
+ */
+rSceneBase::BASE_OBJS rSceneBase::queryOverlap(rAABB const &_box) {
+  std::vector<uint32_t> lIndexes;
+
+  {
+    std::lock_guard<std::mutex> lLock(vBVH_MUT);
+    updateBVH_IMPL();
+    vBVH.queryOverlap(_box, lIndexes);
+  }
+
+  return indexesToObjects(lIndexes);
+}
+
+/*!
+ * \brief Returns the first object hit by _ray
+ * \param[in]  _ray      The ray
+ * \param[in]  _tMax     Maximum distance in units of the ray direction
+ * \param[out] _distance The hit distance in units of the ray direction (optional)
+ * \returns the object or nullptr if nothing was hit
+ */
+std::shared_ptr<rObjectBase> rSceneBase::queryRay(rRay const &_ray, float _tMax, float *_distance) {
+  uint32_t lIndex;
+  float    lT;
+  bool     lHit;
+
+  {
+    std::lock_guard<std::mutex> lLock(vBVH_MUT);
+    updateBVH_IMPL();
+    lHit = vBVH.queryRayClosest(_ray, _tMax, lIndex, lT);
+  }
+
+  if (!lHit)
+    return nullptr;
+
+  if (_distance)
+    *_distance = lT;
+
+  std::lock_guard<std::mutex> lLock(vObjects_MUT);
+  return vObjects[lIndex];
+}
 } // namespace e_engine
 
 // kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -21,9 +21,21 @@
 
 #include "defines.hpp"
 
-#include "vkuCommandPoolManager.hpp"
+#include "uConfig.hpp"
+#include "iEventInfo.hpp"
+#include "vkuTransfer.hpp"
+#include "rAABB.hpp"
+#include "rBVH.hpp"
+#include "rGeometryArena.hpp"
+#include "rLightManager.hpp"
 #include "rMatrixSceneBase.hpp"
 #include "rObjectBase.hpp"
+#include "rTexture.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -37,6 +49,8 @@
 namespace e_engine {
 
 class rWorld;
+class rTextureAtlas;
+class rTextureStreamer;
 
 /*!
  * \brief Contains Objects and other data for a scene
@@ -55,12 +69,29 @@ class rSceneBase {
   using OBJECTS   = std::vector<std::shared_ptr<T>>;
   using BASE_OBJS = OBJECTS<rObjectBase>;
 
+  //! Progress of an object loaded with initObjectAsync()
+  struct LoadHandle {
+    std::shared_ptr<rObjectBase> object;
+    std::shared_future<bool>     visible; //!< The geometry is uploaded and the object is rendered
+    std::shared_future<bool>     loaded;  //!< The textures are loaded too (false if one failed)
+  };
+
  private:
+  struct LoadRequest {
+    std::shared_ptr<rObjectBase> object;
+    uint32_t                     index;
+    std::promise<bool>           visible;
+    std::promise<bool>           loaded;
+  };
+
+  static const size_t MAX_LOAD_BATCH = 16; //!< Objects the loader thread uploads together
+
   rWorld *vWorldPtr;
 
-  BASE_OBJS vObjects;
+  rGeometryArena vGeometry; //!< Declared before the objects, so that it outlives them
+  rLightManager  vLights;   //!< All light sources of the scene
 
-  std::vector<size_t> vLightSourcesIndex;
+  BASE_OBJS vObjects;
 
   std::string vName_str;
   std::string vLoadedFilePath;
@@ -68,15 +99,41 @@ class rSceneBase {
   std::mutex           vObjects_MUT;
   std::recursive_mutex vObjectsInit_MUT;
 
-  bool             vInitializingObjects = false;
-  vkuCommandBuffer vInitBuff_vk;
-  VkQueue          vInitQueue_vk;
+  bool        vInitializingObjects = false;
+  vkuTransfer vInitTransfer; //!< Uploads of the objects (on the transfer queue if there is one)
+
+  rTextureStreamer *vStreamer = nullptr; //!< Manages the textures of the objects (optional)
+  rTextureAtlas *   vAtlas    = nullptr; //!< Packs the small textures of the loaded files (optional)
+  rTexture          vPlaceholder;        //!< Rendered while a texture is not loaded (1x1 white)
 
   BASE_OBJS vInitObjects;
 
+  std::thread             vLoader; //!< Started by the first initObjectAsync()
+  std::deque<LoadRequest> vLoadRequests;
+  std::mutex              vLoad_MUT;
+  std::condition_variable vLoadCond;
+  bool                    vLoadStop = false;
+  bool                    vLoading  = false; //!< The loader thread is working on a batch
+
   Assimp::Importer vImporter_assimp;
   aiScene const *  vScene_assimp = nullptr;
 
+  rBVH                  vBVH;
+  std::vector<uint32_t> vBVHProxies;
+  std::vector<uint32_t> vBVHDirty;
+  std::vector<bool>     vBVHIsDirty;
+  std::mutex            vBVH_MUT;
+  std::mutex            vBVHDirty_MUT;
+
+  std::atomic<uint64_t> vStaticVersion{0}; //!< Incremented whenever static geometry changes
+
+  void      updateBVH_IMPL();
+  BASE_OBJS indexesToObjects(std::vector<uint32_t> const &_indexes);
+
+  bool submitInitObjects(BASE_OBJS &_objects);
+  void loaderThread();
+  void loadBatch(std::vector<LoadRequest> &_batch);
+
 
  public:
   rSceneBase() = delete;
@@ -91,19 +148,78 @@ class rSceneBase {
   std::vector<MeshInfo> loadFile(std::string _file);
   aiMesh const *        getAiMesh(uint32_t _objIndex);
 
+  void setTextureStreamer(rTextureStreamer *_streamer);
+  void setTextureAtlas(rTextureAtlas *_atlas);
+
   bool beginInitObject();
   bool initObject(std::shared_ptr<rObjectBase> _obj, uint32_t _objIndex);
   bool endInitObject();
 
-  inline size_t  getNumObjects() { return vObjects.size(); }
-  inline rWorld *getWorldPTR() { return vWorldPtr; }
+  LoadHandle initObjectAsync(std::shared_ptr<rObjectBase> _obj, uint32_t _objIndex);
+  void       waitForLoader();
+
+  void                         objectTransformChanged(uint32_t _index);
+  void                         staticGeometryChanged() { vStaticVersion++; }
+  void                         updateBVH();
+  BASE_OBJS                    queryFrustum(glm::mat4 const &_viewProj);
+  BASE_OBJS                    queryOverlap(rAABB const &_box);
+  std::shared_ptr<rObjectBase> queryRay(rRay const &_ray, float _tMax = 1.0f, float *_distance = nullptr);
+
+  inline size_t            getNumObjects() { return vObjects.size(); }
+  inline uint64_t          getStaticGeometryVersion() const { return vStaticVersion; }
+  inline rWorld *          getWorldPTR() { return vWorldPtr; }
+  inline rGeometryArena *  getGeometryArena() { return &vGeometry; }
+  inline rLightManager *   getLightManager() { return &vLights; }
+  inline rTextureStreamer *getTextureStreamer() { return vStreamer; }
+  inline rTextureAtlas *   getTextureAtlas() { return vAtlas; }
+  inline rTexture *        getPlaceholderTexture() { return &vPlaceholder; }
 };
 
 template <class T>
 class rScene : public rSceneBase, public rMatrixSceneBase<float> {
  public:
   rScene(std::string _name, rWorld *_world) : rSceneBase(_name, _world), rMatrixSceneBase<float>(_world) {}
+
+  BASE_OBJS getVisibleObjects() { return queryFrustum(*getViewProjectionMatrix()); }
+
+  std::shared_ptr<rObjectBase> pickObject(uint32_t _x, uint32_t _y, float *_distance = nullptr);
+  std::shared_ptr<rObjectBase> pickObject(iEventInfo const &_event, float *_distance = nullptr) {
+    return pickObject(_event.iMouse.posX, _event.iMouse.posY, _distance);
+  }
 };
+
+/*!
+ * \brief Returns the closest object under the window coordinates _x, _y
+ *
+ * Casts a ray from the near to the far plane through the pixel and returns the first object whose
+ * bounding box is hit.
+ *
+ * \param[in]  _x        Window x coordinate (e.g. iEventInfo::iMouse.posX)
+ * \param[in]  _y        Window y coordinate (e.g. iEventInfo::iMouse.posY)
+ * \param[out] _distance Distance between the near plane and the hit (optional)
+ * \returns the object or nullptr if nothing was hit
+ */
+template <class T>
+std::shared_ptr<rObjectBase> rScene<T>::pickObject(uint32_t _x, uint32_t _y, float *_distance) {
+  glm::mat4 lInv = glm::inverse(*getViewProjectionMatrix());
+
+  // Vulkan NDC: (-1, -1) is the top left corner, depth range [0, 1]
+  float lX = 2.0f * (static_cast<float>(_x) + 0.5f) / static_cast<float>(GlobConf.win.width) - 1.0f;
+  float lY = 2.0f * (static_cast<float>(_y) + 0.5f) / static_cast<float>(GlobConf.win.height) - 1.0f;
+
+  glm::vec4 lNear = lInv * glm::vec4(lX, lY, 0.0f, 1.0f);
+  glm::vec4 lFar  = lInv * glm::vec4(lX, lY, 1.0f, 1.0f);
+
+  glm::vec3 lOrigin = glm::vec3(lNear) / lNear.w;
+  glm::vec3 lEnd    = glm::vec3(lFar) / lFar.w;
+
+  auto lObj = queryRay(rRay(lOrigin, lEnd - lOrigin), 1.0f, _distance);
+
+  if (lObj && _distance)
+    *_distance *= glm::length(lEnd - lOrigin);
+
+  return lObj;
+}
 } // namespace e_engine
 
 
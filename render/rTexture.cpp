@@ -16,47 +16,348 @@
 
 #include "defines.hpp"
 #include "rTexture.hpp"
+#include "uAsyncIO.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include "uMappedFile.hpp"
+#include "uThreadPool.hpp"
+#include "vkuBarriers.hpp"
 #include "vkuBuffer.hpp"
-#include "vkuCommandPoolManager.hpp"
-#include "vkuFence.hpp"
+#include "vkuTransfer.hpp"
+#include <algorithm>
+#include <future>
 #include <gli/gli.hpp>
+#include <mutex>
+#include <string.h>
 
 using namespace e_engine;
 
+namespace {
+
+const uint8_t cKTXIdentifier[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+//! \brief Header of KTX 1.1 files (after the identifier)
+struct KTXHeader {
+  uint32_t endianness;
+  uint32_t glType;
+  uint32_t glTypeSize;
+  uint32_t glFormat;
+  uint32_t glInternalFormat;
+  uint32_t glBaseInternalFormat;
+  uint32_t pixelWidth;
+  uint32_t pixelHeight;
+  uint32_t pixelDepth;
+  uint32_t numberOfArrayElements;
+  uint32_t numberOfFaces;
+  uint32_t numberOfMipmapLevels;
+  uint32_t bytesOfKeyValueData;
+};
+
+/*!
+ * \brief Converts a gli format into the matching vulkan format
+ *
+ * The values of gli::format are identical to VkFormat for all core vulkan formats (up to the ASTC
+ * formats). The gli formats after that (PVRTC, ATC, ...) have no core vulkan equivalent.
+ *
+ * \returns the vulkan format or VK_FORMAT_UNDEFINED
+ */
+VkFormat toVkFormat(gli::format _format) {
+  auto lRaw = static_cast<uint32_t>(_format);
+  if (lRaw == 0 || lRaw > static_cast<uint32_t>(VK_FORMAT_ASTC_12x12_SRGB_BLOCK))
+    return VK_FORMAT_UNDEFINED;
+
+  return static_cast<VkFormat>(lRaw);
+}
+
+/*!
+ * \brief Returns the alignment of the levels in the staging buffer
+ *
+ * Copies on transfer queues need buffer offsets that are multiples of 4 and of the texel block size.
+ * The core vulkan formats have the same values as the gli formats (toVkFormat).
+ */
+VkDeviceSize levelAlignment(VkFormat _format) {
+  VkDeviceSize lBlock = static_cast<VkDeviceSize>(gli::block_size(static_cast<gli::format>(_format)));
+  return std::max<VkDeviceSize>(lBlock, 4);
+}
+
+/*!
+ * \brief Records the blit chain that generates the levels 1 to _levels - 1 from level 0
+ *
+ * Level 0 must be in TRANSFER_SRC_OPTIMAL, the other levels are undefined. All levels end up in
+ * SHADER_READ_ONLY_OPTIMAL.
+ */
+void cmdGenerateMips(VkCommandBuffer _buf, VkImage _img, uint32_t _width, uint32_t _height, uint32_t _levels) {
+  vkuBarriers lBarriers;
+
+  lBarriers.addImage(_img,
+                     {VK_IMAGE_ASPECT_COLOR_BIT, 1, _levels - 1, 0, 1},
+                     VK_IMAGE_LAYOUT_UNDEFINED,
+                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  lBarriers.cmdRecord(_buf);
+
+  for (uint32_t i = 1; i < _levels; ++i) {
+    VkImageBlit lBlit;
+    lBlit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1};
+    lBlit.srcOffsets[0]  = {0, 0, 0};
+    lBlit.srcOffsets[1]  = {static_cast<int32_t>(std::max(_width >> (i - 1), 1u)),
+                           static_cast<int32_t>(std::max(_height >> (i - 1), 1u)),
+                           1};
+    lBlit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+    lBlit.dstOffsets[0]  = {0, 0, 0};
+    lBlit.dstOffsets[1]  = {static_cast<int32_t>(std::max(_width >> i, 1u)),
+                           static_cast<int32_t>(std::max(_height >> i, 1u)),
+                           1};
+
+    vkCmdBlitImage(_buf,
+                   _img,
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   _img,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   1,
+                   &lBlit,
+                   VK_FILTER_LINEAR);
+
+    // The level is the source of the next blit
+    lBarriers.addImage(_img,
+                       {VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1},
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    lBarriers.cmdRecord(_buf);
+  }
+
+  lBarriers.addImage(_img,
+                     {VK_IMAGE_ASPECT_COLOR_BIT, 0, _levels, 0, 1},
+                     VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  lBarriers.cmdRecord(_buf);
+}
+
+//! \brief Returns the size of the device memory of _img
+VkDeviceSize imageMemorySize(VkDevice _device, VkImage _img) {
+  VkMemoryRequirements lRequirements;
+  vkGetImageMemoryRequirements(_device, _img, &lRequirements);
+  return lRequirements.size;
+}
+
+} // namespace
+
+/*!
+ * \brief The levels of a texture file
+ *
+ * 2D KTX files are parsed in the mapped file (or the buffer of an asynchronous read), so the levels
+ * are only copied once (into the staging buffer). All other files are loaded with gli from memory.
+ */
+struct rTexture::FileData {
+  struct Level {
+    uint8_t const *data;
+    size_t         size;
+    uint32_t       width;
+    uint32_t       height;
+    size_t         rowPitch = 0; //!< Bytes per row in data (0: tightly packed)
+    size_t         rowSize  = 0; //!< Bytes per tightly packed row (only with rowPitch)
+  };
+
+  uMappedFile                     file;
+  uAsyncIO::Buffer                buffer; //!< Data of open(uAsyncIO::Buffer)
+  uint8_t const *                 data = nullptr;
+  size_t                          size = 0;
+  std::unique_ptr<gli::texture2d> tex; //!< Only for files loaded with gli
+  gli::format                     format = gli::FORMAT_UNDEFINED;
+  std::vector<Level>              levels;
+  bool                            ktx = false; //!< The levels point into data (parseKTX())
+
+  bool open(std::string const &_path);
+  bool open(uAsyncIO::Buffer _buffer);
+  bool parse();
+  bool parseKTX();
+};
+
+bool rTexture::FileData::open(std::string const &_path) {
+  if (!file.open(_path))
+    return false;
+
+  data = static_cast<uint8_t const *>(file.data());
+  size = file.size();
+  return parse();
+}
+
+//! \brief Uses the data of an asynchronous read (uAsyncIO)
+bool rTexture::FileData::open(uAsyncIO::Buffer _buffer) {
+  if (!_buffer)
+    return false;
+
+  buffer = std::move(_buffer);
+  data   = reinterpret_cast<uint8_t const *>(buffer->data());
+  size   = buffer->size();
+  return parse();
+}
+
+bool rTexture::FileData::parse() {
+  if (parseKTX())
+    return true;
+
+  tex.reset(new gli::texture2d(gli::load(reinterpret_cast<char const *>(data), size)));
+
+  // gli has its own copy
+  file.close();
+  buffer = nullptr;
+  data   = nullptr;
+  size   = 0;
+
+  if (tex->empty())
+    return false;
+
+  format = tex->format();
+  levels.clear();
+
+  for (size_t i = 0; i < tex->levels(); ++i) {
+    auto lLevel = (*tex)[i];
+    levels.push_back({static_cast<uint8_t const *>(lLevel.data()),
+                      lLevel.size(),
+                      static_cast<uint32_t>(lLevel.extent().x),
+                      static_cast<uint32_t>(lLevel.extent().y)});
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Finds the levels of a KTX file
+ * \returns false if the file is not a 2D KTX file (arrays, cube maps, ... are left to gli)
+ */
+bool rTexture::FileData::parseKTX() {
+  auto const *lData   = data;
+  size_t      lSize   = size;
+  size_t      lOffset = sizeof(cKTXIdentifier) + sizeof(KTXHeader);
+
+  if (lSize < lOffset || memcmp(lData, cKTXIdentifier, sizeof(cKTXIdentifier)) != 0)
+    return false;
+
+  KTXHeader lHeader;
+  memcpy(&lHeader, lData + sizeof(cKTXIdentifier), sizeof(KTXHeader));
+
+  // Files with the other endianness are converted by gli
+  if (lHeader.endianness != 0x04030201 || lHeader.pixelWidth == 0 || lHeader.pixelDepth > 1 ||
+      lHeader.numberOfArrayElements > 0 || lHeader.numberOfFaces != 1 || lHeader.bytesOfKeyValueData > lSize)
+    return false;
+
+  gli::gl lGL(gli::gl::PROFILE_KTX);
+  format = lGL.find(static_cast<gli::gl::internal_format>(lHeader.glInternalFormat),
+                    static_cast<gli::gl::external_format>(lHeader.glFormat),
+                    static_cast<gli::gl::type_format>(lHeader.glType));
+
+  uint32_t lLevels = std::max(lHeader.numberOfMipmapLevels, 1u);
+  uint32_t lHeight = std::max(lHeader.pixelHeight, 1u);
+
+  // The rows of uncompressed levels are padded to 4 bytes (GL_UNPACK_ALIGNMENT), block rows are not.
+  // Unknown formats are rejected by loadFile().
+  bool   lPadded    = format != gli::FORMAT_UNDEFINED && !gli::is_compressed(format);
+  size_t lBlockSize = gli::block_size(format);
+
+  lOffset += lHeader.bytesOfKeyValueData;
+  levels.clear();
+
+  // Every level is: uint32_t imageSize; uint8_t data[imageSize]; padding to 4 bytes
+  for (uint32_t i = 0; i < lLevels; ++i) {
+    uint32_t lImageSize;
+    if (lOffset + sizeof(uint32_t) > lSize)
+      return false;
+
+    memcpy(&lImageSize, lData + lOffset, sizeof(uint32_t));
+    lOffset += sizeof(uint32_t);
+
+    if (lImageSize > lSize - lOffset)
+      return false;
+
+    Level lLevel = {lData + lOffset, lImageSize, std::max(lHeader.pixelWidth >> i, 1u), std::max(lHeight >> i, 1u)};
+
+    if (lPadded) {
+      lLevel.rowSize  = lLevel.width * lBlockSize;
+      lLevel.rowPitch = (lLevel.rowSize + 3) & ~static_cast<size_t>(3);
+
+      if (lLevel.rowPitch * lLevel.height > lImageSize)
+        return false;
+    }
+
+    levels.push_back(lLevel);
+    lOffset += (static_cast<size_t>(lImageSize) + 3) & ~static_cast<size_t>(3);
+  }
+
+  ktx = true;
+  return true;
+}
+
+//! \brief The result of the asynchronous read of rTexture::readLevels (shared with the read callback)
+struct rTexture::StreamRead {
+  std::mutex       mutex;
+  uAsyncIO::Buffer data;
+  bool             done = false;
+};
+
 rTexture::~rTexture() { destroy(); }
 
 rTexture::rTexture(rTexture &&_old) {
-  vDevice  = _old.vDevice;
-  vSampler = _old.vSampler;
-  cfg      = _old.cfg;
+  vDevice     = _old.vDevice;
+  vSampler    = _old.vSampler;
+  vFilePath   = _old.vFilePath;
+  vWidth      = _old.vWidth;
+  vHeight     = _old.vHeight;
+  vNumLevels  = _old.vNumLevels;
+  vBaseLevel  = _old.vBaseLevel;
+  vStreamBase = _old.vStreamBase;
+  vStreamable = _old.vStreamable;
+  vMemorySize = _old.vMemorySize;
+  vFormat     = _old.vFormat;
+  vGenMips    = _old.vGenMips;
+  cfg         = _old.cfg;
+
+  _old.vDevice     = nullptr;
+  _old.vSampler    = VK_NULL_HANDLE;
+  _old.vStreamBase = UINT32_MAX;
 
-  _old.vDevice  = nullptr;
-  _old.vSampler = VK_NULL_HANDLE;
+  vImg       = std::move(_old.vImg);
+  vStreamImg = std::move(_old.vStreamImg);
+  vStaging   = std::move(_old.vStaging);
 
-  vImg = std::move(_old.vImg);
+  vCopyRegions = std::move(_old.vCopyRegions);
+  vFileLevels  = std::move(_old.vFileLevels);
+  vRead        = std::move(_old.vRead);
 }
 
 rTexture &rTexture::operator=(rTexture &&_old) {
   destroy(); // destroy old texture
 
-  vDevice  = _old.vDevice;
-  vSampler = _old.vSampler;
-  cfg      = _old.cfg;
+  vDevice     = _old.vDevice;
+  vSampler    = _old.vSampler;
+  vFilePath   = _old.vFilePath;
+  vWidth      = _old.vWidth;
+  vHeight     = _old.vHeight;
+  vNumLevels  = _old.vNumLevels;
+  vBaseLevel  = _old.vBaseLevel;
+  vStreamBase = _old.vStreamBase;
+  vStreamable = _old.vStreamable;
+  vMemorySize = _old.vMemorySize;
+  vFormat     = _old.vFormat;
+  vGenMips    = _old.vGenMips;
+  cfg         = _old.cfg;
 
-  _old.vDevice  = nullptr;
-  _old.vSampler = VK_NULL_HANDLE;
+  _old.vDevice     = nullptr;
+  _old.vSampler    = VK_NULL_HANDLE;
+  _old.vStreamBase = UINT32_MAX;
 
-  vImg = std::move(_old.vImg);
+  vImg       = std::move(_old.vImg);
+  vStreamImg = std::move(_old.vStreamImg);
+  vStaging   = std::move(_old.vStaging);
+
+  vCopyRegions = std::move(_old.vCopyRegions);
+  vFileLevels  = std::move(_old.vFileLevels);
+  vRead        = std::move(_old.vRead);
   return *this;
 }
 
 
 /*!
- * \brief Loads a texture from a file
- *
- * \todo make this more generic and support more file types
+ * \brief Loads a texture from a file and waits until it is uploaded
  */
 VkResult rTexture::init(std::string _filePath) {
   if (!vDevice) {
@@ -64,45 +365,482 @@ VkResult rTexture::init(std::string _filePath) {
     return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  if (vImg.isCreated())
-    vImg.destroy();
+  vkuTransfer lTransfer(vDevice);
+
+  VkResult lRes = lTransfer.begin();
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  lRes = init(_filePath, lTransfer);
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  lRes = lTransfer.submit();
+  if (lRes == VK_SUCCESS)
+    lRes = lTransfer.wait();
 
-  // Load the image with GLI
-  auto lTemp = gli::load(_filePath);
-  if (lTemp.empty()) {
+  finishUpload();
+
+  if (lRes != VK_SUCCESS)
+    eLOG(L"Failed to upload texture: ", uEnum2Str::toStr(lRes));
+
+  return lRes;
+}
+
+/*!
+ * \brief Loads a texture from a file and records the upload into _transfer
+ *
+ * Supports all files gli can load (KTX, DDS, KMG) with a format the device can sample with optimal
+ * tiling. Block compressed formats (BC1 - BC7, ETC2 / EAC, ASTC) are uploaded as they are.
+ *
+ * Files with only one level get a full mip chain (Config::generateMips), which is generated with a
+ * vkCmdBlitImage chain on the graphics queue family after the upload. This requires linear filtered
+ * blits of the format, so block compressed formats keep their single level.
+ *
+ * Files with a full mip chain can be streamed (streamLevels()). With Config::maxExtent only the small
+ * levels are loaded, the rest is loaded on demand by rTextureStreamer.
+ *
+ * The texture can be used after _transfer is done. Call finishUpload() then.
+ *
+ * This is load() followed by upload(). Use initParallel() to load many textures.
+ *
+ * \todo make this more generic and support more file types
+ */
+VkResult rTexture::init(std::string _filePath, vkuTransfer &_transfer) {
+  VkResult lRes = load(_filePath);
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  return upload(_transfer);
+}
+
+/*!
+ * \brief Loads a texture file into a new staging buffer (the CPU part of init())
+ *
+ * The file is mapped and the levels of 2D KTX files are copied directly from the mapping into the
+ * staging memory. Other files are loaded with gli first.
+ *
+ * Only touches this texture (and allocates memory), so different textures can be loaded in parallel
+ * (initParallel()). Record the upload with upload() afterwards.
+ */
+VkResult rTexture::load(std::string _filePath) {
+  FileData lFile;
+  if (!lFile.open(_filePath)) {
     eLOG(L"Failed to load texture ", _filePath);
     return VK_ERROR_FORMAT_NOT_SUPPORTED;
   }
 
-  gli::texture2d lTexGLi(lTemp);
-  uint32_t       lWidth     = static_cast<uint32_t>(lTexGLi[0].extent().x);
-  uint32_t       lHeight    = static_cast<uint32_t>(lTexGLi[0].extent().y);
-  uint32_t       lMipLevels = static_cast<uint32_t>(lTexGLi.levels());
+  return loadFile(_filePath, lFile);
+}
+
+/*!
+ * \brief Loads the texture file _filePath from _data (the result of a uAsyncIO read) into a new staging buffer
+ * \sa load(std::string)
+ */
+VkResult rTexture::load(std::string _filePath, uAsyncIO::Buffer _data) {
+  FileData lFile;
+  if (!lFile.open(std::move(_data))) {
+    eLOG(L"Failed to load texture ", _filePath);
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  return loadFile(_filePath, lFile);
+}
+
+VkResult rTexture::loadFile(std::string const &_filePath, FileData const &_file) {
+  if (!vDevice) {
+    eLOG(L"Invalid device");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (_file.levels.empty()) {
+    eLOG(L"Failed to load texture ", _filePath);
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  uint32_t lWidth      = _file.levels[0].width;
+  uint32_t lHeight     = _file.levels[0].height;
+  uint32_t lFileLevels = static_cast<uint32_t>(_file.levels.size());
+  uint32_t lMipLevels  = lFileLevels;
+
+  VkFormat lFormat = toVkFormat(_file.format);
+
+  if (lFormat == VK_FORMAT_UNDEFINED) {
+    eLOG(L"Invalid texture format ", uEnum2Str::toStr(_file.format), L" (", _filePath, L")");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  if (!vDevice->formatSupportsFeature(lFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT, VK_IMAGE_TILING_OPTIMAL)) {
+    eLOG(L"Texture format ", uEnum2Str::toStr(lFormat), L" is not supported by the device (", _filePath, L")");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  if (gli::is_compressed(_file.format))
+    dLOG(L"Compressed texture ", _filePath, L" (", lMipLevels, L" levels)");
+
+  bool lGenerateMips = false;
+  if (cfg.generateMips && lFileLevels == 1 && (lWidth > 1 || lHeight > 1)) {
+    lGenerateMips =
+        vDevice->formatSupportsFeature(lFormat, VK_FORMAT_FEATURE_BLIT_SRC_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(lFormat, VK_FORMAT_FEATURE_BLIT_DST_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(
+            lFormat, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, VK_IMAGE_TILING_OPTIMAL);
+
+    if (lGenerateMips) {
+      lMipLevels = 1;
+      for (uint32_t lMax = std::max(lWidth, lHeight); lMax > 1; lMax >>= 1)
+        lMipLevels++;
+    } else {
+      wLOG(L"Can not generate mip maps for format ", uEnum2Str::toStr(lFormat), L" (", _filePath, L")");
+    }
+  }
+
+  vFilePath   = _filePath;
+  vWidth      = lWidth;
+  vHeight     = lHeight;
+  vNumLevels  = lMipLevels;
+  vBaseLevel  = 0;
+  vStreamable = !lGenerateMips && lFileLevels > 1;
+  vFormat     = lFormat;
+  vGenMips    = lGenerateMips;
+
+  if (vStreamable && cfg.maxExtent > 0)
+    vBaseLevel = getLevelForExtent(cfg.maxExtent);
+
+  // Streams of KTX files only read the needed levels
+  vFileLevels.clear();
+  if (vStreamable && _file.ktx) {
+    for (auto const &i : _file.levels)
+      vFileLevels.push_back({static_cast<uint64_t>(i.data - _file.data), i.size, i.rowPitch, i.rowSize});
+  }
+
+  return stageLevels(_file, vBaseLevel);
+}
+
+/*!
+ * \brief Creates the image and records the upload of the data from load() into _transfer
+ *
+ * With _stream the image is uploaded like a stream (streamLevels()) and only replaces the current
+ * image (if any) in commitStream(). The texture can then be loaded while it is rendered.
+ *
+ * \note _transfer must not be used by other threads at the same time
+ */
+VkResult rTexture::upload(vkuTransfer &_transfer, bool _stream) {
+  if (!vStaging) {
+    eLOG(L"Texture not loaded");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (_stream) {
+    if (isStreaming())
+      return VK_NOT_READY;
+
+    vStreamImg = vkuImageBuffer(vDevice);
+
+    VkResult lRes = recordUpload(vBaseLevel, vStreamImg, vGenMips, _transfer);
+    if (lRes != VK_SUCCESS) {
+      cancelStream();
+      return lRes;
+    }
+
+    vStreamBase = vBaseLevel;
+    return VK_SUCCESS;
+  }
+
+  if (vImg.isCreated())
+    vImg.destroy();
+
+  VkResult lRes = recordUpload(vBaseLevel, vImg, vGenMips, _transfer);
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  vMemorySize = imageMemorySize(**vDevice, vImg.getImage());
+
+  // Shared by all textures with the same configuration (the image views clamp the LOD to the resident levels)
+  vSampler = vDevice->getSampler(getSamplerInfo());
+  if (!vSampler)
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Creates a texture with one texel of the color _r, _g, _b, _a (i.e. a placeholder)
+ */
+VkResult rTexture::initColor(uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a, vkuTransfer &_transfer) {
+  uint8_t lColor[4] = {_r, _g, _b, _a};
+  return initTexels(VK_FORMAT_R8G8B8A8_UNORM, 1, 1, lColor, 1, _transfer);
+}
 
-  if (lTexGLi.format() != gli::FORMAT_RGBA8_UNORM_PACK8) {
-    eLOG(L"Invalid texture format ", uEnum2Str::toStr(lTexGLi.format()));
+/*!
+ * \brief Creates a texture from texels in memory (i.e. an atlas) and records its upload into _transfer
+ *
+ * \param _format    Format of the texels (4 bytes per texel)
+ * \param _width     Width of _data
+ * \param _height    Height of _data
+ * \param _data      Tightly packed texels (copied into the staging buffer)
+ * \param _numLevels Levels of the image, the levels after level 0 are generated on the GPU (clamped to
+ *                   the full mip chain, 1 if the format does not support blits)
+ */
+VkResult rTexture::initTexels(VkFormat       _format,
+                              uint32_t       _width,
+                              uint32_t       _height,
+                              uint8_t const *_data,
+                              uint32_t       _numLevels,
+                              vkuTransfer &  _transfer) {
+  if (!vDevice) {
+    eLOG(L"Invalid device");
     return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  // Copy the image into a buffer
-  vkuBuffer lTempBuff(vDevice);
-  lTempBuff->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-  lTempBuff->usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-  VkResult lRes          = lTempBuff.init(lTexGLi.size());
+  if (!_data || _width == 0 || _height == 0) {
+    eLOG(L"Invalid texel data");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  uint32_t lMaxLevels = 1;
+  for (uint32_t lMax = std::max(_width, _height); lMax > 1; lMax >>= 1)
+    lMaxLevels++;
+
+  uint32_t lLevels = std::max(std::min(_numLevels, lMaxLevels), 1u);
+  if (lLevels > 1 &&
+      !(vDevice->formatSupportsFeature(_format, VK_FORMAT_FEATURE_BLIT_SRC_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(_format, VK_FORMAT_FEATURE_BLIT_DST_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(
+            _format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT, VK_IMAGE_TILING_OPTIMAL))) {
+    wLOG(L"Can not generate mip maps for format ", uEnum2Str::toStr(_format));
+    lLevels = 1;
+  }
+
+  FileData lData;
+  lData.levels.push_back({_data, static_cast<size_t>(_width) * _height * 4, _width, _height});
+
+  vFilePath   = "";
+  vWidth      = _width;
+  vHeight     = _height;
+  vNumLevels  = lLevels;
+  vBaseLevel  = 0;
+  vStreamable = false;
+  vFormat     = _format;
+  vGenMips    = lLevels > 1;
+
+  VkResult lRes = stageLevels(lData, 0);
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  return upload(_transfer);
+}
+
+/*!
+ * \brief Loads level 0 of the texture file _path into memory (without creating a texture)
+ *
+ * \param[in]  _path   The texture file
+ * \param[out] _format Format of the texels
+ * \param[out] _width  Width of level 0
+ * \param[out] _height Height of level 0
+ * \param[out] _out    Tightly packed texels
+ * \returns false if the file can not be loaded or does not have 4 byte RGBA texels (R8G8B8A8 UNORM / SRGB)
+ */
+bool rTexture::loadTexels(
+    std::string const &_path, VkFormat &_format, uint32_t &_width, uint32_t &_height, std::vector<uint8_t> &_out) {
+  FileData lFile;
+  if (!lFile.open(_path) || lFile.levels.empty())
+    return false;
+
+  _format = toVkFormat(lFile.format);
+  if (_format != VK_FORMAT_R8G8B8A8_UNORM && _format != VK_FORMAT_R8G8B8A8_SRGB)
+    return false;
+
+  auto const &lLevel = lFile.levels[0];
+  if (lLevel.size != static_cast<size_t>(lLevel.width) * lLevel.height * 4)
+    return false;
+
+  _width  = lLevel.width;
+  _height = lLevel.height;
+  _out.assign(lLevel.data, lLevel.data + lLevel.size);
+  return true;
+}
+
+/*!
+ * \brief Loads many textures in parallel and records their uploads into _transfer
+ *
+ * All files are read together by uAsyncIO::get() (PREFETCH priority for streams, otherwise VISIBLE) and
+ * every file is parsed (load()) by the threads of uThreadPool::getPool() as soon as it is read. The
+ * uploads are recorded by the calling thread in the order of _textures, each one as soon as its file is
+ * loaded.
+ *
+ * \param _textures The textures and their files
+ * \param _stream   Upload the images as streams (see upload())
+ * \returns the first error (the other textures are still loaded)
+ */
+VkResult rTexture::initParallel(std::vector<std::pair<rTexture *, std::string>> const &_textures,
+                                vkuTransfer &                                          _transfer,
+                                bool                                                   _stream) {
+  std::vector<std::future<VkResult>> lLoads;
+  lLoads.reserve(_textures.size());
+
+  uAsyncIO::PRIORITY lPriority = _stream ? uAsyncIO::PREFETCH : uAsyncIO::VISIBLE;
+
+  for (auto const &i : _textures) {
+    rTexture *  lTex     = i.first;
+    std::string lPath    = i.second;
+    auto        lPromise = std::make_shared<std::promise<VkResult>>();
+    lLoads.emplace_back(lPromise->get_future());
+
+    // Only hand the data to the pool in the callback (it runs on the I/O thread)
+    uAsyncIO::get().read(lPath,
+                         [lTex, lPath, lPromise](uAsyncIO::Buffer _data) {
+                           uThreadPool::getPool().add([lTex, lPath, lPromise, _data]() {
+                             try {
+                               lPromise->set_value(lTex->load(lPath, _data));
+                             } catch (...) { lPromise->set_exception(std::current_exception()); }
+                           });
+                         },
+                         lPriority);
+  }
+
+  VkResult lResult = VK_SUCCESS;
+
+  for (size_t i = 0; i < lLoads.size(); ++i) {
+    VkResult lRes = lLoads[i].get();
+    if (lRes == VK_SUCCESS)
+      lRes = _textures[i].first->upload(_transfer, _stream);
+
+    if (lRes != VK_SUCCESS && lResult == VK_SUCCESS)
+      lResult = lRes;
+  }
+
+  return lResult;
+}
+
+/*!
+ * \brief Returns the sampler configuration for cfg
+ *
+ * Only depends on the config (and the device), so that textures with the same settings share their
+ * sampler (maxLod is not clamped to the levels of the texture).
+ */
+VkSamplerCreateInfo rTexture::getSamplerInfo() const noexcept {
+  VkSamplerAddressMode lMode;
+  switch (cfg.mapMode) {
+    case TextureMapMode::WRAP: lMode = VK_SAMPLER_ADDRESS_MODE_REPEAT; break;
+    case TextureMapMode::CLAMP: lMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE; break;
+    case TextureMapMode::DECAL: lMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER; break;
+    case TextureMapMode::MIRROR: lMode = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT; break;
+    default: lMode = VK_SAMPLER_ADDRESS_MODE_REPEAT; break;
+  }
+
+  auto const &lLimits      = vDevice->getProperties().limits;
+  float       lAnisotropy  = std::min(cfg.maxAnisotropy, lLimits.maxSamplerAnisotropy);
+  float       lLodBias     = std::max(std::min(cfg.lodBias, lLimits.maxSamplerLodBias), -lLimits.maxSamplerLodBias);
+  bool        lAnisotropic = vDevice->getFeatures().samplerAnisotropy == VK_TRUE && lAnisotropy > 1.0f;
+
+  VkSamplerCreateInfo lInfo;
+  lInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  lInfo.pNext                   = nullptr;
+  lInfo.flags                   = 0;
+  lInfo.magFilter               = VK_FILTER_LINEAR;
+  lInfo.minFilter               = VK_FILTER_LINEAR;
+  lInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  lInfo.addressModeU            = lMode;
+  lInfo.addressModeV            = lMode;
+  lInfo.addressModeW            = lMode;
+  lInfo.mipLodBias              = lLodBias;
+  lInfo.anisotropyEnable        = lAnisotropic ? VK_TRUE : VK_FALSE;
+  lInfo.maxAnisotropy           = lAnisotropic ? lAnisotropy : 1.0f;
+  lInfo.compareEnable           = VK_FALSE;
+  lInfo.compareOp               = VK_COMPARE_OP_ALWAYS;
+  lInfo.minLod                  = 0.0f;
+  lInfo.maxLod                  = VK_LOD_CLAMP_NONE;
+  lInfo.unnormalizedCoordinates = VK_FALSE;
+
+  // Decals are transparent outside of the texture (the border color is irrelevant for the other modes)
+  lInfo.borderColor = cfg.mapMode == TextureMapMode::DECAL ? VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK
+                                                           : VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+  return lInfo;
+}
+
+/*!
+ * \brief Copies the levels _baseLevel to the last level of _file into a new staging buffer (vStaging)
+ *
+ * The copy regions for recordUpload() are stored in vCopyRegions.
+ */
+VkResult rTexture::stageLevels(FileData const &_file, uint32_t _baseLevel) {
+  // Padded rows are packed tightly in the staging buffer
+  auto lStagedSize = [](FileData::Level const &_level) {
+    return _level.rowPitch > 0 ? _level.rowSize * _level.height : _level.size;
+  };
+
+  // Every level starts at a multiple of lAlign (not a power of two for the 3 / 6 / 12 byte formats)
+  VkDeviceSize lAlign   = levelAlignment(vFormat);
+  auto         lAligned = [lAlign](VkDeviceSize _offset) { return (_offset + lAlign - 1) / lAlign * lAlign; };
+
+  VkDeviceSize lSize = 0;
+  for (size_t i = _baseLevel; i < _file.levels.size(); ++i)
+    lSize = lAligned(lSize) + lStagedSize(_file.levels[i]);
+
+  vCopyRegions.clear();
+  vStaging.reset(new vkuBuffer(vDevice));
+  (*vStaging)->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  (*vStaging)->usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  VkResult lRes            = vStaging->init(lSize);
   if (lRes != VK_SUCCESS) {
     eLOG(L"Failed to allocate buffer for texture: ", uEnum2Str::toStr(lRes));
     return lRes;
   }
 
-  {
-    auto lBufferPTR = lTempBuff.getBufferAccess();
-    if (!lBufferPTR) {
-      eLOG(L"Failed to bind vulkan memory");
-      return VK_ERROR_INITIALIZATION_FAILED;
+  auto lBufferPTR = vStaging->getBufferAccess();
+  if (!lBufferPTR) {
+    eLOG(L"Failed to bind vulkan memory");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  // The levels are packed at lAlign. For block compressed formats bufferRowLength = 0 means whole blocks
+  // per row and the extent of the small levels may be smaller than one block.
+  uint8_t *    lDst    = static_cast<uint8_t *>(*lBufferPTR);
+  VkDeviceSize lOffset = 0;
+
+  for (size_t i = _baseLevel; i < _file.levels.size(); ++i) {
+    auto const &lLevel = _file.levels[i];
+    lOffset            = lAligned(lOffset);
+
+    if (lLevel.rowPitch > 0 && lLevel.rowPitch != lLevel.rowSize) {
+      for (uint32_t y = 0; y < lLevel.height; ++y)
+        memcpy(lDst + lOffset + y * lLevel.rowSize, lLevel.data + y * lLevel.rowPitch, lLevel.rowSize);
+    } else {
+      memcpy(lDst + lOffset, lLevel.data, lStagedSize(lLevel));
     }
-    memcpy(*lBufferPTR, lTexGLi.data(), lTexGLi.size());
+
+    VkBufferImageCopy lRegion               = {};
+    lRegion.bufferOffset                    = lOffset;
+    lRegion.bufferRowLength                 = 0;
+    lRegion.bufferImageHeight               = 0;
+    lRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    lRegion.imageSubresource.mipLevel       = static_cast<uint32_t>(i) - _baseLevel;
+    lRegion.imageSubresource.baseArrayLayer = 0;
+    lRegion.imageSubresource.layerCount     = 1;
+    lRegion.imageExtent.width               = lLevel.width;
+    lRegion.imageExtent.height              = lLevel.height;
+    lRegion.imageExtent.depth               = 1;
+    lRegion.imageOffset                     = {0, 0, 0};
+
+    vCopyRegions.push_back(lRegion);
+    lOffset += static_cast<VkDeviceSize>(lStagedSize(lLevel));
   }
-  lTempBuff.sync(); // Should do nothing because memory is host visible
+
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Creates _img with the levels _baseLevel to vNumLevels - 1 and records their upload into _transfer
+ *
+ * Level _baseLevel of the full chain is level 0 of _img. The data must be in vStaging (stageLevels()).
+ */
+VkResult rTexture::recordUpload(uint32_t        _baseLevel,
+                                vkuImageBuffer &_img,
+                                bool            _generateMips,
+                                vkuTransfer &   _transfer) {
+  uint32_t lMipLevels = vNumLevels - _baseLevel;
 
   // Setup image buffer
   VkImageSubresourceRange lSubResRange;
@@ -112,117 +850,268 @@ VkResult rTexture::init(std::string _filePath) {
   lSubResRange.baseArrayLayer = 0;
   lSubResRange.layerCount     = 1;
 
+  VkImageSubresourceRange lFileRange = lSubResRange;
+  lFileRange.levelCount              = static_cast<uint32_t>(vCopyRegions.size());
 
-  vImg->type             = VK_IMAGE_TYPE_2D;
-  vImg->format           = VK_FORMAT_R8G8B8A8_UNORM;
-  vImg->extent           = {lWidth, lHeight, 1};
-  vImg->mipLevels        = lMipLevels;
-  vImg->usage            = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-  vImg->subresourceRange = lSubResRange;
+  uint32_t lWidth  = std::max(vWidth >> _baseLevel, 1u);
+  uint32_t lHeight = std::max(vHeight >> _baseLevel, 1u);
 
-  lRes = vImg.init();
+  _img->type             = VK_IMAGE_TYPE_2D;
+  _img->format           = vFormat;
+  _img->extent           = {lWidth, lHeight, 1};
+  _img->mipLevels        = lMipLevels;
+  _img->usage            = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  _img->subresourceRange = lSubResRange;
+
+  if (_generateMips)
+    _img->usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+
+  VkResult lRes = _img.init(vDevice);
   if (lRes != VK_SUCCESS) {
     eLOG(L"Failed to initialize image: ", uEnum2Str::toStr(lRes));
     return lRes;
   }
 
 
-  // Copy vkuBuffer --> vkuImageBuffer
-  std::vector<VkBufferImageCopy> lBufferCopyRegions;
-  uint32_t                       offset = 0;
+  // Upload on the transfer queue and hand the image over to the graphics queue family
+  VkCommandBuffer lBuff = *_transfer.getBuffer();
+  VkImage         lImg  = _img.getImage();
+  vkuBarriers     lBarriers;
 
-  for (uint32_t i = 0; i < lMipLevels; ++i) {
-    VkBufferImageCopy lRegion               = {};
-    lRegion.bufferOffset                    = offset;
-    lRegion.bufferRowLength                 = 0;
-    lRegion.bufferImageHeight               = 0;
-    lRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-    lRegion.imageSubresource.mipLevel       = i;
-    lRegion.imageSubresource.baseArrayLayer = 0;
-    lRegion.imageSubresource.layerCount     = 1;
-    lRegion.imageExtent.width               = static_cast<uint32_t>(lTexGLi[i].extent().x);
-    lRegion.imageExtent.height              = static_cast<uint32_t>(lTexGLi[i].extent().y);
-    lRegion.imageExtent.depth               = 1;
-    lRegion.imageOffset                     = {0, 0, 0};
+  lBarriers.addImage(lImg, lFileRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  lBarriers.cmdRecord(lBuff);
 
-    lBufferCopyRegions.push_back(lRegion);
+  vkCmdCopyBufferToImage(lBuff,
+                         **vStaging,
+                         lImg,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                         static_cast<uint32_t>(vCopyRegions.size()),
+                         vCopyRegions.data());
 
-    offset += static_cast<uint32_t>(lTexGLi[i].size());
+  if (_generateMips) {
+    _transfer.releaseImage(
+        lImg, lFileRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    _transfer.addDstCommands([lImg, lWidth, lHeight, lMipLevels](VkCommandBuffer _buf) {
+      cmdGenerateMips(_buf, lImg, lWidth, lHeight, lMipLevels);
+    });
+  } else {
+    _transfer.releaseImage(
+        lImg, lSubResRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
   }
 
-  uint32_t         lQueueFamilyIndex = 0;
-  VkQueue          lQueue            = vDevice->getQueue(VK_QUEUE_GRAPHICS_BIT, 0.5, &lQueueFamilyIndex);
-  vkuCommandPool * lPool             = vkuCommandPoolManager::get(**vDevice, lQueueFamilyIndex);
-  vkuCommandBuffer lBuff             = lPool->getBuffer();
-  vkuFence_t       lFence(**vDevice);
+  return VK_SUCCESS;
+}
 
-  lBuff.begin();
+/*!
+ * \brief Frees the staging data of the upload
+ * \note Call this only after the transfer passed to init is done
+ */
+void rTexture::finishUpload() { vStaging.reset(); }
 
-  vImg.cmdChangeLayout(&lBuff, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-  vkCmdCopyBufferToImage(*lBuff,
-                         *lTempBuff,
-                         vImg.getImage(),
-                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                         static_cast<uint32_t>(lBufferCopyRegions.size()),
-                         lBufferCopyRegions.data());
-  vImg.cmdChangeLayout(&lBuff, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+/*!
+ * \brief Starts loading the levels _baseLevel to getNumLevels() - 1 for a new image
+ *
+ * Lower _baseLevel values load more detailed levels, higher values free memory. The levels are read
+ * asynchronously with uAsyncIO::get() (PREFETCH priority). For KTX files only the byte range of the
+ * requested levels is read, other files are read and parsed again completely.
+ *
+ * Once isReadDone() returns true, streamLevels() records the upload. The new image replaces the
+ * current one in commitStream().
+ *
+ * \returns VK_NOT_READY if a stream is already in flight
+ */
+VkResult rTexture::readLevels(uint32_t _baseLevel) {
+  if (!vStreamable || !vImg.isCreated()) {
+    eLOG(L"Texture ", vFilePath, L" can not be streamed");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
 
-  lRes = lBuff.end();
-  if (lRes != VK_SUCCESS) {
-    eLOG(L"Failed to record command buffer: ", uEnum2Str::toStr(lRes));
-    return lRes;
+  if (isStreaming())
+    return VK_NOT_READY;
+
+  _baseLevel = std::min(_baseLevel, vNumLevels - 1);
+  if (_baseLevel == vBaseLevel)
+    return VK_SUCCESS;
+
+  // The levels get smaller towards the end of the file ==> one range from _baseLevel to the end
+  uint64_t lOffset = 0;
+  size_t   lSize   = 0;
+  if (vFileLevels.size() == vNumLevels) {
+    lOffset = vFileLevels[_baseLevel].offset;
+    lSize   = static_cast<size_t>(vFileLevels.back().offset + vFileLevels.back().size - lOffset);
+  }
+
+  auto lRead  = std::make_shared<StreamRead>();
+  vRead       = lRead;
+  vStreamBase = _baseLevel;
+
+  uAsyncIO::get().read(vFilePath,
+                       [lRead](uAsyncIO::Buffer _data) {
+                         std::lock_guard<std::mutex> lLock(lRead->mutex);
+                         lRead->data = std::move(_data);
+                         lRead->done = true;
+                       },
+                       uAsyncIO::PREFETCH,
+                       lOffset,
+                       lSize);
+
+  return VK_SUCCESS;
+}
+
+//! \brief Returns true if the data of readLevels() arrived (streamLevels() can be called)
+bool rTexture::isReadDone() const {
+  if (!vRead)
+    return false;
+
+  std::lock_guard<std::mutex> lLock(vRead->mutex);
+  return vRead->done;
+}
+
+/*!
+ * \brief Records the upload of the levels loaded with readLevels() into a new image
+ *
+ * commitStream() must be called after _transfer is done.
+ *
+ * \returns VK_NOT_READY if the data did not arrive yet (isReadDone())
+ */
+VkResult rTexture::streamLevels(vkuTransfer &_transfer) {
+  if (!vRead) {
+    eLOG(L"No levels of ", vFilePath, L" were read");
+    return VK_ERROR_INITIALIZATION_FAILED;
   }
 
-  VkSubmitInfo lSubmitInfo;
-  lSubmitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  lSubmitInfo.pNext                = nullptr;
-  lSubmitInfo.waitSemaphoreCount   = 0;
-  lSubmitInfo.pWaitSemaphores      = nullptr;
-  lSubmitInfo.pWaitDstStageMask    = nullptr;
-  lSubmitInfo.commandBufferCount   = 1;
-  lSubmitInfo.pCommandBuffers      = &lBuff.get();
-  lSubmitInfo.signalSemaphoreCount = 0;
-  lSubmitInfo.pSignalSemaphores    = nullptr;
-
-  vkQueueSubmit(lQueue, 1, &lSubmitInfo, lFence[0]);
-  lFence();
-
-  // Create the sampler
-  VkSamplerCreateInfo lSamplerInfo;
-  lSamplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  lSamplerInfo.pNext                   = nullptr;
-  lSamplerInfo.flags                   = 0;
-  lSamplerInfo.magFilter               = VK_FILTER_LINEAR;
-  lSamplerInfo.minFilter               = VK_FILTER_LINEAR;
-  lSamplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-  lSamplerInfo.addressModeU            = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  lSamplerInfo.addressModeV            = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  lSamplerInfo.addressModeW            = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-  lSamplerInfo.mipLodBias              = 0.0f;
-  lSamplerInfo.anisotropyEnable        = VK_FALSE;
-  lSamplerInfo.maxAnisotropy           = 1.0f;
-  lSamplerInfo.compareEnable           = VK_FALSE;
-  lSamplerInfo.compareOp               = VK_COMPARE_OP_ALWAYS;
-  lSamplerInfo.minLod                  = 0.0f;
-  lSamplerInfo.maxLod                  = 0.0f; // static_cast<float>(lMipLevels);
-  lSamplerInfo.borderColor             = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-  lSamplerInfo.unnormalizedCoordinates = VK_FALSE;
-
-  lRes = vkCreateSampler(**vDevice, &lSamplerInfo, nullptr, &vSampler);
+  uAsyncIO::Buffer lData;
+  {
+    std::lock_guard<std::mutex> lLock(vRead->mutex);
+    if (!vRead->done)
+      return VK_NOT_READY;
+
+    lData = std::move(vRead->data);
+  }
+
+  vRead = nullptr;
+
+  // Only the requested levels are in lData for KTX files (the levels before vStreamBase stay empty)
+  FileData lFile;
+  bool     lOK = false;
+  if (lData && vFileLevels.size() == vNumLevels) {
+    uint64_t lBase = vFileLevels[vStreamBase].offset;
+    lOK            = lData->size() == vFileLevels.back().offset + vFileLevels.back().size - lBase;
+
+    lFile.buffer = lData;
+    for (uint32_t i = 0; i < vNumLevels && lOK; ++i) {
+      auto const *lLevel = i < vStreamBase ? nullptr : reinterpret_cast<uint8_t const *>(lData->data()) +
+                                                           (vFileLevels[i].offset - lBase);
+      lFile.levels.push_back({lLevel,
+                              vFileLevels[i].size,
+                              std::max(vWidth >> i, 1u),
+                              std::max(vHeight >> i, 1u),
+                              vFileLevels[i].rowPitch,
+                              vFileLevels[i].rowSize});
+    }
+  } else if (lData) {
+    lOK = lFile.open(std::move(lData)) && static_cast<uint32_t>(lFile.levels.size()) == vNumLevels;
+  }
+
+  if (!lOK) {
+    eLOG(L"Failed to reload texture ", vFilePath);
+    cancelStream();
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  vStreamImg = vkuImageBuffer(vDevice);
+
+  VkResult lRes = stageLevels(lFile, vStreamBase);
+  if (lRes == VK_SUCCESS)
+    lRes = recordUpload(vStreamBase, vStreamImg, false, _transfer);
+
   if (lRes != VK_SUCCESS) {
-    eLOG(L"Failed to create sampler: ", uEnum2Str::toStr(lRes));
+    cancelStream();
     return lRes;
   }
 
   return VK_SUCCESS;
 }
 
+/*!
+ * \brief Replaces the image with the one from streamLevels()
+ *
+ * The old image is destroyed, so the GPU must not use it any more (rWorld::updateTextures). The
+ * descriptors of the texture must be written again (getImageView() changes).
+ *
+ * \returns true if the image was replaced
+ */
+bool rTexture::commitStream() {
+  if (!isStreaming() || vRead || !vStreamImg.isCreated())
+    return false;
+
+  vImg        = std::move(vStreamImg);
+  vBaseLevel  = vStreamBase;
+  vStreamBase = UINT32_MAX;
+  vMemorySize = imageMemorySize(**vDevice, vImg.getImage());
+  vStaging.reset();
+
+  // First image of the texture (upload() with _stream)
+  if (!vSampler)
+    vSampler = vDevice->getSampler(getSamplerInfo());
+
+  return true;
+}
+
+/*!
+ * \brief Discards the image of streamLevels()
+ * \note The transfer passed to streamLevels() must be done (or never submitted)
+ */
+void rTexture::cancelStream() {
+  vStreamImg.destroy();
+  vStreamBase = UINT32_MAX;
+  vStaging.reset();
+  vRead = nullptr; // A running read only fills the shared StreamRead
+}
+
+/*!
+ * \brief Estimates the device memory of the texture with the levels _baseLevel to getNumLevels() - 1
+ *
+ * Scales the memory of the current image by the number of texels.
+ */
+VkDeviceSize rTexture::estimateMemorySize(uint32_t _baseLevel) const noexcept {
+  auto lTexels = [this](uint32_t _base) -> VkDeviceSize {
+    VkDeviceSize lSum = 0;
+    for (uint32_t i = _base; i < vNumLevels; ++i)
+      lSum += static_cast<VkDeviceSize>(std::max(vWidth >> i, 1u)) * std::max(vHeight >> i, 1u);
+    return lSum;
+  };
+
+  VkDeviceSize lCurrent = lTexels(vBaseLevel);
+  if (lCurrent == 0)
+    return 0;
+
+  return vMemorySize * lTexels(std::min(_baseLevel, vNumLevels - 1)) / lCurrent;
+}
+
+/*!
+ * \brief Returns the level of the full mip chain that is needed to show the texture with a size of _extent
+ *
+ * This is the smallest level that is still at least _extent large (or level 0).
+ */
+uint32_t rTexture::getLevelForExtent(uint32_t _extent) const noexcept {
+  uint32_t lLevel = 0;
+  while (lLevel + 1 < vNumLevels && std::max(vWidth >> (lLevel + 1), vHeight >> (lLevel + 1)) >= _extent)
+    lLevel++;
+
+  return lLevel;
+}
+
 void rTexture::destroy() {
   if (!vDevice)
     return; // Moved form
 
-  if (vSampler)
-    vkDestroySampler(**vDevice, vSampler, nullptr);
+  vStaging.reset();
+
+  vSampler    = VK_NULL_HANDLE; // Owned by the device
+  vStreamBase = UINT32_MAX;
+  vRead       = nullptr;
 
+  vStreamImg.destroy();
   vImg.destroy();
 }
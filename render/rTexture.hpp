@@ -17,8 +17,15 @@
 #pragma once
 
 #include "defines.hpp"
+#include "uAsyncIO.hpp"
+#include "vkuBuffer.hpp"
 #include "vkuDevice.hpp"
 #include "vkuImageBuffer.hpp"
+#include "vkuTransfer.hpp"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace e_engine {
 
@@ -50,18 +57,58 @@ class rTexture final {
     TextureOP      blendOP = TextureOP::MULTIPLY;
     TextureMapping mapping = TextureMapping::UV;
     TextureMapMode mapMode = TextureMapMode::WRAP;
+
+    bool     generateMips  = true;  //!< Generate the mip chain on the GPU if the file has only one level
+    uint32_t maxExtent     = 0;     //!< Only load the levels needed for this width / height (0: all)
+    float    maxAnisotropy = 16.0f; //!< Anisotropic filtering (clamped to the device limit; 1: disabled)
+    float    lodBias       = 0.0f;  //!< Added to the LOD of the sampler
   };
 
  private:
-  vkuDevicePTR   vDevice;
-  vkuImageBuffer vImg;
-  VkSampler      vSampler = VK_NULL_HANDLE;
+  vkuDevicePTR               vDevice;
+  vkuImageBuffer             vImg;
+  vkuImageBuffer             vStreamImg; //!< New image of streamLevels(), swapped in by commitStream()
+  VkSampler                  vSampler = VK_NULL_HANDLE; //!< Owned by the device (vkuDevice::getSampler)
+  std::unique_ptr<vkuBuffer> vStaging; //!< Kept until finishUpload() / commitStream()
+
+  std::vector<VkBufferImageCopy> vCopyRegions; //!< Levels in vStaging (level 0 is the first staged level)
+
+  std::string  vFilePath;
+  uint32_t     vWidth      = 0;          //!< Size of level 0 of the full mip chain
+  uint32_t     vHeight     = 0;          //!< Size of level 0 of the full mip chain
+  uint32_t     vNumLevels  = 0;          //!< Levels of the full mip chain
+  uint32_t     vBaseLevel  = 0;          //!< First level of the full mip chain that is in vImg
+  uint32_t     vStreamBase = UINT32_MAX; //!< First level of the stream (UINT32_MAX: nothing streamed)
+  bool         vStreamable = false;      //!< All levels are in the file
+  VkDeviceSize vMemorySize = 0;          //!< Device memory of vImg
+
+  VkFormat vFormat  = VK_FORMAT_UNDEFINED; //!< Format of the file
+  bool     vGenMips = false;               //!< Generate the levels after level 0 on the GPU
 
   Config cfg;
 
+  struct LevelRange {
+    uint64_t offset; //!< Of the level data in the file
+    size_t   size;
+    size_t   rowPitch; //!< Bytes per row in the file (0: tightly packed)
+    size_t   rowSize;  //!< Bytes per tightly packed row
+  };
+
+  struct FileData;
+  struct StreamRead;
+
+  std::vector<LevelRange>     vFileLevels; //!< Levels of a KTX file (empty: readLevels() reads the whole file)
+  std::shared_ptr<StreamRead> vRead;       //!< Read of readLevels() (nullptr: no read in flight)
+
+  VkResult loadFile(std::string const &_filePath, FileData const &_file);
+  VkResult stageLevels(FileData const &_file, uint32_t _baseLevel);
+  VkResult recordUpload(uint32_t _baseLevel, vkuImageBuffer &_img, bool _generateMips, vkuTransfer &_transfer);
+
+  VkSamplerCreateInfo getSamplerInfo() const noexcept;
+
  public:
   rTexture() = delete;
-  rTexture(vkuDevicePTR _device) : vDevice(_device), vImg(_device) {}
+  rTexture(vkuDevicePTR _device) : vDevice(_device), vImg(_device), vStreamImg(_device) {}
   ~rTexture();
 
   rTexture(rTexture const &) = delete;
@@ -71,8 +118,44 @@ class rTexture final {
   rTexture &operator=(rTexture &&);
 
   VkResult init(std::string _filePath);
+  VkResult init(std::string _filePath, vkuTransfer &_transfer);
+  VkResult initColor(uint8_t _r, uint8_t _g, uint8_t _b, uint8_t _a, vkuTransfer &_transfer);
+  VkResult initTexels(VkFormat       _format,
+                      uint32_t       _width,
+                      uint32_t       _height,
+                      uint8_t const *_data,
+                      uint32_t       _numLevels,
+                      vkuTransfer &  _transfer);
+  VkResult load(std::string _filePath);
+  VkResult load(std::string _filePath, uAsyncIO::Buffer _data);
+  VkResult upload(vkuTransfer &_transfer, bool _stream = false);
+  void     finishUpload();
   void     destroy();
 
+  static VkResult initParallel(std::vector<std::pair<rTexture *, std::string>> const &_textures,
+                               vkuTransfer &                                          _transfer,
+                               bool                                                   _stream = false);
+  static bool     loadTexels(std::string const &   _path,
+                             VkFormat &            _format,
+                             uint32_t &            _width,
+                             uint32_t &            _height,
+                             std::vector<uint8_t> &_out);
+
+  VkResult     readLevels(uint32_t _baseLevel);
+  VkResult     streamLevels(vkuTransfer &_transfer);
+  bool         isReadDone() const;
+  bool         commitStream();
+  void         cancelStream();
+  VkDeviceSize estimateMemorySize(uint32_t _baseLevel) const noexcept;
+  uint32_t     getLevelForExtent(uint32_t _extent) const noexcept;
+
+  inline uint32_t     getNumLevels() const noexcept { return vNumLevels; }
+  inline uint32_t     getBaseLevel() const noexcept { return vBaseLevel; }
+  inline uint32_t     getStreamBaseLevel() const noexcept { return vStreamBase; }
+  inline bool         isStreaming() const noexcept { return vStreamBase != UINT32_MAX; }
+  inline bool         isStreamable() const noexcept { return vStreamable; }
+  inline VkDeviceSize getMemorySize() const noexcept { return vMemorySize; }
+
   inline Config  getConfig() const noexcept { return cfg; }
   inline Config *getConfigPTR() noexcept { return &cfg; }
 
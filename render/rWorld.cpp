@@ -47,14 +47,20 @@ rWorld::rWorld(iInit *_init)
     : vInitPtr(_init),
       vDevice(_init->getDevicePTR()),
       vDevice_vk(**vDevice),
+      vGraph(vDevice),
       vRenderLoop(vDevice,
                   &vSwapChain,
 
                   // A frame was rendered
                   [this]() {
-                    for (auto const &i : vRenderers)
+                    for (auto const &i : vRenderers) {
                       i->updateUniforms();
 
+                      // The fences of the frame have passed: released geometry can be reused
+                      if (i->getScene())
+                        i->getScene()->getGeometryArena()->nextFrame(*vRenderLoop.getRenderedFramesPtr());
+                    }
+
                     vRenderedFrameSignal.notify_all();
                   },
 
@@ -148,6 +154,60 @@ void rWorld::rebuildRenderers() {
   rebuildSubmitInfos();
 }
 
+/*!
+ * \brief Runs _update while no frame is rendered and records the command buffers with the new textures
+ *
+ * _update may destroy images (rTexture::commitStream), because the render loop lock is held and all
+ * submitted frames are done.
+ */
+void rWorld::updateTextures(std::function<void()> _update) {
+  std::lock_guard<std::mutex> lGuard(vRenderAccessMutex);
+  auto                        lRenderLoopLock = vRenderLoop.getRenderLoopLock();
+
+  _update();
+
+  for (auto const &i : vRenderers)
+    i->updateTextures();
+
+  rebuildSubmitInfos();
+}
+
+/*!
+ * \brief Runs _job while no frame is rendered (without recording the command buffers again)
+ *
+ * _job may overwrite resources that are used by the recorded command buffers (i.e. rVirtualTexture
+ * pages), because the render loop lock is held and all submitted frames are done.
+ */
+void rWorld::runWhileIdle(std::function<void()> _job) {
+  std::lock_guard<std::mutex> lGuard(vRenderAccessMutex);
+  auto                        lRenderLoopLock = vRenderLoop.getRenderLoopLock();
+
+  _job();
+}
+
+/*!
+ * \brief Adds _objects to _scene and to all renderers that render _scene (rRendererBase::renderScene)
+ *
+ * Used to add objects while the scene is rendered (rSceneBase::initObjectAsync). The pipelines of
+ * the objects are created and the command buffers are recorded again.
+ */
+void rWorld::addSceneObjects(rSceneBase *_scene, std::vector<std::shared_ptr<rObjectBase>> const &_objects) {
+  std::lock_guard<std::mutex> lGuard(vRenderAccessMutex);
+  auto                        lRenderLoopLock = vRenderLoop.getRenderLoopLock();
+
+  for (auto const &i : _objects)
+    _scene->addObject(i);
+
+  for (auto const &i : vRenderers) {
+    if (i->getScene() != _scene)
+      continue;
+
+    for (auto const &j : _objects)
+      i->addObject(j);
+  }
+
+  rebuildSubmitInfos();
+}
 
 /*!
  * \brief Non thread safe private implementation of rebuildRenderers
@@ -164,25 +224,60 @@ void rWorld::rebuildSubmitInfos() {
     i->updateRenderer();
   }
 
+  // Every renderer is one pass of the graph: submit order follows the declared reads and writes
+  std::vector<rRendererBase *> lPasses;
+  std::vector<uint32_t>        lOrder;
+
+  vGraph.clear();
+  vGraph.importImage(rRendererBase::SWAPCHAIN_RESOURCE,
+                     VK_NULL_HANDLE,
+                     VK_NULL_HANDLE,
+                     {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+                     rRenderGraph::COLOR_ATTACHMENT,
+                     rRenderGraph::COLOR_ATTACHMENT);
+  vGraph.markOutput(rRendererBase::SWAPCHAIN_RESOURCE);
+
+  for (auto &i : vRenderers) {
+    if (!i->getIsInit() || !i->getIsRenderingEnabled())
+      continue;
+
+    i->declareGraphPass(vGraph, vGraph.addPass(i->getGraphName()));
+    lPasses.push_back(i.get());
+  }
+
+  if (vGraph.compile()) {
+    lOrder = vGraph.getPassOrder();
+
+    for (uint32_t i = 0; i < lPasses.size(); ++i)
+      if (vGraph.getIsCulled(i))
+        wLOG(L"Renderer '", lPasses[i]->getGraphName(), L"' is skipped (no other renderer reads its output)");
+  } else {
+    wLOG(L"Failed to compile the render graph ==> submitting the renderers in the order they were added");
+    for (uint32_t i = 0; i < lPasses.size(); ++i)
+      lOrder.push_back(i);
+  }
+
   lBufferRef->frames.resize(vSwapChain.getNumImages());
 
   for (uint32_t i = 0; i < vSwapChain.getNumImages(); ++i) {
-    lBufferRef->frames[i].inf.clear();
-
-    for (auto &j : vRenderers) {
-      if (!j->getIsInit()) {
-        continue;
-      }
+    auto &lFrame = lBufferRef->frames[i];
+    lFrame.inf.clear();
+    lFrame.compute.clear();
+    lFrame.computeWait = UINT32_MAX;
 
-      if (!j->getIsRenderingEnabled())
-        continue;
+    for (auto j : lOrder) {
+      auto lSubmitInfo = lPasses[j]->getVulkanSubmitInfos();
 
-      auto lSubmitInfo = j->getVulkanSubmitInfos();
+      // The graphics work of the first renderer with compute work waits for all compute work of the frame
+      auto &lCompute = lSubmitInfo.compute.submitInfos;
+      if (!lCompute.empty() && lFrame.computeWait == UINT32_MAX)
+        lFrame.computeWait = static_cast<uint32_t>(lFrame.inf.size());
 
       auto &lShared = lSubmitInfo.shared.submitInfos;
       auto &fb      = lSubmitInfo.fb[i].submitInfos;
-      std::copy(lShared.begin(), lShared.end(), std::back_inserter(lBufferRef->frames[i].inf));
-      std::copy(fb.begin(), fb.end(), std::back_inserter(lBufferRef->frames[i].inf));
+      std::copy(lCompute.begin(), lCompute.end(), std::back_inserter(lFrame.compute));
+      std::copy(lShared.begin(), lShared.end(), std::back_inserter(lFrame.inf));
+      std::copy(fb.begin(), fb.end(), std::back_inserter(lFrame.inf));
     }
   }
 }
@@ -25,9 +25,11 @@
 #include "uSignalSlot.hpp"
 #include "vkuDevice.hpp"
 #include "vkuSwapChain.hpp"
+#include "rRenderGraph.hpp"
 #include "rRenderLoop.hpp"
 #include "rRendererBase.hpp"
 #include <condition_variable>
+#include <functional>
 #include <mutex>
 #include <unordered_map>
 #include <vulkan.h>
@@ -79,6 +81,7 @@ class rWorld {
   VkSurfaceKHR vSurface_vk;
 
   std::vector<std::shared_ptr<rRendererBase>> vRenderers;
+  rRenderGraph                                vGraph; //!< Orders the renderers and culls unused ones
 
   vkuSwapChain vSwapChain;
 
@@ -109,6 +112,9 @@ class rWorld {
   int  init();
   void shutdown();
   void rebuildRenderers();
+  void updateTextures(std::function<void()> _update);
+  void runWhileIdle(std::function<void()> _job);
+  void addSceneObjects(rSceneBase *_scene, std::vector<std::shared_ptr<rObjectBase>> const &_objects);
 
   bool isSetup() { return vIsSetup; }
   bool waitForFrame(std::mutex &_mutex);
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rGPUCulling.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "rObjectBase.hpp"
+#include "rPipeline.hpp"
+#include <algorithm>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace e_engine {
+
+const std::string rGPUCulling::OBJECTS_BLOCK  = "Objects";
+const std::string rGPUCulling::COMMANDS_BLOCK = "Commands";
+
+rGPUCulling::rGPUCulling(vkuDevicePTR _device) : vDevice(_device), vObjectBuffer(_device), vDrawBuffer(_device) {}
+
+rGPUCulling::~rGPUCulling() { destroy(); }
+
+/*!
+ * \brief Sets up the buffers and the compute pipeline for all supported objects in _objects
+ * \param[in] _shader  The culling shader (must have a compute stage)
+ * \param[in] _objects The objects to render (objects without indirect draw support are ignored)
+ * \returns false on error
+ * \note Only objects in getObjects() are drawn by cmdDraw()
+ */
+bool rGPUCulling::init(rShaderBase *_shader, std::vector<std::shared_ptr<rObjectBase>> const &_objects) {
+  destroy();
+
+  if (!_shader || !_shader->has_comp()) {
+    eLOG("Invalid culling shader (no compute stage)");
+    return false;
+  }
+
+  if (!vDevice->getFeatures().drawIndirectFirstInstance) {
+    wLOG("drawIndirectFirstInstance is not supported ==> GPU culling disabled");
+    return false;
+  }
+
+  vShader    = _shader;
+  vMultiDraw = vDevice->getFeatures().multiDrawIndirect == VK_TRUE;
+
+  struct Candidate {
+    std::shared_ptr<rObjectBase>  obj;
+    rObjectBase::IndirectDrawData data;
+  };
+
+  std::vector<Candidate> lCandidates;
+  for (auto const &i : _objects) {
+    rObjectBase::IndirectDrawData lData;
+    if (!i || !i->isMesh() || !i->getPipeline() || !i->getIndirectDrawData(lData))
+      continue;
+
+    lCandidates.push_back({i, lData});
+  }
+
+  if (lCandidates.empty())
+    return true;
+
+  std::stable_sort(lCandidates.begin(), lCandidates.end(), [](Candidate const &a, Candidate const &b) {
+    if (a.obj->getPipeline() != b.obj->getPipeline())
+      return a.obj->getPipeline() < b.obj->getPipeline();
+
+    return a.data.geometry.block < b.data.geometry.block;
+  });
+
+  for (auto const &i : lCandidates) {
+    uint32_t lIndex = static_cast<uint32_t>(vObjects.size());
+    vObjects.push_back(i.obj);
+
+    if (vGroups.empty() || vGroups.back().pipeline != i.obj->getPipeline() ||
+        vGroups.back().vertexBuffer != i.data.geometry.vertexBuffer) {
+      vGroups.push_back({i.obj->getPipeline(),
+                         i.data.geometry.vertexBuffer,
+                         i.data.geometry.indexBuffer,
+                         i.data.geometry.indexType,
+                         lIndex,
+                         0});
+    }
+
+    vGroups.back().numDraws++;
+  }
+
+  vObjectBuffer->usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  vObjectBuffer->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  vDrawBuffer->usage         = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+  if (vQueueFamilies.size() > 1) {
+    vObjectBuffer->sharingMode        = VK_SHARING_MODE_CONCURRENT;
+    vDrawBuffer->sharingMode          = VK_SHARING_MODE_CONCURRENT;
+    vObjectBuffer->queueFamilyIndices = vQueueFamilies;
+    vDrawBuffer->queueFamilyIndices   = vQueueFamilies;
+  }
+
+  VkResult lRes = vObjectBuffer.init(vObjects.size() * sizeof(ObjectData));
+  if (lRes == VK_SUCCESS)
+    lRes = vDrawBuffer.init(vObjects.size() * sizeof(VkDrawIndexedIndirectCommand));
+
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create GPU culling buffers: ", uEnum2Str::toStr(lRes));
+    destroy();
+    return false;
+  }
+
+  // Only written by the compute shader
+  vDrawBuffer.destroyStagingBufferMemory();
+
+  if (!writeObjectData() || !initPipeline()) {
+    destroy();
+    return false;
+  }
+
+  iLOG("GPU culling: ", vObjects.size(), " objects in ", vGroups.size(), " indirect draws");
+  return true;
+}
+
+/*!
+ * \brief Creates the compute pipeline and binds the storage buffers to the shaders
+ */
+bool rGPUCulling::initPipeline() {
+  if (!bindStorage(vShader, VK_SHADER_STAGE_COMPUTE_BIT, OBJECTS_BLOCK, vObjectBuffer) ||
+      !bindStorage(vShader, VK_SHADER_STAGE_COMPUTE_BIT, COMMANDS_BLOCK, vDrawBuffer))
+    return false;
+
+  auto const *lUniforms = vShader->getUniformBuffer(VK_SHADER_STAGE_COMPUTE_BIT);
+  if (lUniforms) {
+    for (auto const &i : lUniforms->vars) {
+      if (i.guessedRole == rShaderBase::VIEW_PROJECTION_MATRIX) {
+        vViewProjVar = i;
+        vHasViewProj = true;
+      }
+    }
+  }
+
+  if (!vHasViewProj)
+    wLOG("Culling shader ", vShader->getName(), " has no view projection matrix");
+
+  // Object data for the vertex shaders
+  for (auto const &i : vGroups) {
+    if (!bindStorage(i.pipeline->getShader(), VK_SHADER_STAGE_VERTEX_BIT, OBJECTS_BLOCK, vObjectBuffer))
+      return false;
+  }
+
+  VkPipelineShaderStageCreateInfo lStage = {};
+  bool                            lFound = false;
+  for (auto const &i : vShader->getShaderStageInfo()) {
+    if (i.stage == VK_SHADER_STAGE_COMPUTE_BIT) {
+      lStage = i;
+      lFound = true;
+    }
+  }
+
+  if (!lFound) {
+    eLOG("Failed to get compute stage of ", vShader->getName());
+    return false;
+  }
+
+  VkComputePipelineCreateInfo lInfo = {};
+  lInfo.sType                       = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  lInfo.pNext                       = nullptr;
+  lInfo.flags                       = 0;
+  lInfo.stage                       = lStage;
+  lInfo.layout                      = vShader->getPipelineLayout();
+  lInfo.basePipelineHandle          = VK_NULL_HANDLE;
+  lInfo.basePipelineIndex           = -1;
+
+  auto lRes = vkCreateComputePipelines(**vDevice, VK_NULL_HANDLE, 1, &lInfo, nullptr, &vPipeline_vk);
+  if (lRes) {
+    eLOG("'vkCreateComputePipelines' returned ", uEnum2Str::toStr(lRes));
+    vPipeline_vk = VK_NULL_HANDLE;
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Binds _buffer to the storage block _name of _shader
+ * \returns false if the shader has no such block or binding fails
+ */
+bool rGPUCulling::bindStorage(rShaderBase *         _shader,
+                              VkShaderStageFlagBits _stage,
+                              std::string const &   _name,
+                              vkuBuffer &           _buffer) {
+  for (auto const &i : _shader->getStorageBuffers(_stage))
+    if (i.name == _name)
+      return _shader->updateStorageBuffer(i, *_buffer);
+
+  eLOG("Shader ", _shader->getName(), " has no storage block named ", _name);
+  return false;
+}
+
+/*!
+ * \brief Writes the transforms, bounds and index ranges of all objects into the storage buffer
+ */
+bool rGPUCulling::writeObjectData() {
+  auto lAccess = vObjectBuffer.getBufferAccess();
+  if (!lAccess) {
+    eLOG(L"Failed to bind vulkan memory");
+    return false;
+  }
+
+  ObjectData *lData = reinterpret_cast<ObjectData *>(*lAccess);
+
+  for (size_t i = 0; i < vObjects.size(); ++i) {
+    rObjectBase::IndirectDrawData lDraw;
+    if (!vObjects[i]->getIndirectDrawData(lDraw)) {
+      lData[i].indexCount = 0; // Draws nothing
+      continue;
+    }
+
+    lData[i].model        = lDraw.model;
+    lData[i].boundsMin    = glm::vec4(lDraw.bounds.min, 1.0f);
+    lData[i].boundsMax    = glm::vec4(lDraw.bounds.max, 1.0f);
+    lData[i].indexCount   = lDraw.geometry.numIndexes;
+    lData[i].firstIndex   = lDraw.geometry.firstIndex;
+    lData[i].vertexOffset = lDraw.geometry.vertexOffset;
+    lData[i].padding      = 0;
+  }
+
+  return true;
+}
+
+void rGPUCulling::destroy() {
+  if (vPipeline_vk != VK_NULL_HANDLE)
+    vkDestroyPipeline(**vDevice, vPipeline_vk, nullptr);
+
+  vPipeline_vk = VK_NULL_HANDLE;
+  vShader      = nullptr;
+  vHasViewProj = false;
+
+  vObjectBuffer.destroy();
+  vDrawBuffer.destroy();
+  vObjects.clear();
+  vGroups.clear();
+}
+
+/*!
+ * \brief Sets the queue families that execute cmdCull and cmdDraw (only affects the next init)
+ *
+ * Duplicates are removed. The buffers are shared concurrently when more than one family remains.
+ */
+void rGPUCulling::setQueueFamilies(std::vector<uint32_t> _families) {
+  std::sort(_families.begin(), _families.end());
+  _families.erase(std::unique(_families.begin(), _families.end()), _families.end());
+  vQueueFamilies = _families;
+}
+
+/*!
+ * \brief Updates the object data and the view projection matrix (call once per frame)
+ * \note This function does NO MEMORY SYNCHRONISATION (same as rShaderBase::updateUniform)
+ */
+void rGPUCulling::update() {
+  if (!isEnabled())
+    return;
+
+  writeObjectData();
+
+  glm::mat4 *lViewProj = nullptr;
+  if (vHasViewProj && vObjects[0]->getMatrix(&lViewProj, rObjectBase::CAMERA_MATRIX) == 0)
+    vShader->updateUniform(vViewProjVar, glm::value_ptr(*lViewProj));
+}
+
+/*!
+ * \brief Records the culling dispatch (must be recorded outside of a render pass)
+ * \vkIntern
+ */
+void rGPUCulling::cmdCull(VkCommandBuffer _buf) {
+  if (!isEnabled())
+    return;
+
+  // The draws of the previous frame must have read the commands before they are overwritten
+  vkCmdPipelineBarrier(_buf,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       0,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr);
+
+  uint32_t lNumObjects = static_cast<uint32_t>(vObjects.size());
+
+  vkCmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_COMPUTE, vPipeline_vk);
+  vShader->cmdBindDescriptorSets(_buf, VK_PIPELINE_BIND_POINT_COMPUTE);
+  vkCmdDispatch(_buf, (lNumObjects + LOCAL_SIZE - 1) / LOCAL_SIZE, 1, 1);
+
+  VkBufferMemoryBarrier lBarrier = {};
+  lBarrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  lBarrier.pNext                 = nullptr;
+  lBarrier.srcAccessMask         = VK_ACCESS_SHADER_WRITE_BIT;
+  lBarrier.dstAccessMask         = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  lBarrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+  lBarrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+  lBarrier.buffer                = *vDrawBuffer;
+  lBarrier.offset                = 0;
+  lBarrier.size                  = VK_WHOLE_SIZE;
+
+  vkCmdPipelineBarrier(_buf,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                       0,
+                       0,
+                       nullptr,
+                       1,
+                       &lBarrier,
+                       0,
+                       nullptr);
+}
+
+/*!
+ * \brief Records the indirect draws of all groups (viewport and scissors must already be set)
+ * \vkIntern
+ */
+void rGPUCulling::cmdDraw(VkCommandBuffer _buf) {
+  if (!isEnabled())
+    return;
+
+  VkDeviceSize lOffsets[] = {0};
+  uint32_t     lStride    = sizeof(VkDrawIndexedIndirectCommand);
+
+  for (auto const &i : vGroups) {
+    i.pipeline->cmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    i.pipeline->getShader()->cmdBindDescriptorSets(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+    vkCmdBindVertexBuffers(_buf, i.pipeline->getVertexBindPoint(), 1, &i.vertexBuffer, &lOffsets[0]);
+    vkCmdBindIndexBuffer(_buf, i.indexBuffer, 0, i.indexType);
+
+    if (vMultiDraw) {
+      vkCmdDrawIndexedIndirect(_buf, *vDrawBuffer, i.firstDraw * lStride, i.numDraws, lStride);
+      continue;
+    }
+
+    for (uint32_t j = 0; j < i.numDraws; ++j)
+      vkCmdDrawIndexedIndirect(_buf, *vDrawBuffer, (i.firstDraw + j) * lStride, 1, lStride);
+  }
+}
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,133 @@
+/*!
+ * \file rGPUCulling.hpp
+ * \brief \b Classes: \a rGPUCulling
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuBuffer.hpp"
+#include "vkuDevice.hpp"
+#include "rShaderBase.hpp"
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+class rObjectBase;
+class rPipeline;
+
+/*!
+ * \brief Frustum culling on the GPU, generating the draw commands for indirect draws
+ *
+ * All objects supporting rObjectBase::getIndirectDrawData are stored in a storage buffer and are
+ * grouped by pipeline and geometry block (rGeometryArena). A compute shader culls them against the
+ * view frustum and writes one VkDrawIndexedIndirectCommand per object (instanceCount = 0 when
+ * culled). Every group is then drawn with a single vkCmdDrawIndexedIndirect.
+ *
+ * The command buffers only have to be recorded when the object list changes. Per frame only the
+ * object transforms are written into the storage buffer (update()).
+ *
+ * cmdCull may be recorded for another queue family than cmdDraw (i.e. the async compute queue). The
+ * buffers are then shared concurrently between the families set with setQueueFamilies().
+ *
+ * The culling shader needs:
+ *  - local_size_x = LOCAL_SIZE
+ *  - a uniform block with the view projection matrix (viewProject)
+ *  - two storage blocks: the object data (ObjectData[], named OBJECTS_BLOCK) and the draw commands
+ *    (named COMMANDS_BLOCK)
+ *
+ * The vertex shaders of the objects get the object data in their storage block named OBJECTS_BLOCK
+ * and index it with gl_InstanceIndex (firstInstance is the object index).
+ */
+class rGPUCulling {
+ public:
+  static const uint32_t    LOCAL_SIZE = 64;
+  static const std::string OBJECTS_BLOCK;
+  static const std::string COMMANDS_BLOCK;
+
+  //! std430 layout of one object in the object storage buffer
+  struct ObjectData {
+    glm::mat4 model;
+    glm::vec4 boundsMin;
+    glm::vec4 boundsMax;
+    uint32_t  indexCount;
+    uint32_t  firstIndex;
+    int32_t   vertexOffset;
+    uint32_t  padding;
+  };
+
+ private:
+  struct DrawGroup {
+    rPipeline * pipeline;
+    VkBuffer    vertexBuffer;
+    VkBuffer    indexBuffer;
+    VkIndexType indexType;
+    uint32_t    firstDraw;
+    uint32_t    numDraws;
+  };
+
+  vkuDevicePTR vDevice;
+  vkuBuffer    vObjectBuffer;
+  vkuBuffer    vDrawBuffer;
+
+  rShaderBase *vShader      = nullptr;
+  VkPipeline   vPipeline_vk = VK_NULL_HANDLE;
+
+  rShaderBase::UniformBuffer::Var vViewProjVar;
+
+  std::vector<std::shared_ptr<rObjectBase>> vObjects; //!< Sorted by draw group
+  std::vector<DrawGroup>                    vGroups;
+  std::vector<uint32_t>                     vQueueFamilies;
+
+  bool vHasViewProj = false;
+  bool vMultiDraw   = false;
+
+  bool initPipeline();
+  bool bindStorage(rShaderBase *_shader, VkShaderStageFlagBits _stage, std::string const &_name, vkuBuffer &_buffer);
+  bool writeObjectData();
+
+ public:
+  rGPUCulling(vkuDevicePTR _device);
+  ~rGPUCulling();
+
+  rGPUCulling(rGPUCulling const &) = delete;
+  rGPUCulling &operator=(rGPUCulling const &) = delete;
+
+  bool init(rShaderBase *_shader, std::vector<std::shared_ptr<rObjectBase>> const &_objects);
+  void destroy();
+  void update();
+  void setQueueFamilies(std::vector<uint32_t> _families);
+
+  void cmdCull(VkCommandBuffer _buf);
+  void cmdDraw(VkCommandBuffer _buf);
+
+  inline bool isEnabled() const noexcept { return vPipeline_vk != VK_NULL_HANDLE; }
+
+  std::vector<std::shared_ptr<rObjectBase>> const &getObjects() const { return vObjects; }
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
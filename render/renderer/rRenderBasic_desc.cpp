@@ -24,6 +24,11 @@ using namespace e_engine;
 /*!
  * \brief Returns a complete description of the render pass (+ framebuffer image formats)
  * \param _surfaceFormat The surface format of the swapchain
+ *
+ * The depth buffer is never read after the render pass, so it is a transient attachment.
+ *
+ * With the depth pre-pass, a depth only subpass is inserted before the main subpass (which becomes
+ * subpass 1).
  */
 vkuRenderPass::Config rRendererBasic::getRenderPassDescription(VkSurfaceFormatKHR _surfaceFormat) {
   // Query some vaiables
@@ -41,7 +46,9 @@ vkuRenderPass::Config rRendererBasic::getRenderPassDescription(VkSurfaceFormatKH
       0     // stencil
   };
 
-  return {
+  VkImageUsageFlags lDepthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+  vkuRenderPass::Config lConfig = {
 
       // ===============
       // = Attachments =
@@ -82,9 +89,9 @@ vkuRenderPass::Config rRendererBasic::getRenderPassDescription(VkSurfaceFormatKH
                   lDepthFormat,                                     // format
                   VK_SAMPLE_COUNT_1_BIT,                            // samples
                   VK_ATTACHMENT_LOAD_OP_CLEAR,                      // loadOp
-                  VK_ATTACHMENT_STORE_OP_STORE,                     // storeOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE,                 // storeOp
                   VK_ATTACHMENT_LOAD_OP_CLEAR,                      // stencilLoadOp
-                  VK_ATTACHMENT_STORE_OP_STORE,                     // stencilStoreOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE,                 // stencilStoreOp
                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, // initialLayout
                   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL  // finalLayout
               },
@@ -94,13 +101,13 @@ vkuRenderPass::Config rRendererBasic::getRenderPassDescription(VkSurfaceFormatKH
 
               // Buffer create info
               {
-                  VK_IMAGE_TYPE_2D,                            // type
-                  1,                                           // mipLevels
-                  1,                                           // arrayLayers
-                  VK_IMAGE_TILING_OPTIMAL,                     // tiling
-                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, // usage
-                  VK_SHARING_MODE_EXCLUSIVE,                   // sharingMode
-                  {lAspectFlags, 0, 1, 0, 1}                   // subresourceRange
+                  VK_IMAGE_TYPE_2D,          // type
+                  1,                         // mipLevels
+                  1,                         // arrayLayers
+                  VK_IMAGE_TILING_OPTIMAL,   // tiling
+                  lDepthUsage,               // usage
+                  VK_SHARING_MODE_EXCLUSIVE, // sharingMode
+                  {lAspectFlags, 0, 1, 0, 1} // subresourceRange
               }
 
           }
@@ -169,4 +176,40 @@ vkuRenderPass::Config rRendererBasic::getRenderPassDescription(VkSurfaceFormatKH
       }
 
   };
+
+  if (!vPrePass)
+    return lConfig;
+
+  for (auto &i : lConfig.dependencies) {
+    i.srcSubpass = i.srcSubpass == 0 ? 1 : i.srcSubpass;
+    i.dstSubpass = i.dstSubpass == 0 ? 1 : i.dstSubpass;
+  }
+
+  // ====== SUBPASS 0 ----- Depth pre-pass ======
+  lConfig.subpasses.insert(lConfig.subpasses.begin(),
+                           {
+                               0,                               // flags
+                               VK_PIPELINE_BIND_POINT_GRAPHICS, // pipelineBindPoint
+                               {},                              // inputAttachments
+                               {},                              // colorAttachments
+                               {},                              // resolveAttachments
+
+                               // depthStencilAttachment (ATTACHMENT 1)
+                               {1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+
+                               {} // preserveAttachments
+                           });
+
+  // ====== DEPENDENCY 2 ----- Depth of the pre-pass is tested in the main pass ======
+  lConfig.dependencies.push_back({
+      0,                                                                                         // srcSubpass
+      1,                                                                                         // dstSubpass
+      VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,                                                 // srcStageMask
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,                                                // dstStageMask
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,                                              // srcAccessMask
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, // dstAccessMask
+      VK_DEPENDENCY_BY_REGION_BIT                                                                // dependencyFlags
+  });
+
+  return lConfig;
 }
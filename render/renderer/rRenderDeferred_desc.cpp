@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "defines.hpp"
+#include "rRendererDeferred.hpp"
+
+using namespace e_engine;
+
+/*!
+ * \brief Returns a complete description of the G-buffer render pass (+ framebuffer image formats)
+ *
+ * G-buffer layout (12 bytes per pixel with a 32 bit depth buffer):
+ *  - octahedral encoded view space normal (RG16F)
+ *  - albedo + specular intensity (RGBA8)
+ *  - depth (the view space position is reconstructed from it)
+ *
+ * All attachments are sampled by the lighting pass, so they end in a read only layout.
+ */
+vkuRenderPass::Config rRendererDeferred::getRenderPassDescription() {
+  // The depth buffer is sampled ==> no stencil (the image view would need both aspects)
+  VkFormat lDepthFormat = VK_FORMAT_UNDEFINED;
+  for (auto i : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM}) {
+    if (vDevice->formatSupportsFeature(i, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(i, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT, VK_IMAGE_TILING_OPTIMAL)) {
+      lDepthFormat = i;
+      break;
+    }
+  }
+
+  if (lDepthFormat == VK_FORMAT_UNDEFINED)
+    eLOG("Unable to find a sampleable depth format for the G-buffer");
+
+  VkClearValue lColorClear;
+  VkClearValue lDepthClear;
+
+  lColorClear.color        = {{0.0f, 0.0f, 0.0f, 0.0f}};
+  lDepthClear.depthStencil = {
+      1.0f, // depth (1.0 marks the background)
+      0     // stencil
+  };
+
+  VkPipelineStageFlags lLastFrameStages =
+      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  VkPipelineStageFlags lGBufferStages =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  VkPipelineStageFlags lGBufferDoneStages =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  VkAccessFlags lGBufferAccess = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  return {
+
+      // ===============
+      // = Attachments =
+      // ===============
+
+      {
+
+          // ====== ATTACHMENT 0 ----- View space normal (octahedral) ======
+          {
+
+              // Attachment Description
+              {
+                  0,                                       // flags
+                  VK_FORMAT_R16G16_SFLOAT,                 // format
+                  VK_SAMPLE_COUNT_1_BIT,                   // samples
+                  VK_ATTACHMENT_LOAD_OP_CLEAR,             // loadOp
+                  VK_ATTACHMENT_STORE_OP_STORE,            // storeOp
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE,         // stencilLoadOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE,        // stencilStoreOp
+                  VK_IMAGE_LAYOUT_UNDEFINED,               // initialLayout
+                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // finalLayout
+              },
+
+              // Clear color
+              lColorClear,
+
+              // Buffer create info
+              {
+                  VK_IMAGE_TYPE_2D,                                                 // type
+                  1,                                                                // mipLevels
+                  1,                                                                // arrayLayers
+                  VK_IMAGE_TILING_OPTIMAL,                                          // tiling
+                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // usage
+                  VK_SHARING_MODE_EXCLUSIVE,                                        // sharingMode
+                  {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}                           // subresourceRange
+              }
+
+          },
+
+          // ====== ATTACHMENT 1 ----- Albedo + specular intensity ======
+          {
+
+              // Attachment Description
+              {
+                  0,                                       // flags
+                  VK_FORMAT_R8G8B8A8_UNORM,                // format
+                  VK_SAMPLE_COUNT_1_BIT,                   // samples
+                  VK_ATTACHMENT_LOAD_OP_CLEAR,             // loadOp
+                  VK_ATTACHMENT_STORE_OP_STORE,            // storeOp
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE,         // stencilLoadOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE,        // stencilStoreOp
+                  VK_IMAGE_LAYOUT_UNDEFINED,               // initialLayout
+                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL // finalLayout
+              },
+
+              // Clear color
+              lColorClear,
+
+              // Buffer create info
+              {
+                  VK_IMAGE_TYPE_2D,                                                 // type
+                  1,                                                                // mipLevels
+                  1,                                                                // arrayLayers
+                  VK_IMAGE_TILING_OPTIMAL,                                          // tiling
+                  VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // usage
+                  VK_SHARING_MODE_EXCLUSIVE,                                        // sharingMode
+                  {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}                           // subresourceRange
+              }
+
+          },
+
+          // ====== ATTACHMENT 2 ----- Depth buffer ======
+          {
+
+              // Attachment Description
+              {
+                  0,                                              // flags
+                  lDepthFormat,                                   // format
+                  VK_SAMPLE_COUNT_1_BIT,                          // samples
+                  VK_ATTACHMENT_LOAD_OP_CLEAR,                    // loadOp
+                  VK_ATTACHMENT_STORE_OP_STORE,                   // storeOp
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE,                // stencilLoadOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE,               // stencilStoreOp
+                  VK_IMAGE_LAYOUT_UNDEFINED,                      // initialLayout
+                  VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL // finalLayout
+              },
+
+              // Clear color
+              lDepthClear,
+
+              // Buffer create info
+              {
+                  VK_IMAGE_TYPE_2D,                                                         // type
+                  1,                                                                        // mipLevels
+                  1,                                                                        // arrayLayers
+                  VK_IMAGE_TILING_OPTIMAL,                                                  // tiling
+                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, // usage
+                  VK_SHARING_MODE_EXCLUSIVE,                                                // sharingMode
+                  {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1}                                   // subresourceRange
+              }
+
+          }
+
+      },
+
+      // =============
+      // = Subpasses =
+      // =============
+      {
+
+          // ====== SUBPASS 0 ----- G-buffer ======
+          {
+
+              0,                               // flags
+              VK_PIPELINE_BIND_POINT_GRAPHICS, // pipelineBindPoint
+
+              // inputAttachments
+              {},
+
+              // colorAttachments
+              {
+                  {0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}, // ATTACHMENT 0
+                  {1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL}  // ATTACHMENT 1
+              },
+
+              // resolveAttachments
+              {},
+
+              // depthStencilAttachment (ATTACHMENT 2)
+              {2, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+
+              // preserveAttachments
+              {}
+
+          }
+
+      },
+
+      // ========================
+      // = Subpass dependencies =
+      // ========================
+      {
+
+          // ====== DEPENDENCY 0 ----- lighting pass / depth test of the last frame ======
+          {
+              VK_SUBPASS_EXTERNAL,                          // srcSubpass
+              0,                                            // dstSubpass
+              lLastFrameStages,                             // srcStageMask
+              lGBufferStages,                               // dstStageMask
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, // srcAccessMask
+              lGBufferAccess,                               // dstAccessMask
+              0                                             // dependencyFlags
+          },
+
+          // ====== DEPENDENCY 1 ----- G-buffer is read by the lighting pass ======
+          {
+              0,                                    // srcSubpass
+              VK_SUBPASS_EXTERNAL,                  // dstSubpass
+              lGBufferDoneStages,                   // srcStageMask
+              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, // dstStageMask
+              lGBufferAccess,                       // srcAccessMask
+              VK_ACCESS_SHADER_READ_BIT,            // dstAccessMask
+              0                                     // dependencyFlags
+          },
+
+      }
+
+  };
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "defines.hpp"
+#include "rRendererShadow.hpp"
+
+using namespace e_engine;
+
+/*!
+ * \brief Returns a depth only render pass for one shadow map / cache layer
+ *
+ * The 3 render passes only differ in the load op and the layouts, so they are compatible and share
+ * the same pipeline and framebuffers. The images are created by the renderer (array layers), so the
+ * buffer create info is not used.
+ *
+ * \param _loadOp        VK_ATTACHMENT_LOAD_OP_LOAD to draw on top of a copied cache layer
+ * \param _initialLayout Layout of the layer before the pass
+ * \param _finalLayout   Layout of the layer after the pass (sampled or copied)
+ */
+vkuRenderPass::Config rRendererShadow::getRenderPassDescription(VkAttachmentLoadOp _loadOp,
+                                                                VkImageLayout      _initialLayout,
+                                                                VkImageLayout      _finalLayout) {
+  VkClearValue lDepthClear;
+  lDepthClear.depthStencil = {
+      1.0f, // depth
+      0     // stencil
+  };
+
+  VkPipelineStageFlags lBeforeStages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  VkPipelineStageFlags lDepthStages =
+      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  VkPipelineStageFlags lAfterStages =
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkAccessFlags lDepthAccess =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  return {
+
+      // ===============
+      // = Attachments =
+      // ===============
+
+      {
+
+          // ====== ATTACHMENT 0 ----- Shadow map layer ======
+          {
+
+              // Attachment Description
+              {
+                  0,                                // flags
+                  vDepthFormat,                     // format
+                  VK_SAMPLE_COUNT_1_BIT,            // samples
+                  _loadOp,                          // loadOp
+                  VK_ATTACHMENT_STORE_OP_STORE,     // storeOp
+                  VK_ATTACHMENT_LOAD_OP_DONT_CARE,  // stencilLoadOp
+                  VK_ATTACHMENT_STORE_OP_DONT_CARE, // stencilStoreOp
+                  _initialLayout,                   // initialLayout
+                  _finalLayout                      // finalLayout
+              },
+
+              // Clear color
+              lDepthClear,
+
+              // Buffer create info (unused)
+              {
+                  VK_IMAGE_TYPE_2D,                            // type
+                  1,                                           // mipLevels
+                  1,                                           // arrayLayers
+                  VK_IMAGE_TILING_OPTIMAL,                     // tiling
+                  VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, // usage
+                  VK_SHARING_MODE_EXCLUSIVE,                   // sharingMode
+                  {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1}      // subresourceRange
+              }
+
+          }
+
+      },
+
+      // =============
+      // = Subpasses =
+      // =============
+      {
+
+          // ====== SUBPASS 0 ----- Depth only ======
+          {
+
+              0,                               // flags
+              VK_PIPELINE_BIND_POINT_GRAPHICS, // pipelineBindPoint
+
+              // inputAttachments
+              {},
+
+              // colorAttachments
+              {},
+
+              // resolveAttachments
+              {},
+
+              // depthStencilAttachment (ATTACHMENT 0)
+              {0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL},
+
+              // preserveAttachments
+              {}
+
+          }
+
+      },
+
+      // ========================
+      // = Subpass dependencies =
+      // ========================
+      {
+
+          // ====== DEPENDENCY 0 ----- cache copy / sampling of the last frame ======
+          {
+              VK_SUBPASS_EXTERNAL,                                                         // srcSubpass
+              0,                                                                           // dstSubpass
+              lBeforeStages,                                                               // srcStageMask
+              lDepthStages,                                                                // dstStageMask
+              VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, // srcAccessMask
+              lDepthAccess,                                                                // dstAccessMask
+              0                                                                            // dependencyFlags
+          },
+
+          // ====== DEPENDENCY 1 ----- layer is sampled or copied ======
+          {
+              0,                                                       // srcSubpass
+              VK_SUBPASS_EXTERNAL,                                     // dstSubpass
+              VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,               // srcStageMask
+              lAfterStages,                                            // dstStageMask
+              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,            // srcAccessMask
+              VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT, // dstAccessMask
+              0                                                        // dependencyFlags
+          },
+
+      }
+
+  };
+}
@@ -25,8 +25,10 @@
 #include "vkuCommandPoolManager.hpp"
 #include "vkuFence.hpp"
 #include "iInit.hpp"
+#include "rLightManager.hpp"
 #include "rPipeline.hpp"
 #include "rObjectBase.hpp"
+#include "rRenderGraph.hpp"
 #include "rScene.hpp"
 #include "rShaderBase.hpp"
 #include "rWorld.hpp"
@@ -46,6 +48,8 @@
 
 using namespace e_engine;
 
+const std::string rRendererBase::SWAPCHAIN_RESOURCE = "swapchain";
+
 rRendererBase::rRendererBase(rWorld *_root, std::wstring _id) : vID(_id), vWorldPtr(_root) {
   vDevice    = vWorldPtr->getDevice();
   vDevice_vk = **vDevice;
@@ -97,6 +101,10 @@ int rRendererBase::init(vkuCommandPool *_pool) {
 
   vImages = lSwapChain->getImages();
 
+  // The light buffer must exist before the renderer binds it
+  if (vLightManager && !vLightManager->init())
+    return 3;
+
   if (initRenderer(vImages, lSwapChain->getFormat(), _pool))
     return 2;
 
@@ -161,6 +169,7 @@ void rRendererBase::recordCmdBuffersWrapper(uint32_t &_fbIndex, RECORD_TARGET _t
   vCmdRecordInfo.lInherit.sType                = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
   vCmdRecordInfo.lInherit.pNext                = nullptr;
   vCmdRecordInfo.lInherit.renderPass           = getRenderPass();
+  vCmdRecordInfo.lInherit.subpass              = getObjectSubpass();
   vCmdRecordInfo.lInherit.framebuffer          = getFrameBuffer(_fbIndex);
   vCmdRecordInfo.lInherit.occlusionQueryEnable = VK_FALSE;
   vCmdRecordInfo.lInherit.queryFlags           = 0;
@@ -172,33 +181,40 @@ void rRendererBase::recordCmdBuffersWrapper(uint32_t &_fbIndex, RECORD_TARGET _t
 void rRendererBase::updateRenderer() {
   std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
 
-  // Destroy old pipelines
-  for (auto &i : vObjects) {
-    rPipeline *  lPipe   = i->getPipeline();
-    rShaderBase *lShader = i->getShader();
-    if (lPipe != nullptr) {
-      if (lPipe->getIsCreated()) {
-        lPipe->destroy();
+  // Renderers with their own pipelines must not touch the pipelines of the objects
+  if (usesObjectPipelines()) {
+    // Destroy old pipelines
+    for (auto &i : vObjects) {
+      rPipeline *  lPipe   = i->getPipeline();
+      rShaderBase *lShader = i->getShader();
+      if (lPipe != nullptr) {
+        if (lPipe->getIsCreated()) {
+          lPipe->destroy();
+        }
       }
-    }
 
-    // Clear reserved uniforms, part of making sure not to change one uniform more than once
-    if (lShader != nullptr) {
-      lShader->signalRenderReset();
+      // Clear reserved uniforms, part of making sure not to change one uniform more than once
+      if (lShader != nullptr) {
+        lShader->signalRenderReset();
+      }
     }
-  }
 
-  // Create new pipelines
-  for (auto &i : vObjects) {
-    rPipeline *lPipe = i->getPipeline();
-    if (lPipe != nullptr) {
-      if (!lPipe->getIsCreated()) {
-        lPipe->create(vDevice_vk, getRenderPass(), 0);
+    // Create new pipelines
+    for (auto &i : vObjects) {
+      rPipeline *lPipe = i->getPipeline();
+      if (lPipe != nullptr) {
+        if (!lPipe->getIsCreated()) {
+          lPipe->create(vDevice_vk, getRenderPass(), getObjectSubpass());
+        }
       }
-    }
 
-    // Setup object for rendering (preparing uniforms)
-    i->signalRenderReset(this);
+      // Setup object for rendering (preparing uniforms)
+      i->signalRenderReset(this);
+
+      // Forward shaders may read the lights of the scene
+      if (vLightManager)
+        vLightManager->bindToShader(i->getShader());
+    }
   }
 
   // Record all command buffers
@@ -206,9 +222,63 @@ void rRendererBase::updateRenderer() {
     recordCmdBuffersWrapper(i, RECORD_ALL);
 }
 
+/*!
+ * \brief Writes the texture descriptors of the objects again and records all command buffers
+ *
+ * Cheaper than updateRenderer() (the pipelines are kept). Used after the image views of textures
+ * changed (rTextureStreamer).
+ *
+ * \note Requires external synchronisation with the Render Loop Lock
+ */
+void rRendererBase::updateTextures() {
+  std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
+
+  if (!vIsSetup)
+    return;
+
+  if (usesObjectPipelines())
+    for (auto &i : vObjects)
+      i->signalTexturesChanged();
+
+  for (uint32_t i = 0; i < vImages.size(); ++i)
+    recordCmdBuffersWrapper(i, RECORD_ALL);
+}
+
 void rRendererBase::updateUniforms() {
-  for (auto i : vObjects)
-    i->updateUniforms();
+  if (usesObjectPipelines())
+    for (auto i : vObjects)
+      i->updateUniforms();
+
+  if (vLightManager)
+    vLightManager->update();
+
+  updateRendererData();
+}
+
+
+/*!
+ * \brief Declares the resources this renderer uses in the render graph of the world
+ *
+ * The default reads all resources added with addGraphRead and renders into the swapchain image.
+ * rWorld submits the renderers in the order of the graph and skips renderers whose output is not used.
+ */
+void rRendererBase::declareGraphPass(rRenderGraph &_graph, uint32_t _pass) {
+  std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
+  for (auto const &i : vGraphReads)
+    _graph.read(_pass, i, rRenderGraph::SAMPLED_GRAPHICS);
+
+  _graph.write(_pass, SWAPCHAIN_RESOURCE, rRenderGraph::COLOR_ATTACHMENT);
+}
+
+/*!
+ * \brief Marks a render graph resource (i.e. rRendererShadow::getGraphResource) as read by this renderer
+ *
+ * The writer of the resource is submitted before this renderer and is not culled.
+ * \note Only takes effect with the next rWorld::rebuildRenderers
+ */
+void rRendererBase::addGraphRead(std::string _resource) {
+  std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
+  vGraphReads.emplace_back(_resource);
 }
 
 
@@ -216,6 +286,10 @@ void rRendererBase::updateUniforms() {
  * \brief Adds all objects form a scene to the renderer
  */
 bool rRendererBase::renderScene(rSceneBase *_scene) {
+  std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
+
+  vScene        = _scene;
+  vLightManager = _scene->getLightManager();
   for (auto const &i : _scene->getObjects()) {
     addObject(i);
   }
@@ -237,6 +311,8 @@ bool rRendererBase::resetObjects() {
   std::lock_guard<std::recursive_mutex> lGuard(vMutexRecordData);
 
   vObjects.clear();
+  vScene        = nullptr;
+  vLightManager = nullptr;
   return true;
 }
 
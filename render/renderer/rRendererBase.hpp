@@ -28,6 +28,7 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <unordered_map>
 #include <vector>
@@ -39,6 +40,8 @@ class rWorld;
 class rObjectBase;
 class rRenderLoop;
 class rSceneBase;
+class rLightManager;
+class rRenderGraph;
 
 /*!
  * \brief Main render class
@@ -62,18 +65,23 @@ class rRendererBase {
       std::vector<VkSubmitInfo> submitInfos;
     };
 
-    std::vector<FBInfo> fb;     //!< Submit infos. Must be empty or have an element for each swapchain image
-    FBInfo              shared; //!< Submit info for single framebuffer systems.
+    std::vector<FBInfo> fb;      //!< Submit infos. Must be empty or have an element for each swapchain image
+    FBInfo              shared;  //!< Submit info for single framebuffer systems.
+    FBInfo              compute; //!< Submitted to the compute queue (rRenderLoop::getComputeQueueFamilyIndex)
   };
 
   using OBJECTS = std::vector<std::shared_ptr<rObjectBase>>;
 
   enum RECORD_TARGET { RECORD_ALL, RECORD_PUSH_CONST_ONLY };
-  enum ATTACHMENT_ROLE { DEPTH_STENCIL, DEFERRED_POSITION, DEFERRED_NORMAL, DEFERRED_ALBEDO };
+  enum ATTACHMENT_ROLE { DEPTH_STENCIL, DEFERRED_NORMAL, DEFERRED_ALBEDO };
+
+  static const std::string SWAPCHAIN_RESOURCE; //!< Render graph name of the swapchain image
 
  private:
   std::wstring vID;
 
+  std::vector<std::string> vGraphReads; //!< Render graph resources read by this renderer
+
   std::recursive_mutex vMutexRecordData;
 
   SwapChainImages vImages;
@@ -98,6 +106,9 @@ class rRendererBase {
 
   OBJECTS vObjects;
 
+  rSceneBase *   vScene        = nullptr; //!< The rendered scene (set in renderScene)
+  rLightManager *vLightManager = nullptr; //!< Light manager of the rendered scene (set in renderScene)
+
   virtual VkResult initRenderer(SwapChainImages _images, VkSurfaceFormatKHR _surfaceFormat, vkuCommandPool *_pool) = 0;
   virtual void     destroyRenderer()                                                                               = 0;
   virtual void     recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender)                                   = 0;
@@ -106,8 +117,14 @@ class rRendererBase {
   virtual VkFramebuffer             getFrameBuffer(uint32_t _fbIndex) = 0;
   virtual std::vector<VkClearValue> getClearValues()                  = 0;
 
+  //! \brief false if the renderer draws the objects with its own pipelines (i.e. depth only passes)
+  virtual bool usesObjectPipelines() const { return true; }
+  //! \brief The subpass the objects are drawn in (their pipelines are created for it)
+  virtual uint32_t getObjectSubpass() const { return 0; }
+
   virtual bool initRendererData() { return true; }
   virtual bool freeRendererData() { return true; }
+  virtual void updateRendererData() {}
 
  public:
   rRendererBase() = delete;
@@ -121,6 +138,11 @@ class rRendererBase {
   virtual VkImageView getAttachmentView(ATTACHMENT_ROLE _role) = 0;
   virtual SubmitInfo  getVulkanSubmitInfos()                   = 0;
 
+  virtual void declareGraphPass(rRenderGraph &_graph, uint32_t _pass);
+
+  void        addGraphRead(std::string _resource);
+  std::string getGraphName() const { return std::string(vID.begin(), vID.end()); }
+
   bool renderScene(rSceneBase *_scene);
   bool addObject(std::shared_ptr<rObjectBase> _obj);
   bool resetObjects();
@@ -138,9 +160,11 @@ class rRendererBase {
 
   void setClearColor(VkClearColorValue _clearColor);
 
-  uint32_t getNumFramebuffers() const;
+  uint32_t    getNumFramebuffers() const;
+  rSceneBase *getScene() const { return vScene; }
 
   void updateRenderer();
+  void updateTextures();
   void updatePushConstants(uint32_t _framebuffer);
 };
 } // namespace e_engine
@@ -24,9 +24,17 @@
 #include "uConfig.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
-#include "rPipeline.hpp"
+#include "rMatrixSceneBase.hpp"
+#include "vkuCommandPoolManager.hpp"
 #include "rObjectBase.hpp"
+#include "rRenderLoop.hpp"
+#include "rScene.hpp"
 #include "rWorld.hpp"
+#include <algorithm>
+#include <cstring>
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+#include <glm/vec4.hpp>
 
 using namespace e_engine;
 
@@ -35,6 +43,16 @@ VkResult rRendererBasic::initRenderer(SwapChainImages    _images,
                                       vkuCommandPool *   _pool) {
   vFbData.resize(_images.size());
 
+  // The pre-pass changes the subpass layout, so this must be known before the render pass is created
+  vPrePass = false;
+  if (vPrePassShader) {
+    vPrePass = true;
+    if (!initPrePass()) {
+      wLOG("Failed to setup the depth pre-pass ==> rendering without it");
+      vPrePass = false;
+    }
+  }
+
   // ==> Setup render pass
   vRenderPass.setup(getRenderPassDescription(_surfaceFormat));
 
@@ -57,6 +75,11 @@ VkResult rRendererBasic::initRenderer(SwapChainImages    _images,
     eLOG(L"Failed to create depth buffer ==> can not create framebuffer");
   }
 
+  if (vPrePass && !vPrePassPipeline.create(vDevice_vk, *vRenderPass, 0)) {
+    eLOG("Failed to create the depth pre-pass pipeline");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
   for (size_t i = 0; i < vFbData.size(); ++i) {
     vFbData[i].frameBuffer.setup(vRenderPass);
     lRes = vFbData[i].frameBuffer.reCreateFrameBuffers({
@@ -85,6 +108,24 @@ VkResult rRendererBasic::initRenderer(SwapChainImages    _images,
     i.cmdBuffer.init(_pool);
   }
 
+  //   -- GPU culled objects (culled on the compute queue)
+  if (vCullShader) {
+    auto *lLoop = vWorldPtr->getRenderLoop();
+    vCulling.setQueueFamilies({lLoop->getQueueFamilyIndex(), lLoop->getComputeQueueFamilyIndex()});
+
+    if (!vCulling.init(vCullShader, vObjects)) {
+      wLOG("Failed to init GPU culling ==> recording all objects");
+    } else {
+      // Only depends on the buffers of vCulling, so it is recorded once
+      vCullBuffer.init(vkuCommandPoolManager::get(vDevice_vk, lLoop->getComputeQueueFamilyIndex()));
+      vCullBuffer.begin();
+      vCulling.cmdCull(*vCullBuffer);
+      vCullBuffer.end();
+    }
+  }
+
+  auto const &lCulledObjects = vCulling.getObjects();
+
   //   -- Child object buffers
   for (auto i : vObjects) {
     if (i.get() == nullptr) {
@@ -92,30 +133,75 @@ VkResult rRendererBasic::initRenderer(SwapChainImages    _images,
       continue;
     }
 
+    if (std::find(lCulledObjects.begin(), lCulledObjects.end(), i) != lCulledObjects.end())
+      continue;
+
     if (i->isMesh()) {
       vRenderObjects.emplace_back(i);
     }
   }
 
+  vSortValid = false;
+
   for (auto &i : vFbData) {
-    i.buffers.resize(vRenderObjects.size());
-    for (auto &j : i.buffers) {
-      j.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
-    }
+    i.objectBuffer.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    i.pushConstBuffer.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    i.prePassBuffer.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    i.indirectBuffer.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
   }
 
   return lRes;
 }
 
+/*!
+ * \brief Checks the depth pre-pass shader and configures its pipeline (created with the render pass)
+ */
+bool rRendererBasic::initPrePass() {
+  if (!vScene || !dynamic_cast<rMatrixSceneBase<float> *>(vScene)) {
+    wLOG("The depth pre-pass needs a scene with a camera (renderScene)");
+    return false;
+  }
+
+  if (!vPrePassShader->has_vert()) {
+    wLOG("Invalid depth pre-pass shader (no vertex stage)");
+    return false;
+  }
+
+  bool lHasMVP = false;
+  for (auto const &i : vPrePassShader->getPushConstants(VK_SHADER_STAGE_VERTEX_BIT)) {
+    if (i.guessedRole == rShaderBase::MODEL_VIEW_PROJECTION_MATRIX) {
+      vPrePassMVPVar = i;
+      lHasMVP        = true;
+      break;
+    }
+  }
+
+  if (!lHasMVP) {
+    wLOG("Depth pre-pass shader ", vPrePassShader->getName(), " has no model view projection push constant");
+    return false;
+  }
+
+  vPrePassPipeline.setShader(vPrePassShader);
+  vPrePassPipeline.setNumColorAttachments(0)->enableDepthTest()->enableDepthBias();
+  return true;
+}
+
 void rRendererBasic::destroyRenderer() {
+  vCullBuffer.destroy();
+  vCulling.destroy();
+
+  if (vPrePassPipeline.getIsCreated())
+    vPrePassPipeline.destroy();
+
   vRenderPass.destroy();
   vFbData.clear();
   vDepthBuffer.destroy();
 
-  for (auto &i : vFbData)
-    i.buffers.clear();
-
   vRenderObjects.clear();
+  vDrawOrder.clear();
+  vPrePassOrder.clear();
+  vPrePass   = false;
+  vSortValid = false;
 }
 
 
@@ -144,49 +230,292 @@ rRendererBase::SubmitInfo rRendererBasic::getVulkanSubmitInfos() {
     lInfo.fb.push_back({{lSubInfo}});
   }
 
+  if (vCulling.isEnabled()) {
+    VkSubmitInfo lSubInfo;
+    lSubInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    lSubInfo.pNext                = nullptr;
+    lSubInfo.waitSemaphoreCount   = 0;
+    lSubInfo.pWaitSemaphores      = nullptr;
+    lSubInfo.pWaitDstStageMask    = nullptr;
+    lSubInfo.commandBufferCount   = 1;
+    lSubInfo.pCommandBuffers      = &vCullBuffer.get();
+    lSubInfo.signalSemaphoreCount = 0;
+    lSubInfo.pSignalSemaphores    = nullptr;
+
+    lInfo.compute.submitInfos.push_back(lSubInfo);
+  }
+
   return lInfo;
 }
 
 
 
+/*!
+ * \brief Returns the camera matrices of the rendered scene
+ * \returns false if the renderer does not render a scene with a camera
+ */
+bool rRendererBasic::getCameraMatrices(glm::mat4 &_view, glm::mat4 &_viewProj) {
+  auto *lCamera = dynamic_cast<rMatrixSceneBase<float> *>(vScene);
+  if (!lCamera)
+    return false;
+
+  _view     = *lCamera->getViewMatrix();
+  _viewProj = *lCamera->getProjectionMatrix() * _view;
+  return true;
+}
+
+/*!
+ * \brief Sorts the objects if the camera moved too far since the last sort
+ *
+ * The main pass is sorted by pipeline, then by shader (descriptor sets) and then front to back, so
+ * that as few binds as possible are recorded. The depth pre-pass only binds its own pipeline, so it
+ * is sorted purely front to back (the main pass then rarely has any overdraw).
+ *
+ * The front to back order only has to be roughly right, so the order is kept until the camera moved
+ * more than SORT_DISTANCE or turned more than SORT_ANGLE_COS (vSortVersion is incremented on a sort).
+ */
+void rRendererBasic::sortObjects() {
+  glm::mat4 lView;
+  glm::mat4 lViewProj;
+  bool      lHasCamera = getCameraMatrices(lView, lViewProj);
+
+  if (lHasCamera) {
+    glm::mat4 lInvView = glm::inverse(lView);
+    glm::vec3 lPos     = glm::vec3(lInvView[3]);
+    glm::vec3 lDir     = -glm::vec3(lInvView[2]); // The camera looks along -z in view space
+
+    if (vSortValid && glm::length(lPos - vSortPosition) < SORT_DISTANCE &&
+        glm::dot(lDir, vSortDirection) > SORT_ANGLE_COS)
+      return;
+
+    vSortPosition  = lPos;
+    vSortDirection = lDir;
+  } else if (vSortValid) {
+    return;
+  }
+
+  vSortValid = true;
+  vSortVersion++;
+  vNumPushConstants = 0;
+
+  vDrawOrder.clear();
+  for (auto const &i : vRenderObjects) {
+    float lDepth = 0.0f;
+    rAABB lBounds;
+    if (lHasCamera && i->getWorldAABB(lBounds) && lBounds.isValid()) {
+      glm::vec4 lCenter = lView * glm::vec4((lBounds.min + lBounds.max) * 0.5f, 1.0f);
+      lDepth            = -lCenter.z;
+    }
+
+    bool lPushConstants = i->supportsPushConstants();
+    if (lPushConstants)
+      vNumPushConstants++;
+
+    vDrawOrder.push_back({i.get(), i->getPipeline(), i->getShader(), lDepth, lPushConstants});
+  }
+
+  std::sort(vDrawOrder.begin(), vDrawOrder.end(), [](DrawItem const &a, DrawItem const &b) -> bool {
+    if (a.pipeline != b.pipeline)
+      return a.pipeline < b.pipeline;
+
+    if (a.shader != b.shader)
+      return a.shader < b.shader;
+
+    return a.depth < b.depth;
+  });
+
+  if (!vPrePass)
+    return;
+
+  std::vector<DrawItem> lByDepth = vDrawOrder;
+  std::sort(lByDepth.begin(), lByDepth.end(), [](DrawItem const &a, DrawItem const &b) -> bool {
+    return a.depth < b.depth;
+  });
+
+  vPrePassOrder.clear();
+  for (auto const &i : lByDepth)
+    if (i.object->checkIsCompatible(&vPrePassPipeline))
+      vPrePassOrder.push_back(i.object);
+}
+
+/*!
+ * \brief Checks whether the recorded pre-pass of _fb is outdated (camera or model matrices changed)
+ *
+ * Also stores the current matrices in _fb. The matrices are compared bitwise, because the recorded
+ * push constants are only valid for exactly the same values.
+ */
+bool rRendererBasic::prePassChanged(FB_DATA &_fb) {
+  glm::mat4 lView;
+  glm::mat4 lViewProj;
+  if (!getCameraMatrices(lView, lViewProj))
+    return false;
+
+  bool lChanged = memcmp(&_fb.prePassViewProj, &lViewProj, sizeof(glm::mat4)) != 0;
+  if (_fb.prePassModels.size() != vPrePassOrder.size()) {
+    _fb.prePassModels.resize(vPrePassOrder.size());
+    lChanged = true;
+  }
+
+  _fb.prePassViewProj = lViewProj;
+
+  rObjectBase::IndirectDrawData lData;
+  for (size_t i = 0; i < vPrePassOrder.size(); ++i) {
+    if (!vPrePassOrder[i]->getDrawData(lData))
+      continue;
+
+    if (memcmp(&_fb.prePassModels[i], &lData.model, sizeof(glm::mat4)) != 0) {
+      _fb.prePassModels[i] = lData.model;
+      lChanged             = true;
+    }
+  }
+
+  return lChanged;
+}
+
+/*!
+ * \brief Records the objects with (_pushConstants == true) or without push constants in draw order
+ * \vkIntern
+ */
+void rRendererBasic::cmdObjects(vkuCommandBuffer &_buf, bool _pushConstants) {
+  _buf.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
+  vkCmdSetViewport(*_buf, 0, 1, &vCmdRecordInfo.lViewPort);
+  vkCmdSetScissor(*_buf, 0, 1, &vCmdRecordInfo.lScissors);
+
+  rObjectBase::RecordState lState;
+  for (auto const &i : vDrawOrder) {
+    if (i.pushConstants != _pushConstants)
+      continue;
+
+    if (!i.pipeline) {
+      eLOG("Object ", i.object->getName(), " has no pipeline!");
+      continue;
+    }
+
+    i.object->record(*_buf, lState);
+  }
+
+  _buf.end();
+}
+
+/*!
+ * \brief Records the depth pre-pass (subpass 0)
+ * The meshes are drawn with the LODs selected in rObjectBase::updateUniforms, like in the main pass.
+ * \vkIntern
+ */
+void rRendererBasic::cmdDepthPrePass(VkCommandBuffer _buf) {
+  glm::mat4 lView;
+  glm::mat4 lViewProj;
+  if (!getCameraMatrices(lView, lViewProj))
+    return;
+
+  vPrePassPipeline.cmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+  vkCmdSetViewport(_buf, 0, 1, &vCmdRecordInfo.lViewPort);
+  vkCmdSetScissor(_buf, 0, 1, &vCmdRecordInfo.lScissors);
+  vkCmdSetDepthBias(_buf, PRE_PASS_BIAS_CONSTANT, 0.0f, PRE_PASS_BIAS_SLOPE);
+
+  VkBuffer lLastVertex = VK_NULL_HANDLE;
+  VkBuffer lLastIndex  = VK_NULL_HANDLE;
+  uint32_t lBindPoint  = vPrePassPipeline.getVertexBindPoint();
+
+  rObjectBase::IndirectDrawData lData;
+  for (auto *i : vPrePassOrder) {
+    if (!i->getDrawData(lData))
+      continue;
+
+    glm::mat4    lMVP    = lViewProj * lData.model;
+    VkDeviceSize lOffset = 0;
+
+    vPrePassShader->cmdUpdatePushConstant(_buf, vPrePassMVPVar, &lMVP);
+
+    if (lData.geometry.vertexBuffer != lLastVertex) {
+      lLastVertex = lData.geometry.vertexBuffer;
+      vkCmdBindVertexBuffers(_buf, lBindPoint, 1, &lLastVertex, &lOffset);
+    }
+
+    if (lData.geometry.indexBuffer != lLastIndex) {
+      lLastIndex = lData.geometry.indexBuffer;
+      vkCmdBindIndexBuffer(_buf, lLastIndex, 0, lData.geometry.indexType);
+    }
+
+    vkCmdDrawIndexed(_buf, lData.geometry.numIndexes, 1, lData.geometry.firstIndex, lData.geometry.vertexOffset, 0);
+  }
+}
+
 /*!
  * \brief Records the Vulkan command buffers, for a framebuffer
- * \note _toRender.size() MUST BE EQUAL TO _fb.secondary.size()
- * Elements in _toRender can be skipped by setting them to nullptr
+ *
+ * The primary command buffer and the objects with push constants are recorded every time. The other
+ * objects and the depth pre-pass are only recorded again when their content changed. The GPU culled
+ * indirect draws are only recorded with RECORD_ALL.
  */
 void rRendererBasic::recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) {
   auto &fb = vFbData[_fbIndex];
   fb.cmdBuffer.begin();
 
-  vkCmdBeginRenderPass(*fb.cmdBuffer, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  // Pipelines or shaders of the objects may have changed
+  if (_toRender == RECORD_ALL)
+    vSortValid = false;
 
-  for (uint32_t i = 0; i < vRenderObjects.size(); i++) {
-    if (_toRender == RECORD_PUSH_CONST_ONLY)
-      if (!vRenderObjects[i]->supportsPushConstants())
-        continue;
+  sortObjects();
 
-    auto *lPipe = vRenderObjects[i]->getPipeline();
-    if (!lPipe) {
-      eLOG("Object ", vRenderObjects[i]->getName(), " has no pipeline!");
-      continue;
-    }
+  bool lResorted = fb.sortVersion != vSortVersion;
+  fb.sortVersion = vSortVersion;
 
-    vFbData[_fbIndex].buffers[i].begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
+  // ==> Main pass objects
+  bool lRecordAll     = lResorted || _toRender == RECORD_ALL || fb.versions.size() != vDrawOrder.size();
+  bool lRecordObjects = lRecordAll;
+  bool lLODChanged    = false;
+  fb.versions.resize(vDrawOrder.size());
 
-    if (lPipe->getNumViewpors() > 0)
-      vkCmdSetViewport(*vFbData[_fbIndex].buffers[i], 0, 1, &vCmdRecordInfo.lViewPort);
+  for (size_t i = 0; i < vDrawOrder.size(); ++i) {
+    uint32_t lVersion = vDrawOrder[i].object->getRecordVersion();
+    if (fb.versions[i] != lVersion) {
+      fb.versions[i] = lVersion;
+      lLODChanged    = true;
+      lRecordObjects = lRecordObjects || !vDrawOrder[i].pushConstants;
+    }
+  }
+
+  if (lRecordObjects)
+    cmdObjects(fb.objectBuffer, false);
 
-    if (lPipe->getNumScissors() > 0)
-      vkCmdSetScissor(*vFbData[_fbIndex].buffers[i], 0, 1, &vCmdRecordInfo.lScissors);
+  if (vNumPushConstants > 0)
+    cmdObjects(fb.pushConstBuffer, true);
 
-    vRenderObjects[i]->record(*vFbData[_fbIndex].buffers[i]);
-    vFbData[_fbIndex].buffers[i].end();
+  // The indirect draws do not depend on push constants
+  if (vCulling.isEnabled() && _toRender == RECORD_ALL) {
+    fb.indirectBuffer.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
+    vkCmdSetViewport(*fb.indirectBuffer, 0, 1, &vCmdRecordInfo.lViewPort);
+    vkCmdSetScissor(*fb.indirectBuffer, 0, 1, &vCmdRecordInfo.lScissors);
+    vCulling.cmdDraw(*fb.indirectBuffer);
+    fb.indirectBuffer.end();
   }
 
-  for (auto &i : vFbData[_fbIndex].buffers) {
-    vkCmdExecuteCommands(*fb.cmdBuffer, 1, &i.get());
+  vkCmdBeginRenderPass(*fb.cmdBuffer, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  if (vPrePass) {
+    bool lChanged = prePassChanged(fb);
+    if (lChanged || lRecordAll || lLODChanged) {
+      VkCommandBufferInheritanceInfo lInherit = vCmdRecordInfo.lInherit;
+      lInherit.subpass                        = 0;
+
+      fb.prePassBuffer.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &lInherit);
+      cmdDepthPrePass(*fb.prePassBuffer);
+      fb.prePassBuffer.end();
+    }
+
+    vkCmdExecuteCommands(*fb.cmdBuffer, 1, &fb.prePassBuffer.get());
+    vkCmdNextSubpass(*fb.cmdBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
   }
 
+  if (vCulling.isEnabled())
+    vkCmdExecuteCommands(*fb.cmdBuffer, 1, &fb.indirectBuffer.get());
+
+  vkCmdExecuteCommands(*fb.cmdBuffer, 1, &fb.objectBuffer.get());
+
+  if (vNumPushConstants > 0)
+    vkCmdExecuteCommands(*fb.cmdBuffer, 1, &fb.pushConstBuffer.get());
+
   vkCmdEndRenderPass(*fb.cmdBuffer);
 
   auto lRes = vkEndCommandBuffer(*fb.cmdBuffer);
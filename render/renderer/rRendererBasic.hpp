@@ -26,15 +26,60 @@
 #include "vkuFrameBuffer.hpp"
 #include "vkuImageBuffer.hpp"
 #include "vkuRenderPass.hpp"
+#include "rGPUCulling.hpp"
+#include "rPipeline.hpp"
 #include "rRendererBase.hpp"
+#include "rShaderBase.hpp"
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 
 namespace e_engine {
 
+/*!
+ * \brief Forward renderer
+ *
+ * The objects are sorted by pipeline, shader (descriptor sets) and front to back view depth. Binds
+ * that are already done by the previous object are skipped (rObjectBase::RecordState). The order is
+ * cached and only sorted again when the camera moved more than SORT_DISTANCE or turned more than
+ * SORT_ANGLE_COS since the last sort (or with RECORD_ALL).
+ *
+ * Objects with push constants are recorded every frame into their own secondary command buffer. The
+ * objects using uniform buffers are only recorded again when the order or their commands
+ * (rObjectBase::getRecordVersion) changed. When a culling shader is set, all objects supporting
+ * indirect draws are culled on the GPU instead and drawn with a few indirect draws (see rGPUCulling).
+ * The culling dispatch is submitted to the compute queue (SubmitInfo::compute), so that it can run in
+ * parallel to the graphics work submitted before this renderer.
+ *
+ * With setDepthPrePassShader, the render pass gets an additional depth only subpass before the main
+ * subpass. It draws all meshes front to back with the LOD of the main pass, so the expensive
+ * fragment shaders of the main pass only run for the visible fragments. The depth pre-pass shader
+ * needs the vertex inputs of the meshes and a mat4 push constant with the
+ * MODEL_VIEW_PROJECTION_MATRIX role. The pre-pass is rendered with a small depth bias, so that the
+ * main pass (rPipeline::enableDepthTest default LESS_OR_EQUAL) passes despite slightly different
+ * vertex transformations. It is only recorded again when the camera, the order or a model matrix
+ * changed.
+ */
 class rRendererBasic final : public rRendererBase {
   struct FB_DATA {
-    std::vector<vkuCommandBuffer> buffers;
-    vkuFrameBuffer                frameBuffer;
-    vkuCommandBuffer              cmdBuffer;
+    vkuFrameBuffer   frameBuffer;
+    vkuCommandBuffer cmdBuffer;
+    vkuCommandBuffer objectBuffer;    //!< Objects without push constants in draw order
+    vkuCommandBuffer pushConstBuffer; //!< Objects with push constants in draw order
+    vkuCommandBuffer prePassBuffer;   //!< Depth pre-pass
+    vkuCommandBuffer indirectBuffer;  //!< GPU culled objects
+
+    uint64_t               sortVersion = 0; //!< vSortVersion of the recorded buffers
+    std::vector<uint32_t>  versions;        //!< rObjectBase::getRecordVersion in vDrawOrder order
+    glm::mat4              prePassViewProj;
+    std::vector<glm::mat4> prePassModels; //!< Model matrices in vPrePassOrder order
+  };
+
+  struct DrawItem {
+    rObjectBase *object;
+    rPipeline *  pipeline;
+    rShaderBase *shader;
+    float        depth;         //!< Distance to the camera along the view direction
+    bool         pushConstants; //!< Recorded every frame
   };
 
  private:
@@ -45,26 +90,61 @@ class rRendererBasic final : public rRendererBase {
 
   OBJECTS vRenderObjects;
 
+  std::vector<DrawItem>      vDrawOrder;
+  std::vector<rObjectBase *> vPrePassOrder;
+
+  glm::vec3 vSortPosition;         //!< Camera position of the last sort
+  glm::vec3 vSortDirection;        //!< Camera view direction of the last sort
+  uint64_t  vSortVersion      = 0; //!< Incremented with every sort
+  uint32_t  vNumPushConstants = 0; //!< Objects in vDrawOrder with push constants
+  bool      vSortValid        = false;
+
+  rGPUCulling      vCulling;
+  rShaderBase *    vCullShader = nullptr;
+  vkuCommandBuffer vCullBuffer; //!< Culling dispatch (compute queue, shared by all frames)
+
+  rShaderBase *                vPrePassShader = nullptr;
+  rPipeline                    vPrePassPipeline;
+  rShaderBase::PushConstantVar vPrePassMVPVar;
+  bool                         vPrePass = false;
+
   vkuRenderPass::Config getRenderPassDescription(VkSurfaceFormatKHR _surfaceFormat);
 
+  bool initPrePass();
+  bool getCameraMatrices(glm::mat4 &_view, glm::mat4 &_viewProj);
+  void sortObjects();
+  bool prePassChanged(FB_DATA &_fb);
+  void cmdObjects(vkuCommandBuffer &_buf, bool _pushConstants);
+  void cmdDepthPrePass(VkCommandBuffer _buf);
+
  protected:
   VkResult initRenderer(SwapChainImages _images, VkSurfaceFormatKHR _surfaceFormat, vkuCommandPool *_pool) override;
   void     destroyRenderer() override;
+  void     updateRendererData() override { vCulling.update(); }
 
   void recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) override;
 
   VkRenderPass              getRenderPass() override { return *vRenderPass; }
   VkFramebuffer             getFrameBuffer(uint32_t _fbIndex) override { return *vFbData[_fbIndex].frameBuffer; }
   std::vector<VkClearValue> getClearValues() override { return vRenderPass.getClearValues(); }
+  uint32_t                  getObjectSubpass() const override { return vPrePass ? 1 : 0; }
 
  public:
   static const uint32_t DEPTH_STENCIL_ATTACHMENT_INDEX = FIRST_FREE_ATTACHMENT_INDEX + 0;
 
+  static constexpr float PRE_PASS_BIAS_CONSTANT = 2.0f;
+  static constexpr float PRE_PASS_BIAS_SLOPE    = 2.0f;
+  static constexpr float SORT_DISTANCE          = 0.5f;   //!< Camera movement that triggers a new sort
+  static constexpr float SORT_ANGLE_COS         = 0.996f; //!< Cosine of the rotation that triggers a new sort
+
   VkImageView getAttachmentView(ATTACHMENT_ROLE _role) override;
 
   SubmitInfo getVulkanSubmitInfos() override;
 
+  void setDepthPrePassShader(rShaderBase *_shader) { vPrePassShader = _shader; } //!< nullptr disables (before init)
+
   rRendererBasic() = delete;
-  rRendererBasic(rWorld *_root, std::wstring _id) : rRendererBase(_root, _id) {}
+  rRendererBasic(rWorld *_root, std::wstring _id, rShaderBase *_cullShader = nullptr)
+      : rRendererBase(_root, _id), vCulling(vDevice), vCullShader(_cullShader) {}
 };
 } // namespace e_engine
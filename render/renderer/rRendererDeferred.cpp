@@ -20,343 +20,535 @@
  */
 
 
+#include "defines.hpp"
 #include "rRendererDeferred.hpp"
-
+#include "uConfig.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
-#include "vkuCommandPoolManager.hpp"
-#include "vkuFence.hpp"
-#include "iInit.hpp"
+#include "rLightManager.hpp"
 #include "rPipeline.hpp"
 #include "rObjectBase.hpp"
+#include "rRenderGraph.hpp"
+#include "rRendererShadow.hpp"
 #include "rWorld.hpp"
+#include <glm/matrix.hpp>
 
-namespace e_engine {
-
-rRendererDeferred::rRendererDeferred(rWorld *_root, std::wstring _id)
-    : rRendererBase(_root,
-                    _id) /*, vDeferredDataBuffer(_root->getDevice()), vDeferredIndexBuffer(_root->getDevice())*/ {}
-
-#if 0
-void rRendererDeferred::setupSubpasses() {
-  addSubpass(VK_PIPELINE_BIND_POINT_GRAPHICS,
-             DEPTH_STENCIL_ATTACHMENT_INDEX, // Depth / Stencil
-             {DEFERRED_POS_ATTACHMENT_INDEX, // Color Output
-              DEFERRED_NORMAL_ATTACHMENT_INDEX,
-              DEFERRED_ALBEDO_ATTACHMENT_INDEX},
-             {} // Input
-             );
-
-  addSubpass(VK_PIPELINE_BIND_POINT_GRAPHICS,
-             UINT32_MAX,                     // Depth / Stencil
-             {FRAMEBUFFER_ATTACHMENT_INDEX}, // Color Output
-             {DEFERRED_POS_ATTACHMENT_INDEX, // Input
-              DEFERRED_NORMAL_ATTACHMENT_INDEX,
-              DEFERRED_ALBEDO_ATTACHMENT_INDEX});
-
-  addSubpassDependecy(0,                                    // src subPass
-                      1,                                    // dst subPass
-                      VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,   // src Stage mask
-                      VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,   // dst Stage mask
-                      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | // src Access flags
-                          VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                          VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
-                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                      VK_ACCESS_INPUT_ATTACHMENT_READ_BIT | // dst Access flags
-                          VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-                          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
-}
+using namespace e_engine;
 
-std::vector<rRendererDeferred::AttachmentInfo> rRendererDeferred::getAttachmentInfos() {
-  VkFormat           lDepthStencilFormat;
-  VkImageTiling      lTiling;
-  VkImageAspectFlags lAspectFlags;
+const std::string rRendererDeferred::LIGHT_RESOURCE = "light";
 
-  vDevice->getDepthFormat(lDepthStencilFormat, lTiling, lAspectFlags);
+VkResult rRendererDeferred::initRenderer(SwapChainImages _images, VkSurfaceFormatKHR, vkuCommandPool *_pool) {
+  if (!vLightShader || !vLightShader->has_comp()) {
+    eLOG("Invalid lighting shader (no compute stage)");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
 
-  return {
+  if (!vLightManager) {
+    eLOG("No light manager (the deferred renderer needs renderScene)");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
 
-      // Depth Stencil buffer
-      {
-          lDepthStencilFormat,                              // format
-          VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,      // usage
-          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, // layout
-          lTiling,                                          // tiling
-          lAspectFlags,                                     // aspect
-          DEPTH_STENCIL_ATTACHMENT_INDEX,                   // attachID
-      },
-
-      // Deferred Position
-      {
-          VK_FORMAT_R16G16B16A16_SFLOAT,                                             // format
-          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, // usage
-          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,                                  // layout
-          VK_IMAGE_TILING_OPTIMAL,                                                   // tiling
-          VK_IMAGE_ASPECT_COLOR_BIT,                                                 // aspect
-          DEFERRED_POS_ATTACHMENT_INDEX,                                             // ID
-      },
-
-      // Deferred Normal
-      {
-          VK_FORMAT_R16G16B16A16_SFLOAT,                                             // format
-          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, // usage
-          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,                                  // layout
-          VK_IMAGE_TILING_OPTIMAL,                                                   // tiling
-          VK_IMAGE_ASPECT_COLOR_BIT,                                                 // aspect
-          DEFERRED_NORMAL_ATTACHMENT_INDEX,                                          // ID
-      },
-
-      // Deferred Albedo
+  if ((vWorldPtr->getSwapChain()->getUsageFlags() & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0) {
+    eLOG("The swapchain images do not support VK_IMAGE_USAGE_TRANSFER_DST_BIT ==> can not use deferred rendering");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  vFbData.resize(_images.size());
+
+  // ==> Setup render pass
+  vRenderPass.setup(getRenderPassDescription());
+
+  auto lRes = vRenderPass.init(vDevice);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to init render pass. Can not initialize renderer");
+    return lRes;
+  }
+
+  VkExtent3D lSize = {
+      GlobConf.win.width,  // width
+      GlobConf.win.height, // height
+      1                    // depth
+  };
+
+  // ==> Setup G-buffer
+  vNormalBuffer = vRenderPass.generateImageBufferFromAttachment(DEFERRED_NORMAL_ATTACHMENT_INDEX, lSize);
+  vAlbedoBuffer = vRenderPass.generateImageBufferFromAttachment(DEFERRED_ALBEDO_ATTACHMENT_INDEX, lSize);
+  vDepthBuffer  = vRenderPass.generateImageBufferFromAttachment(DEPTH_STENCIL_ATTACHMENT_INDEX, lSize);
+
+  if (!vNormalBuffer || !vAlbedoBuffer || !vDepthBuffer) {
+    eLOG(L"Failed to create the G-buffer ==> can not create framebuffer");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  vFrameBuffer.setup(vRenderPass);
+  lRes = vFrameBuffer.reCreateFrameBuffers({
+
+      // Size
+      lSize,
+
+      // Data
       {
-          VK_FORMAT_R8G8B8A8_UNORM,                                                  // format
-          VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT, // usage
-          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,                                  // layout
-          VK_IMAGE_TILING_OPTIMAL,                                                   // tiling
-          VK_IMAGE_ASPECT_COLOR_BIT,                                                 // aspect
-          DEFERRED_ALBEDO_ATTACHMENT_INDEX,                                          // ID
+
+          {DEFERRED_NORMAL_ATTACHMENT_INDEX, *vNormalBuffer},
+          {DEFERRED_ALBEDO_ATTACHMENT_INDEX, *vAlbedoBuffer},
+          {DEPTH_STENCIL_ATTACHMENT_INDEX, *vDepthBuffer}
+
       }
 
-  };
-}
+  });
 
-VkImageView rRendererDeferred::getAttachmentView(ATTACHMENT_ROLE _role) {
-  switch (_role) {
-    case DEPTH_STENCIL: return vRenderPass_vk.attachmentViews[DEPTH_STENCIL_ATTACHMENT_INDEX];
-    case DEFERRED_POSITION: return vRenderPass_vk.attachmentViews[DEFERRED_POS_ATTACHMENT_INDEX];
-    case DEFERRED_NORMAL: return vRenderPass_vk.attachmentViews[DEFERRED_NORMAL_ATTACHMENT_INDEX];
-    case DEFERRED_ALBEDO: return vRenderPass_vk.attachmentViews[DEFERRED_ALBEDO_ATTACHMENT_INDEX];
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  // ==> Setup the lighting pass output (blitted into the swapchain image)
+  vLightBuffer->format           = VK_FORMAT_R8G8B8A8_UNORM;
+  vLightBuffer->extent           = lSize;
+  vLightBuffer->usage            = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  vLightBuffer->startLayout      = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  vLightBuffer->subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  lRes = vLightBuffer.init(vDevice);
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create the lighting output image: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  // ==> Collect meshes (the lights are handled by the light manager)
+  for (auto const &i : vObjects) {
+    if (i.get() == nullptr) {
+      wLOG("WARNING: nullptr in object list! (skipping)");
+      continue;
+    }
+
+    if (i->isMesh())
+      vRenderObjects.emplace_back(i);
+  }
+
+  if (!initGBufferSampler() || !initLightPipeline() || !initLightGraph())
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  iLOG("Deferred renderer: ",
+       vLightManager->getNumPointLights(),
+       " point lights, ",
+       vLightManager->getNumDirectionalLights(),
+       " directional lights");
+
+  // ==> Setup command buffers
+  for (size_t i = 0; i < vFbData.size(); ++i) {
+    vFbData[i].image = _images[i].img;
+    vFbData[i].cmdBuffer.init(_pool);
+    vFbData[i].buffers.resize(vRenderObjects.size());
+    vFbData[i].versions.resize(vRenderObjects.size(), 0);
+    for (auto &j : vFbData[i].buffers) {
+      j.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    }
   }
 
-  return nullptr;
+  return VK_SUCCESS;
 }
 
-#endif
+/*!
+ * \brief Creates the sampler used to read the G-buffer (only texelFetch is used)
+ */
+bool rRendererDeferred::initGBufferSampler() {
+  VkSamplerCreateInfo lSamplerInfo;
+  lSamplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  lSamplerInfo.pNext                   = nullptr;
+  lSamplerInfo.flags                   = 0;
+  lSamplerInfo.magFilter               = VK_FILTER_NEAREST;
+  lSamplerInfo.minFilter               = VK_FILTER_NEAREST;
+  lSamplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  lSamplerInfo.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSamplerInfo.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSamplerInfo.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSamplerInfo.mipLodBias              = 0.0f;
+  lSamplerInfo.anisotropyEnable        = VK_FALSE;
+  lSamplerInfo.maxAnisotropy           = 1.0f;
+  lSamplerInfo.compareEnable           = VK_FALSE;
+  lSamplerInfo.compareOp               = VK_COMPARE_OP_ALWAYS;
+  lSamplerInfo.minLod                  = 0.0f;
+  lSamplerInfo.maxLod                  = 0.0f;
+  lSamplerInfo.borderColor             = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  lSamplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+  auto lRes = vkCreateSampler(vDevice_vk, &lSamplerInfo, nullptr, &vGBufferSampler_vk);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create sampler: ", uEnum2Str::toStr(lRes));
+    vGBufferSampler_vk = VK_NULL_HANDLE;
+    return false;
+  }
+
+  return true;
+}
 
 /*!
- * \brief Initializes vertex and Index buffer
- *
- * The buffers have 2 triangles, filling the entire normalized space (-1,-1) - (1,1)
+ * \brief Creates the lighting pipeline and binds the G-buffer, the output image and the light data
  */
-bool rRendererDeferred::initRendererData() {
-  uint32_t         lQueueFamily;
-  auto             lDevice = vWorldPtr->getDevice();
-  VkQueue          lQueue  = lDevice->getQueue(VK_QUEUE_TRANSFER_BIT, 0.0, &lQueueFamily);
-  vkuCommandBuffer lBuf    = vkuCommandPoolManager::getBuffer(**lDevice, lQueueFamily);
-  vkuFence_t       lFence(**lDevice);
-
-  std::vector<float>    lDefBufferData  = {1.0f, 1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, -1.0f};
-  std::vector<uint32_t> lDefBufferIndex = {0, 1, 2, 2, 3, 0};
-
-  lBuf.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-  //   vDeferredDataBuffer.cmdInit(lDefBufferData, *lBuf, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-  //   vDeferredIndexBuffer.cmdInit(lDefBufferIndex, *lBuf, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-
-  VkSubmitInfo lInfo;
-  lInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  lInfo.pNext                = nullptr;
-  lInfo.waitSemaphoreCount   = 0;
-  lInfo.pWaitSemaphores      = nullptr;
-  lInfo.pWaitDstStageMask    = nullptr;
-  lInfo.commandBufferCount   = 1;
-  lInfo.pCommandBuffers      = &lBuf.get();
-  lInfo.signalSemaphoreCount = 0;
-  lInfo.pSignalSemaphores    = nullptr;
-
-  lBuf.end();
-
-  {
-    std::lock_guard<std::mutex> lGuard(lDevice->getQueueMutex(lQueue));
-    vkQueueSubmit(lQueue, 1, &lInfo, lFence[0]);
+bool rRendererDeferred::initLightPipeline() {
+  if (!vLightManager->bindToShader(vLightShader)) {
+    eLOG("Lighting shader ", vLightShader->getName(), " has no storage block ", rLightManager::BLOCK_NAME);
+    return false;
   }
 
-  auto lRes = lFence();
-  if (lRes) {
-    eLOG("'vkWaitForFences' returned ", uEnum2Str::toStr(lRes));
+  uint32_t    lNumMatrices = 0;
+  auto const *lUniforms    = vLightShader->getUniformBuffer(VK_SHADER_STAGE_COMPUTE_BIT);
+  if (lUniforms) {
+    for (auto const &i : lUniforms->vars) {
+      if (i.type != "mat4")
+        continue;
+
+      if (i.name == "view") {
+        vViewVar = i;
+      } else if (i.name == "projection") {
+        vProjectionVar = i;
+      } else if (i.name == "invProjection") {
+        vInvProjectionVar = i;
+      } else if (i.name == "invView") {
+        vInvViewVar = i;
+        vHasInvView = true;
+        continue;
+      } else {
+        continue;
+      }
+
+      lNumMatrices++;
+    }
   }
 
-  //   vDeferredDataBuffer.doneCopying();
-  //   vDeferredIndexBuffer.doneCopying();
-  return true;
-}
-bool rRendererDeferred::freeRendererData() {
-  //   vDeferredDataBuffer.destroy();
-  //   vDeferredIndexBuffer.destroy();
-  return true;
-}
+  if (lNumMatrices != 3) {
+    eLOG("Lighting shader ", vLightShader->getName(), " needs a uniform block with view, projection and invProjection");
+    return false;
+  }
 
-#if 0
-void rRendererDeferred::initCmdBuffers(vkuCommandPool *_pool) {
-  for (auto i : vObjects) {
-    if (i.get() == nullptr) {
-      eLOG("FATAL ERROR: nullptr in object list!");
-      return;
+  if (vShadows) {
+    if (!vHasInvView) {
+      eLOG("Lighting shader ", vLightShader->getName(), " needs the uniform invView for the shadows");
+      return false;
     }
 
-    if (i->isMesh()) {
-      vRenderObjects.emplace_back(i);
-    } else {
-      vLightObjects.emplace_back(i);
+    if (!vShadows->bindToShader(vLightShader)) {
+      eLOG("Failed to bind the shadow maps to ", vLightShader->getName());
+      return false;
     }
   }
 
-  vFbData.resize(getNumFramebuffers());
-  for (auto &i : vFbData) {
-    i.objects.resize(vRenderObjects.size());
-    i.lights.resize(vLightObjects.size());
+  VkDescriptorSet lSet = vLightShader->getDescriptorSet(nullptr);
+  if (lSet == VK_NULL_HANDLE) {
+    eLOG(L"Failed to get descriptor set");
+    return false;
+  }
 
-    for (auto &j : i.objects)
-      j.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+  bool     lHasOutput = false;
+  uint32_t lNumInputs = 0;
+  for (auto const &i : vLightShader->getUniforms()) {
+    if (i.stage != VK_SHADER_STAGE_COMPUTE_BIT)
+      continue;
 
-    for (auto &j : i.lights)
-      j.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    if (i.type == "image2D") {
+      if (!vLightShader->updateDescriptorSet(i, *vLightBuffer))
+        return false;
+
+      lHasOutput = true;
+      continue;
+    }
+
+    if (i.type != "sampler2D")
+      continue;
+
+    VkDescriptorImageInfo lImageInfo;
+    lImageInfo.sampler     = vGBufferSampler_vk;
+    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    switch (i.guessedRole) {
+      case rShaderBase::NORMAL_SUBPASS_DATA: lImageInfo.imageView = *vNormalBuffer; break;
+      case rShaderBase::ALBEDO_SUBPASS_DATA: lImageInfo.imageView = *vAlbedoBuffer; break;
+      case rShaderBase::DEPTH_SUBPASS_DATA:
+        lImageInfo.imageView   = *vDepthBuffer;
+        lImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        break;
+      default:
+        eLOG("Unknown G-buffer sampler ", i.name, " in ", vLightShader->getName());
+        return false;
+    }
 
-    i.layoutChange1.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
-    i.layoutChange2.init(_pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    VkWriteDescriptorSet lWriteSet;
+    lWriteSet.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    lWriteSet.pNext            = nullptr;
+    lWriteSet.dstSet           = lSet;
+    lWriteSet.dstBinding       = i.binding;
+    lWriteSet.dstArrayElement  = 0;
+    lWriteSet.descriptorCount  = 1;
+    lWriteSet.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    lWriteSet.pImageInfo       = &lImageInfo;
+    lWriteSet.pBufferInfo      = nullptr;
+    lWriteSet.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(vDevice_vk, 1, &lWriteSet, 0, nullptr);
+    lNumInputs++;
   }
+
+  if (!lHasOutput || lNumInputs != 3) {
+    eLOG("Lighting shader ", vLightShader->getName(), " needs 3 G-buffer samplers and 1 output image");
+    return false;
+  }
+
+  VkPipelineShaderStageCreateInfo lStage = {};
+  bool                            lFound = false;
+  for (auto const &i : vLightShader->getShaderStageInfo()) {
+    if (i.stage == VK_SHADER_STAGE_COMPUTE_BIT) {
+      lStage = i;
+      lFound = true;
+    }
+  }
+
+  if (!lFound) {
+    eLOG("Failed to get compute stage of ", vLightShader->getName());
+    return false;
+  }
+
+  VkComputePipelineCreateInfo lInfo = {};
+  lInfo.sType                       = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  lInfo.pNext                       = nullptr;
+  lInfo.flags                       = 0;
+  lInfo.stage                       = lStage;
+  lInfo.layout                      = vLightShader->getPipelineLayout();
+  lInfo.basePipelineHandle          = VK_NULL_HANDLE;
+  lInfo.basePipelineIndex           = -1;
+
+  auto lRes = vkCreateComputePipelines(vDevice_vk, VK_NULL_HANDLE, 1, &lInfo, nullptr, &vLightPipeline_vk);
+  if (lRes) {
+    eLOG("'vkCreateComputePipelines' returned ", uEnum2Str::toStr(lRes));
+    vLightPipeline_vk = VK_NULL_HANDLE;
+    return false;
+  }
+
+  return true;
 }
 
-void rRendererDeferred::freeCmdBuffers() {
+void rRendererDeferred::destroyRenderer() {
+  if (vLightPipeline_vk != VK_NULL_HANDLE)
+    vkDestroyPipeline(vDevice_vk, vLightPipeline_vk, nullptr);
+
+  if (vGBufferSampler_vk != VK_NULL_HANDLE)
+    vkDestroySampler(vDevice_vk, vGBufferSampler_vk, nullptr);
+
+  vLightPipeline_vk  = VK_NULL_HANDLE;
+  vGBufferSampler_vk = VK_NULL_HANDLE;
+
+  vLightGraph.clear();
   vFbData.clear();
+  vFrameBuffer.destroy();
+  vRenderPass.destroy();
+  vNormalBuffer.destroy();
+  vAlbedoBuffer.destroy();
+  vDepthBuffer.destroy();
+  vLightBuffer.destroy();
+
   vRenderObjects.clear();
-  vLightObjects.clear();
 }
-#endif
 
+VkImageView rRendererDeferred::getAttachmentView(rRendererBase::ATTACHMENT_ROLE _role) {
+  switch (_role) {
+    case DEPTH_STENCIL: return vDepthBuffer.get();
+    case DEFERRED_NORMAL: return vNormalBuffer.get();
+    case DEFERRED_ALBEDO: return vAlbedoBuffer.get();
+  }
 
-/*!
- * \brief Records the Vulkan command buffers, for a framebuffer
- * \note _toRender.size() MUST BE EQUAL TO _fb.secondary.size()
- * Elements in _toRender can be skipped by setting them to nullptr
- */
-void rRendererDeferred::recordCmdBuffers(unsigned int &_fbIndex, RECORD_TARGET _toRender) {
-  (void)_fbIndex;
-  (void)_toRender;
-#if 0
-  _fb.render.begin();
+  return VK_NULL_HANDLE;
+}
 
-  vkCmdBeginRenderPass(*_fb.render, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+rRendererBase::SubmitInfo rRendererDeferred::getVulkanSubmitInfos() {
+  SubmitInfo lInfo;
 
-  for (uint32_t i = 0; i < vRenderObjects.size(); i++) {
-    if (_toRender == RECORD_PUSH_CONST_ONLY)
-      if (!vRenderObjects[i]->supportsPushConstants())
-        continue;
+  for (auto &i : vFbData) {
+    VkSubmitInfo lSubInfo;
+    lSubInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    lSubInfo.pNext                = nullptr;
+    lSubInfo.waitSemaphoreCount   = 0;
+    lSubInfo.pWaitSemaphores      = nullptr;
+    lSubInfo.pWaitDstStageMask    = nullptr;
+    lSubInfo.commandBufferCount   = 1;
+    lSubInfo.pCommandBuffers      = &i.cmdBuffer.get();
+    lSubInfo.signalSemaphoreCount = 0;
+    lSubInfo.pSignalSemaphores    = nullptr;
+
+    lInfo.fb.push_back({{lSubInfo}});
+  }
 
-    auto *lPipe = vRenderObjects[i]->getPipeline();
-    if (!lPipe) {
-      eLOG("Object ", vRenderObjects[i]->getName(), " has no pipeline!");
-      continue;
-    }
+  return lInfo;
+}
 
-    vFbData[_fb.index].objects[i].begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
+/*!
+ * \brief Updates the camera matrices of the lighting shader (the lights are updated by rLightManager)
+ * \note This function does NO MEMORY SYNCHRONISATION (same as rShaderBase::updateUniform)
+ */
+void rRendererDeferred::updateRendererData() {
+  if (vRenderObjects.empty() || vLightPipeline_vk == VK_NULL_HANDLE)
+    return;
 
-    if (lPipe->getNumViewpors() > 0)
-      vkCmdSetViewport(*vFbData[_fb.index].objects[i], 0, 1, &vCmdRecordInfo.lViewPort);
+  glm::mat4 *lView       = nullptr;
+  glm::mat4 *lProjection = nullptr;
+  if (vRenderObjects[0]->getMatrix(&lView, rObjectBase::VIEW_MATRIX) != 0 || !lView ||
+      vRenderObjects[0]->getMatrix(&lProjection, rObjectBase::PROJECTION_MATRIX) != 0 || !lProjection)
+    return;
 
-    if (lPipe->getNumScissors() > 0)
-      vkCmdSetScissor(*vFbData[_fb.index].objects[i], 0, 1, &vCmdRecordInfo.lScissors);
+  glm::mat4 lInvProjection = glm::inverse(*lProjection);
+
+  vLightShader->updateUniform(vViewVar, lView);
+  vLightShader->updateUniform(vProjectionVar, lProjection);
+  vLightShader->updateUniform(vInvProjectionVar, &lInvProjection);
 
-    vRenderObjects[i]->record(*vFbData[_fb.index].objects[i]);
-    vFbData[_fb.index].objects[i].end();
+  if (vHasInvView) {
+    glm::mat4 lInvView = glm::inverse(*lView);
+    vLightShader->updateUniform(vInvViewVar, &lInvView);
   }
+}
+
+/*!
+ * \brief Shadows the first directional light with the cascaded shadow maps of _shadows
+ *
+ * Also makes the world submit the shadow pass before this renderer (addGraphRead). The shadow renderer
+ * must be added to the world before this renderer, so that the shadow maps exist when the lighting
+ * shader is initialized.
+ *
+ * \note Only takes effect with the next init
+ */
+void rRendererDeferred::setShadowRenderer(rRendererShadow *_shadows) {
+  vShadows = _shadows;
+  if (vShadows)
+    addGraphRead(vShadows->getGraphResource());
+}
 
-  for (auto &i : vFbData[_fb.index].objects) {
-    vkCmdExecuteCommands(*_fb.render, 1, &i.get());
+/*!
+ * \brief Builds the graph of the lighting dispatch and the blit into the swapchain image
+ *
+ * The G-buffer is synchronized by the subpass dependencies of the render pass and is not part of the graph.
+ */
+bool rRendererDeferred::initLightGraph() {
+  VkImageSubresourceRange lRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  vLightGraph.clear();
+
+  // The blit of the last frame must have read the output image before it is overwritten
+  vLightGraph.importImage(LIGHT_RESOURCE,
+                          vLightBuffer.getImage(),
+                          vLightBuffer.get(),
+                          lRange,
+                          rRenderGraph::TRANSFER_SRC,
+                          rRenderGraph::TRANSFER_SRC);
+
+  // The old content of the swapchain image is overwritten anyway. The render loop expects the image in
+  // VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+  vLightGraph.importImage(SWAPCHAIN_RESOURCE,
+                          VK_NULL_HANDLE,
+                          VK_NULL_HANDLE,
+                          lRange,
+                          rRenderGraph::COLOR_ATTACHMENT,
+                          rRenderGraph::COLOR_ATTACHMENT,
+                          true);
+
+  uint32_t lLighting = vLightGraph.addPass("lighting", [this](VkCommandBuffer _buf) { cmdLighting(_buf); });
+  uint32_t lBlit     = vLightGraph.addPass("blit", [this](VkCommandBuffer _buf) { cmdBlit(_buf); });
+
+  vLightGraph.write(lLighting, LIGHT_RESOURCE, rRenderGraph::STORAGE_WRITE_COMPUTE);
+  vLightGraph.read(lBlit, LIGHT_RESOURCE, rRenderGraph::TRANSFER_SRC);
+  vLightGraph.write(lBlit, SWAPCHAIN_RESOURCE, rRenderGraph::TRANSFER_DST);
+  vLightGraph.markOutput(SWAPCHAIN_RESOURCE);
+
+  if (!vLightGraph.compile()) {
+    eLOG("Failed to compile the lighting graph");
+    return false;
   }
 
-  vFbData[_fb.index].layoutChange1.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
-
-  VkImageSubresourceRange lRange = {};
-  lRange.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
-  lRange.baseMipLevel            = 0;
-  lRange.levelCount              = 1;
-  lRange.baseArrayLayer          = 0;
-  lRange.layerCount              = 1;
-
-  auto *lBuffPos    = vRenderPass_vk.attachmentBuffers[DEFERRED_POS_ATTACHMENT_INDEX];
-  auto *lBuffNormal = vRenderPass_vk.attachmentBuffers[DEFERRED_NORMAL_ATTACHMENT_INDEX];
-  auto *lBuffAlbedo = vRenderPass_vk.attachmentBuffers[DEFERRED_ALBEDO_ATTACHMENT_INDEX];
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange1,
-                                  lBuffPos->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange1,
-                                  lBuffNormal->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange1,
-                                  lBuffAlbedo->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-  vFbData[_fb.index].layoutChange1.end();
-  vkCmdExecuteCommands(*_fb.render, 1, &vFbData[_fb.index].layoutChange1.get());
-  vkCmdNextSubpass(*_fb.render, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-
-  for (uint32_t i = 0; i < vLightObjects.size(); i++) {
+  return true;
+}
+
+/*!
+ * \brief Records the tiled lighting dispatch (barriers are recorded by vLightGraph)
+ * \vkIntern
+ */
+void rRendererDeferred::cmdLighting(VkCommandBuffer _buf) {
+  vkCmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_COMPUTE, vLightPipeline_vk);
+  vLightShader->cmdBindDescriptorSets(_buf, VK_PIPELINE_BIND_POINT_COMPUTE);
+  vkCmdDispatch(_buf,
+                (GlobConf.win.width + TILE_SIZE - 1) / TILE_SIZE,
+                (GlobConf.win.height + TILE_SIZE - 1) / TILE_SIZE,
+                1);
+}
+
+/*!
+ * \brief Copies the lit image into the swapchain image of the graph (SWAPCHAIN_RESOURCE)
+ * \vkIntern
+ */
+void rRendererDeferred::cmdBlit(VkCommandBuffer _buf) {
+  int32_t     lWidth  = static_cast<int32_t>(GlobConf.win.width);
+  int32_t     lHeight = static_cast<int32_t>(GlobConf.win.height);
+  VkImageBlit lBlit   = {};
+  lBlit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  lBlit.srcOffsets[0]  = {0, 0, 0};
+  lBlit.srcOffsets[1]  = {lWidth, lHeight, 1};
+  lBlit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  lBlit.dstOffsets[0]  = {0, 0, 0};
+  lBlit.dstOffsets[1]  = {lWidth, lHeight, 1};
+
+  vkCmdBlitImage(_buf,
+                 vLightBuffer.getImage(),
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 vLightGraph.getImage(SWAPCHAIN_RESOURCE),
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 1,
+                 &lBlit,
+                 VK_FILTER_NEAREST);
+}
+
+/*!
+ * \brief Records the G-buffer pass and the lighting pass for a framebuffer
+ */
+void rRendererDeferred::recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) {
+  auto &fb = vFbData[_fbIndex];
+  fb.cmdBuffer.begin();
+
+  vkCmdBeginRenderPass(*fb.cmdBuffer, &vCmdRecordInfo.lRPInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+  for (uint32_t i = 0; i < vRenderObjects.size(); i++) {
+    // Objects without push constants are only recorded again when their commands changed (LOD)
+    uint32_t lVersion = vRenderObjects[i]->getRecordVersion();
     if (_toRender == RECORD_PUSH_CONST_ONLY)
-      if (!vLightObjects[i]->supportsPushConstants())
+      if (!vRenderObjects[i]->supportsPushConstants() && fb.versions[i] == lVersion)
         continue;
 
-    auto *lPipe = vLightObjects[i]->getPipeline();
+    fb.versions[i] = lVersion;
+
+    auto *lPipe = vRenderObjects[i]->getPipeline();
     if (!lPipe) {
-      eLOG("Object ", vLightObjects[i]->getName(), " has no pipeline!");
+      eLOG("Object ", vRenderObjects[i]->getName(), " has no pipeline!");
       continue;
     }
 
-    vFbData[_fb.index].lights[i].begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
+    fb.buffers[i].begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
 
     if (lPipe->getNumViewpors() > 0)
-      vkCmdSetViewport(*vFbData[_fb.index].lights[i], 0, 1, &vCmdRecordInfo.lViewPort);
+      vkCmdSetViewport(*fb.buffers[i], 0, 1, &vCmdRecordInfo.lViewPort);
 
     if (lPipe->getNumScissors() > 0)
-      vkCmdSetScissor(*vFbData[_fb.index].lights[i], 0, 1, &vCmdRecordInfo.lScissors);
+      vkCmdSetScissor(*fb.buffers[i], 0, 1, &vCmdRecordInfo.lScissors);
 
-    vLightObjects[i]->recordLight(*vFbData[_fb.index].lights[i], vDeferredDataBuffer, vDeferredIndexBuffer);
-    vFbData[_fb.index].lights[i].end();
+    vRenderObjects[i]->record(*fb.buffers[i]);
+    fb.buffers[i].end();
   }
 
-  for (auto &i : vFbData[_fb.index].lights) {
-    vkCmdExecuteCommands(*_fb.render, 1, &i.get());
+  for (auto &i : fb.buffers) {
+    vkCmdExecuteCommands(*fb.cmdBuffer, 1, &i.get());
   }
 
-  vFbData[_fb.index].layoutChange2.begin(VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT, &vCmdRecordInfo.lInherit);
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange2,
-                                  lBuffPos->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange2,
-                                  lBuffNormal->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-  vWorldPtr->cmdChangeImageLayout(*vFbData[_fb.index].layoutChange2,
-                                  lBuffAlbedo->img,
-                                  lRange,
-                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                  VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-
-  vFbData[_fb.index].layoutChange2.end();
-  vkCmdExecuteCommands(*_fb.render, 1, &vFbData[_fb.index].layoutChange2.get());
+  vkCmdEndRenderPass(*fb.cmdBuffer);
 
-  vkCmdEndRenderPass(*_fb.render);
+  vLightGraph.setImage(SWAPCHAIN_RESOURCE, fb.image);
+  vLightGraph.execute(*fb.cmdBuffer);
 
-  auto lRes = _fb.render.end();
-  ;
+  auto lRes = vkEndCommandBuffer(*fb.cmdBuffer);
   if (lRes) {
     eLOG("'vkEndCommandBuffer' returned ", uEnum2Str::toStr(lRes));
     //! \todo Handle this somehow (practically this code must not execute)
   }
-#endif
 }
-} // namespace e_engine
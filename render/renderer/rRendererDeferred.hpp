@@ -22,48 +22,113 @@
 #pragma once
 
 #include "defines.hpp"
-// #include "rBuffer.hpp"
 #include "vkuCommandBuffer.hpp"
+#include "vkuFrameBuffer.hpp"
+#include "vkuImageBuffer.hpp"
+#include "vkuRenderPass.hpp"
+#include "rRenderGraph.hpp"
 #include "rRendererBase.hpp"
+#include "rShaderBase.hpp"
 
 namespace e_engine {
 
+class rRendererShadow;
+
 /*!
- * \warning THIS RENDERER IS BROKEN
+ * \brief Deferred renderer with tiled light culling
+ *
+ * All meshes are rendered into a compact G-buffer: octahedral encoded view space normals (RG16F),
+ * albedo + specular intensity (RGBA8) and depth. The view space position is reconstructed from the
+ * depth buffer. The pipelines of the objects must write both color attachments
+ * (rPipeline::setNumColorAttachments).
+ *
+ * The lighting is done in a single compute dispatch with one TILE_SIZE x TILE_SIZE work group per
+ * screen tile. Every work group computes the depth range of its tile, culls the point lights against
+ * the tile frustum and shades its pixels only with the remaining lights. Directional lights are
+ * applied to every pixel. The result is blitted into the swapchain image.
+ *
+ * The lights are read from the light buffer of the rendered scene (rLightManager, world space).
+ *
+ * The lighting shader needs:
+ *  - local_size_x = local_size_y = TILE_SIZE
+ *  - the G-buffer as sampler2D uniforms with the NORMAL / ALBEDO / DEPTH_SUBPASS_DATA roles
+ *  - one more rgba8 image2D for the result
+ *  - a uniform block with the mat4 members view, projection and invProjection
+ *  - the light storage block (rLightManager::BLOCK_NAME)
  *
- * \todo FIX THIS
+ * With setShadowRenderer the first directional light is shadowed. The lighting shader then also needs
+ * the mat4 member invView in the uniform block and the shadow map / cascade block of rRendererShadow
+ * (see rRendererShadow::bindToShader).
  */
-class rRendererDeferred : public rRendererBase {
-  struct FB_DATA {
-    std::vector<vkuCommandBuffer> objects;
-    std::vector<vkuCommandBuffer> lights;
+class rRendererDeferred final : public rRendererBase {
+ public:
+  static const uint32_t TILE_SIZE = 16;
 
-    vkuCommandBuffer layoutChange1;
-    vkuCommandBuffer layoutChange2;
+ private:
+  static const std::string LIGHT_RESOURCE;
+
+  struct FB_DATA {
+    std::vector<vkuCommandBuffer> buffers;
+    std::vector<uint32_t>         versions; //!< rObjectBase::getRecordVersion of the recorded objects
+    vkuCommandBuffer              cmdBuffer;
+    VkImage                       image;
   };
 
- private:
   std::vector<FB_DATA> vFbData;
 
+  vkuRenderPass  vRenderPass;
+  vkuFrameBuffer vFrameBuffer;
+  vkuImageBuffer vNormalBuffer;
+  vkuImageBuffer vAlbedoBuffer;
+  vkuImageBuffer vDepthBuffer;
+  vkuImageBuffer vLightBuffer; //!< Output of the lighting pass
+  rRenderGraph   vLightGraph;  //!< Lighting dispatch + blit into the swapchain image
+
   OBJECTS vRenderObjects;
-  OBJECTS vLightObjects;
 
-  //   rBuffer vDeferredDataBuffer;
-  //   rBuffer vDeferredIndexBuffer;
+  rShaderBase *    vLightShader       = nullptr;
+  rRendererShadow *vShadows           = nullptr;
+  VkPipeline       vLightPipeline_vk  = VK_NULL_HANDLE;
+  VkSampler        vGBufferSampler_vk = VK_NULL_HANDLE;
+
+  rShaderBase::UniformBuffer::Var vViewVar;
+  rShaderBase::UniformBuffer::Var vProjectionVar;
+  rShaderBase::UniformBuffer::Var vInvProjectionVar;
+  rShaderBase::UniformBuffer::Var vInvViewVar;
+  bool                            vHasInvView = false;
+
+  vkuRenderPass::Config getRenderPassDescription();
+
+  bool initGBufferSampler();
+  bool initLightPipeline();
+  bool initLightGraph();
+  void cmdLighting(VkCommandBuffer _buf);
+  void cmdBlit(VkCommandBuffer _buf);
 
  protected:
+  VkResult initRenderer(SwapChainImages _images, VkSurfaceFormatKHR _surfaceFormat, vkuCommandPool *_pool) override;
+  void     destroyRenderer() override;
+  void     updateRendererData() override;
+
   void recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) override;
 
-  bool initRendererData() override;
-  bool freeRendererData() override;
+  VkRenderPass              getRenderPass() override { return *vRenderPass; }
+  VkFramebuffer             getFrameBuffer(uint32_t) override { return *vFrameBuffer; }
+  std::vector<VkClearValue> getClearValues() override { return vRenderPass.getClearValues(); }
 
  public:
-  static const uint32_t DEPTH_STENCIL_ATTACHMENT_INDEX   = FIRST_FREE_ATTACHMENT_INDEX + 0;
-  static const uint32_t DEFERRED_POS_ATTACHMENT_INDEX    = FIRST_FREE_ATTACHMENT_INDEX + 1;
-  static const uint32_t DEFERRED_NORMAL_ATTACHMENT_INDEX = FIRST_FREE_ATTACHMENT_INDEX + 2;
-  static const uint32_t DEFERRED_ALBEDO_ATTACHMENT_INDEX = FIRST_FREE_ATTACHMENT_INDEX + 3;
+  static const uint32_t DEFERRED_NORMAL_ATTACHMENT_INDEX = 0;
+  static const uint32_t DEFERRED_ALBEDO_ATTACHMENT_INDEX = 1;
+  static const uint32_t DEPTH_STENCIL_ATTACHMENT_INDEX   = 2;
+
+  VkImageView getAttachmentView(ATTACHMENT_ROLE _role) override;
+
+  SubmitInfo getVulkanSubmitInfos() override;
+
+  void setShadowRenderer(rRendererShadow *_shadows);
 
   rRendererDeferred() = delete;
-  rRendererDeferred(rWorld *_root, std::wstring _id);
+  rRendererDeferred(rWorld *_root, std::wstring _id, rShaderBase *_lightShader)
+      : rRendererBase(_root, _id), vLightGraph(vDevice), vLightShader(_lightShader) {}
 };
 } // namespace e_engine
@@ -0,0 +1,708 @@
+/*!
+ * \file rRendererShadow.cpp
+ * \brief \b Classes: \a rRendererShadow
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "defines.hpp"
+#include "rRendererShadow.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "rMatrixSceneBase.hpp"
+#include "rObjectBase.hpp"
+#include "rRenderGraph.hpp"
+#include "rScene.hpp"
+#include "rWorld.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/matrix.hpp>
+
+using namespace e_engine;
+
+const std::string rRendererShadow::SAMPLER_NAME = "uShadowMap";
+const std::string rRendererShadow::BLOCK_NAME   = "Shadows";
+
+rRendererShadow::rRendererShadow(
+    rWorld *_root, std::wstring _id, rShaderBase *_shader, uint32_t _resolution, uint32_t _numCascades)
+    : rRendererBase(_root, _id),
+      vCascadeBuffer(vDevice),
+      vShader(_shader),
+      vResolution(_resolution),
+      vNumCascades(_numCascades) {
+
+  if (vNumCascades < 1 || vNumCascades > MAX_CASCADES)
+    vNumCascades = vNumCascades < 1 ? 1 : MAX_CASCADES;
+
+  if (vNumCascades != _numCascades)
+    wLOG("Unsupported number of cascades ", _numCascades, " ==> using ", vNumCascades);
+
+  vPipeline.setShader(vShader);
+  vPipeline.setNumColorAttachments(0)->enableDepthTest()->enableDepthBias();
+}
+
+VkResult rRendererShadow::initRenderer(SwapChainImages _images, VkSurfaceFormatKHR, vkuCommandPool *_pool) {
+  if (!vShader || !vShader->has_vert()) {
+    eLOG("Invalid shadow shader (no vertex stage)");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (!vScene || !dynamic_cast<rMatrixSceneBase<float> *>(vScene)) {
+    eLOG("The shadow renderer needs a scene with a camera (renderScene)");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  bool lHasMVP = false;
+  for (auto const &i : vShader->getPushConstants(VK_SHADER_STAGE_VERTEX_BIT)) {
+    if (i.guessedRole == rShaderBase::MODEL_VIEW_PROJECTION_MATRIX) {
+      vMVPVar = i;
+      lHasMVP = true;
+      break;
+    }
+  }
+
+  if (!lHasMVP) {
+    eLOG("Shadow shader ", vShader->getName(), " has no model view projection push constant");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  // The depth buffer is sampled ==> no stencil (the image view would need both aspects)
+  vDepthFormat = VK_FORMAT_UNDEFINED;
+  for (auto i : {VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM}) {
+    if (vDevice->formatSupportsFeature(i, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_TILING_OPTIMAL) &&
+        vDevice->formatSupportsFeature(i, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT, VK_IMAGE_TILING_OPTIMAL)) {
+      vDepthFormat = i;
+      break;
+    }
+  }
+
+  if (vDepthFormat == VK_FORMAT_UNDEFINED) {
+    eLOG("Unable to find a sampleable depth format for the shadow map");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  // ==> Setup render passes
+  VkImageLayout lReadOnly = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+  vPassClear.setup(getRenderPassDescription(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, lReadOnly));
+  vPassCache.setup(getRenderPassDescription(
+      VK_ATTACHMENT_LOAD_OP_CLEAR, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL));
+  vPassLoad.setup(
+      getRenderPassDescription(VK_ATTACHMENT_LOAD_OP_LOAD, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, lReadOnly));
+
+  for (auto *i : {&vPassClear, &vPassCache, &vPassLoad}) {
+    auto lRes = i->init(vDevice);
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"Failed to init render pass. Can not initialize renderer");
+      return lRes;
+    }
+  }
+
+  if (!initImages() || !initSampler())
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  vCascadeBuffer->usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  vCascadeBuffer->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  auto lRes = vCascadeBuffer.init(sizeof(CascadeData));
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create the cascade buffer: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  // All pipelines are compatible with the 3 render passes (same attachment format)
+  if (vPipeline.getIsCreated())
+    vPipeline.destroy();
+
+  if (!vPipeline.create(vDevice_vk, *vPassClear, 0)) {
+    eLOG("Failed to create the shadow pipeline");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  // ==> Collect the light and the shadow casters
+  for (auto const &i : vObjects) {
+    if (i.get() == nullptr) {
+      wLOG("WARNING: nullptr in object list! (skipping)");
+      continue;
+    }
+
+    glm::vec3 *lTemp = nullptr;
+    if (!vLight && i->getVector(&lTemp, rObjectBase::DIRECTION) == rObjectBase::ALL_OK)
+      vLight = i;
+
+    if (i->isMesh() && i->checkIsCompatible(&vPipeline))
+      vCasters.insert(i.get());
+  }
+
+  if (!vLight)
+    wLOG("No directional light in the shadow renderer ==> the shadow maps stay empty");
+
+  vCached.assign(std::min(vNumCached, vNumCascades - 1), CachedCascade());
+
+  iLOG("Shadow renderer: ",
+       vNumCascades,
+       " cascades (",
+       vCached.size(),
+       " cached) with ",
+       vResolution,
+       "x",
+       vResolution,
+       " texels, ",
+       vCasters.size(),
+       " shadow casters");
+
+  // ==> Setup command buffers
+  vFbData.resize(_images.size());
+  for (auto &i : vFbData)
+    i.cmdBuffer.init(_pool);
+
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Creates the shadow map, the static cache and a framebuffer for every layer of them
+ */
+bool rRendererShadow::initImages() {
+  uint32_t lNumCached = std::min(vNumCached, vNumCascades - 1);
+
+  vShadowMap->format           = vDepthFormat;
+  vShadowMap->extent           = {vResolution, vResolution, 1};
+  vShadowMap->arrayLayers      = vNumCascades;
+  vShadowMap->usage            = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  vShadowMap->subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, vNumCascades};
+
+  if (lNumCached > 0)
+    vShadowMap->usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+  auto lRes = vShadowMap.init(vDevice);
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create the shadow map: ", uEnum2Str::toStr(lRes));
+    return false;
+  }
+
+  if (lNumCached > 0) {
+    vCache->format           = vDepthFormat;
+    vCache->extent           = {vResolution, vResolution, 1};
+    vCache->arrayLayers      = lNumCached;
+    vCache->usage            = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    vCache->subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, lNumCached};
+
+    lRes = vCache.init(vDevice);
+    if (lRes != VK_SUCCESS) {
+      eLOG("Failed to create the shadow cache: ", uEnum2Str::toStr(lRes));
+      return false;
+    }
+  }
+
+  // The image view of vkuImageBuffer is only an array view for more than one layer
+  vArrayView_vk = createLayerView(vShadowMap.getImage(), VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, vNumCascades);
+  if (vArrayView_vk == VK_NULL_HANDLE)
+    return false;
+
+  for (uint32_t i = 0; i < vNumCascades; ++i)
+    vLayerViews_vk.emplace_back(createLayerView(vShadowMap.getImage(), VK_IMAGE_VIEW_TYPE_2D, i, 1));
+
+  for (uint32_t i = 0; i < lNumCached; ++i)
+    vLayerViews_vk.emplace_back(createLayerView(vCache.getImage(), VK_IMAGE_VIEW_TYPE_2D, i, 1));
+
+  for (auto i : vLayerViews_vk) {
+    if (i == VK_NULL_HANDLE)
+      return false;
+
+    vFrameBuffers.emplace_back();
+    vFrameBuffers.back().setup(vPassClear);
+    lRes = vFrameBuffers.back().reCreateFrameBuffers({{vResolution, vResolution, 1}, {{0, i}}});
+    if (lRes != VK_SUCCESS) {
+      eLOG("Failed to create a shadow framebuffer: ", uEnum2Str::toStr(lRes));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*!
+ * \returns VK_NULL_HANDLE on error
+ */
+VkImageView rRendererShadow::createLayerView(VkImage         _img,
+                                             VkImageViewType _type,
+                                             uint32_t        _firstLayer,
+                                             uint32_t        _numLayers) {
+  VkComponentSwizzle lID = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+  VkImageViewCreateInfo lInfo;
+  lInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  lInfo.pNext            = nullptr;
+  lInfo.flags            = 0;
+  lInfo.image            = _img;
+  lInfo.viewType         = _type;
+  lInfo.format           = vDepthFormat;
+  lInfo.components       = {lID, lID, lID, lID};
+  lInfo.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, _firstLayer, _numLayers};
+
+  VkImageView lView = VK_NULL_HANDLE;
+  auto        lRes  = vkCreateImageView(vDevice_vk, &lInfo, nullptr, &lView);
+  if (lRes != VK_SUCCESS) {
+    eLOG("'vkCreateImageView' returned ", uEnum2Str::toStr(lRes));
+    return VK_NULL_HANDLE;
+  }
+
+  return lView;
+}
+
+/*!
+ * \brief Creates the depth compare sampler (hardware PCF, everything outside the map is lit)
+ */
+bool rRendererShadow::initSampler() {
+  VkSamplerCreateInfo lSamplerInfo;
+  lSamplerInfo.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  lSamplerInfo.pNext                   = nullptr;
+  lSamplerInfo.flags                   = 0;
+  lSamplerInfo.magFilter               = VK_FILTER_LINEAR;
+  lSamplerInfo.minFilter               = VK_FILTER_LINEAR;
+  lSamplerInfo.mipmapMode              = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  lSamplerInfo.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  lSamplerInfo.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  lSamplerInfo.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+  lSamplerInfo.mipLodBias              = 0.0f;
+  lSamplerInfo.anisotropyEnable        = VK_FALSE;
+  lSamplerInfo.maxAnisotropy           = 1.0f;
+  lSamplerInfo.compareEnable           = VK_TRUE;
+  lSamplerInfo.compareOp               = VK_COMPARE_OP_LESS_OR_EQUAL;
+  lSamplerInfo.minLod                  = 0.0f;
+  lSamplerInfo.maxLod                  = 0.0f;
+  lSamplerInfo.borderColor             = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+  lSamplerInfo.unnormalizedCoordinates = VK_FALSE;
+
+  auto lRes = vkCreateSampler(vDevice_vk, &lSamplerInfo, nullptr, &vSampler_vk);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create sampler: ", uEnum2Str::toStr(lRes));
+    vSampler_vk = VK_NULL_HANDLE;
+    return false;
+  }
+
+  return true;
+}
+
+void rRendererShadow::destroyRenderer() {
+  vFbData.clear();
+  vFrameBuffers.clear();
+
+  for (auto i : vLayerViews_vk)
+    if (i != VK_NULL_HANDLE)
+      vkDestroyImageView(vDevice_vk, i, nullptr);
+
+  if (vArrayView_vk != VK_NULL_HANDLE)
+    vkDestroyImageView(vDevice_vk, vArrayView_vk, nullptr);
+
+  if (vSampler_vk != VK_NULL_HANDLE)
+    vkDestroySampler(vDevice_vk, vSampler_vk, nullptr);
+
+  vLayerViews_vk.clear();
+  vArrayView_vk = VK_NULL_HANDLE;
+  vSampler_vk   = VK_NULL_HANDLE;
+
+  if (vPipeline.getIsCreated())
+    vPipeline.destroy();
+
+  vShadowMap.destroy();
+  vCache.destroy();
+  vCascadeBuffer.destroy();
+  vPassClear.destroy();
+  vPassCache.destroy();
+  vPassLoad.destroy();
+
+  vLight = nullptr;
+  vCasters.clear();
+  vCached.clear();
+}
+
+VkFramebuffer rRendererShadow::getFrameBuffer(uint32_t) {
+  return vFrameBuffers.empty() ? VK_NULL_HANDLE : *vFrameBuffers[0];
+}
+
+VkImageView rRendererShadow::getAttachmentView(rRendererBase::ATTACHMENT_ROLE _role) {
+  switch (_role) {
+    case DEPTH_STENCIL: return vArrayView_vk;
+    default: return VK_NULL_HANDLE;
+  }
+}
+
+/*!
+ * \brief Writes the shadow map (getGraphResource) instead of the swapchain image
+ *
+ * The shadow pass is culled by the world unless an other renderer reads the shadow map (addGraphRead).
+ */
+void rRendererShadow::declareGraphPass(rRenderGraph &_graph, uint32_t _pass) {
+  _graph.importImage(getGraphResource(),
+                     vShadowMap.getImage(),
+                     vArrayView_vk,
+                     {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, vNumCascades},
+                     rRenderGraph::SAMPLED_GRAPHICS,
+                     rRenderGraph::SAMPLED_GRAPHICS);
+  _graph.write(_pass, getGraphResource(), rRenderGraph::DEPTH_ATTACHMENT);
+}
+
+rRendererBase::SubmitInfo rRendererShadow::getVulkanSubmitInfos() {
+  SubmitInfo lInfo;
+
+  for (auto &i : vFbData) {
+    VkSubmitInfo lSubInfo;
+    lSubInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    lSubInfo.pNext                = nullptr;
+    lSubInfo.waitSemaphoreCount   = 0;
+    lSubInfo.pWaitSemaphores      = nullptr;
+    lSubInfo.pWaitDstStageMask    = nullptr;
+    lSubInfo.commandBufferCount   = 1;
+    lSubInfo.pCommandBuffers      = &i.cmdBuffer.get();
+    lSubInfo.signalSemaphoreCount = 0;
+    lSubInfo.pSignalSemaphores    = nullptr;
+
+    lInfo.fb.push_back({{lSubInfo}});
+  }
+
+  return lInfo;
+}
+
+/*!
+ * \brief Binds the shadow map and the cascade buffer to a shader that samples them
+ *
+ * Binds all sampler2DArrayShadow uniforms named SAMPLER_NAME and all storage blocks named BLOCK_NAME.
+ * \returns true if at least one of them was bound
+ */
+bool rRendererShadow::bindToShader(rShaderBase *_shader) {
+  if (!_shader || vArrayView_vk == VK_NULL_HANDLE) {
+    eLOG("Shadow renderer not initialized yet");
+    return false;
+  }
+
+  bool lFound = false;
+  for (auto i : {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT}) {
+    for (auto const &j : _shader->getStorageBuffers(i)) {
+      if (j.name != BLOCK_NAME)
+        continue;
+
+      if (!_shader->updateStorageBuffer(j, *vCascadeBuffer))
+        return false;
+
+      lFound = true;
+    }
+  }
+
+  for (auto const &i : _shader->getUniforms()) {
+    if (i.name != SAMPLER_NAME)
+      continue;
+
+    if (i.type != "sampler2DArrayShadow") {
+      eLOG("The shadow map sampler ", i.name, " in ", _shader->getName(), " must be a sampler2DArrayShadow");
+      return false;
+    }
+
+    VkDescriptorSet lSet = _shader->getDescriptorSet(nullptr);
+    if (lSet == VK_NULL_HANDLE) {
+      eLOG(L"Failed to get descriptor set");
+      return false;
+    }
+
+    VkDescriptorImageInfo lImageInfo;
+    lImageInfo.sampler     = vSampler_vk;
+    lImageInfo.imageView   = vArrayView_vk;
+    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet lWriteSet;
+    lWriteSet.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    lWriteSet.pNext            = nullptr;
+    lWriteSet.dstSet           = lSet;
+    lWriteSet.dstBinding       = i.binding;
+    lWriteSet.dstArrayElement  = 0;
+    lWriteSet.descriptorCount  = 1;
+    lWriteSet.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    lWriteSet.pImageInfo       = &lImageInfo;
+    lWriteSet.pBufferInfo      = nullptr;
+    lWriteSet.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(vDevice_vk, 1, &lWriteSet, 0, nullptr);
+    lFound = true;
+  }
+
+  return lFound;
+}
+
+/*!
+ * \brief Sets the dynamic depth bias used while rendering the shadow maps
+ * \param _constant Constant depth offset (in units of the depth format)
+ * \param _slope    Offset scaled by the depth slope of the polygon
+ */
+void rRendererShadow::setDepthBias(float _constant, float _slope) {
+  vBiasConstant = _constant;
+  vBiasSlope    = _slope;
+}
+
+/*!
+ * \brief Returns a stable light space projection for a bounding sphere
+ *
+ * The light camera is placed vCasterDistance behind the sphere, so that objects outside of the
+ * cascade still cast shadows into it. The projection is snapped to whole texels, so that the shadow
+ * edges do not flicker when the camera moves.
+ */
+glm::mat4 rRendererShadow::fitCascade(glm::vec3 const &_center, float _radius, glm::vec3 const &_lightDir) {
+  glm::vec3 lUp   = std::abs(_lightDir.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+  glm::mat4 lView = glm::lookAt(_center - _lightDir * (_radius + vCasterDistance), _center, lUp);
+  glm::mat4 lProj = glm::ortho(-_radius, _radius, -_radius, _radius, 0.0f, 2.0f * _radius + vCasterDistance);
+
+  float     lHalfRes = static_cast<float>(vResolution) / 2.0f;
+  glm::vec4 lOrigin  = lProj * lView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+  glm::vec2 lTexel   = glm::vec2(lOrigin) * lHalfRes;
+  glm::vec2 lOffset  = (glm::round(lTexel) - lTexel) / lHalfRes;
+
+  lProj[3][0] += lOffset.x;
+  lProj[3][1] += lOffset.y;
+  return lProj * lView;
+}
+
+/*!
+ * \brief Renders the shadow casters of a cascade into one layer
+ * \param _buf      The command buffer (outside of a render pass)
+ * \param _pass     The render pass (defines load op and layouts)
+ * \param _layer    Index in vFrameBuffers
+ * \param _viewProj The light space projection of the cascade
+ * \param _casters  Which objects are rendered
+ * \vkIntern
+ */
+void rRendererShadow::cmdRenderLayer(
+    VkCommandBuffer _buf, VkRenderPass _pass, uint32_t _layer, glm::mat4 const &_viewProj, CASTERS _casters) {
+  auto lClear = vPassClear.getClearValues();
+
+  VkRenderPassBeginInfo lInfo;
+  lInfo.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  lInfo.pNext           = nullptr;
+  lInfo.renderPass      = _pass;
+  lInfo.framebuffer     = *vFrameBuffers[_layer];
+  lInfo.renderArea      = {{0, 0}, {vResolution, vResolution}};
+  lInfo.clearValueCount = static_cast<uint32_t>(lClear.size());
+  lInfo.pClearValues    = lClear.data();
+
+  VkViewport lViewPort = {0.0f, 0.0f, static_cast<float>(vResolution), static_cast<float>(vResolution), 0.0f, 1.0f};
+  VkRect2D   lScissors = {{0, 0}, {vResolution, vResolution}};
+
+  vkCmdBeginRenderPass(_buf, &lInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+  if (vLight) {
+    vPipeline.cmdBindPipeline(_buf, VK_PIPELINE_BIND_POINT_GRAPHICS);
+    vkCmdSetViewport(_buf, 0, 1, &lViewPort);
+    vkCmdSetScissor(_buf, 0, 1, &lScissors);
+    vkCmdSetDepthBias(_buf, vBiasConstant, 0.0f, vBiasSlope);
+
+    VkBuffer lLastVertex = VK_NULL_HANDLE;
+    VkBuffer lLastIndex  = VK_NULL_HANDLE;
+    uint32_t lBindPoint  = vPipeline.getVertexBindPoint();
+
+    rObjectBase::IndirectDrawData lData;
+    for (auto const &i : vScene->queryFrustum(_viewProj)) {
+      if (vCasters.count(i.get()) == 0)
+        continue;
+
+      if ((_casters == STATIC_CASTERS && !i->getIsStatic()) || (_casters == DYNAMIC_CASTERS && i->getIsStatic()))
+        continue;
+
+      if (!i->getIndirectDrawData(lData))
+        continue;
+
+      glm::mat4    lMVP    = _viewProj * lData.model;
+      VkDeviceSize lOffset = 0;
+
+      vShader->cmdUpdatePushConstant(_buf, vMVPVar, &lMVP);
+
+      if (lData.geometry.vertexBuffer != lLastVertex) {
+        lLastVertex = lData.geometry.vertexBuffer;
+        vkCmdBindVertexBuffers(_buf, lBindPoint, 1, &lLastVertex, &lOffset);
+      }
+
+      if (lData.geometry.indexBuffer != lLastIndex) {
+        lLastIndex = lData.geometry.indexBuffer;
+        vkCmdBindIndexBuffer(_buf, lLastIndex, 0, lData.geometry.indexType);
+      }
+
+      vkCmdDrawIndexed(
+          _buf, lData.geometry.numIndexes, 1, lData.geometry.firstIndex, lData.geometry.vertexOffset, 0);
+    }
+  }
+
+  vkCmdEndRenderPass(_buf);
+}
+
+/*!
+ * \brief Copies a layer of the static cache into a cascade of the shadow map
+ * \note The cache layer must be in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL (final layout of vPassCache)
+ * \note The cascade is left in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL (initial layout of vPassLoad)
+ * \vkIntern
+ */
+void rRendererShadow::cmdCopyCache(VkCommandBuffer _buf, uint32_t _cacheLayer, uint32_t _cascade) {
+  VkImageSubresourceRange lRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, _cascade, 1};
+
+  // The old content of the cascade is overwritten anyway, but the last frame must be done reading it
+  VkImageMemoryBarrier lBarrier = vkuImageBuffer::generateLayoutChangeBarrier(
+      vShadowMap.getImage(), lRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+  lBarrier.srcAccessMask = 0;
+  lBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(_buf,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0,
+                       0,
+                       nullptr,
+                       0,
+                       nullptr,
+                       1,
+                       &lBarrier);
+
+  VkImageCopy lCopy;
+  lCopy.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, _cacheLayer, 1};
+  lCopy.srcOffset      = {0, 0, 0};
+  lCopy.dstSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, _cascade, 1};
+  lCopy.dstOffset      = {0, 0, 0};
+  lCopy.extent         = {vResolution, vResolution, 1};
+
+  vkCmdCopyImage(_buf,
+                 vCache.getImage(),
+                 VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 vShadowMap.getImage(),
+                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 1,
+                 &lCopy);
+}
+
+/*!
+ * \brief Fits the cascades to the current camera and records all shadow passes
+ *
+ * The casters are culled per cascade on the CPU, so this is done every frame (updatePushConstants
+ * records the buffer of the next frame right before it is submitted). The static cache is only marked
+ * valid in these per frame recordings, because the buffers recorded with RECORD_ALL may never be
+ * submitted.
+ */
+void rRendererShadow::recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) {
+  auto &fb = vFbData[_fbIndex];
+  fb.cmdBuffer.begin();
+
+  auto *    lCamera  = dynamic_cast<rMatrixSceneBase<float> *>(vScene);
+  glm::mat4 lView    = *lCamera->getViewMatrix();
+  glm::mat4 lProj    = *lCamera->getProjectionMatrix();
+  glm::mat4 lInvCam  = glm::inverse(lProj * lView);
+  bool      lCommit  = _toRender == RECORD_PUSH_CONST_ONLY;
+  uint64_t  lVersion = vScene->getStaticGeometryVersion();
+
+  // Near and far plane of a (depth zero to one) perspective projection
+  float lNear     = lProj[3][2] / lProj[2][2];
+  float lProjFar  = lProj[3][2] / (lProj[2][2] + 1.0f);
+  float lFar      = std::min(lProjFar, vMaxDistance);
+  bool  lHasSplit = vLight && lNear > 0.0f && lFar > lNear;
+
+  glm::vec3 *lDirPtr   = nullptr;
+  glm::vec3  lLightDir = glm::vec3(0.0f, -1.0f, 0.0f);
+  if (vLight && vLight->getVector(&lDirPtr, rObjectBase::DIRECTION) == rObjectBase::ALL_OK && lDirPtr)
+    lLightDir = glm::normalize(*lDirPtr);
+
+  // World space corners of the camera frustum on the near and the far plane
+  glm::vec3 lNearCorners[4];
+  glm::vec3 lFarCorners[4];
+  for (uint32_t i = 0; i < 4; ++i) {
+    glm::vec4 lN    = lInvCam * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 0.0f, 1.0f);
+    glm::vec4 lF    = lInvCam * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 1.0f, 1.0f);
+    lNearCorners[i] = glm::vec3(lN) / lN.w;
+    lFarCorners[i]  = glm::vec3(lF) / lF.w;
+  }
+
+  CascadeData lData    = {};
+  lData.numCascades    = glm::uvec4(vNumCascades, 0, 0, 0);
+  uint32_t lFirstCache = vNumCascades - static_cast<uint32_t>(vCached.size());
+  float    lSplitStart = lNear;
+
+  for (uint32_t i = 0; i < vNumCascades; ++i) {
+    // Blend of logarithmic and uniform split distribution
+    float lPart     = static_cast<float>(i + 1) / static_cast<float>(vNumCascades);
+    float lLog      = lHasSplit ? lNear * std::pow(lFar / lNear, lPart) : 0.0f;
+    float lUniform  = lNear + (lFar - lNear) * lPart;
+    float lSplitEnd = vSplitLambda * lLog + (1.0f - vSplitLambda) * lUniform;
+
+    lData.splits[i] = lSplitEnd;
+
+    // Bounding sphere of the cascade (independent of the camera rotation ==> stable texel size)
+    glm::vec3 lCorners[8];
+    glm::vec3 lCenter = glm::vec3(0.0f);
+    for (uint32_t j = 0; j < 4; ++j) {
+      float lT0       = lHasSplit ? (lSplitStart - lNear) / (lProjFar - lNear) : 0.0f;
+      float lT1       = lHasSplit ? (lSplitEnd - lNear) / (lProjFar - lNear) : 0.0f;
+      lCorners[j]     = glm::mix(lNearCorners[j], lFarCorners[j], lT0);
+      lCorners[j + 4] = glm::mix(lNearCorners[j], lFarCorners[j], lT1);
+      lCenter += lCorners[j] + lCorners[j + 4];
+    }
+
+    lCenter /= 8.0f;
+
+    float lRadius = 0.0f;
+    for (auto const &j : lCorners)
+      lRadius = std::max(lRadius, glm::length(j - lCenter));
+
+    lRadius     = std::max(std::ceil(lRadius * 16.0f) / 16.0f, 1.0f / 16.0f);
+    lSplitStart = lSplitEnd;
+
+    if (i < lFirstCache || !lHasSplit) {
+      lData.viewProj[i] = fitCascade(lCenter, lRadius, lLightDir);
+      cmdRenderLayer(*fb.cmdBuffer, *vPassClear, i, lData.viewProj[i], ALL_CASTERS);
+      continue;
+    }
+
+    // ==> Cached cascade: the cached region must still contain the whole cascade
+    uint32_t       lCacheIndex = i - lFirstCache;
+    CachedCascade &lCache      = vCached[lCacheIndex];
+    bool           lSameLight  = glm::length(lCache.lightDir - lLightDir) < 1e-4f;
+    bool           lSameSize   = std::abs(lCache.radius - lRadius * vCacheMargin) < 1e-4f;
+    bool           lInside     = glm::length(lCenter - lCache.center) + lRadius <= lCache.radius;
+
+    if (!lCache.valid || lCache.staticVersion != lVersion || !lSameLight || !lSameSize || !lInside) {
+      CachedCascade lNew;
+      lNew.center        = lCenter;
+      lNew.lightDir      = lLightDir;
+      lNew.radius        = lRadius * vCacheMargin;
+      lNew.staticVersion = lVersion;
+      lNew.viewProj      = fitCascade(lNew.center, lNew.radius, lLightDir);
+      lNew.valid         = lCommit;
+
+      cmdRenderLayer(*fb.cmdBuffer, *vPassCache, vNumCascades + lCacheIndex, lNew.viewProj, STATIC_CASTERS);
+      lCache = lNew;
+    }
+
+    lData.viewProj[i] = lCache.viewProj;
+    cmdCopyCache(*fb.cmdBuffer, lCacheIndex, i);
+    cmdRenderLayer(*fb.cmdBuffer, *vPassLoad, i, lCache.viewProj, DYNAMIC_CASTERS);
+  }
+
+  auto lAccess = vCascadeBuffer.getBufferAccess();
+  if (lAccess) {
+    *reinterpret_cast<CascadeData *>(*lAccess) = lData;
+  } else {
+    eLOG(L"Failed to bind vulkan memory");
+  }
+
+  auto lRes = vkEndCommandBuffer(*fb.cmdBuffer);
+  if (lRes) {
+    eLOG("'vkEndCommandBuffer' returned ", uEnum2Str::toStr(lRes));
+    //! \todo Handle this somehow (practically this code must not execute)
+  }
+}
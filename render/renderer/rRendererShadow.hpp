@@ -0,0 +1,185 @@
+/*!
+ * \file rRendererShadow.hpp
+ * \brief \b Classes: \a rRendererShadow
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "vkuBuffer.hpp"
+#include "vkuCommandBuffer.hpp"
+#include "vkuFrameBuffer.hpp"
+#include "vkuImageBuffer.hpp"
+#include "vkuRenderPass.hpp"
+#include "rPipeline.hpp"
+#include "rRendererBase.hpp"
+#include "rShaderBase.hpp"
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <unordered_set>
+
+namespace e_engine {
+
+/*!
+ * \brief Cascaded shadow maps for the first directional light of a scene
+ *
+ * The view frustum of the scene camera is split into cascades (blend of logarithmic and uniform
+ * splits, see setSplitLambda). Every cascade is rendered depth only into one layer of a 2D array
+ * image with the own pipeline of this renderer. The shadow casters are culled per cascade frustum
+ * with the BVH of the scene, so the command buffers are recorded every frame.
+ *
+ * The last setNumCachedCascades cascades are cached: the static objects (rObjectBase::setIsStatic)
+ * are rendered into a separate cache image, which is only updated when the light direction, the
+ * static geometry or the projection changes, or when the camera left the (enlarged) cached region.
+ * Every frame the cache is copied into the shadow map and only the dynamic objects are drawn on top.
+ *
+ * The renderers sampling the shadow map must read getGraphResource (rRendererBase::addGraphRead), so
+ * that the world submits the shadow pass before them (the render pass dependencies order the shadow pass
+ * before later fragment and compute shaders). Without readers the shadow pass is culled.
+ *
+ * The shadow shader needs:
+ *  - the vertex inputs of the meshes (same layout as their normal pipeline)
+ *  - a mat4 push constant with the MODEL_VIEW_PROJECTION_MATRIX role (i.e. uMVP)
+ *
+ * Shaders sampling the shadow map can be bound with bindToShader. They need a sampler2DArrayShadow
+ * named SAMPLER_NAME (depth compare sampler) and / or a storage block named BLOCK_NAME with the
+ * CascadeData layout.
+ */
+class rRendererShadow final : public rRendererBase {
+ public:
+  static const uint32_t MAX_CASCADES = 4;
+
+  static const std::string SAMPLER_NAME;
+  static const std::string BLOCK_NAME;
+
+  //! std430 layout of the cascade storage buffer
+  struct CascadeData {
+    glm::mat4  viewProj[MAX_CASCADES]; //!< World space to shadow map clip space
+    glm::vec4  splits;                 //!< View space distance where each cascade ends
+    glm::uvec4 numCascades;
+  };
+
+ private:
+  enum CASTERS { ALL_CASTERS, STATIC_CASTERS, DYNAMIC_CASTERS };
+
+  struct CachedCascade {
+    glm::mat4 viewProj;
+    glm::vec3 center;
+    glm::vec3 lightDir;
+    float     radius        = 0.0f;
+    uint64_t  staticVersion = 0;
+    bool      valid         = false;
+  };
+
+  struct FB_DATA {
+    vkuCommandBuffer cmdBuffer;
+  };
+
+  std::vector<FB_DATA> vFbData;
+
+  vkuRenderPass  vPassClear; //!< Cascades without cache
+  vkuRenderPass  vPassCache; //!< Static objects into the cache image
+  vkuRenderPass  vPassLoad;  //!< Dynamic objects on top of the copied cache
+  vkuImageBuffer vShadowMap;
+  vkuImageBuffer vCache;
+  vkuBuffer      vCascadeBuffer;
+
+  VkImageView                 vArrayView_vk = VK_NULL_HANDLE; //!< All cascades (sampled)
+  std::vector<VkImageView>    vLayerViews_vk;                 //!< Shadow map layers, then cache layers
+  std::vector<vkuFrameBuffer> vFrameBuffers;                  //!< One per entry in vLayerViews_vk
+
+  rShaderBase *vShader      = nullptr;
+  rPipeline    vPipeline;
+  VkSampler    vSampler_vk  = VK_NULL_HANDLE;
+  VkFormat     vDepthFormat = VK_FORMAT_UNDEFINED;
+
+  rShaderBase::PushConstantVar vMVPVar;
+
+  std::shared_ptr<rObjectBase>      vLight;
+  std::unordered_set<rObjectBase *> vCasters; //!< Meshes compatible with the shadow pipeline
+  std::vector<CachedCascade>        vCached;
+
+  uint32_t vResolution;
+  uint32_t vNumCascades;
+  uint32_t vNumCached      = 1;
+  float    vSplitLambda    = 0.75f;
+  float    vMaxDistance    = 100.0f;
+  float    vCasterDistance = 50.0f; //!< Distance behind a cascade in which objects still cast shadows
+  float    vCacheMargin    = 1.5f;  //!< Scale of the cached region relative to the cascade
+  float    vBiasConstant   = 1.25f;
+  float    vBiasSlope      = 1.75f;
+
+  vkuRenderPass::Config getRenderPassDescription(VkAttachmentLoadOp _loadOp,
+                                                 VkImageLayout      _initialLayout,
+                                                 VkImageLayout      _finalLayout);
+
+  bool        initImages();
+  bool        initSampler();
+  VkImageView createLayerView(VkImage _img, VkImageViewType _type, uint32_t _firstLayer, uint32_t _numLayers);
+
+  glm::mat4 fitCascade(glm::vec3 const &_center, float _radius, glm::vec3 const &_lightDir);
+  void      cmdRenderLayer(VkCommandBuffer  _buf,
+                           VkRenderPass     _pass,
+                           uint32_t         _layer,
+                           glm::mat4 const &_viewProj,
+                           CASTERS          _casters);
+  void      cmdCopyCache(VkCommandBuffer _buf, uint32_t _cacheLayer, uint32_t _cascade);
+
+ protected:
+  VkResult initRenderer(SwapChainImages _images, VkSurfaceFormatKHR _surfaceFormat, vkuCommandPool *_pool) override;
+  void     destroyRenderer() override;
+
+  void recordCmdBuffers(uint32_t &_fbIndex, RECORD_TARGET _toRender) override;
+  bool usesObjectPipelines() const override { return false; }
+
+  VkRenderPass              getRenderPass() override { return *vPassClear; }
+  VkFramebuffer             getFrameBuffer(uint32_t) override;
+  std::vector<VkClearValue> getClearValues() override { return vPassClear.getClearValues(); }
+
+ public:
+  VkImageView getAttachmentView(ATTACHMENT_ROLE _role) override;
+
+  SubmitInfo getVulkanSubmitInfos() override;
+  void       declareGraphPass(rRenderGraph &_graph, uint32_t _pass) override;
+
+  bool bindToShader(rShaderBase *_shader);
+
+  void setSplitLambda(float _lambda) { vSplitLambda = _lambda; }
+  void setMaxDistance(float _distance) { vMaxDistance = _distance; }
+  void setCasterDistance(float _distance) { vCasterDistance = _distance; }
+  void setNumCachedCascades(uint32_t _num) { vNumCached = _num; }
+  void setDepthBias(float _constant, float _slope);
+
+  rPipeline * getShadowPipeline() { return &vPipeline; } //!< Configure the vertex input formats before init
+  VkImageView getShadowMapView() const { return vArrayView_vk; }
+  VkSampler   getSampler() const { return vSampler_vk; }
+  VkBuffer    getCascadeBuffer() const { return *vCascadeBuffer; }
+  std::string getGraphResource() const { return "shadow:" + getGraphName(); } //!< Render graph name of the map
+
+  rRendererShadow() = delete;
+  rRendererShadow(rWorld *      _root,
+                  std::wstring  _id,
+                  rShaderBase * _shader,
+                  uint32_t      _resolution  = 2048,
+                  uint32_t      _numCascades = MAX_CASCADES);
+};
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
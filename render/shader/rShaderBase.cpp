@@ -165,7 +165,7 @@ VkDescriptorType rShaderBase::getDescriptorType(std::string _str) {
   if (_str == "texture2D")
     return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 
-  if (_str == "sampler2D")
+  if (_str == "sampler2D" || _str == "usampler2D" || _str == "sampler2DArray" || _str == "sampler2DArrayShadow")
     return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
   if (_str == "samplerBuffer")
@@ -193,6 +193,14 @@ rShaderBase::UNIFORM_ROLE rShaderBase::guessRole(std::string _type, std::string
     for (auto const &i : gShaderInputVarNames[U_M_M])
       if (i == _name)
         return MODEL_MATRIX;
+
+    for (auto const &i : gShaderInputVarNames[U_M_MV])
+      if (i == _name)
+        return MODEL_VIEW_MATRIX;
+
+    for (auto const &i : gShaderInputVarNames[U_M_DEQUANT])
+      if (i == _name)
+        return DEQUANTIZE_MATRIX;
   }
 
   if (_type == "mat3" || _type == "mat3x3") {
@@ -201,7 +209,8 @@ rShaderBase::UNIFORM_ROLE rShaderBase::guessRole(std::string _type, std::string
         return NORMAL_MATRIX;
   }
 
-  if (_type == "subpassInput") {
+  // G-buffer data is read from storage images or samplers in compute based lighting
+  if (_type == "subpassInput" || _type == "image2D" || _type == "sampler2D") {
     for (auto const &i : gShaderInputVarNames[U_SP_POS])
       if (i == _name)
         return POSITION_SUBPASS_DATA;
@@ -213,6 +222,10 @@ rShaderBase::UNIFORM_ROLE rShaderBase::guessRole(std::string _type, std::string
     for (auto const &i : gShaderInputVarNames[U_SP_ALBEDO])
       if (i == _name)
         return ALBEDO_SUBPASS_DATA;
+
+    for (auto const &i : gShaderInputVarNames[U_SP_DEPTH])
+      if (i == _name)
+        return DEPTH_SUBPASS_DATA;
   }
 
   if (_type == "float") {
@@ -398,6 +411,35 @@ void rShaderBase::addLayoutBindings(VkShaderStageFlagBits _stage, ShaderInfo _in
     for (auto &j : vUniformBufferDescs.back().vars)
       j.mem = vMemory[lIndex];
   }
+
+
+  // Handle storage blocks (the buffers are provided by the user with updateStorageBuffer)
+
+  for (auto const &i : _info.storageBlocks) {
+    VkDescriptorSetLayoutBinding lTemp = {};
+    lTemp.binding                      = i.binding;
+    lTemp.descriptorType               = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    lTemp.descriptorCount              = 1;
+    lTemp.stageFlags                   = _stage;
+    lTemp.pImmutableSamplers           = nullptr;
+
+    dVkLOG("    -- Storage Block binding = ", i.binding, " ", i.name);
+
+    vLayoutBindings.emplace_back(lTemp);
+    vStorageBufferDescs.push_back({_stage, i.name, i.binding});
+
+    bool lFound = false;
+    for (auto &j : vDescPoolSizes) {
+      if (j.type == lTemp.descriptorType) {
+        j.descriptorCount++;
+        lFound = true;
+        break;
+      }
+    }
+
+    if (!lFound)
+      vDescPoolSizes.push_back({lTemp.descriptorType, 1});
+  }
 }
 
 bool rShaderBase::getGLSLTypeInfo(std::string _name, uint32_t &_size, VkFormat &_format) {
@@ -437,6 +479,18 @@ bool rShaderBase::getGLSLTypeInfo(std::string _name, uint32_t &_size, VkFormat &
     return true;
   }
 
+  if (_name == "uint") {
+    _size   = sizeof(uint32_t);
+    _format = VK_FORMAT_R32_UINT;
+    return true;
+  }
+
+  if (_name == "int") {
+    _size   = sizeof(int32_t);
+    _format = VK_FORMAT_R32_SINT;
+    return true;
+  }
+
   if (_name == "mat2") {
     _size   = sizeof(float) * 2 * 2;
     _format = VK_FORMAT_R32G32_SFLOAT;
@@ -799,11 +853,18 @@ bool rShaderBase::updateDescriptorSet(UniformVar const &_var,
   lWrite.pBufferInfo      = nullptr;
   lWrite.pTexelBufferView = nullptr;
 
-  if (_var.guessedRole == POSITION_SUBPASS_DATA || _var.guessedRole == NORMAL_SUBPASS_DATA ||
-      _var.guessedRole == ALBEDO_SUBPASS_DATA) {
+  if (getDescriptorType(_var.type) == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
     lFound                 = true;
     lImageInfo.imageView   = reinterpret_cast<VkImageView>(_data);
-    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    lWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    lWrite.pImageInfo     = &lImageInfo;
+  } else if (getDescriptorType(_var.type) == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT) {
+    lFound                 = true;
+    lImageInfo.imageView   = reinterpret_cast<VkImageView>(_data);
+    lImageInfo.imageLayout = _var.guessedRole == DEPTH_SUBPASS_DATA ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                                                    : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
     lWrite.descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
     lWrite.pImageInfo     = &lImageInfo;
@@ -829,6 +890,45 @@ bool rShaderBase::updateDescriptorSet(UniformVar const &_var,
   return true;
 }
 
+/*!
+ * \brief Binds a storage buffer to a storage block of the descriptor set for a material
+ * \param[in] _var         The storage block (from getStorageBuffers)
+ * \param[in] _buffer      The buffer to bind (must have VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+ * \param[in] _offset      Offset in the buffer
+ * \param[in] _range       Size of the bound range
+ * \param[in] _materialPtr The pointer to a material (nullptr is valid)
+ *
+ * \returns false on error
+ */
+bool rShaderBase::updateStorageBuffer(StorageBufferVar const &_var,
+                                      VkBuffer                _buffer,
+                                      VkDeviceSize            _offset,
+                                      VkDeviceSize            _range,
+                                      rMaterial const *       _materialPtr) {
+  VkDescriptorSet lDescSet = getDescriptorSet(_materialPtr);
+  if (lDescSet == nullptr) {
+    eLOG("Failed to acquire descriptor set");
+    return false;
+  }
+
+  VkDescriptorBufferInfo lBufferInfo = {_buffer, _offset, _range};
+
+  VkWriteDescriptorSet lWrite;
+  lWrite.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  lWrite.pNext            = nullptr;
+  lWrite.dstSet           = lDescSet;
+  lWrite.dstBinding       = _var.binding;
+  lWrite.dstArrayElement  = 0;
+  lWrite.descriptorCount  = 1;
+  lWrite.descriptorType   = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  lWrite.pImageInfo       = nullptr;
+  lWrite.pBufferInfo      = &lBufferInfo;
+  lWrite.pTexelBufferView = nullptr;
+
+  vkUpdateDescriptorSets(vDevice_vk, 1, &lWrite, 0, nullptr);
+  return true;
+}
+
 /*!
  * \returns nullptr on error
  */
@@ -889,6 +989,20 @@ std::vector<rShaderBase::UniformVar> rShaderBase::getUniforms() {
   return vUniformDesc;
 }
 
+std::vector<rShaderBase::StorageBufferVar> rShaderBase::getStorageBuffers(VkShaderStageFlagBits _stage) {
+  if (!vModulesCreated)
+    if (!init())
+      return {};
+
+  std::vector<rShaderBase::StorageBufferVar> lTemp;
+
+  for (auto const &i : vStorageBufferDescs)
+    if (i.stage == _stage)
+      lTemp.push_back(i);
+
+  return lTemp;
+}
+
 /*!
  * \brief get shader stage unifrom buffer information
  * \returns nullptr on failure
@@ -49,6 +49,9 @@ static const std::vector<std::vector<std::string>> gShaderInputVarNames = {
     {"uColor", "uAlbedo", "color", "albedo"},         // Subpass color / albedo data
     {"uLodBias", "LodBias", "lodBias"},               // Level of detail bias
     {"uSamplerDiffuse", "samplerDiffuse"},            // Diffuse color texture
+    {"uModelView", "modelView"},                      // Model view matrix
+    {"uDepth", "depth"},                              // Subpass depth data
+    {"uDequantize", "dequantize"},                    // Dequantization matrix of compressed positions
     {}};
 
 enum SHADER_INPUT_NAME_INDEX {
@@ -63,7 +66,10 @@ enum SHADER_INPUT_NAME_INDEX {
   U_SP_NORM   = 8,
   U_SP_ALBEDO = 9,
   U_LOD_BIAS  = 10,
-  U_SAMP_DIFF = 11
+  U_SAMP_DIFF = 11,
+  U_M_MV      = 12,
+  U_SP_DEPTH  = 13,
+  U_M_DEQUANT = 14
 };
 } // namespace internal
 
@@ -78,12 +84,15 @@ class rShaderBase {
     MODEL_VIEW_PROJECTION_MATRIX,
     VIEW_PROJECTION_MATRIX,
     MODEL_MATRIX,
+    MODEL_VIEW_MATRIX,
     NORMAL_MATRIX,
     POSITION_SUBPASS_DATA,
     NORMAL_SUBPASS_DATA,
     ALBEDO_SUBPASS_DATA,
+    DEPTH_SUBPASS_DATA,
     LOD_BIAS,
     TEXTURE_DIFFUSE_COLOR,
+    DEQUANTIZE_MATRIX,
     UNKONOWN
   };
 
@@ -109,6 +118,7 @@ class rShaderBase {
     std::vector<InOut>   uniforms;
     std::vector<InOut>   pushConstants;
     std::vector<Uniform> uniformBlocks;
+    std::vector<Uniform> storageBlocks;
   } ShaderInfo;
 
   struct UniformBuffer {
@@ -153,6 +163,13 @@ class rShaderBase {
     UNIFORM_ROLE guessedRole = UNKONOWN;
   };
 
+  struct StorageBufferVar {
+    VkShaderStageFlagBits stage;
+
+    std::string name;
+    uint32_t    binding;
+  };
+
  private:
   vkuDevicePTR vDevice;
   VkDevice     vDevice_vk; //!< \brief Shortcut for **vDevice \todo Evaluate elimenating this.
@@ -181,6 +198,7 @@ class rShaderBase {
   std::vector<UniformVar>                      vUniformDesc;
   std::vector<UniformBuffer>                   vUniformBufferDescs;
   std::vector<PushConstantVar>                 vPushConstantDescs;
+  std::vector<StorageBufferVar>                vStorageBufferDescs;
 
   std::unordered_map<rMaterial const *, VkDescriptorSet> vDescSetMap;
 
@@ -223,17 +241,24 @@ class rShaderBase {
 
   // Uniform handling
 
-  UniformBuffer const *        getUniformBuffer(VkShaderStageFlagBits _stage);
-  bool                         updateUniform(UniformBuffer::Var const &_var, void const *_data);
-  bool                         tryReserveUniform(UniformBuffer::Var const &_var);
-  std::vector<PushConstantVar> getPushConstants(VkShaderStageFlagBits _stage);
-  std::vector<UniformVar>      getUniforms();
+  UniformBuffer const *         getUniformBuffer(VkShaderStageFlagBits _stage);
+  bool                          updateUniform(UniformBuffer::Var const &_var, void const *_data);
+  bool                          tryReserveUniform(UniformBuffer::Var const &_var);
+  std::vector<PushConstantVar>  getPushConstants(VkShaderStageFlagBits _stage);
+  std::vector<UniformVar>       getUniforms();
+  std::vector<StorageBufferVar> getStorageBuffers(VkShaderStageFlagBits _stage);
 
   bool updateDescriptorSet(UniformVar const &_var,
                            void *            _data,
                            rMaterial const * _materialPtr = nullptr,
                            uint32_t          _elemet      = 0);
 
+  bool updateStorageBuffer(StorageBufferVar const &_var,
+                           VkBuffer                _buffer,
+                           VkDeviceSize            _offset      = 0,
+                           VkDeviceSize            _range       = VK_WHOLE_SIZE,
+                           rMaterial const *       _materialPtr = nullptr);
+
   void cmdUpdatePushConstant(VkCommandBuffer _buf, PushConstantVar const &_var, void const *_data);
 
   void cmdBindDescriptorSets(VkCommandBuffer     _buf,
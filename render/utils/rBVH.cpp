@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rBVH.hpp"
+#include "uLog.hpp"
+
+namespace e_engine {
+
+rBVH::rBVH(float _margin) : vMargin(_margin) { vNodes.reserve(64); }
+
+uint32_t rBVH::allocateNode() {
+  uint32_t lNode;
+
+  if (vFreeList != NULL_NODE) {
+    lNode     = vFreeList;
+    vFreeList = vNodes[lNode].parent;
+  } else {
+    lNode = static_cast<uint32_t>(vNodes.size());
+    vNodes.emplace_back();
+  }
+
+  vNodes[lNode]        = Node();
+  vNodes[lNode].height = 0;
+  return lNode;
+}
+
+void rBVH::freeNode(uint32_t _node) {
+  vNodes[_node].parent = vFreeList;
+  vNodes[_node].height = -1;
+  vFreeList            = _node;
+}
+
+/*!
+ * \brief Adds a new proxy to the tree
+ * \param[in] _box      The (tight) box of the proxy
+ * \param[in] _userData Value returned by the queries
+ * \returns the proxy ID (needed for update() and remove())
+ */
+uint32_t rBVH::insert(rAABB const &_box, uint32_t _userData) {
+  uint32_t  lLeaf   = allocateNode();
+  glm::vec3 lMargin = glm::vec3(vMargin);
+
+  vNodes[lLeaf].box      = rAABB(_box.min - lMargin, _box.max + lMargin);
+  vNodes[lLeaf].userData = _userData;
+
+  insertLeaf(lLeaf);
+  vNumLeafs++;
+  return lLeaf;
+}
+
+void rBVH::remove(uint32_t _proxy) {
+  if (_proxy >= vNodes.size() || !vNodes[_proxy].isLeaf() || vNodes[_proxy].height < 0) {
+    eLOG("Invalid BVH proxy ", _proxy);
+    return;
+  }
+
+  removeLeaf(_proxy);
+  freeNode(_proxy);
+  vNumLeafs--;
+}
+
+/*!
+ * \brief Moves a proxy
+ *
+ * The tree is only modified when _box is no longer inside the fat box of the proxy.
+ *
+ * \returns true if the tree was modified
+ */
+bool rBVH::update(uint32_t _proxy, rAABB const &_box) {
+  if (_proxy >= vNodes.size() || !vNodes[_proxy].isLeaf() || vNodes[_proxy].height < 0) {
+    eLOG("Invalid BVH proxy ", _proxy);
+    return false;
+  }
+
+  if (vNodes[_proxy].box.contains(_box))
+    return false;
+
+  glm::vec3 lMargin = glm::vec3(vMargin);
+
+  removeLeaf(_proxy);
+  vNodes[_proxy].box = rAABB(_box.min - lMargin, _box.max + lMargin);
+  insertLeaf(_proxy);
+  return true;
+}
+
+void rBVH::clear() {
+  vNodes.clear();
+  vRoot     = NULL_NODE;
+  vFreeList = NULL_NODE;
+  vNumLeafs = 0;
+}
+
+void rBVH::insertLeaf(uint32_t _leaf) {
+  if (vRoot == NULL_NODE) {
+    vRoot                = _leaf;
+    vNodes[_leaf].parent = NULL_NODE;
+    return;
+  }
+
+  // Find the best sibling (surface area heuristic)
+  rAABB    lLeafBox = vNodes[_leaf].box;
+  uint32_t lIndex   = vRoot;
+
+  while (!vNodes[lIndex].isLeaf()) {
+    Node const &lNode = vNodes[lIndex];
+
+    float lArea         = lNode.box.area();
+    float lCombinedArea = rAABB::merge(lNode.box, lLeafBox).area();
+
+    // Cost of creating a new parent for this node and the new leaf
+    float lCost = 2.0f * lCombinedArea;
+
+    // Minimum cost of pushing the leaf further down the tree
+    float lInheritanceCost = 2.0f * (lCombinedArea - lArea);
+
+    auto lDescendCost = [&](uint32_t _child) -> float {
+      Node const &lChild = vNodes[_child];
+      float       lNew   = rAABB::merge(lLeafBox, lChild.box).area();
+      return (lChild.isLeaf() ? lNew : lNew - lChild.box.area()) + lInheritanceCost;
+    };
+
+    float lCost1 = lDescendCost(lNode.child1);
+    float lCost2 = lDescendCost(lNode.child2);
+
+    if (lCost < lCost1 && lCost < lCost2)
+      break;
+
+    lIndex = lCost1 < lCost2 ? lNode.child1 : lNode.child2;
+  }
+
+  uint32_t lSibling   = lIndex;
+  uint32_t lOldParent = vNodes[lSibling].parent;
+  uint32_t lNewParent = allocateNode(); // May invalidate references into vNodes
+
+  vNodes[lNewParent].parent = lOldParent;
+  vNodes[lNewParent].box    = rAABB::merge(lLeafBox, vNodes[lSibling].box);
+  vNodes[lNewParent].height = vNodes[lSibling].height + 1;
+  vNodes[lNewParent].child1 = lSibling;
+  vNodes[lNewParent].child2 = _leaf;
+  vNodes[lSibling].parent   = lNewParent;
+  vNodes[_leaf].parent      = lNewParent;
+
+  if (lOldParent != NULL_NODE) {
+    if (vNodes[lOldParent].child1 == lSibling)
+      vNodes[lOldParent].child1 = lNewParent;
+    else
+      vNodes[lOldParent].child2 = lNewParent;
+  } else {
+    vRoot = lNewParent;
+  }
+
+  fixUpwards(vNodes[_leaf].parent);
+}
+
+void rBVH::removeLeaf(uint32_t _leaf) {
+  if (_leaf == vRoot) {
+    vRoot = NULL_NODE;
+    return;
+  }
+
+  uint32_t lParent      = vNodes[_leaf].parent;
+  uint32_t lGrandParent = vNodes[lParent].parent;
+  uint32_t lSibling     = vNodes[lParent].child1 == _leaf ? vNodes[lParent].child2 : vNodes[lParent].child1;
+
+  if (lGrandParent != NULL_NODE) {
+    if (vNodes[lGrandParent].child1 == lParent)
+      vNodes[lGrandParent].child1 = lSibling;
+    else
+      vNodes[lGrandParent].child2 = lSibling;
+
+    vNodes[lSibling].parent = lGrandParent;
+    freeNode(lParent);
+    fixUpwards(lGrandParent);
+  } else {
+    vRoot                   = lSibling;
+    vNodes[lSibling].parent = NULL_NODE;
+    freeNode(lParent);
+  }
+}
+
+//! Walks to the root, rebalancing and refitting every node on the way
+void rBVH::fixUpwards(uint32_t _node) {
+  while (_node != NULL_NODE) {
+    _node = balance(_node);
+
+    Node &lNode = vNodes[_node];
+    Node &lC1   = vNodes[lNode.child1];
+    Node &lC2   = vNodes[lNode.child2];
+
+    lNode.height = 1 + std::max(lC1.height, lC2.height);
+    lNode.box    = rAABB::merge(lC1.box, lC2.box);
+
+    _node = lNode.parent;
+  }
+}
+
+/*!
+ * \brief Performs a left or right rotation if node A is imbalanced
+ * \returns the new root of the subtree
+ */
+uint32_t rBVH::balance(uint32_t _iA) {
+  Node &A = vNodes[_iA];
+  if (A.isLeaf() || A.height < 2)
+    return _iA;
+
+  uint32_t iB = A.child1;
+  uint32_t iC = A.child2;
+  Node &   B  = vNodes[iB];
+  Node &   C  = vNodes[iC];
+
+  int32_t lBalance = C.height - B.height;
+
+  auto lReplaceInParent = [&](uint32_t _new) {
+    if (vNodes[_new].parent == NULL_NODE) {
+      vRoot = _new;
+    } else if (vNodes[vNodes[_new].parent].child1 == _iA) {
+      vNodes[vNodes[_new].parent].child1 = _new;
+    } else {
+      vNodes[vNodes[_new].parent].child2 = _new;
+    }
+  };
+
+  // Rotate C up
+  if (lBalance > 1) {
+    uint32_t iF = C.child1;
+    uint32_t iG = C.child2;
+    Node &   F  = vNodes[iF];
+    Node &   G  = vNodes[iG];
+
+    C.child1 = _iA;
+    C.parent = A.parent;
+    A.parent = iC;
+    lReplaceInParent(iC);
+
+    if (F.height > G.height) {
+      C.child2 = iF;
+      A.child2 = iG;
+      G.parent = _iA;
+      A.box    = rAABB::merge(B.box, G.box);
+      C.box    = rAABB::merge(A.box, F.box);
+      A.height = 1 + std::max(B.height, G.height);
+      C.height = 1 + std::max(A.height, F.height);
+    } else {
+      C.child2 = iG;
+      A.child2 = iF;
+      F.parent = _iA;
+      A.box    = rAABB::merge(B.box, F.box);
+      C.box    = rAABB::merge(A.box, G.box);
+      A.height = 1 + std::max(B.height, F.height);
+      C.height = 1 + std::max(A.height, G.height);
+    }
+
+    return iC;
+  }
+
+  // Rotate B up
+  if (lBalance < -1) {
+    uint32_t iD = B.child1;
+    uint32_t iE = B.child2;
+    Node &   D  = vNodes[iD];
+    Node &   E  = vNodes[iE];
+
+    B.child1 = _iA;
+    B.parent = A.parent;
+    A.parent = iB;
+    lReplaceInParent(iB);
+
+    if (D.height > E.height) {
+      B.child2 = iD;
+      A.child1 = iE;
+      E.parent = _iA;
+      A.box    = rAABB::merge(C.box, E.box);
+      B.box    = rAABB::merge(A.box, D.box);
+      A.height = 1 + std::max(C.height, E.height);
+      B.height = 1 + std::max(A.height, D.height);
+    } else {
+      B.child2 = iE;
+      A.child1 = iD;
+      D.parent = _iA;
+      A.box    = rAABB::merge(C.box, D.box);
+      B.box    = rAABB::merge(A.box, E.box);
+      A.height = 1 + std::max(C.height, D.height);
+      B.height = 1 + std::max(A.height, E.height);
+    }
+
+    return iB;
+  }
+
+  return _iA;
+}
+
+
+/*!
+ * \brief Appends the user data of all proxies whose (fat) box overlaps _box to _out
+ */
+void rBVH::queryOverlap(rAABB const &_box, std::vector<uint32_t> &_out) const {
+  if (vRoot == NULL_NODE)
+    return;
+
+  std::vector<uint32_t> lStack;
+  lStack.reserve(64);
+  lStack.push_back(vRoot);
+
+  while (!lStack.empty()) {
+    Node const &lNode = vNodes[lStack.back()];
+    lStack.pop_back();
+
+    if (!lNode.box.overlaps(_box))
+      continue;
+
+    if (lNode.isLeaf()) {
+      _out.push_back(lNode.userData);
+    } else {
+      lStack.push_back(lNode.child1);
+      lStack.push_back(lNode.child2);
+    }
+  }
+}
+
+/*!
+ * \brief Appends the user data of all proxies (partially) inside _frustum to _out
+ *
+ * Subtrees completely inside the frustum are collected without further plane tests.
+ */
+void rBVH::queryFrustum(rFrustum const &_frustum, std::vector<uint32_t> &_out) const {
+  if (vRoot == NULL_NODE)
+    return;
+
+  std::vector<uint32_t> lStack;
+  std::vector<uint32_t> lInside; // Subtrees that need no further tests
+  lStack.reserve(64);
+  lInside.reserve(64);
+  lStack.push_back(vRoot);
+
+  while (!lStack.empty()) {
+    Node const &lNode = vNodes[lStack.back()];
+    lStack.pop_back();
+
+    rFrustum::TEST_RESULT lRes = _frustum.test(lNode.box);
+    if (lRes == rFrustum::OUTSIDE)
+      continue;
+
+    if (lNode.isLeaf()) {
+      _out.push_back(lNode.userData);
+      continue;
+    }
+
+    auto &lTarget = lRes == rFrustum::INSIDE ? lInside : lStack;
+    lTarget.push_back(lNode.child1);
+    lTarget.push_back(lNode.child2);
+  }
+
+  while (!lInside.empty()) {
+    Node const &lNode = vNodes[lInside.back()];
+    lInside.pop_back();
+
+    if (lNode.isLeaf()) {
+      _out.push_back(lNode.userData);
+    } else {
+      lInside.push_back(lNode.child1);
+      lInside.push_back(lNode.child2);
+    }
+  }
+}
+
+/*!
+ * \brief Appends the user data of all proxies hit by _ray (up to _tMax) to _out
+ */
+void rBVH::queryRay(rRay const &_ray, float _tMax, std::vector<uint32_t> &_out) const {
+  if (vRoot == NULL_NODE)
+    return;
+
+  std::vector<uint32_t> lStack;
+  lStack.reserve(64);
+  lStack.push_back(vRoot);
+
+  float lT;
+
+  while (!lStack.empty()) {
+    Node const &lNode = vNodes[lStack.back()];
+    lStack.pop_back();
+
+    if (!_ray.intersects(lNode.box, _tMax, lT))
+      continue;
+
+    if (lNode.isLeaf()) {
+      _out.push_back(lNode.userData);
+    } else {
+      lStack.push_back(lNode.child1);
+      lStack.push_back(lNode.child2);
+    }
+  }
+}
+
+/*!
+ * \brief Finds the proxy with the closest (fat box) hit along _ray
+ * \param[in]  _ray      The ray
+ * \param[in]  _tMax     Ignore hits further away
+ * \param[out] _userData The user data of the hit proxy
+ * \param[out] _t        The hit distance
+ * \returns true if something was hit
+ */
+bool rBVH::queryRayClosest(rRay const &_ray, float _tMax, uint32_t &_userData, float &_t) const {
+  if (vRoot == NULL_NODE)
+    return false;
+
+  std::vector<uint32_t> lStack;
+  lStack.reserve(64);
+  lStack.push_back(vRoot);
+
+  bool  lHit = false;
+  float lT;
+  float lT1;
+  float lT2;
+
+  while (!lStack.empty()) {
+    Node const &lNode = vNodes[lStack.back()];
+    lStack.pop_back();
+
+    if (!_ray.intersects(lNode.box, _tMax, lT))
+      continue;
+
+    if (lNode.isLeaf()) {
+      _tMax     = lT;
+      _t        = lT;
+      _userData = lNode.userData;
+      lHit      = true;
+      continue;
+    }
+
+    // Visit the closer child first (pushed last)
+    bool lHit1 = _ray.intersects(vNodes[lNode.child1].box, _tMax, lT1);
+    bool lHit2 = _ray.intersects(vNodes[lNode.child2].box, _tMax, lT2);
+
+    if (lHit1 && lHit2) {
+      lStack.push_back(lT1 < lT2 ? lNode.child2 : lNode.child1);
+      lStack.push_back(lT1 < lT2 ? lNode.child1 : lNode.child2);
+    } else if (lHit1) {
+      lStack.push_back(lNode.child1);
+    } else if (lHit2) {
+      lStack.push_back(lNode.child2);
+    }
+  }
+
+  return lHit;
+}
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,94 @@
+/*!
+ * \file rBVH.hpp
+ * \brief \b Classes: \a rBVH
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rAABB.hpp"
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Dynamic bounding volume hierarchy over axis aligned boxes
+ *
+ * Every leaf (proxy) stores a user value and a "fat" box, which is the real box grown by a
+ * margin. Moving a proxy only touches the tree when the new box leaves the fat box, so small
+ * per frame movements are (nearly) free. Leaves are inserted with the surface area heuristic and
+ * the tree is kept balanced with rotations, so all queries are O(log n) + the number of hits.
+ *
+ * \note This class is NOT thread safe
+ */
+class rBVH {
+ public:
+  static const uint32_t NULL_NODE = UINT32_MAX;
+
+ private:
+  struct Node {
+    rAABB    box;
+    uint32_t parent   = NULL_NODE; //!< Also used as next pointer in the free list
+    uint32_t child1   = NULL_NODE;
+    uint32_t child2   = NULL_NODE;
+    int32_t  height   = -1; //!< Leaf = 0, free node = -1
+    uint32_t userData = 0;
+
+    inline bool isLeaf() const { return child1 == NULL_NODE; }
+  };
+
+  std::vector<Node> vNodes;
+
+  uint32_t vRoot     = NULL_NODE;
+  uint32_t vFreeList = NULL_NODE;
+  uint32_t vNumLeafs = 0;
+  float    vMargin;
+
+  uint32_t allocateNode();
+  void     freeNode(uint32_t _node);
+
+  void     insertLeaf(uint32_t _leaf);
+  void     removeLeaf(uint32_t _leaf);
+  uint32_t balance(uint32_t _node);
+  void     fixUpwards(uint32_t _node);
+
+ public:
+  rBVH(float _margin = 0.1f);
+
+  uint32_t insert(rAABB const &_box, uint32_t _userData);
+  void     remove(uint32_t _proxy);
+  bool     update(uint32_t _proxy, rAABB const &_box);
+  void     clear();
+
+  void queryOverlap(rAABB const &_box, std::vector<uint32_t> &_out) const;
+  void queryFrustum(rFrustum const &_frustum, std::vector<uint32_t> &_out) const;
+  void queryRay(rRay const &_ray, float _tMax, std::vector<uint32_t> &_out) const;
+  bool queryRayClosest(rRay const &_ray, float _tMax, uint32_t &_userData, float &_t) const;
+
+  uint32_t     getUserData(uint32_t _proxy) const { return vNodes[_proxy].userData; }
+  rAABB const &getFatAABB(uint32_t _proxy) const { return vNodes[_proxy].box; }
+
+  uint32_t size() const { return vNumLeafs; }
+  int32_t  getHeight() const { return vRoot == NULL_NODE ? 0 : vNodes[vRoot].height; }
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
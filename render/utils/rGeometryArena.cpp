@@ -0,0 +1,412 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rGeometryArena.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace e_engine {
+
+rGeometryArena::rGeometryArena(vkuDevicePTR _device,
+                               VkDeviceSize _vertexBlockSize,
+                               VkDeviceSize _indexBlockSize,
+                               VkDeviceSize _stagingSize)
+    : vDevice(_device),
+      vVertexBlockSize(_vertexBlockSize),
+      vIndexBlockSize(_indexBlockSize),
+      vStagingSize(_stagingSize) {}
+
+rGeometryArena::~rGeometryArena() { destroy(); }
+
+//! Finds the first free range with at least _size bytes
+bool rGeometryArena::findRange(FreeList const &_list, VkDeviceSize _size, VkDeviceSize &_offset) {
+  for (auto const &i : _list) {
+    if (i.size >= _size) {
+      _offset = i.offset;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+//! Removes [_offset, _offset + _size) from the free range starting at _offset
+void rGeometryArena::takeRange(FreeList &_list, VkDeviceSize _offset, VkDeviceSize _size) {
+  for (auto i = _list.begin(); i != _list.end(); ++i) {
+    if (i->offset != _offset)
+      continue;
+
+    i->offset += _size;
+    i->size -= _size;
+    if (i->size == 0)
+      _list.erase(i);
+
+    return;
+  }
+}
+
+//! Inserts a free range and merges it with its neighbours
+void rGeometryArena::addRange(FreeList &_list, VkDeviceSize _offset, VkDeviceSize _size) {
+  auto lIter = std::lower_bound(
+      _list.begin(), _list.end(), _offset, [](Range const &_r, VkDeviceSize _o) { return _r.offset < _o; });
+
+  lIter = _list.insert(lIter, {_offset, _size});
+
+  auto lNext = lIter + 1;
+  if (lNext != _list.end() && lIter->offset + lIter->size == lNext->offset) {
+    lIter->size += lNext->size;
+    lIter = _list.erase(lNext) - 1;
+  }
+
+  if (lIter != _list.begin()) {
+    auto lPrev = lIter - 1;
+    if (lPrev->offset + lPrev->size == lIter->offset) {
+      lPrev->size += lIter->size;
+      _list.erase(lIter);
+    }
+  }
+}
+
+/*!
+ * \brief Returns a block with enough free space for the data (creates a new block if necessary)
+ * \param[out] _vertOffset Offset of the free vertex range in bytes
+ * \param[out] _indOffset  Offset of the free index range in bytes
+ * \returns the block index or UINT32_MAX on error
+ * \note vMutex must be locked
+ */
+uint32_t rGeometryArena::findBlock(uint32_t      _layout,
+                                   uint32_t      _stride,
+                                   VkIndexType   _indexType,
+                                   VkDeviceSize  _vert,
+                                   VkDeviceSize  _ind,
+                                   VkDeviceSize &_vertOffset,
+                                   VkDeviceSize &_indOffset) {
+  for (uint32_t i = 0; i < vBlocks.size(); ++i) {
+    Block *lB = vBlocks[i].get();
+    if (lB->layout != _layout || lB->stride != _stride || lB->indexType != _indexType)
+      continue;
+
+    if (findRange(lB->vertexFree, _vert, _vertOffset) && findRange(lB->indexFree, _ind, _indOffset))
+      return i;
+  }
+
+  std::unique_ptr<Block> lBlock(new Block(vDevice));
+  lBlock->layout    = _layout;
+  lBlock->stride    = _stride;
+  lBlock->indexType = _indexType;
+
+  lBlock->vertex->usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  lBlock->index->usage  = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  if (vQueueFamilies.size() > 1) {
+    lBlock->vertex->sharingMode        = VK_SHARING_MODE_CONCURRENT;
+    lBlock->index->sharingMode         = VK_SHARING_MODE_CONCURRENT;
+    lBlock->vertex->queueFamilyIndices = vQueueFamilies;
+    lBlock->index->queueFamilyIndices  = vQueueFamilies;
+  }
+
+  // Round the block size down to a multiple of the stride, so that vertexOffset is always exact
+  VkDeviceSize lVertSize = std::max(_vert, (vVertexBlockSize / _stride) * _stride);
+  VkDeviceSize lIndSize  = std::max(_ind, vIndexBlockSize);
+
+  VkResult lRes = lBlock->vertex.init(lVertSize);
+  if (lRes == VK_SUCCESS)
+    lRes = lBlock->index.init(lIndSize);
+
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create geometry block: ", uEnum2Str::toStr(lRes));
+    return UINT32_MAX;
+  }
+
+  // Uploads use the staging ring of the arena
+  lBlock->vertex.destroyStagingBufferMemory();
+  lBlock->index.destroyStagingBufferMemory();
+
+  lBlock->vertexFree.push_back({0, lVertSize});
+  lBlock->indexFree.push_back({0, lIndSize});
+  _vertOffset = 0;
+  _indOffset  = 0;
+
+  dLOG("Created geometry block ", vBlocks.size(), " (stride ", _stride, "; ", lVertSize + lIndSize, " bytes)");
+
+  vBlocks.emplace_back(std::move(lBlock));
+  return static_cast<uint32_t>(vBlocks.size() - 1);
+}
+
+/*!
+ * \brief Reserves _size bytes in the staging ring
+ *
+ * Creates a larger ring when the free part of the current one is too small. The old ring is
+ * kept until finishUploads(), because the recorded copies still read from it.
+ *
+ * \note vMutex must be locked
+ */
+bool rGeometryArena::allocStaging(VkDeviceSize _size, VkDeviceSize &_offset) {
+  VkDeviceSize lSize = ((_size + STAGING_ALIGN - 1) / STAGING_ALIGN) * STAGING_ALIGN;
+
+  if (vStaging) {
+    VkDeviceSize lCap = vStaging->buffer.size();
+
+    if (!vStagingWrap && vStagingHead + lSize <= lCap) {
+      _offset = vStagingHead;
+      vStagingHead += lSize;
+      return true;
+    }
+
+    if (!vStagingWrap && lSize <= vStagingTail) {
+      _offset      = 0;
+      vStagingHead = lSize;
+      vStagingWrap = true;
+      return true;
+    }
+
+    if (vStagingWrap && vStagingHead + lSize <= vStagingTail) {
+      _offset = vStagingHead;
+      vStagingHead += lSize;
+      return true;
+    }
+  }
+
+  VkDeviceSize lNewSize = std::max(vStagingSize, lSize);
+  if (vStaging) {
+    lNewSize = std::max(lNewSize, vStaging->buffer.size() * 2);
+    vOldStaging.emplace_back(std::move(vStaging));
+  }
+
+  std::unique_ptr<Staging> lStaging(new Staging(vDevice));
+  lStaging->buffer->usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  lStaging->buffer->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  if (lStaging->buffer.init(lNewSize) != VK_SUCCESS)
+    return false;
+
+  lStaging->access.reset(new vkuBuffer::MemoryAccess(lStaging->buffer.getBufferAccess()));
+  if (!*lStaging->access) {
+    eLOG(L"Failed to bind vulkan memory");
+    return false;
+  }
+
+  dLOG("Created geometry staging ring (", lNewSize, " bytes)");
+
+  vStaging     = std::move(lStaging);
+  vStagingHead = lSize;
+  vStagingTail = 0;
+  vStagingWrap = false;
+  _offset      = 0;
+  return true;
+}
+
+//! Records a copy of _data into _dst at _offset (via the staging ring)
+bool rGeometryArena::cmdUpload(
+    vkuCommandBuffer &_buf, vkuBuffer &_dst, VkDeviceSize _offset, void const *_data, VkDeviceSize _size) {
+  VkDeviceSize lSrcOffset;
+  if (!allocStaging(_size, lSrcOffset))
+    return false;
+
+  memcpy(static_cast<char *>(vStaging->access->get()) + lSrcOffset, _data, _size);
+
+  VkBufferCopy lRegion = {};
+  lRegion.srcOffset    = lSrcOffset;
+  lRegion.dstOffset    = _offset;
+  lRegion.size         = _size;
+
+  vkCmdCopyBuffer(*_buf, *vStaging->buffer, *_dst, 1, &lRegion);
+
+  if (std::find(vUploaded.begin(), vUploaded.end(), *_dst) == vUploaded.end())
+    vUploaded.push_back(*_dst);
+
+  return true;
+}
+
+/*!
+ * \brief Allocates space for a mesh and records the upload into _buf
+ * \param[in] _buf         The command buffer for the upload (must be executed before finishUploads())
+ * \param[in] _layout      Vertex layout ID (only meshes with the same layout share a block)
+ * \param[in] _stride      Size of one vertex in bytes
+ * \param[in] _vertexData  The vertex data (_numVertices * _stride bytes)
+ * \param[in] _numVertices Number of vertices
+ * \param[in] _indexType   VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32
+ * \param[in] _indexData   The index data
+ * \param[in] _numIndexes  Number of indexes
+ * \returns the allocation (check with Allocation::isValid())
+ */
+rGeometryArena::Allocation rGeometryArena::allocate(vkuCommandBuffer &_buf,
+                                                    uint32_t          _layout,
+                                                    uint32_t          _stride,
+                                                    void const *      _vertexData,
+                                                    uint32_t          _numVertices,
+                                                    VkIndexType       _indexType,
+                                                    void const *      _indexData,
+                                                    uint32_t          _numIndexes) {
+  Allocation lRes;
+
+  if (_stride == 0 || _numVertices == 0 || _numIndexes == 0) {
+    eLOG("Invalid mesh data");
+    return lRes;
+  }
+
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  VkDeviceSize lVertSize   = static_cast<VkDeviceSize>(_numVertices) * _stride;
+  VkDeviceSize lIndSize    = static_cast<VkDeviceSize>(_numIndexes) * getIndexSize(_indexType);
+  VkDeviceSize lVertOffset = 0;
+  VkDeviceSize lIndOffset  = 0;
+  uint32_t     lBlockID    = findBlock(_layout, _stride, _indexType, lVertSize, lIndSize, lVertOffset, lIndOffset);
+
+  if (lBlockID == UINT32_MAX)
+    return lRes;
+
+  Block *lB = vBlocks[lBlockID].get();
+
+  if (!cmdUpload(_buf, lB->vertex, lVertOffset, _vertexData, lVertSize) ||
+      !cmdUpload(_buf, lB->index, lIndOffset, _indexData, lIndSize)) {
+    eLOG("Failed to upload mesh data");
+    return lRes;
+  }
+
+  takeRange(lB->vertexFree, lVertOffset, lVertSize);
+  takeRange(lB->indexFree, lIndOffset, lIndSize);
+
+  lRes.block        = lBlockID;
+  lRes.vertexBuffer = *lB->vertex;
+  lRes.indexBuffer  = *lB->index;
+  lRes.indexType    = _indexType;
+  lRes.vertexOffset = static_cast<int32_t>(lVertOffset / _stride);
+  lRes.firstIndex   = static_cast<uint32_t>(lIndOffset / getIndexSize(_indexType));
+  lRes.numVertices  = _numVertices;
+  lRes.numIndexes   = _numIndexes;
+
+  lB->numAllocations++;
+
+  return lRes;
+}
+
+/*!
+ * \brief Releases an allocation
+ *
+ * The ranges are reused after RETIRE_FRAMES frames (see nextFrame()).
+ */
+void rGeometryArena::free(Allocation const &_alloc) {
+  if (!_alloc.isValid())
+    return;
+
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (_alloc.block >= vBlocks.size()) {
+    eLOG("Invalid geometry allocation");
+    return;
+  }
+
+  vRetired.push_back({_alloc, vFrame});
+}
+
+//! Returns the ranges of an allocation to the free lists of its block (vMutex must be locked)
+void rGeometryArena::release(Allocation const &_alloc) {
+  Block *      lB        = vBlocks[_alloc.block].get();
+  VkDeviceSize lIndSize  = getIndexSize(lB->indexType);
+  VkDeviceSize lVertBase = static_cast<VkDeviceSize>(_alloc.vertexOffset) * lB->stride;
+  VkDeviceSize lIndBase  = static_cast<VkDeviceSize>(_alloc.firstIndex) * lIndSize;
+
+  addRange(lB->vertexFree, lVertBase, static_cast<VkDeviceSize>(_alloc.numVertices) * lB->stride);
+  addRange(lB->indexFree, lIndBase, static_cast<VkDeviceSize>(_alloc.numIndexes) * lIndSize);
+
+  lB->numAllocations--;
+}
+
+/*!
+ * \brief Reuses the ranges released RETIRE_FRAMES frames before _frame
+ * \param _frame The number of rendered frames (the fences of all these frames have passed)
+ */
+void rGeometryArena::nextFrame(uint64_t _frame) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  vFrame = _frame;
+
+  auto lEnd = std::remove_if(vRetired.begin(), vRetired.end(), [this](Retired const &_r) {
+    if (_r.frame + RETIRE_FRAMES > vFrame)
+      return false;
+
+    release(_r.alloc);
+    return true;
+  });
+
+  vRetired.erase(lEnd, vRetired.end());
+}
+
+/*!
+ * \brief Sets the queue families that access the geometry (only affects new blocks)
+ *
+ * Duplicates are removed. Blocks are shared concurrently when more than one family remains.
+ */
+void rGeometryArena::setQueueFamilies(std::vector<uint32_t> _families) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  std::sort(_families.begin(), _families.end());
+  _families.erase(std::unique(_families.begin(), _families.end()), _families.end());
+  vQueueFamilies = _families;
+}
+
+/*!
+ * \brief Makes all uploads since the last finishUploads() visible to the vertex input stage
+ * \param _transfer The transfer the uploads were recorded into (must still be recording)
+ */
+void rGeometryArena::releaseUploads(vkuTransfer &_transfer) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  for (auto i : vUploaded)
+    _transfer.releaseBuffer(i,
+                            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT,
+                            0,
+                            VK_WHOLE_SIZE,
+                            vQueueFamilies.size() > 1);
+}
+
+/*!
+ * \brief Reclaims the staging ring space of all previous uploads
+ * \note Call this only after the upload command buffers have finished executing
+ */
+void rGeometryArena::finishUploads() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  vOldStaging.clear();
+  vUploaded.clear();
+  vStagingTail = vStagingHead;
+  vStagingWrap = false;
+}
+
+void rGeometryArena::destroy() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  vStaging.reset();
+  vOldStaging.clear();
+  vUploaded.clear();
+  vRetired.clear();
+  vBlocks.clear();
+  vStagingHead = 0;
+  vStagingTail = 0;
+  vStagingWrap = false;
+}
+
+size_t rGeometryArena::getNumBlocks() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  return vBlocks.size();
+}
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,175 @@
+/*!
+ * \file rGeometryArena.hpp
+ * \brief \b Classes: \a rGeometryArena
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuBuffer.hpp"
+#include "vkuCommandBuffer.hpp"
+#include "vkuDevice.hpp"
+#include "vkuTransfer.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Shared vertex / index buffers for all meshes of a scene
+ *
+ * Geometry is sub allocated from large blocks. Every block only contains data with the same vertex
+ * layout and index type, so all meshes in a block can be drawn with the same bound buffers
+ * (firstIndex / vertexOffset in the draw call).
+ *
+ * Data is uploaded through one persistent, host visible staging buffer that is used as a ring. Space
+ * of the ring is reclaimed by finishUploads() (after the upload command buffer was executed). When an
+ * upload batch does not fit, a larger ring is created and the old one is kept until finishUploads().
+ *
+ * Blocks are appended to while they are in use, so uploads from another queue family can not transfer
+ * the ownership of a block. Blocks are created with VK_SHARING_MODE_CONCURRENT for the families set with
+ * setQueueFamilies() instead (only done when these are different).
+ *
+ * Every block keeps a free list of its vertex and index ranges (first fit, neighbours are merged).
+ * Released ranges may still be read by frames in flight, so they are only returned to the free list
+ * after RETIRE_FRAMES calls of nextFrame() (called by rWorld once the frame fences have passed).
+ */
+class rGeometryArena {
+ public:
+  struct Allocation {
+    uint32_t    block        = UINT32_MAX;
+    VkBuffer    vertexBuffer = VK_NULL_HANDLE;
+    VkBuffer    indexBuffer  = VK_NULL_HANDLE;
+    VkIndexType indexType    = VK_INDEX_TYPE_UINT32;
+    int32_t     vertexOffset = 0; //!< In vertices
+    uint32_t    firstIndex   = 0;
+    uint32_t    numVertices  = 0;
+    uint32_t    numIndexes   = 0;
+
+    inline bool isValid() const { return block != UINT32_MAX; }
+  };
+
+ private:
+  static const uint64_t     RETIRE_FRAMES = 2;  //!< Frames a released range is kept before it is reused
+  static const VkDeviceSize STAGING_ALIGN = 16; //!< Alignment of the uploads in the staging ring
+
+  struct Range {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+  };
+
+  typedef std::vector<Range> FreeList; //!< Sorted by offset
+
+  struct Block {
+    vkuBuffer   vertex;
+    vkuBuffer   index;
+    uint32_t    layout;
+    uint32_t    stride;
+    VkIndexType indexType;
+
+    FreeList vertexFree;
+    FreeList indexFree;
+    uint32_t numAllocations = 0;
+
+    Block(vkuDevicePTR _device) : vertex(_device), index(_device) {}
+  };
+
+  struct Retired {
+    Allocation alloc;
+    uint64_t   frame; //!< vFrame when the allocation was released
+  };
+
+  struct Staging {
+    vkuBuffer                                buffer;
+    std::unique_ptr<vkuBuffer::MemoryAccess> access; //!< Mapped as long as the buffer exists
+
+    Staging(vkuDevicePTR _device) : buffer(_device) {}
+  };
+
+  vkuDevicePTR vDevice;
+  VkDeviceSize vVertexBlockSize;
+  VkDeviceSize vIndexBlockSize;
+  VkDeviceSize vStagingSize;
+
+  std::vector<std::unique_ptr<Block>>   vBlocks;
+  std::unique_ptr<Staging>              vStaging;
+  std::vector<std::unique_ptr<Staging>> vOldStaging; //!< Replaced rings that may still be read
+  std::vector<VkBuffer>                 vUploaded;   //!< Blocks written since the last finishUploads()
+  std::vector<Retired>                  vRetired;
+  std::vector<uint32_t>                 vQueueFamilies;
+
+  VkDeviceSize vStagingHead = 0; //!< Next write position in the ring
+  VkDeviceSize vStagingTail = 0; //!< Start of the data that is not yet uploaded
+  bool         vStagingWrap = false; //!< vStagingHead wrapped around and is before vStagingTail
+  uint64_t     vFrame       = 0;    //!< Last frame passed to nextFrame()
+
+  std::mutex vMutex;
+
+  uint32_t findBlock(uint32_t      _layout,
+                     uint32_t      _stride,
+                     VkIndexType   _indexType,
+                     VkDeviceSize  _vert,
+                     VkDeviceSize  _ind,
+                     VkDeviceSize &_vertOffset,
+                     VkDeviceSize &_indOffset);
+  bool     allocStaging(VkDeviceSize _size, VkDeviceSize &_offset);
+  bool cmdUpload(vkuCommandBuffer &_buf, vkuBuffer &_dst, VkDeviceSize _offset, void const *_data, VkDeviceSize _size);
+  void release(Allocation const &_alloc);
+
+  static bool findRange(FreeList const &_list, VkDeviceSize _size, VkDeviceSize &_offset);
+  static void takeRange(FreeList &_list, VkDeviceSize _offset, VkDeviceSize _size);
+  static void addRange(FreeList &_list, VkDeviceSize _offset, VkDeviceSize _size);
+
+  static uint32_t getIndexSize(VkIndexType _type) { return _type == VK_INDEX_TYPE_UINT16 ? 2 : 4; }
+
+ public:
+  rGeometryArena(vkuDevicePTR _device,
+                 VkDeviceSize _vertexBlockSize = 32 * 1024 * 1024,
+                 VkDeviceSize _indexBlockSize  = 16 * 1024 * 1024,
+                 VkDeviceSize _stagingSize     = 8 * 1024 * 1024);
+  ~rGeometryArena();
+
+  rGeometryArena(rGeometryArena const &) = delete;
+  rGeometryArena &operator=(rGeometryArena const &) = delete;
+
+  Allocation allocate(vkuCommandBuffer &_buf,
+                      uint32_t          _layout,
+                      uint32_t          _stride,
+                      void const *      _vertexData,
+                      uint32_t          _numVertices,
+                      VkIndexType       _indexType,
+                      void const *      _indexData,
+                      uint32_t          _numIndexes);
+
+  void free(Allocation const &_alloc);
+  void setQueueFamilies(std::vector<uint32_t> _families);
+  void releaseUploads(vkuTransfer &_transfer);
+  void finishUploads();
+  void nextFrame(uint64_t _frame);
+  void destroy();
+
+  size_t getNumBlocks();
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rLightManager.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "rLightRenderBase.hpp"
+#include "rShaderBase.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/geometric.hpp>
+#include <limits>
+
+namespace e_engine {
+
+const std::string rLightManager::BLOCK_NAME = "Lights";
+
+rLightManager::rLightManager(vkuDevicePTR _device) : vDevice(_device), vBuffer(_device) {}
+rLightManager::~rLightManager() { destroy(); }
+
+/*!
+ * \brief Registers a light
+ *
+ * Lights with a direction (rObjectBase::DIRECTION) are stored as directional lights, all other
+ * lights as point lights.
+ *
+ * \returns the light ID or UINT32_MAX on error
+ */
+uint32_t rLightManager::addLight(std::shared_ptr<rLightRenderBase> _light) {
+  if (!_light) {
+    eLOG("Invalid light pointer");
+    return UINT32_MAX;
+  }
+
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  glm::vec3 *lTemp        = nullptr;
+  bool       lDirectional = _light->getVector(&lTemp, rObjectBase::DIRECTION) == rObjectBase::ALL_OK;
+
+  if (lDirectional && vNumDirectionalLights >= MAX_DIRECTIONAL_LIGHTS) {
+    wLOG("Only ", MAX_DIRECTIONAL_LIGHTS, " directional lights are supported ==> ignoring ", _light->getName());
+    return UINT32_MAX;
+  }
+
+  uint32_t lSlot = lDirectional ? vNumDirectionalLights++ : vNumPointLights++;
+  uint32_t lID   = static_cast<uint32_t>(vLights.size());
+
+  vLights.push_back({_light, lDirectional, lSlot});
+  _light->setLightManager(this, lID);
+
+  markDirty_IMPL(lID);
+  vHeaderDirty = true;
+  return lID;
+}
+
+/*!
+ * \brief Marks the data of a light as outdated (it will be written in the next update())
+ * \param[in] _id The ID returned by addLight
+ */
+void rLightManager::markDirty(uint32_t _id) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  markDirty_IMPL(_id);
+}
+
+//! \note vMutex must be locked
+void rLightManager::markDirty_IMPL(uint32_t _id) {
+  if (_id >= vLights.size())
+    return;
+
+  if (_id >= vIsDirty.size())
+    vIsDirty.resize(_id + 1, false);
+
+  if (vIsDirty[_id])
+    return;
+
+  vIsDirty[_id] = true;
+  vDirty.emplace_back(_id);
+}
+
+/*!
+ * \brief Creates the light buffer or grows it, so that it can hold all registered point lights
+ *
+ * The capacity is rounded up to a power of 2, so that adding lights between renderer resets rarely
+ * requires a new buffer. All lights are written in the next update().
+ *
+ * \note The buffer must not be in use by the GPU when it has to be recreated
+ * \returns false on error
+ */
+bool rLightManager::init() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  uint32_t lCapacity = MIN_CAPACITY;
+  while (lCapacity < vNumPointLights)
+    lCapacity *= 2;
+
+  if (vBuffer && vCapacity >= lCapacity)
+    return true;
+
+  vBuffer.destroy();
+  vBuffer->usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  vBuffer->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  auto lRes = vBuffer.init(sizeof(Header) + lCapacity * sizeof(LightData));
+  if (lRes != VK_SUCCESS) {
+    eLOG("Failed to create the light buffer: ", uEnum2Str::toStr(lRes));
+    vCapacity = 0;
+    return false;
+  }
+
+  vCapacity       = lCapacity;
+  vHeaderDirty    = true;
+  vCapacityWarned = false;
+
+  vDirty.clear();
+  vIsDirty.assign(vLights.size(), true);
+  for (uint32_t i = 0; i < vLights.size(); ++i)
+    vDirty.emplace_back(i);
+
+  return true;
+}
+
+/*!
+ * \brief Writes the data of all changed lights into the light buffer
+ * \note This function does NO MEMORY SYNCHRONISATION (same as rShaderBase::updateUniform)
+ * \returns false on error
+ */
+bool rLightManager::update() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (vDirty.empty() && !vHeaderDirty)
+    return true;
+
+  if (!vBuffer) {
+    eLOG("Light buffer not created (call init first)");
+    return false;
+  }
+
+  auto lAccess = vBuffer.getBufferAccess();
+  if (!lAccess) {
+    eLOG(L"Failed to bind vulkan memory");
+    return false;
+  }
+
+  Header *   lHeader = reinterpret_cast<Header *>(*lAccess);
+  LightData *lPoints = reinterpret_cast<LightData *>(reinterpret_cast<uint8_t *>(*lAccess) + sizeof(Header));
+
+  if (vHeaderDirty) {
+    if (vNumPointLights > vCapacity && !vCapacityWarned) {
+      wLOG("Light buffer full: ",
+           vNumPointLights - vCapacity,
+           " point lights are ignored until the next renderer reset");
+      vCapacityWarned = true;
+    }
+
+    lHeader->numLights = glm::uvec4(std::min(vNumPointLights, vCapacity), vNumDirectionalLights, 0, 0);
+    vHeaderDirty       = false;
+  }
+
+  for (auto i : vDirty) {
+    vIsDirty[i] = false;
+    writeLight(vLights[i], lHeader, lPoints);
+  }
+
+  vDirty.clear();
+  return true;
+}
+
+//! \note vMutex must be locked
+void rLightManager::writeLight(Light const &_light, Header *_header, LightData *_points) {
+  glm::vec3 *lColor   = nullptr;
+  glm::vec3 *lAmbient = nullptr;
+  glm::vec3 *lVec     = nullptr;
+  glm::vec3 *lAtt     = nullptr;
+
+  _light.light->getVector(&lColor, rObjectBase::LIGHT_COLOR);
+  _light.light->getVector(&lAmbient, rObjectBase::AMBIENT_COLOR);
+
+  if (_light.directional) {
+    _light.light->getVector(&lVec, rObjectBase::DIRECTION);
+
+    LightData &lData  = _header->directional[_light.slot];
+    lData.position    = glm::vec4(glm::normalize(*lVec), 0.0f);
+    lData.color       = glm::vec4(*lColor, 1.0f);
+    lData.ambient     = glm::vec4(*lAmbient, 1.0f);
+    lData.attenuation = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+    return;
+  }
+
+  if (_light.slot >= vCapacity)
+    return;
+
+  _light.light->getVector(&lVec, rObjectBase::POSITION);
+  _light.light->getVector(&lAtt, rObjectBase::ATTENUATION);
+
+  LightData &lData  = _points[_light.slot];
+  lData.position    = glm::vec4(*lVec, calcLightRadius(*lColor, *lAtt));
+  lData.color       = glm::vec4(*lColor, 1.0f);
+  lData.ambient     = glm::vec4(*lAmbient, 1.0f);
+  lData.attenuation = glm::vec4(*lAtt, 0.0f);
+}
+
+/*!
+ * \brief Binds the light buffer to all storage blocks named BLOCK_NAME of a shader
+ * \returns true if at least one storage block was bound
+ */
+bool rLightManager::bindToShader(rShaderBase *_shader) {
+  if (!_shader || !vBuffer)
+    return false;
+
+  bool lFound = false;
+  for (auto i : {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT}) {
+    for (auto const &j : _shader->getStorageBuffers(i)) {
+      if (j.name != BLOCK_NAME)
+        continue;
+
+      if (!_shader->updateStorageBuffer(j, *vBuffer))
+        return false;
+
+      lFound = true;
+    }
+  }
+
+  return lFound;
+}
+
+void rLightManager::destroy() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  for (auto &i : vLights)
+    i.light->setLightManager(nullptr, UINT32_MAX);
+
+  vBuffer.destroy();
+  vLights.clear();
+  vDirty.clear();
+  vIsDirty.clear();
+
+  vCapacity             = 0;
+  vNumPointLights       = 0;
+  vNumDirectionalLights = 0;
+  vHeaderDirty          = true;
+}
+
+uint32_t rLightManager::getNumPointLights() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  return vNumPointLights;
+}
+
+uint32_t rLightManager::getNumDirectionalLights() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  return vNumDirectionalLights;
+}
+
+/*!
+ * \brief Returns the distance at which the light contributes less than 1/256 to the color
+ * \returns std::numeric_limits<float>::max() if the light has no falloff
+ */
+float rLightManager::calcLightRadius(glm::vec3 _color, glm::vec3 _attenuation) {
+  float lMax = 256.0f * std::max(_color.r, std::max(_color.g, _color.b));
+  float lC   = _attenuation.x - lMax;
+  float lL   = _attenuation.y;
+  float lE   = _attenuation.z;
+
+  // Solve lE * d^2 + lL * d + lC = 0
+  if (lE > 0.0f) {
+    float lDisc = lL * lL - 4.0f * lE * lC;
+    return lDisc < 0.0f ? 0.0f : (-lL + std::sqrt(lDisc)) / (2.0f * lE);
+  }
+
+  if (lL > 0.0f)
+    return std::max(-lC / lL, 0.0f);
+
+  return std::numeric_limits<float>::max();
+}
+
+} // namespace e_engine
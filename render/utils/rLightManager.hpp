@@ -0,0 +1,136 @@
+/*!
+ * \file rLightManager.hpp
+ * \brief \b Classes: \a rLightManager
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuBuffer.hpp"
+#include "vkuDevice.hpp"
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+class rLightRenderBase;
+class rShaderBase;
+
+/*!
+ * \brief Packs the parameters of all lights of a scene into one storage buffer
+ *
+ * Every light registered with addLight gets a fixed slot in the buffer. Lights report changes with
+ * markDirty (rLightRenderBase does this in its setters) and update() only rewrites the slots of the
+ * changed lights, so the per frame cost does not depend on the total number of lights.
+ *
+ * All data is stored in world space. Buffer layout (std430):
+ *
+ * \code
+ * layout (std430) readonly buffer Lights {
+ *   uvec4     numLights;                               // x: point lights, y: directional lights
+ *   LightData directional[MAX_DIRECTIONAL_LIGHTS];
+ *   LightData lights[];                                 // point lights
+ * };
+ * \endcode
+ *
+ * Every shader with a storage block named BLOCK_NAME can be bound to the buffer with bindToShader.
+ *
+ * \note The buffer is only (re)allocated in init(). Point lights added after init() that do not fit
+ * \note into the current capacity are ignored until the renderer is reset.
+ */
+class rLightManager {
+ public:
+  static const uint32_t MAX_DIRECTIONAL_LIGHTS = 4;
+  static const uint32_t MIN_CAPACITY           = 64;
+
+  static const std::string BLOCK_NAME;
+
+  //! std430 layout of one light in the light storage buffer
+  struct LightData {
+    glm::vec4 position; //!< World space position + radius (point) or world space direction (directional)
+    glm::vec4 color;
+    glm::vec4 ambient;
+    glm::vec4 attenuation; //!< constant, linear, exponential
+  };
+
+  //! std430 layout of the start of the light storage buffer
+  struct Header {
+    glm::uvec4 numLights; //!< x: point lights, y: directional lights
+    LightData  directional[MAX_DIRECTIONAL_LIGHTS];
+  };
+
+ private:
+  struct Light {
+    std::shared_ptr<rLightRenderBase> light;
+
+    bool     directional;
+    uint32_t slot; //!< Index in the point light array or in Header::directional
+  };
+
+  vkuDevicePTR vDevice;
+  vkuBuffer    vBuffer;
+  uint32_t     vCapacity = 0; //!< Number of point lights the buffer can hold
+
+  std::vector<Light>    vLights; //!< Index is the light ID
+  std::vector<uint32_t> vDirty;
+  std::vector<bool>     vIsDirty;
+
+  uint32_t vNumPointLights       = 0;
+  uint32_t vNumDirectionalLights = 0;
+
+  bool vHeaderDirty    = true;
+  bool vCapacityWarned = false;
+
+  std::mutex vMutex;
+
+  void markDirty_IMPL(uint32_t _id);
+  void writeLight(Light const &_light, Header *_header, LightData *_points);
+
+ public:
+  rLightManager(vkuDevicePTR _device);
+  ~rLightManager();
+
+  rLightManager(rLightManager const &) = delete;
+  rLightManager &operator=(rLightManager const &) = delete;
+
+  uint32_t addLight(std::shared_ptr<rLightRenderBase> _light);
+  void     markDirty(uint32_t _id);
+
+  bool init();
+  bool update();
+  bool bindToShader(rShaderBase *_shader);
+  void destroy();
+
+  uint32_t getNumPointLights();
+  uint32_t getNumDirectionalLights();
+
+  inline VkBuffer getBuffer() const noexcept { return *vBuffer; }
+
+  static float calcLightRadius(glm::vec3 _color, glm::vec3 _attenuation);
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
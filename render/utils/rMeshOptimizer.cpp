@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rMeshOptimizer.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+namespace e_engine {
+
+namespace {
+
+const uint32_t NO_VERTEX = UINT32_MAX;
+
+/*!
+ * \brief FIFO cache simulation with timestamps
+ *
+ * A vertex is in the cache if it was one of the last _cacheSize misses. Flushing the cache is done
+ * by advancing the time.
+ */
+class FIFOCache {
+ private:
+  std::vector<uint32_t> vStamps;
+  uint32_t              vTime;
+  uint32_t              vSize;
+
+ public:
+  FIFOCache(uint32_t _numVertices, uint32_t _size) : vStamps(_numVertices, 0), vTime(_size + 1), vSize(_size) {}
+
+  inline uint32_t age(uint32_t _v) const { return vTime - vStamps[_v]; }
+  inline bool     contains(uint32_t _v) const { return age(_v) <= vSize; }
+  inline void     flush() { vTime += vSize + 1; }
+
+  //! \returns true on a cache miss
+  inline bool access(uint32_t _v) {
+    if (contains(_v))
+      return false;
+
+    vStamps[_v] = vTime++;
+    return true;
+  }
+};
+
+struct Cluster {
+  uint32_t begin;
+  uint32_t end;
+  float    sortKey;
+};
+
+} // namespace
+
+/*!
+ * \brief Simulates a FIFO post transform cache
+ * \param[in] _index       Triangle list
+ * \param[in] _numVertices Number of vertices (all indexes must be smaller)
+ * \param[in] _cacheSize   Number of cache entries
+ */
+rMeshOptimizer::Stats rMeshOptimizer::analyze(std::vector<uint32_t> const &_index,
+                                              uint32_t                     _numVertices,
+                                              uint32_t                     _cacheSize) {
+  Stats lRes;
+  if (_index.size() < 3 || _numVertices == 0)
+    return lRes;
+
+  FIFOCache         lCache(_numVertices, _cacheSize);
+  std::vector<bool> lUsed(_numVertices, false);
+  uint32_t          lMisses = 0;
+  uint32_t          lUnique = 0;
+
+  for (auto i : _index) {
+    if (lCache.access(i))
+      lMisses++;
+
+    if (!lUsed[i]) {
+      lUsed[i] = true;
+      lUnique++;
+    }
+  }
+
+  lRes.acmr = static_cast<float>(lMisses) / static_cast<float>(_index.size() / 3);
+  lRes.atvr = static_cast<float>(lMisses) / static_cast<float>(lUnique);
+  return lRes;
+}
+
+/*!
+ * \brief Reorders the triangles in _index for the post transform cache (Tipsify)
+ *
+ * Triangles are emitted as fans around a vertex. The next fan vertex is a vertex of the last fan that
+ * is still in the cache (and will stay there), otherwise the most recently used vertex with remaining
+ * triangles (dead end).
+ *
+ * \returns The first triangle of every cluster (a new cluster starts at every dead end)
+ */
+std::vector<uint32_t> rMeshOptimizer::optimizeVertexCache(std::vector<uint32_t> &_index,
+                                                          uint32_t               _numVertices,
+                                                          uint32_t               _cacheSize) {
+  size_t lNumTris = _index.size() / 3;
+  if (lNumTris == 0)
+    return {};
+
+  // Vertex -> triangle adjacency
+  std::vector<uint32_t> lLive(_numVertices, 0);
+  std::vector<uint32_t> lOffsets(_numVertices + 1, 0);
+  std::vector<uint32_t> lAdjacency(lNumTris * 3);
+
+  for (auto i : _index)
+    lLive[i]++;
+
+  for (uint32_t i = 0; i < _numVertices; ++i)
+    lOffsets[i + 1] = lOffsets[i] + lLive[i];
+
+  {
+    std::vector<uint32_t> lFill(lOffsets.begin(), lOffsets.end() - 1);
+    for (size_t i = 0; i < lNumTris * 3; ++i)
+      lAdjacency[lFill[_index[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  FIFOCache             lCache(_numVertices, _cacheSize);
+  std::vector<bool>     lEmitted(lNumTris, false);
+  std::vector<uint32_t> lDeadEnd;
+  std::vector<uint32_t> lCandidates;
+  std::vector<uint32_t> lOut;
+  std::vector<uint32_t> lClusters = {0};
+  uint32_t              lCursor   = 0;
+
+  lOut.reserve(lNumTris * 3);
+
+  auto lSkipDeadEnd = [&]() -> uint32_t {
+    while (!lDeadEnd.empty()) {
+      uint32_t lV = lDeadEnd.back();
+      lDeadEnd.pop_back();
+      if (lLive[lV] > 0)
+        return lV;
+    }
+
+    for (; lCursor < _numVertices; ++lCursor)
+      if (lLive[lCursor] > 0)
+        return lCursor;
+
+    return NO_VERTEX;
+  };
+
+  uint32_t lFan = lSkipDeadEnd();
+
+  while (lFan != NO_VERTEX) {
+    lCandidates.clear();
+
+    for (uint32_t i = lOffsets[lFan]; i < lOffsets[lFan + 1]; ++i) {
+      uint32_t lTri = lAdjacency[i];
+      if (lEmitted[lTri])
+        continue;
+
+      for (uint32_t j = 0; j < 3; ++j) {
+        uint32_t lV = _index[lTri * 3 + j];
+        lOut.push_back(lV);
+        lDeadEnd.push_back(lV);
+        lCandidates.push_back(lV);
+        lLive[lV]--;
+        lCache.access(lV);
+      }
+
+      lEmitted[lTri] = true;
+    }
+
+    // Prefer the oldest candidate that stays in the cache while its fan is emitted
+    uint32_t lNext     = NO_VERTEX;
+    int64_t  lPriority = -1;
+
+    for (auto i : lCandidates) {
+      if (lLive[i] == 0)
+        continue;
+
+      int64_t lP = 0;
+      if (lCache.age(i) + 2 * lLive[i] <= _cacheSize)
+        lP = lCache.age(i);
+
+      if (lP > lPriority) {
+        lPriority = lP;
+        lNext     = i;
+      }
+    }
+
+    if (lNext == NO_VERTEX) {
+      lNext = lSkipDeadEnd();
+      if (lNext != NO_VERTEX)
+        lClusters.push_back(static_cast<uint32_t>(lOut.size() / 3));
+    }
+
+    lFan = lNext;
+  }
+
+  _index = std::move(lOut);
+  return lClusters;
+}
+
+/*!
+ * \brief Sorts the clusters of a cache optimized triangle list to reduce overdraw
+ *
+ * The hard clusters (from optimizeVertexCache) are split further where the local ACMR is already
+ * below _threshold * mesh ACMR. Clusters facing away from the mesh center are drawn first, since
+ * they are more likely to occlude the rest of the mesh (Sander et al. 2007).
+ *
+ * \param[in,out] _index      Cache optimized triangle list
+ * \param[in]     _clusters   The cluster starts returned by optimizeVertexCache
+ * \param[in]     _vertexData Interleaved vertex data, the position MUST be the first 3 floats
+ * \param[in]     _stride     Number of floats per vertex
+ * \param[in]     _threshold  Max allowed ACMR increase (1.05 = 5%)
+ * \param[in]     _cacheSize  Number of cache entries
+ */
+void rMeshOptimizer::optimizeOverdraw(std::vector<uint32_t> &      _index,
+                                      std::vector<uint32_t> const &_clusters,
+                                      std::vector<float> const &   _vertexData,
+                                      uint32_t                     _stride,
+                                      float                        _threshold,
+                                      uint32_t                     _cacheSize) {
+  uint32_t lNumTris     = static_cast<uint32_t>(_index.size() / 3);
+  uint32_t lNumVertices = static_cast<uint32_t>(_vertexData.size() / _stride);
+  if (lNumTris == 0 || _clusters.empty())
+    return;
+
+  float lTarget = analyze(_index, lNumVertices, _cacheSize).acmr * _threshold;
+
+  // Split into soft clusters
+  std::vector<Cluster> lSoft;
+  FIFOCache            lCache(lNumVertices, _cacheSize);
+
+  for (size_t i = 0; i < _clusters.size(); ++i) {
+    uint32_t lBegin  = _clusters[i];
+    uint32_t lEnd    = i + 1 < _clusters.size() ? _clusters[i + 1] : lNumTris;
+    uint32_t lMisses = 0;
+
+    lCache.flush();
+
+    for (uint32_t j = lBegin; j < lEnd; ++j) {
+      for (uint32_t k = 0; k < 3; ++k)
+        if (lCache.access(_index[j * 3 + k]))
+          lMisses++;
+
+      if (j + 1 < lEnd && static_cast<float>(lMisses) <= lTarget * static_cast<float>(j + 1 - lBegin)) {
+        lSoft.push_back({lBegin, j + 1, 0.0f});
+        lBegin  = j + 1;
+        lMisses = 0;
+        lCache.flush();
+      }
+    }
+
+    lSoft.push_back({lBegin, lEnd, 0.0f});
+  }
+
+  auto lPos = [&](uint32_t _v) -> glm::vec3 {
+    float const *lV = &_vertexData[_v * _stride];
+    return glm::vec3(lV[0], lV[1], lV[2]);
+  };
+
+  // Area weighted mesh centroid
+  glm::vec3 lMeshCenter(0.0f);
+  float     lMeshArea = 0.0f;
+
+  for (uint32_t i = 0; i < lNumTris; ++i) {
+    glm::vec3 lA    = lPos(_index[i * 3 + 0]);
+    glm::vec3 lB    = lPos(_index[i * 3 + 1]);
+    glm::vec3 lC    = lPos(_index[i * 3 + 2]);
+    float     lArea = glm::length(glm::cross(lB - lA, lC - lA));
+
+    lMeshCenter += (lA + lB + lC) * (lArea / 3.0f);
+    lMeshArea += lArea;
+  }
+
+  if (lMeshArea > 0.0f)
+    lMeshCenter /= lMeshArea;
+
+  for (auto &i : lSoft) {
+    glm::vec3 lCenter(0.0f);
+    glm::vec3 lNormal(0.0f);
+    float     lArea = 0.0f;
+
+    for (uint32_t j = i.begin; j < i.end; ++j) {
+      glm::vec3 lA     = lPos(_index[j * 3 + 0]);
+      glm::vec3 lB     = lPos(_index[j * 3 + 1]);
+      glm::vec3 lC     = lPos(_index[j * 3 + 2]);
+      glm::vec3 lCross = glm::cross(lB - lA, lC - lA);
+      float     lTArea = glm::length(lCross);
+
+      lCenter += (lA + lB + lC) * (lTArea / 3.0f);
+      lNormal += lCross;
+      lArea += lTArea;
+    }
+
+    float lNormLen = glm::length(lNormal);
+    if (lArea > 0.0f && lNormLen > 0.0f)
+      i.sortKey = glm::dot(lCenter / lArea - lMeshCenter, lNormal / lNormLen);
+  }
+
+  std::stable_sort(
+      lSoft.begin(), lSoft.end(), [](Cluster const &a, Cluster const &b) { return a.sortKey > b.sortKey; });
+
+  std::vector<uint32_t> lOut;
+  lOut.reserve(_index.size());
+
+  for (auto const &i : lSoft)
+    lOut.insert(lOut.end(), _index.begin() + i.begin * 3, _index.begin() + i.end * 3);
+
+  _index = std::move(lOut);
+}
+
+/*!
+ * \brief Stores the vertices in the order of their first use in _index
+ * \note Unreferenced vertices are removed
+ */
+void rMeshOptimizer::optimizeVertexFetch(std::vector<uint32_t> &_index,
+                                         std::vector<float> &   _vertexData,
+                                         uint32_t               _stride) {
+  std::vector<uint32_t> lRemap(_vertexData.size() / _stride, NO_VERTEX);
+  std::vector<float>    lData;
+  uint32_t              lNext = 0;
+
+  lData.reserve(_vertexData.size());
+
+  for (auto &i : _index) {
+    if (lRemap[i] == NO_VERTEX) {
+      lRemap[i] = lNext++;
+      lData.insert(lData.end(), _vertexData.begin() + i * _stride, _vertexData.begin() + (i + 1) * _stride);
+    }
+
+    i = lRemap[i];
+  }
+
+  _vertexData = std::move(lData);
+}
+
+/*!
+ * \brief Runs all optimization passes and logs the cache statistics
+ * \param[in,out] _index      Triangle list
+ * \param[in,out] _vertexData Interleaved vertex data, the position MUST be the first 3 floats
+ * \param[in]     _stride     Number of floats per vertex
+ * \param[in]     _name       Name of the mesh (for logging)
+ */
+void rMeshOptimizer::optimize(std::vector<uint32_t> &_index,
+                              std::vector<float> &   _vertexData,
+                              uint32_t               _stride,
+                              std::string const &    _name) {
+  if (_stride < 3 || _index.size() < 3)
+    return;
+
+  uint32_t lNumVertices = static_cast<uint32_t>(_vertexData.size() / _stride);
+  Stats    lBefore      = analyze(_index, lNumVertices);
+
+  auto lClusters = optimizeVertexCache(_index, lNumVertices);
+  optimizeOverdraw(_index, lClusters, _vertexData, _stride);
+  optimizeVertexFetch(_index, _vertexData, _stride);
+
+  Stats lAfter = analyze(_index, static_cast<uint32_t>(_vertexData.size() / _stride));
+
+  dLOG("Optimized mesh ",
+       _name,
+       ": ACMR ",
+       lBefore.acmr,
+       " -> ",
+       lAfter.acmr,
+       "; ATVR ",
+       lBefore.atvr,
+       " -> ",
+       lAfter.atvr,
+       " (",
+       lClusters.size(),
+       " clusters)");
+}
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
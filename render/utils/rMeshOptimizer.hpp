@@ -0,0 +1,76 @@
+/*!
+ * \file rMeshOptimizer.hpp
+ * \brief \b Classes: \a rMeshOptimizer
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include <string>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Reorders triangle lists and vertex data for the GPU caches
+ *
+ * Three passes (in this order):
+ *  1. vertex cache optimization (Tipsify, Sander et al. 2007)
+ *  2. overdraw reduction: the clusters from 1. are sorted front to back from the outside, as long as
+ *     the cache efficiency does not drop by more than a threshold
+ *  3. vertex fetch optimization: vertices are stored in the order of their first use
+ *
+ * Vertex data is interleaved float data with the position as the first 3 floats.
+ */
+class rMeshOptimizer {
+ public:
+  static const uint32_t DEFAULT_CACHE_SIZE = 16;
+
+  struct Stats {
+    float acmr = 0.0f; //!< Average cache miss ratio (transformed vertices / triangles, 0.5 - 3)
+    float atvr = 0.0f; //!< Average transformed vertex ratio (transformed vertices / vertices, >= 1)
+  };
+
+  static Stats analyze(std::vector<uint32_t> const &_index,
+                       uint32_t                     _numVertices,
+                       uint32_t                     _cacheSize = DEFAULT_CACHE_SIZE);
+
+  static std::vector<uint32_t> optimizeVertexCache(std::vector<uint32_t> &_index,
+                                                   uint32_t               _numVertices,
+                                                   uint32_t               _cacheSize = DEFAULT_CACHE_SIZE);
+
+  static void optimizeOverdraw(std::vector<uint32_t> &      _index,
+                               std::vector<uint32_t> const &_clusters,
+                               std::vector<float> const &   _vertexData,
+                               uint32_t                     _stride,
+                               float                        _threshold = 1.05f,
+                               uint32_t                     _cacheSize = DEFAULT_CACHE_SIZE);
+
+  static void optimizeVertexFetch(std::vector<uint32_t> &_index, std::vector<float> &_vertexData, uint32_t _stride);
+
+  static void optimize(std::vector<uint32_t> &_index,
+                       std::vector<float> &   _vertexData,
+                       uint32_t               _stride,
+                       std::string const &    _name);
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rMeshSimplifier.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+namespace e_engine {
+
+/*!
+ * \brief Constructor
+ * \param[in] _vertexData Interleaved vertex data, the position MUST be the first 3 floats
+ * \param[in] _stride     Number of floats per vertex
+ * \param[in] _index      Triangle list
+ */
+rMeshSimplifier::rMeshSimplifier(std::vector<float> const &   _vertexData,
+                                 uint32_t                     _stride,
+                                 std::vector<uint32_t> const &_index)
+    : vIndex(_index) {
+  size_t lNumVertices = _stride > 0 ? _vertexData.size() / _stride : 0;
+  vPositions.resize(lNumVertices);
+
+  glm::vec3 lMin(std::numeric_limits<float>::max());
+  glm::vec3 lMax(-std::numeric_limits<float>::max());
+
+  for (size_t i = 0; i < lNumVertices; ++i) {
+    vPositions[i] = glm::vec3(_vertexData[i * _stride + 0], _vertexData[i * _stride + 1], _vertexData[i * _stride + 2]);
+    lMin          = glm::min(lMin, vPositions[i]);
+    lMax          = glm::max(lMax, vPositions[i]);
+  }
+
+  // Normalize to the unit cube, so that errors are relative to the mesh extent
+  glm::vec3 lExt   = lMax - lMin;
+  float     lScale = std::max(lExt.x, std::max(lExt.y, lExt.z));
+  lScale           = lScale > 0.0f ? 1.0f / lScale : 1.0f;
+
+  for (auto &i : vPositions)
+    i = (i - lMin) * lScale;
+
+  setupLocked();
+  setupQuadrics();
+}
+
+//! Locks all vertices on open borders and on attribute seams
+void rMeshSimplifier::setupLocked() {
+  vLocked.assign(vPositions.size(), false);
+
+  // Seams: more than one vertex with the same position
+  std::map<std::array<float, 3>, uint32_t> lPosMap;
+  for (uint32_t i = 0; i < vPositions.size(); ++i) {
+    auto lRes = lPosMap.emplace(std::array<float, 3>{{vPositions[i].x, vPositions[i].y, vPositions[i].z}}, i);
+    if (!lRes.second) {
+      vLocked[i]                  = true;
+      vLocked[lRes.first->second] = true;
+    }
+  }
+
+  // Borders: edges without an opposite edge
+  std::unordered_map<uint64_t, uint32_t> lEdges;
+  auto lKey = [](uint32_t _a, uint32_t _b) { return (static_cast<uint64_t>(_a) << 32) | _b; };
+
+  for (size_t i = 0; i + 2 < vIndex.size(); i += 3)
+    for (uint32_t j = 0; j < 3; ++j)
+      lEdges[lKey(vIndex[i + j], vIndex[i + (j + 1) % 3])]++;
+
+  for (auto const &i : lEdges) {
+    uint32_t lA = static_cast<uint32_t>(i.first >> 32);
+    uint32_t lB = static_cast<uint32_t>(i.first & 0xFFFFFFFF);
+
+    if (lEdges.find(lKey(lB, lA)) == lEdges.end()) {
+      vLocked[lA] = true;
+      vLocked[lB] = true;
+    }
+  }
+}
+
+//! Accumulates the area weighted plane quadrics of all triangles
+void rMeshSimplifier::setupQuadrics() {
+  vQuadrics.assign(vPositions.size(), Quadric{});
+
+  for (size_t i = 0; i + 2 < vIndex.size(); i += 3) {
+    glm::vec3 const &lP0 = vPositions[vIndex[i + 0]];
+    glm::vec3 const &lP1 = vPositions[vIndex[i + 1]];
+    glm::vec3 const &lP2 = vPositions[vIndex[i + 2]];
+
+    glm::vec3 lNormal = glm::cross(lP1 - lP0, lP2 - lP0);
+    float     lLength = glm::length(lNormal);
+
+    if (lLength <= 0.0f)
+      continue;
+
+    lNormal /= lLength;
+
+    double lW = lLength * 0.5; // Triangle area
+    double lA = lNormal.x;
+    double lB = lNormal.y;
+    double lC = lNormal.z;
+    double lD = -glm::dot(lNormal, lP0);
+
+    Quadric lQ = {{lA * lA, lA * lB, lA * lC, lA * lD, lB * lB, lB * lC, lB * lD, lC * lC, lC * lD, lD * lD, 1.0}};
+
+    for (uint32_t j = 0; j < 3; ++j) {
+      Quadric &lTarget = vQuadrics[vIndex[i + j]];
+      for (size_t k = 0; k < lQ.size(); ++k)
+        lTarget[k] += lQ[k] * lW;
+    }
+  }
+}
+
+//! \returns the mean squared distance of _p to the planes in _q
+double rMeshSimplifier::evaluate(Quadric const &_q, glm::vec3 const &_p) const {
+  double x = _p.x;
+  double y = _p.y;
+  double z = _p.z;
+
+  double lRes = _q[0] * x * x + 2 * _q[1] * x * y + 2 * _q[2] * x * z + 2 * _q[3] * x + _q[4] * y * y +
+                2 * _q[5] * y * z + 2 * _q[6] * y + _q[7] * z * z + 2 * _q[8] * z + _q[9];
+
+  return _q[10] > 0.0 ? std::abs(lRes) / _q[10] : 0.0;
+}
+
+//! \returns true if moving _from to _to would flip one of the triangles _tris (triangle start indexes)
+bool rMeshSimplifier::flips(uint32_t _from, uint32_t _to, std::vector<uint32_t> const &_tris) const {
+  for (auto i : _tris) {
+    uint32_t lV[3] = {vIndex[i + 0], vIndex[i + 1], vIndex[i + 2]};
+
+    if (lV[0] == _to || lV[1] == _to || lV[2] == _to)
+      continue; // Will be removed
+
+    glm::vec3 lP[3];
+    glm::vec3 lNewP[3];
+    for (uint32_t j = 0; j < 3; ++j) {
+      lP[j]    = vPositions[lV[j]];
+      lNewP[j] = lV[j] == _from ? vPositions[_to] : lP[j];
+    }
+
+    glm::vec3 lOld = glm::cross(lP[1] - lP[0], lP[2] - lP[0]);
+    glm::vec3 lNew = glm::cross(lNewP[1] - lNewP[0], lNewP[2] - lNewP[0]);
+
+    if (glm::dot(lOld, lNew) <= 0.0f)
+      return true;
+  }
+
+  return false;
+}
+
+/*!
+ * \brief Collapses edges until the index count is <= _targetIndexCount or the error would exceed _maxError
+ *
+ * Works in passes: all candidate edges are sorted by their quadric cost and collapsed in order,
+ * skipping edges next to vertices that were already touched in the current pass.
+ *
+ * \returns true if the index buffer was reduced
+ */
+bool rMeshSimplifier::simplify(uint32_t _targetIndexCount, float _maxError) {
+  struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    double   cost;
+  };
+
+  size_t lStartSize = vIndex.size();
+  double lMaxCost   = static_cast<double>(_maxError) * static_cast<double>(_maxError);
+
+  std::vector<uint32_t> lRemap(vPositions.size());
+  std::vector<bool>     lTouched(vPositions.size());
+  std::vector<uint32_t> lTriOffsets(vPositions.size() + 1);
+  std::vector<uint32_t> lTris;
+  std::vector<Collapse> lCollapses;
+
+  while (vIndex.size() > _targetIndexCount) {
+    // Vertex -> triangle adjacency
+    std::fill(lTriOffsets.begin(), lTriOffsets.end(), 0);
+    for (auto i : vIndex)
+      lTriOffsets[i + 1]++;
+
+    for (size_t i = 1; i < lTriOffsets.size(); ++i)
+      lTriOffsets[i] += lTriOffsets[i - 1];
+
+    lTris.resize(vIndex.size());
+    std::vector<uint32_t> lFill(lTriOffsets.begin(), lTriOffsets.end() - 1);
+    for (uint32_t i = 0; i < vIndex.size(); ++i)
+      lTris[lFill[vIndex[i]]++] = i - (i % 3);
+
+    // Candidates (every directed edge once, interior edges show up in both directions)
+    lCollapses.clear();
+    for (size_t i = 0; i + 2 < vIndex.size(); i += 3) {
+      for (uint32_t j = 0; j < 3; ++j) {
+        uint32_t lFrom = vIndex[i + j];
+        uint32_t lTo   = vIndex[i + (j + 1) % 3];
+
+        if (vLocked[lFrom])
+          continue;
+
+        Quadric lQ = vQuadrics[lFrom];
+        for (size_t k = 0; k < lQ.size(); ++k)
+          lQ[k] += vQuadrics[lTo][k];
+
+        lCollapses.push_back({lFrom, lTo, evaluate(lQ, vPositions[lTo])});
+      }
+    }
+
+    std::sort(lCollapses.begin(), lCollapses.end(), [](Collapse const &a, Collapse const &b) {
+      return a.cost < b.cost;
+    });
+
+    for (uint32_t i = 0; i < lRemap.size(); ++i)
+      lRemap[i] = i;
+
+    std::fill(lTouched.begin(), lTouched.end(), false);
+
+    size_t lRemovedIndexes = 0;
+    size_t lNumCollapsed   = 0;
+    size_t lMaxRemove      = vIndex.size() - _targetIndexCount;
+
+    for (auto const &i : lCollapses) {
+      if (i.cost > lMaxCost || lRemovedIndexes >= lMaxRemove)
+        break;
+
+      if (lTouched[i.from] || lTouched[i.to])
+        continue;
+
+      std::vector<uint32_t> lAdjacent(lTris.begin() + lTriOffsets[i.from], lTris.begin() + lTriOffsets[i.from + 1]);
+
+      if (flips(i.from, i.to, lAdjacent))
+        continue;
+
+      lRemap[i.from] = i.to;
+      vError         = std::max(vError, static_cast<float>(std::sqrt(i.cost)));
+
+      for (size_t k = 0; k < vQuadrics[i.to].size(); ++k)
+        vQuadrics[i.to][k] += vQuadrics[i.from][k];
+
+      // Lock the neighbourhood for this pass (flip tests would be outdated)
+      for (auto j : lAdjacent) {
+        lTouched[vIndex[j + 0]] = true;
+        lTouched[vIndex[j + 1]] = true;
+        lTouched[vIndex[j + 2]] = true;
+
+        if (vIndex[j + 0] == i.to || vIndex[j + 1] == i.to || vIndex[j + 2] == i.to)
+          lRemovedIndexes += 3;
+      }
+
+      lNumCollapsed++;
+    }
+
+    if (lNumCollapsed == 0)
+      break;
+
+    // Apply and drop degenerate triangles
+    size_t lWrite = 0;
+    for (size_t i = 0; i + 2 < vIndex.size(); i += 3) {
+      uint32_t lA = lRemap[vIndex[i + 0]];
+      uint32_t lB = lRemap[vIndex[i + 1]];
+      uint32_t lC = lRemap[vIndex[i + 2]];
+
+      if (lA == lB || lB == lC || lA == lC)
+        continue;
+
+      vIndex[lWrite++] = lA;
+      vIndex[lWrite++] = lB;
+      vIndex[lWrite++] = lC;
+    }
+
+    vIndex.resize(lWrite);
+  }
+
+  return vIndex.size() < lStartSize;
+}
+
+/*!
+ * \brief Generates a LOD chain and stores all LODs in one index buffer
+ *
+ * LOD 0 is always the original index buffer. Every further LOD targets half the triangles of the
+ * previous one. Generation stops early when a LOD does not reduce the triangle count by at least
+ * 10% or when the error limit is hit.
+ *
+ * \param[in]  _vertexData Interleaved vertex data, the position MUST be the first 3 floats
+ * \param[in]  _stride     Number of floats per vertex
+ * \param[in]  _index      Triangle list (LOD 0)
+ * \param[out] _outIndex   All LODs
+ * \param[in]  _maxLODs    Maximum number of LODs (including LOD 0)
+ * \param[in]  _maxError   Maximum geometric error relative to the mesh extent
+ * \returns the LOD ranges in _outIndex
+ */
+std::vector<rMeshSimplifier::LOD> rMeshSimplifier::generateLODs(std::vector<float> const &   _vertexData,
+                                                                uint32_t                     _stride,
+                                                                std::vector<uint32_t> const &_index,
+                                                                std::vector<uint32_t> &      _outIndex,
+                                                                uint32_t                     _maxLODs,
+                                                                float                        _maxError) {
+  std::vector<LOD> lLODs;
+
+  _outIndex = _index;
+  lLODs.push_back({0, static_cast<uint32_t>(_index.size()), 0.0f});
+
+  if (_index.size() % 3 != 0) {
+    wLOG("Index buffer is not a triangle list; skipping LOD generation");
+    return lLODs;
+  }
+
+  rMeshSimplifier lSimplifier(_vertexData, _stride, _index);
+
+  while (lLODs.size() < _maxLODs) {
+    uint32_t lPrev   = lLODs.back().indexCount;
+    uint32_t lTarget = (lPrev / 6) * 3;
+
+    if (lTarget < 3 || !lSimplifier.simplify(lTarget, _maxError))
+      break;
+
+    auto const &lIndex = lSimplifier.getIndex();
+    if (lIndex.size() > lPrev - lPrev / 10)
+      break;
+
+    uint32_t lFirst = static_cast<uint32_t>(_outIndex.size());
+    lLODs.push_back({lFirst, static_cast<uint32_t>(lIndex.size()), lSimplifier.getError()});
+    _outIndex.insert(_outIndex.end(), lIndex.begin(), lIndex.end());
+  }
+
+  return lLODs;
+}
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,83 @@
+/*!
+ * \file rMeshSimplifier.hpp
+ * \brief \b Classes: \a rMeshSimplifier
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include <array>
+#include <glm/vec3.hpp>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Generates simplified index buffers with quadric edge collapse (Garland / Heckbert)
+ *
+ * Only the index buffer is simplified; vertices are collapsed onto existing vertices, so every LOD
+ * can reuse the original vertex buffer. Border vertices and vertices on attribute seams (same
+ * position, different normal / UV) are never removed.
+ *
+ * Calling simplify() repeatedly continues from the last result, so LODs are generated coarser and
+ * coarser without restarting.
+ */
+class rMeshSimplifier {
+ public:
+  struct LOD {
+    uint32_t firstIndex; //!< Offset in the combined index buffer
+    uint32_t indexCount;
+    float    error; //!< Geometric error, relative to the mesh extent
+  };
+
+ private:
+  typedef std::array<double, 11> Quadric; // 10 symmetric matrix values + weight
+
+  std::vector<glm::vec3> vPositions;
+  std::vector<Quadric>   vQuadrics;
+  std::vector<bool>      vLocked;
+  std::vector<uint32_t>  vIndex;
+
+  float vError = 0.0f;
+
+  void   setupQuadrics();
+  void   setupLocked();
+  double evaluate(Quadric const &_q, glm::vec3 const &_p) const;
+  bool   flips(uint32_t _from, uint32_t _to, std::vector<uint32_t> const &_tris) const;
+
+ public:
+  rMeshSimplifier(std::vector<float> const &_vertexData, uint32_t _stride, std::vector<uint32_t> const &_index);
+
+  bool simplify(uint32_t _targetIndexCount, float _maxError);
+
+  std::vector<uint32_t> const &getIndex() const { return vIndex; }
+  float                        getError() const { return vError; }
+
+  static std::vector<LOD> generateLODs(std::vector<float> const &   _vertexData,
+                                       uint32_t                     _stride,
+                                       std::vector<uint32_t> const &_index,
+                                       std::vector<uint32_t> &      _outIndex,
+                                       uint32_t                     _maxLODs  = 4,
+                                       float                        _maxError = 0.05f);
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,838 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rRenderGraph.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include <algorithm>
+#include <set>
+
+namespace e_engine {
+
+namespace {
+
+const VkAccessFlags cWriteAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                   VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+const VkPipelineStageFlags cGraphicsShaders =
+    VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+const VkPipelineStageFlags cDepthTests =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+void addUnique(std::vector<uint32_t> &_list, uint32_t _val) {
+  if (std::find(_list.begin(), _list.end(), _val) == _list.end())
+    _list.push_back(_val);
+}
+
+} // namespace
+
+// clang-format off
+const rRenderGraph::UsageInfo rRenderGraph::cUsageInfo[__USAGE_LAST__] = {
+  // NONE
+  {VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0, false},
+
+  // COLOR_ATTACHMENT
+  {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+   VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true},
+
+  // DEPTH_ATTACHMENT
+  {cDepthTests,
+   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+   VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true},
+
+  // DEPTH_READ_ONLY
+  {cDepthTests | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+   VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+   VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, false},
+
+  // SAMPLED_GRAPHICS
+  {cGraphicsShaders, VK_ACCESS_SHADER_READ_BIT,
+   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false},
+
+  // SAMPLED_COMPUTE
+  {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false},
+
+  // STORAGE_READ_GRAPHICS
+  {cGraphicsShaders, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false},
+
+  // STORAGE_READ_COMPUTE
+  {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+   VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false},
+
+  // STORAGE_WRITE_COMPUTE
+  {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+   VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true},
+
+  // UNIFORM_GRAPHICS
+  {cGraphicsShaders, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false},
+
+  // INDIRECT_COMMANDS
+  {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, 0, false},
+
+  // TRANSFER_SRC
+  {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false},
+
+  // TRANSFER_DST
+  {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true},
+
+  // PRESENT
+  {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false},
+};
+// clang-format on
+
+rRenderGraph::rRenderGraph(vkuDevicePTR _device) : vDevice(_device) {}
+rRenderGraph::~rRenderGraph() { destroy(); }
+
+
+/*!
+ * \brief Declares a resource name
+ * \returns the resource index or UINT32_MAX if the name is already used
+ */
+uint32_t rRenderGraph::addResource(std::string const &_name) {
+  if (vResourceMap.count(_name) > 0) {
+    eLOG("Render graph resource '", _name, "' already exists");
+    return UINT32_MAX;
+  }
+
+  vIsCompiled = false;
+
+  uint32_t lIndex     = static_cast<uint32_t>(vResources.size());
+  vResourceMap[_name] = lIndex;
+  vResources.emplace_back();
+  vResources.back().name = _name;
+  return lIndex;
+}
+
+/*!
+ * \brief Adds an image that is created outside of the graph
+ *
+ * \param _name    Name of the resource
+ * \param _image   The image (can be changed with setImage before every execute)
+ * \param _view    Optional view of the image (only stored for getImageView)
+ * \param _range   Subresource range the graph synchronizes
+ * \param _before  Usage before the graph is executed (last synchronized use)
+ * \param _after   Usage after the graph is executed (NONE to keep the last layout)
+ * \param _discard The content before the graph is not needed (first transition from UNDEFINED)
+ */
+bool rRenderGraph::importImage(std::string const &     _name,
+                               VkImage                 _image,
+                               VkImageView             _view,
+                               VkImageSubresourceRange _range,
+                               USAGE                   _before,
+                               USAGE                   _after,
+                               bool                    _discard) {
+  uint32_t lIndex = addResource(_name);
+  if (lIndex == UINT32_MAX)
+    return false;
+
+  Resource &lRes = vResources[lIndex];
+  lRes.image_vk  = _image;
+  lRes.view_vk   = _view;
+  lRes.range     = _range;
+  lRes.before    = _before;
+  lRes.after     = _after;
+  lRes.discard   = _discard;
+  return true;
+}
+
+/*!
+ * \brief Adds a buffer that is created outside of the graph (synchronized with global memory barriers)
+ */
+bool rRenderGraph::importBuffer(std::string const &_name, VkBuffer _buffer, USAGE _before, USAGE _after) {
+  uint32_t lIndex = addResource(_name);
+  if (lIndex == UINT32_MAX)
+    return false;
+
+  Resource &lRes = vResources[lIndex];
+  lRes.isImage   = false;
+  lRes.buffer_vk = _buffer;
+  lRes.before    = _before;
+  lRes.after     = _after;
+  return true;
+}
+
+/*!
+ * \brief Adds a 2D image that is created by the graph in compile() and only lives during execute()
+ *
+ * The usage flags are derived from the declared usages. Transient images whose lifetimes do not overlap
+ * share their memory, so their content is undefined before their first write in every execute().
+ */
+bool rRenderGraph::createImage(std::string const &_name, ImageDesc _desc) {
+  uint32_t lIndex = addResource(_name);
+  if (lIndex == UINT32_MAX)
+    return false;
+
+  Resource &lRes = vResources[lIndex];
+  lRes.transient = true;
+  lRes.desc      = _desc;
+  lRes.range     = {_desc.aspect, 0, 1, 0, 1};
+  lRes.discard   = true;
+  return true;
+}
+
+//! \brief Replaces the image of an imported image resource (i.e. the current swapchain image)
+bool rRenderGraph::setImage(std::string const &_name, VkImage _image, VkImageView _view) {
+  auto lIter = vResourceMap.find(_name);
+  if (lIter == vResourceMap.end() || !vResources[lIter->second].isImage || vResources[lIter->second].transient) {
+    eLOG("'", _name, "' is not an imported image");
+    return false;
+  }
+
+  vResources[lIter->second].image_vk = _image;
+  vResources[lIter->second].view_vk  = _view;
+  return true;
+}
+
+//! \brief Replaces the buffer of an imported buffer resource
+bool rRenderGraph::setBuffer(std::string const &_name, VkBuffer _buffer) {
+  auto lIter = vResourceMap.find(_name);
+  if (lIter == vResourceMap.end() || vResources[lIter->second].isImage) {
+    eLOG("'", _name, "' is not an imported buffer");
+    return false;
+  }
+
+  vResources[lIter->second].buffer_vk = _buffer;
+  return true;
+}
+
+//! \brief All passes writing this resource (and everything they depend on) are never culled
+bool rRenderGraph::markOutput(std::string const &_name) {
+  auto lIter = vResourceMap.find(_name);
+  if (lIter == vResourceMap.end()) {
+    eLOG("Unknown render graph resource '", _name, "'");
+    return false;
+  }
+
+  vResources[lIter->second].output = true;
+  vIsCompiled                      = false;
+  return true;
+}
+
+/*!
+ * \brief Adds a pass
+ * \param _name   Name for log messages
+ * \param _record Records the commands of the pass (called in execute)
+ * \returns the index of the pass
+ */
+uint32_t rRenderGraph::addPass(std::string _name, std::function<void(VkCommandBuffer)> _record) {
+  vPasses.emplace_back();
+  vPasses.back().name   = _name;
+  vPasses.back().record = _record;
+  vIsCompiled           = false;
+  return static_cast<uint32_t>(vPasses.size() - 1);
+}
+
+bool rRenderGraph::addUse(uint32_t _pass, std::string const &_resource, USAGE _usage, bool _write) {
+  if (_pass >= vPasses.size()) {
+    eLOG("Invalid render graph pass ", _pass);
+    return false;
+  }
+
+  if (_usage == NONE || _usage >= __USAGE_LAST__ || cUsageInfo[_usage].write != _write) {
+    eLOG("Usage ", static_cast<int>(_usage), " of '", _resource, "' is not a ", _write ? "write" : "read");
+    return false;
+  }
+
+  vPasses[_pass].declared.emplace_back(_resource, _usage);
+  vIsCompiled = false;
+  return true;
+}
+
+//! \brief Declares that the pass reads the resource (the resource may be declared later)
+bool rRenderGraph::read(uint32_t _pass, std::string const &_resource, USAGE _usage) {
+  return addUse(_pass, _resource, _usage, false);
+}
+
+//! \brief Declares that the pass writes the resource (the resource may be declared later)
+bool rRenderGraph::write(uint32_t _pass, std::string const &_resource, USAGE _usage) {
+  return addUse(_pass, _resource, _usage, true);
+}
+
+//! \brief Passes with side effects (i.e. host readbacks) are never culled
+void rRenderGraph::setHasSideEffects(uint32_t _pass, bool _sideEffects) {
+  if (_pass >= vPasses.size())
+    return;
+
+  vPasses[_pass].sideEffects = _sideEffects;
+  vIsCompiled                = false;
+}
+
+
+/*!
+ * \brief Culls and orders the passes, creates the transient images and generates the barriers
+ * \note Destroys the transient images of the last compile (wait until they are no longer used)
+ */
+bool rRenderGraph::compile() {
+  destroy();
+
+  if (!resolveUses())
+    return false;
+
+  buildDependencies();
+  cull();
+
+  if (!sortPasses())
+    return false;
+
+  if (!allocateTransients()) {
+    destroy();
+    return false;
+  }
+
+  generateBarriers();
+
+  vIsCompiled = true;
+  return true;
+}
+
+bool rRenderGraph::resolveUses() {
+  for (auto &i : vPasses) {
+    i.uses.clear();
+
+    for (auto const &j : i.declared) {
+      auto lIter = vResourceMap.find(j.first);
+      if (lIter == vResourceMap.end()) {
+        eLOG("Pass '", i.name, "' uses the unknown resource '", j.first, "'");
+        return false;
+      }
+
+      // All uses of an image in one pass share one barrier ==> the layouts must match
+      Resource const &lRes = vResources[lIter->second];
+      for (auto const &k : i.uses) {
+        if (k.resource == lIter->second && lRes.isImage &&
+            cUsageInfo[k.usage].layout != cUsageInfo[j.second].layout) {
+          eLOG("Pass '", i.name, "' uses '", lRes.name, "' with different layouts");
+          return false;
+        }
+      }
+
+      i.uses.push_back({lIter->second, j.second});
+    }
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Connects the passes per resource in declaration order
+ *
+ * Readers depend on the last writer before them (or on all writers if there is none), writers on the
+ * last writer and on all readers of the previous content (write after read).
+ */
+void rRenderGraph::buildDependencies() {
+  for (auto &i : vPasses) {
+    i.dataDeps.clear();
+    i.orderDeps.clear();
+  }
+
+  for (uint32_t lRes = 0; lRes < vResources.size(); ++lRes) {
+    uint32_t              lLastWriter = UINT32_MAX;
+    std::vector<uint32_t> lReaders;
+    std::vector<uint32_t> lEarlyReaders;
+    std::vector<uint32_t> lWriters;
+
+    for (uint32_t lPass = 0; lPass < vPasses.size(); ++lPass) {
+      bool lReads  = false;
+      bool lWrites = false;
+
+      for (auto const &i : vPasses[lPass].uses) {
+        if (i.resource == lRes) {
+          lReads |= !cUsageInfo[i.usage].write;
+          lWrites |= cUsageInfo[i.usage].write;
+        }
+      }
+
+      if (lReads && lLastWriter != UINT32_MAX) {
+        addUnique(vPasses[lPass].dataDeps, lLastWriter);
+        lReaders.push_back(lPass);
+      } else if (lReads && !lWrites) {
+        lEarlyReaders.push_back(lPass);
+      }
+
+      if (!lWrites)
+        continue;
+
+      if (lLastWriter != UINT32_MAX)
+        addUnique(vPasses[lPass].dataDeps, lLastWriter);
+
+      for (auto i : lReaders)
+        if (i != lPass)
+          addUnique(vPasses[lPass].orderDeps, i);
+
+      lReaders.clear();
+      lLastWriter = lPass;
+      lWriters.push_back(lPass);
+    }
+
+    for (auto i : lEarlyReaders)
+      for (auto j : lWriters)
+        addUnique(vPasses[i].dataDeps, j);
+  }
+}
+
+//! \brief Marks all passes contributing to an output or with side effects as live
+void rRenderGraph::cull() {
+  vLive.assign(vPasses.size(), false);
+  std::vector<uint32_t> lStack;
+
+  for (uint32_t i = 0; i < vPasses.size(); ++i) {
+    bool lRoot = vPasses[i].sideEffects;
+    for (auto const &j : vPasses[i].uses)
+      lRoot |= cUsageInfo[j.usage].write && vResources[j.resource].output;
+
+    if (lRoot) {
+      vLive[i] = true;
+      lStack.push_back(i);
+    }
+  }
+
+  while (!lStack.empty()) {
+    uint32_t lPass = lStack.back();
+    lStack.pop_back();
+
+    for (auto i : vPasses[lPass].dataDeps) {
+      if (!vLive[i]) {
+        vLive[i] = true;
+        lStack.push_back(i);
+      }
+    }
+  }
+
+  for (uint32_t i = 0; i < vPasses.size(); ++i)
+    if (!vLive[i])
+      dLOG("Render graph: culled pass '", vPasses[i].name, "'");
+}
+
+//! \brief Topological sort of the live passes, ties are broken by declaration order
+bool rRenderGraph::sortPasses() {
+  std::vector<uint32_t>              lNumDeps(vPasses.size(), 0);
+  std::vector<std::vector<uint32_t>> lSuccessors(vPasses.size());
+  std::set<uint32_t>                 lReady;
+
+  for (uint32_t i = 0; i < vPasses.size(); ++i) {
+    if (!vLive[i])
+      continue;
+
+    for (auto const *j : {&vPasses[i].dataDeps, &vPasses[i].orderDeps}) {
+      for (auto k : *j) {
+        if (!vLive[k])
+          continue;
+
+        lSuccessors[k].push_back(i);
+        lNumDeps[i]++;
+      }
+    }
+
+    if (lNumDeps[i] == 0)
+      lReady.insert(i);
+  }
+
+  vOrder.clear();
+  while (!lReady.empty()) {
+    uint32_t lPass = *lReady.begin();
+    lReady.erase(lReady.begin());
+    vOrder.push_back(lPass);
+
+    for (auto i : lSuccessors[lPass])
+      if (--lNumDeps[i] == 0)
+        lReady.insert(i);
+  }
+
+  uint32_t lNumLive = static_cast<uint32_t>(std::count(vLive.begin(), vLive.end(), true));
+  if (vOrder.size() != lNumLive) {
+    for (uint32_t i = 0; i < vPasses.size(); ++i)
+      if (vLive[i] && lNumDeps[i] > 0)
+        eLOG("Render graph: pass '", vPasses[i].name, "' is part of a dependency cycle");
+
+    vOrder.clear();
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+ * \brief Creates the transient images and assigns them to memory slots
+ *
+ * The images are placed greedily (sorted by their first use) into the first slot whose last occupant is
+ * no longer used, so every slot is as large as its largest occupant.
+ */
+bool rRenderGraph::allocateTransients() {
+  for (uint32_t i = 0; i < vOrder.size(); ++i) {
+    for (auto const &j : vPasses[vOrder[i]].uses) {
+      Resource &lRes = vResources[j.resource];
+      lRes.firstUse  = std::min(lRes.firstUse, i);
+      lRes.lastUse   = std::max(lRes.lastUse, i);
+    }
+  }
+
+  std::vector<uint32_t> lTransients;
+  for (uint32_t i = 0; i < vResources.size(); ++i)
+    if (vResources[i].transient && vResources[i].firstUse != UINT32_MAX)
+      lTransients.push_back(i);
+
+  std::sort(lTransients.begin(), lTransients.end(), [this](uint32_t a, uint32_t b) -> bool {
+    return vResources[a].firstUse < vResources[b].firstUse;
+  });
+
+  VkDevice lDevice = **vDevice;
+
+  for (auto i : lTransients) {
+    Resource &           lRes     = vResources[i];
+    VkImageUsageFlags    lUsage   = lRes.desc.extraUsage;
+    VkPipelineStageFlags lStages  = 0;
+    VkAccessFlags        lWrites  = 0;
+    bool                 lWritten = false;
+
+    for (uint32_t j = lRes.firstUse; j <= lRes.lastUse; ++j) {
+      for (auto const &k : vPasses[vOrder[j]].uses) {
+        if (k.resource != i)
+          continue;
+
+        lUsage |= cUsageInfo[k.usage].imageUsage;
+        lStages |= cUsageInfo[k.usage].stages;
+        lWrites |= cUsageInfo[k.usage].access & cWriteAccess;
+        lWritten |= cUsageInfo[k.usage].write;
+      }
+
+      if (j == lRes.firstUse && !lWritten)
+        wLOG("Transient image '", lRes.name, "' is read before it is written");
+    }
+
+    VkImageCreateInfo lInfo     = {};
+    lInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    lInfo.imageType             = VK_IMAGE_TYPE_2D;
+    lInfo.format                = lRes.desc.format;
+    lInfo.extent                = lRes.desc.extent;
+    lInfo.mipLevels             = 1;
+    lInfo.arrayLayers           = 1;
+    lInfo.samples               = lRes.desc.samples;
+    lInfo.tiling                = VK_IMAGE_TILING_OPTIMAL;
+    lInfo.usage                 = lUsage;
+    lInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+    lInfo.queueFamilyIndexCount = 0;
+    lInfo.pQueueFamilyIndices   = nullptr;
+    lInfo.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    auto lRes_vk = vkCreateImage(lDevice, &lInfo, nullptr, &lRes.image_vk);
+    if (lRes_vk != VK_SUCCESS) {
+      eLOG("'vkCreateImage' returned ", uEnum2Str::toStr(lRes_vk), " for transient image '", lRes.name, "'");
+      return false;
+    }
+
+    VkMemoryRequirements lReq;
+    vkGetImageMemoryRequirements(lDevice, lRes.image_vk, &lReq);
+
+    for (uint32_t j = 0; j < vSlots.size() && lRes.slot == UINT32_MAX; ++j)
+      if (vSlots[j].freeAfter < lRes.firstUse && (vSlots[j].typeBits & lReq.memoryTypeBits) != 0)
+        lRes.slot = j;
+
+    if (lRes.slot == UINT32_MAX) {
+      lRes.slot = static_cast<uint32_t>(vSlots.size());
+      vSlots.emplace_back();
+    }
+
+    MemorySlot &lSlot = vSlots[lRes.slot];
+    lSlot.size        = std::max(lSlot.size, lReq.size);
+    lSlot.typeBits &= lReq.memoryTypeBits;
+    lSlot.freeAfter = lRes.lastUse;
+    lSlot.stages |= lStages;
+    lSlot.writeAccess |= lWrites;
+  }
+
+  for (auto &i : vSlots) {
+    VkMemoryAllocateInfo lAllocInfo = {};
+    lAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    lAllocInfo.allocationSize       = i.size;
+    lAllocInfo.memoryTypeIndex =
+        vDevice->getMemoryTypeIndexFromBitfield(i.typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (lAllocInfo.memoryTypeIndex == UINT32_MAX) {
+      eLOG("No device local memory type for the transient images");
+      return false;
+    }
+
+    auto lRes = vkAllocateMemory(lDevice, &lAllocInfo, nullptr, &i.memory_vk);
+    if (lRes != VK_SUCCESS) {
+      eLOG("'vkAllocateMemory' returned ", uEnum2Str::toStr(lRes));
+      return false;
+    }
+  }
+
+  for (auto i : lTransients) {
+    Resource &lRes = vResources[i];
+
+    auto lRes_vk = vkBindImageMemory(lDevice, lRes.image_vk, vSlots[lRes.slot].memory_vk, 0);
+    if (lRes_vk != VK_SUCCESS) {
+      eLOG("'vkBindImageMemory' returned ", uEnum2Str::toStr(lRes_vk));
+      return false;
+    }
+
+    VkImageViewCreateInfo lViewInfo = {};
+    lViewInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    lViewInfo.image                 = lRes.image_vk;
+    lViewInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+    lViewInfo.format                = lRes.desc.format;
+    lViewInfo.subresourceRange      = lRes.range; // components: 0 == VK_COMPONENT_SWIZZLE_IDENTITY
+
+    lRes_vk = vkCreateImageView(lDevice, &lViewInfo, nullptr, &lRes.view_vk);
+    if (lRes_vk != VK_SUCCESS) {
+      eLOG("'vkCreateImageView' returned ", uEnum2Str::toStr(lRes_vk));
+      return false;
+    }
+  }
+
+  if (!vSlots.empty())
+    dLOG("Render graph: ", lTransients.size(), " transient images in ", vSlots.size(), " memory blocks");
+
+  return true;
+}
+
+//! \brief The synchronization state of a resource after a use outside of the graph
+rRenderGraph::State rRenderGraph::initialState(USAGE _usage, bool _discard) {
+  UsageInfo const &lInfo  = cUsageInfo[_usage];
+  State            lState = {};
+
+  lState.layout = _discard ? VK_IMAGE_LAYOUT_UNDEFINED : lInfo.layout;
+  if (lInfo.write) {
+    lState.writeStages = lInfo.stages;
+    lState.writeAccess = lInfo.access & cWriteAccess;
+  } else if (_usage != NONE) {
+    lState.readStages   = lInfo.stages;
+    lState.syncedStages = lInfo.stages;
+    lState.syncedAccess = lInfo.access;
+  }
+
+  return lState;
+}
+
+/*!
+ * \brief Adds the synchronization for one use of a resource to a barrier and updates the resource state
+ *
+ * Writes and layout transitions wait for all previous reads and writes. Reads only wait for the last
+ * write and only if it is not yet visible to their stages and access types. Write after read hazards
+ * only need an execution dependency.
+ */
+void rRenderGraph::addTransition(Barrier &_barrier, State &_state, uint32_t _res, bool _isImage, USAGE _usage) {
+  UsageInfo const &lInfo = cUsageInfo[_usage];
+
+  bool lLayoutChange = _isImage && lInfo.layout != VK_IMAGE_LAYOUT_UNDEFINED && lInfo.layout != _state.layout;
+  bool lUnsynced = (lInfo.stages & ~_state.syncedStages) != 0 || (lInfo.access & ~_state.syncedAccess) != 0;
+
+  VkPipelineStageFlags lSrcStages = _state.writeStages;
+  if (lInfo.write || lLayoutChange)
+    lSrcStages |= _state.readStages;
+
+  bool lNeeded = lLayoutChange || (lInfo.write && lSrcStages != 0) || (_state.writeStages != 0 && lUnsynced);
+
+  if (lNeeded) {
+    _barrier.srcStages |= lSrcStages;
+    _barrier.dstStages |= lInfo.stages;
+
+    if (_isImage && (lLayoutChange || _state.writeAccess != 0)) {
+      VkImageLayout lNewLayout = lLayoutChange ? lInfo.layout : _state.layout;
+      _barrier.images.push_back({_res, _state.layout, lNewLayout, _state.writeAccess, lInfo.access});
+    } else if (!_isImage && _state.writeAccess != 0) {
+      _barrier.srcAccess |= _state.writeAccess;
+      _barrier.dstAccess |= lInfo.access;
+    }
+  }
+
+  if (lLayoutChange)
+    _state.layout = lInfo.layout;
+
+  if (lInfo.write) {
+    _state.writeStages  = lInfo.stages;
+    _state.writeAccess  = lInfo.access & cWriteAccess;
+    _state.readStages   = 0;
+    _state.syncedStages = 0;
+    _state.syncedAccess = 0;
+  } else if (lLayoutChange) {
+    // Later reads in other stages must wait for the layout transition
+    _state.writeStages  = lInfo.stages;
+    _state.writeAccess  = 0;
+    _state.readStages   = lInfo.stages;
+    _state.syncedStages = lInfo.stages;
+    _state.syncedAccess = lInfo.access;
+  } else {
+    _state.readStages |= lInfo.stages;
+    if (lNeeded) {
+      _state.syncedStages |= lInfo.stages;
+      _state.syncedAccess |= lInfo.access;
+    }
+  }
+}
+
+void rRenderGraph::generateBarriers() {
+  std::vector<State> lStates(vResources.size());
+
+  for (uint32_t i = 0; i < vResources.size(); ++i) {
+    Resource const &lRes = vResources[i];
+    if (!lRes.transient) {
+      lStates[i] = initialState(lRes.before, lRes.discard);
+      continue;
+    }
+
+    // The memory may still be used by an other image of the slot (also from the last execute)
+    lStates[i]             = {};
+    lStates[i].layout      = VK_IMAGE_LAYOUT_UNDEFINED;
+    lStates[i].writeStages = lRes.slot != UINT32_MAX ? vSlots[lRes.slot].stages : 0;
+    lStates[i].writeAccess = lRes.slot != UINT32_MAX ? vSlots[lRes.slot].writeAccess : 0;
+  }
+
+  vBarriers.clear();
+  vBarriers.resize(vOrder.size());
+
+  for (uint32_t i = 0; i < vOrder.size(); ++i)
+    for (auto const &j : vPasses[vOrder[i]].uses)
+      addTransition(vBarriers[i], lStates[j.resource], j.resource, vResources[j.resource].isImage, j.usage);
+
+  vFinalBarrier = Barrier();
+  for (uint32_t i = 0; i < vResources.size(); ++i) {
+    Resource const &lRes = vResources[i];
+    if (lRes.transient || lRes.firstUse == UINT32_MAX || lRes.after == NONE)
+      continue;
+
+    addTransition(vFinalBarrier, lStates[i], i, lRes.isImage, lRes.after);
+  }
+}
+
+void rRenderGraph::cmdBarrier(VkCommandBuffer _buf, Barrier const &_barrier) {
+  if (_barrier.empty())
+    return;
+
+  std::vector<VkImageMemoryBarrier> lImages;
+  lImages.reserve(_barrier.images.size());
+
+  for (auto const &i : _barrier.images) {
+    Resource const &lRes = vResources[i.resource];
+    if (lRes.image_vk == VK_NULL_HANDLE)
+      continue;
+
+    VkImageMemoryBarrier lBarrier;
+    lBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    lBarrier.pNext               = nullptr;
+    lBarrier.srcAccessMask       = i.srcAccess;
+    lBarrier.dstAccessMask       = i.dstAccess;
+    lBarrier.oldLayout           = i.oldLayout;
+    lBarrier.newLayout           = i.newLayout;
+    lBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    lBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    lBarrier.image               = lRes.image_vk;
+    lBarrier.subresourceRange    = lRes.range;
+    lImages.push_back(lBarrier);
+  }
+
+  VkMemoryBarrier lMemory;
+  lMemory.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  lMemory.pNext         = nullptr;
+  lMemory.srcAccessMask = _barrier.srcAccess;
+  lMemory.dstAccessMask = _barrier.dstAccess;
+
+  uint32_t lNumMemory = (_barrier.srcAccess != 0 || _barrier.dstAccess != 0) ? 1 : 0;
+
+  vkCmdPipelineBarrier(_buf,
+                       _barrier.srcStages != 0 ? _barrier.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       _barrier.dstStages != 0 ? _barrier.dstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0,
+                       lNumMemory,
+                       &lMemory,
+                       0,
+                       nullptr,
+                       static_cast<uint32_t>(lImages.size()),
+                       lImages.data());
+}
+
+/*!
+ * \brief Records all live passes with their barriers
+ * \note The imported images must be set (setImage) to the images used by this command buffer
+ */
+void rRenderGraph::execute(VkCommandBuffer _buf) {
+  if (!vIsCompiled) {
+    eLOG("The render graph is not compiled");
+    return;
+  }
+
+  for (uint32_t i = 0; i < vOrder.size(); ++i) {
+    cmdBarrier(_buf, vBarriers[i]);
+
+    if (vPasses[vOrder[i]].record)
+      vPasses[vOrder[i]].record(_buf);
+  }
+
+  cmdBarrier(_buf, vFinalBarrier);
+}
+
+//! \brief Destroys the transient images and the compiled data (the declarations are kept)
+void rRenderGraph::destroy() {
+  VkDevice lDevice = vDevice ? **vDevice : VK_NULL_HANDLE;
+
+  for (auto &i : vResources) {
+    if (i.transient && lDevice != VK_NULL_HANDLE) {
+      if (i.view_vk != VK_NULL_HANDLE)
+        vkDestroyImageView(lDevice, i.view_vk, nullptr);
+
+      if (i.image_vk != VK_NULL_HANDLE)
+        vkDestroyImage(lDevice, i.image_vk, nullptr);
+
+      i.view_vk  = VK_NULL_HANDLE;
+      i.image_vk = VK_NULL_HANDLE;
+    }
+
+    i.firstUse = UINT32_MAX;
+    i.lastUse  = 0;
+    i.slot     = UINT32_MAX;
+  }
+
+  for (auto &i : vSlots)
+    if (i.memory_vk != VK_NULL_HANDLE && lDevice != VK_NULL_HANDLE)
+      vkFreeMemory(lDevice, i.memory_vk, nullptr);
+
+  vSlots.clear();
+  vLive.clear();
+  vOrder.clear();
+  vBarriers.clear();
+  vFinalBarrier = Barrier();
+  vIsCompiled   = false;
+}
+
+//! \brief Destroys everything and removes all passes and resources
+void rRenderGraph::clear() {
+  destroy();
+  vResources.clear();
+  vResourceMap.clear();
+  vPasses.clear();
+}
+
+VkImage rRenderGraph::getImage(std::string const &_name) const {
+  auto lIter = vResourceMap.find(_name);
+  return lIter != vResourceMap.end() ? vResources[lIter->second].image_vk : VK_NULL_HANDLE;
+}
+
+VkImageView rRenderGraph::getImageView(std::string const &_name) const {
+  auto lIter = vResourceMap.find(_name);
+  return lIter != vResourceMap.end() ? vResources[lIter->second].view_vk : VK_NULL_HANDLE;
+}
+
+bool rRenderGraph::getIsCulled(uint32_t _pass) const { return _pass < vLive.size() && !vLive[_pass]; }
+
+} // namespace e_engine
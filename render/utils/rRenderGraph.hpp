@@ -0,0 +1,244 @@
+/*!
+ * \file rRenderGraph.hpp
+ * \brief \b Classes: \a rRenderGraph
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuDevice.hpp"
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Orders passes by the resources they read and write and generates the barriers between them
+ *
+ * Passes declare how they use named resources (read / write with a USAGE). compile() then:
+ *  - culls all passes whose results are neither marked as output (markOutput) nor have side effects
+ *  - orders the remaining passes (writers before readers, otherwise in declaration order)
+ *  - creates the transient images and lets images with disjoint lifetimes share the same memory
+ *  - computes one merged vkCmdPipelineBarrier per pass with the exact stages, access masks and layouts
+ *
+ * execute() records the barriers and the record callbacks of the passes into a command buffer. Graphs
+ * without record callbacks can also only be used for ordering (getPassOrder).
+ *
+ * A read depends on the last pass declared before it that writes the resource. Reads without such a
+ * pass depend on all writers declared after them, so passes can be declared in any order as long as
+ * every resource is written in order. A pass both reading and writing a resource modifies its content.
+ *
+ * Imported resources are described by the usage before (_before) and after (_after) the graph. The
+ * graph transitions imported images back into the layout of _after at the end of execute().
+ *
+ * \note The graph does not synchronize across submits or queues. Images used in a render pass with own
+ * \note subpass dependencies should be imported with the usage the render pass leaves them in.
+ */
+class rRenderGraph {
+ public:
+  enum USAGE {
+    NONE,                  //!< No previous use (only valid for the initial / final usage of imports)
+    COLOR_ATTACHMENT,      //!< Color attachment of a render pass (write)
+    DEPTH_ATTACHMENT,      //!< Depth stencil attachment with depth writes (write)
+    DEPTH_READ_ONLY,       //!< Depth test without writes or sampled while bound as depth attachment (read)
+    SAMPLED_GRAPHICS,      //!< Sampled in the vertex or fragment shader (read)
+    SAMPLED_COMPUTE,       //!< Sampled in a compute shader (read)
+    STORAGE_READ_GRAPHICS, //!< Storage image / buffer read in the vertex or fragment shader (read)
+    STORAGE_READ_COMPUTE,  //!< Storage image / buffer read in a compute shader (read)
+    STORAGE_WRITE_COMPUTE, //!< Storage image / buffer written in a compute shader (write)
+    UNIFORM_GRAPHICS,      //!< Uniform buffer in the vertex or fragment shader (read)
+    INDIRECT_COMMANDS,     //!< vkCmdDraw*Indirect / vkCmdDispatchIndirect arguments (read)
+    TRANSFER_SRC,          //!< Copy / blit source (read)
+    TRANSFER_DST,          //!< Copy / blit / clear destination (write)
+    PRESENT,               //!< Presented by the swapchain (read)
+    __USAGE_LAST__
+  };
+
+  //! Create info of a transient image
+  struct ImageDesc {
+    VkFormat              format;
+    VkExtent3D            extent;
+    VkImageAspectFlags    aspect;
+    VkImageUsageFlags     extraUsage = 0; //!< Added to the usage flags derived from the declared usages
+    VkSampleCountFlagBits samples    = VK_SAMPLE_COUNT_1_BIT;
+  };
+
+ private:
+  struct UsageInfo {
+    VkPipelineStageFlags stages;
+    VkAccessFlags        access;
+    VkImageLayout        layout;
+    VkImageUsageFlags    imageUsage;
+    bool                 write;
+  };
+
+  static const UsageInfo cUsageInfo[__USAGE_LAST__];
+
+  struct Resource {
+    std::string name;
+    bool        isImage   = true;
+    bool        transient = false;
+    bool        output    = false;
+
+    VkImage                 image_vk  = VK_NULL_HANDLE;
+    VkImageView             view_vk   = VK_NULL_HANDLE;
+    VkBuffer                buffer_vk = VK_NULL_HANDLE;
+    VkImageSubresourceRange range     = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    ImageDesc               desc      = {};
+
+    USAGE before  = NONE;
+    USAGE after   = NONE;
+    bool  discard = false; //!< Content before the graph is not needed
+
+    // Compiled data
+    uint32_t firstUse = UINT32_MAX; //!< Position in vOrder
+    uint32_t lastUse  = 0;
+    uint32_t slot     = UINT32_MAX; //!< Memory slot of transient images
+  };
+
+  struct Use {
+    uint32_t resource;
+    USAGE    usage;
+  };
+
+  struct Pass {
+    std::string                                name;
+    std::vector<std::pair<std::string, USAGE>> declared; //!< Uses by resource name (resolved in compile)
+    std::vector<Use>                           uses;
+    std::function<void(VkCommandBuffer)>       record;
+    bool                                       sideEffects = false;
+
+    std::vector<uint32_t> dataDeps;  //!< Passes whose results this pass needs
+    std::vector<uint32_t> orderDeps; //!< Passes that must run before this pass (write after read)
+  };
+
+  struct ImageBarrier {
+    uint32_t      resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+  };
+
+  struct Barrier {
+    VkPipelineStageFlags      srcStages = 0;
+    VkPipelineStageFlags      dstStages = 0;
+    VkAccessFlags             srcAccess = 0; //!< Global memory barrier (buffers)
+    VkAccessFlags             dstAccess = 0;
+    std::vector<ImageBarrier> images;
+
+    bool empty() const { return srcStages == 0 && dstStages == 0; }
+  };
+
+  //! Synchronization state of a resource while generating the barriers
+  struct State {
+    VkImageLayout        layout;
+    VkPipelineStageFlags writeStages;  //!< Stages of the last write
+    VkAccessFlags        writeAccess;  //!< Access of the last write
+    VkPipelineStageFlags readStages;   //!< Stages that read since the last write
+    VkPipelineStageFlags syncedStages; //!< Stages the last write is visible to
+    VkAccessFlags        syncedAccess; //!< Access types the last write is visible to
+  };
+
+  struct MemorySlot {
+    VkDeviceMemory       memory_vk   = VK_NULL_HANDLE;
+    VkDeviceSize         size        = 0;
+    uint32_t             typeBits    = UINT32_MAX;
+    uint32_t             freeAfter   = 0; //!< Last use of the current occupant (position in vOrder)
+    VkPipelineStageFlags stages      = 0; //!< All stages any occupant is used in
+    VkAccessFlags        writeAccess = 0; //!< All write access types of all occupants
+  };
+
+  vkuDevicePTR vDevice;
+
+  std::vector<Resource>                     vResources;
+  std::unordered_map<std::string, uint32_t> vResourceMap;
+  std::vector<Pass>                         vPasses;
+
+  std::vector<bool>       vLive;     //!< Passes that are not culled
+  std::vector<uint32_t>   vOrder;    //!< Indexes of the passes that are executed
+  std::vector<Barrier>    vBarriers; //!< Barrier before each pass in vOrder
+  Barrier                 vFinalBarrier;
+  std::vector<MemorySlot> vSlots;
+
+  bool vIsCompiled = false;
+
+  uint32_t addResource(std::string const &_name);
+  bool     addUse(uint32_t _pass, std::string const &_resource, USAGE _usage, bool _write);
+
+  bool resolveUses();
+  void buildDependencies();
+  void cull();
+  bool sortPasses();
+  bool allocateTransients();
+  void generateBarriers();
+
+  static State initialState(USAGE _usage, bool _discard);
+  static void  addTransition(Barrier &_barrier, State &_state, uint32_t _res, bool _isImage, USAGE _usage);
+
+  void cmdBarrier(VkCommandBuffer _buf, Barrier const &_barrier);
+
+ public:
+  rRenderGraph(vkuDevicePTR _device);
+  ~rRenderGraph();
+
+  rRenderGraph(rRenderGraph const &) = delete;
+  rRenderGraph &operator=(rRenderGraph const &) = delete;
+
+  bool importImage(std::string const &     _name,
+                   VkImage                 _image,
+                   VkImageView             _view,
+                   VkImageSubresourceRange _range,
+                   USAGE                   _before,
+                   USAGE                   _after,
+                   bool                    _discard = false);
+  bool importBuffer(std::string const &_name, VkBuffer _buffer, USAGE _before, USAGE _after);
+  bool createImage(std::string const &_name, ImageDesc _desc);
+
+  bool setImage(std::string const &_name, VkImage _image, VkImageView _view = VK_NULL_HANDLE);
+  bool setBuffer(std::string const &_name, VkBuffer _buffer);
+  bool markOutput(std::string const &_name);
+
+  uint32_t addPass(std::string _name, std::function<void(VkCommandBuffer)> _record = nullptr);
+  bool     read(uint32_t _pass, std::string const &_resource, USAGE _usage);
+  bool     write(uint32_t _pass, std::string const &_resource, USAGE _usage);
+  void     setHasSideEffects(uint32_t _pass, bool _sideEffects = true);
+
+  bool compile();
+  void execute(VkCommandBuffer _buf);
+  void destroy();
+  void clear();
+
+  VkImage     getImage(std::string const &_name) const;
+  VkImageView getImageView(std::string const &_name) const;
+
+  bool getIsCompiled() const { return vIsCompiled; }
+  bool getIsCulled(uint32_t _pass) const;
+
+  //! Indexes (addPass) of the passes that are executed, in execution order
+  std::vector<uint32_t> const &getPassOrder() const { return vOrder; }
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
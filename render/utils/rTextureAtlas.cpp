@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rTextureAtlas.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "uThreadPool.hpp"
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <string.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Loads and packs the textures _paths that are small enough
+ *
+ * The files are loaded on the engine thread pool. Textures that are already packed, too large or not
+ * RGBA8 are skipped. The atlases are uploaded before this function returns.
+ *
+ * \returns the first error (the textures of the failed atlas are not packed)
+ */
+VkResult rTextureAtlas::addTextures(std::vector<std::string> const &_paths) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  uint32_t lPadding = cfg.padding > 0 ? 1 : 0;
+  while (lPadding > 0 && lPadding < cfg.padding)
+    lPadding <<= 1;
+
+  // The padded texture must fit into an empty atlas
+  uint32_t lMaxExtent = cfg.atlasExtent > 2 * lPadding ? cfg.atlasExtent - 2 * lPadding : 0;
+  lMaxExtent          = std::min(lMaxExtent / std::max(lPadding, 1u) * std::max(lPadding, 1u), cfg.maxTextureExtent);
+
+  std::vector<std::string> lPaths;
+  for (auto const &i : _paths)
+    if (vRegions.count(i) == 0 && std::find(lPaths.begin(), lPaths.end(), i) == lPaths.end())
+      lPaths.push_back(i);
+
+  std::vector<std::future<std::unique_ptr<Image>>> lLoads;
+  for (auto const &i : lPaths) {
+    lLoads.emplace_back(uThreadPool::getPool().add([i, lMaxExtent]() {
+      std::unique_ptr<Image> lImage(new Image);
+      lImage->path = i;
+
+      if (!rTexture::loadTexels(i, lImage->format, lImage->width, lImage->height, lImage->texels) ||
+          lImage->width > lMaxExtent || lImage->height > lMaxExtent)
+        lImage.reset();
+
+      return lImage;
+    }));
+  }
+
+  std::vector<std::unique_ptr<Image>> lImages;
+  for (auto &i : lLoads) {
+    auto lImage = i.get();
+    if (lImage)
+      lImages.emplace_back(std::move(lImage));
+  }
+
+  if (lImages.empty())
+    return VK_SUCCESS;
+
+  VkResult lRes = vTransfer.begin();
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  size_t lFirstAtlas = vAtlases.size();
+  size_t lNumPacked  = 0;
+
+  for (VkFormat lFormat : {VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB}) {
+    std::vector<Image *> lGroup;
+    for (auto &i : lImages)
+      if (i->format == lFormat)
+        lGroup.push_back(i.get());
+
+    if (lGroup.size() < std::max(cfg.minTextures, 1u))
+      continue;
+
+    // Tallest first (shelf packing)
+    std::sort(lGroup.begin(), lGroup.end(), [](Image const *a, Image const *b) {
+      return a->height != b->height ? a->height > b->height : a->width > b->width;
+    });
+
+    while (lGroup.size() >= std::max(cfg.minTextures, 1u)) {
+      std::vector<Image *> lPacked = lGroup;
+      uint32_t             lWidth  = 0;
+      uint32_t             lHeight = 0;
+
+      if (!pack(lPacked, lPadding, lWidth, lHeight))
+        break;
+
+      lGroup.erase(lGroup.begin(), lGroup.begin() + static_cast<std::ptrdiff_t>(lPacked.size()));
+
+      if (lPacked.size() < std::max(cfg.minTextures, 1u))
+        break;
+
+      lRes = createAtlas(lPacked, lPadding, lWidth, lHeight);
+      if (lRes != VK_SUCCESS)
+        break;
+
+      lNumPacked += lPacked.size();
+    }
+
+    if (lRes != VK_SUCCESS)
+      break;
+  }
+
+  VkResult lSubmit = vTransfer.submit();
+  if (lSubmit == VK_SUCCESS)
+    lSubmit = vTransfer.wait();
+
+  for (size_t i = lFirstAtlas; i < vAtlases.size(); ++i)
+    vAtlases[i]->finishUpload();
+
+  if (lSubmit != VK_SUCCESS) {
+    eLOG(L"Failed to upload the texture atlases: ", uEnum2Str::toStr(lSubmit));
+
+    for (auto lIter = vRegions.begin(); lIter != vRegions.end();) {
+      bool lIsNew = false;
+      for (size_t i = lFirstAtlas; i < vAtlases.size(); ++i)
+        lIsNew = lIsNew || lIter->second.texture == vAtlases[i].get();
+
+      lIter = lIsNew ? vRegions.erase(lIter) : std::next(lIter);
+    }
+
+    vAtlases.resize(lFirstAtlas);
+    return lSubmit;
+  }
+
+  if (lNumPacked > 0)
+    iLOG(L"Packed ", lNumPacked, L" textures into ", vAtlases.size() - lFirstAtlas, L" texture atlases");
+
+  return lRes;
+}
+
+/*!
+ * \brief Packs the first images of _images into one atlas (shelf packing)
+ *
+ * Every image is placed with _padding texels on each side and aligned to _padding, so that the
+ * images do not share texels in the first log2(_padding) mip levels.
+ *
+ * \param[in,out] _images The images (sorted by height), the images that do not fit are removed
+ * \param[out]    _width  Used width of the atlas
+ * \param[out]    _height Used height of the atlas
+ * \returns false if the first image does not fit into an empty atlas
+ */
+bool rTextureAtlas::pack(std::vector<Image *> &_images, uint32_t _padding, uint32_t &_width, uint32_t &_height) {
+  uint32_t lAlign    = std::max(_padding, 1u);
+  auto     lCellSize = [_padding, lAlign](uint32_t _size) {
+    return (_size + 2 * _padding + lAlign - 1) / lAlign * lAlign;
+  };
+
+  uint32_t lX           = 0;
+  uint32_t lShelfY      = 0;
+  uint32_t lShelfHeight = 0;
+  size_t   lNumPacked   = 0;
+
+  _width  = 0;
+  _height = 0;
+
+  for (auto *i : _images) {
+    uint32_t lCellW = lCellSize(i->width);
+    uint32_t lCellH = lCellSize(i->height);
+
+    if (lX + lCellW > cfg.atlasExtent) {
+      lX = 0;
+      lShelfY += lShelfHeight;
+      lShelfHeight = 0;
+    }
+
+    if (lX + lCellW > cfg.atlasExtent || lShelfY + lCellH > cfg.atlasExtent)
+      break;
+
+    i->x = lX;
+    i->y = lShelfY;
+
+    lX += lCellW;
+    lShelfHeight = std::max(lShelfHeight, lCellH);
+    _width       = std::max(_width, lX);
+    _height      = std::max(_height, lShelfY + lShelfHeight);
+    lNumPacked++;
+  }
+
+  _images.resize(lNumPacked);
+  return lNumPacked > 0;
+}
+
+/*!
+ * \brief Copies the packed images into one texture and records its upload into vTransfer
+ */
+VkResult rTextureAtlas::createAtlas(std::vector<Image *> const &_images,
+                                    uint32_t                    _padding,
+                                    uint32_t                    _width,
+                                    uint32_t                    _height) {
+  std::vector<uint8_t> lTexels(static_cast<size_t>(_width) * _height * 4, 0);
+
+  // Every padded cell repeats the edge texels of its image
+  for (auto const *i : _images) {
+    uint32_t lCellW = i->width + 2 * _padding;
+    uint32_t lCellH = i->height + 2 * _padding;
+
+    for (uint32_t y = 0; y < lCellH; ++y) {
+      uint32_t lSrcY = y < _padding ? 0 : std::min(y - _padding, i->height - 1);
+
+      for (uint32_t x = 0; x < lCellW; ++x) {
+        uint32_t lSrcX = x < _padding ? 0 : std::min(x - _padding, i->width - 1);
+        size_t   lDst  = (static_cast<size_t>(i->y + y) * _width + i->x + x) * 4;
+        memcpy(&lTexels[lDst], &i->texels[(static_cast<size_t>(lSrcY) * i->width + lSrcX) * 4], 4);
+      }
+    }
+  }
+
+  // The padding keeps log2(_padding) levels free of bleeding
+  uint32_t lLevels = 1;
+  for (uint32_t lPad = _padding; lPad > 1; lPad >>= 1)
+    lLevels++;
+
+  std::unique_ptr<rTexture> lAtlas(new rTexture(vDevice));
+  (*lAtlas)->mapMode = TextureMapMode::CLAMP;
+
+  VkResult lRes = lAtlas->initTexels(_images[0]->format, _width, _height, lTexels.data(), lLevels, vTransfer);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create texture atlas: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  for (auto const *i : _images) {
+    Region lRegion;
+    lRegion.texture   = lAtlas.get();
+    lRegion.transform = glm::vec4(static_cast<float>(i->width) / _width,
+                                  static_cast<float>(i->height) / _height,
+                                  static_cast<float>(i->x + _padding) / _width,
+                                  static_cast<float>(i->y + _padding) / _height);
+
+    vRegions[i->path] = lRegion;
+  }
+
+  dLOG(L"Texture atlas ", _width, L'x', _height, L" with ", _images.size(), L" textures");
+  vAtlases.emplace_back(std::move(lAtlas));
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Returns the atlas region of the texture _path
+ * \returns false if the texture is not packed
+ */
+bool rTextureAtlas::find(std::string const &_path, Region &_out) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  auto lIter = vRegions.find(_path);
+  if (lIter == vRegions.end())
+    return false;
+
+  _out = lIter->second;
+  return true;
+}
+
+//! \brief Destroys all atlases (the objects using them must be destroyed first)
+void rTextureAtlas::destroy() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  vRegions.clear();
+  vAtlases.clear();
+}
+
+/*!
+ * \brief Returns the texture of mesh _meshIndex if the mesh can sample it from an atlas
+ *
+ * This is the case if all textures of the material of the mesh are the same file (mapped with the
+ * first UV channel) and all UVs of the mesh are in [0, 1] (no wrapping), so that they can be remapped.
+ *
+ * \param[in]  _scene     The imported scene
+ * \param[in]  _meshIndex The mesh
+ * \param[in]  _root      Directory of the scene file (the texture paths are relative to it)
+ * \param[out] _out       Path of the texture
+ */
+bool rTextureAtlas::getPackablePath(aiScene const *    _scene,
+                                    uint32_t           _meshIndex,
+                                    std::string const &_root,
+                                    std::string &      _out) {
+  if (!_scene || _meshIndex >= _scene->mNumMeshes)
+    return false;
+
+  aiMesh const *lMesh = _scene->mMeshes[_meshIndex];
+  if (!lMesh || !lMesh->HasTextureCoords(0) || lMesh->mNumUVComponents[0] != 2 ||
+      lMesh->mMaterialIndex >= _scene->mNumMaterials)
+    return false;
+
+  const float lEpsilon = 1e-4f;
+  for (uint32_t i = 0; i < lMesh->mNumVertices; ++i) {
+    aiVector3D const &lUV = lMesh->mTextureCoords[0][i];
+    if (lUV.x < -lEpsilon || lUV.x > 1.0f + lEpsilon || lUV.y < -lEpsilon || lUV.y > 1.0f + lEpsilon)
+      return false;
+  }
+
+  aiMaterial const *lMat = _scene->mMaterials[lMesh->mMaterialIndex];
+  std::string       lPath;
+
+  for (uint32_t i = aiTextureType_NONE; i <= aiTextureType_UNKNOWN; ++i) {
+    aiTextureType lType = static_cast<aiTextureType>(i);
+
+    for (uint32_t j = 0; j < lMat->GetTextureCount(lType); ++j) {
+      aiString         lFile;
+      aiTextureMapping lMapping = aiTextureMapping_UV;
+      unsigned int     lUVIndex = 0;
+      lMat->GetTexture(lType, j, &lFile, &lMapping, &lUVIndex);
+
+      // Embedded textures ("*<index>") are not loaded from files
+      if (lMapping != aiTextureMapping_UV || lUVIndex != 0 || lFile.length == 0 || lFile.C_Str()[0] == '*')
+        return false;
+
+      if (!lPath.empty() && lPath != lFile.C_Str())
+        return false;
+
+      lPath = lFile.C_Str();
+    }
+  }
+
+  if (lPath.empty())
+    return false;
+
+  _out = _root + "/" + lPath;
+  return true;
+}
+
+} // namespace e_engine
@@ -0,0 +1,120 @@
+/*!
+ * \file rTextureAtlas.hpp
+ * \brief \b Classes: \a rTextureAtlas
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuDevice.hpp"
+#include "vkuTransfer.hpp"
+#include "rTexture.hpp"
+#include <assimp/scene.h>
+#include <glm/vec4.hpp>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Packs small textures of scenes into shared atlas images
+ *
+ * Textures with at most Config::maxTextureExtent texels per side and RGBA8 texels are packed into
+ * atlases of up to Config::atlasExtent x Config::atlasExtent texels (one atlas per format). Every
+ * texture is surrounded by Config::padding texels of its clamped edge, so that filtering and the first
+ * log2(padding) mip levels do not bleed into the neighbours.
+ *
+ * rSceneBase::loadFile adds the textures of the meshes that can use an atlas (getPackablePath()) and
+ * rObjectBase::setData remaps the UVs of these meshes into the atlas (Region::transform) instead of
+ * loading their textures. All meshes sharing an atlas then use the same image, view, sampler and
+ * descriptor.
+ *
+ * \note The atlas images are never removed, so the regions stay valid until destroy()
+ * \note The atlas must outlive the objects using it
+ */
+class rTextureAtlas final {
+ public:
+  struct Config {
+    uint32_t maxTextureExtent = 256;  //!< Larger textures keep their own image
+    uint32_t atlasExtent      = 2048; //!< Maximum width / height of an atlas
+    uint32_t padding          = 4;    //!< Edge texels around every texture (rounded up to a power of two)
+    uint32_t minTextures      = 2;    //!< Textures of one format needed to create an atlas
+  };
+
+  //! A packed texture
+  struct Region {
+    rTexture *texture   = nullptr;                            //!< The atlas
+    glm::vec4 transform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f); //!< UV scale (xy) and offset (zw): uv * scale + offset
+  };
+
+ private:
+  struct Image {
+    std::string          path;
+    VkFormat             format = VK_FORMAT_UNDEFINED;
+    uint32_t             width  = 0;
+    uint32_t             height = 0;
+    uint32_t             x      = 0; //!< Position of the padded image in the atlas
+    uint32_t             y      = 0;
+    std::vector<uint8_t> texels;
+  };
+
+  vkuDevicePTR vDevice;
+  vkuTransfer  vTransfer;
+
+  std::vector<std::unique_ptr<rTexture>>  vAtlases;
+  std::unordered_map<std::string, Region> vRegions;
+
+  std::mutex vMutex;
+
+  Config cfg;
+
+  bool     pack(std::vector<Image *> &_images, uint32_t _padding, uint32_t &_width, uint32_t &_height);
+  VkResult createAtlas(std::vector<Image *> const &_images, uint32_t _padding, uint32_t _width, uint32_t _height);
+
+ public:
+  rTextureAtlas() = delete;
+  rTextureAtlas(vkuDevicePTR _device) : vDevice(_device), vTransfer(_device) {}
+  ~rTextureAtlas() { destroy(); }
+
+  rTextureAtlas(rTextureAtlas const &) = delete;
+  rTextureAtlas &operator=(const rTextureAtlas &) = delete;
+
+  VkResult addTextures(std::vector<std::string> const &_paths);
+  bool     find(std::string const &_path, Region &_out);
+  void     destroy();
+
+  static bool getPackablePath(aiScene const *_scene, uint32_t _meshIndex, std::string const &_root, std::string &_out);
+
+  inline size_t getNumAtlases() const noexcept { return vAtlases.size(); }
+  inline size_t getNumTextures() const noexcept { return vRegions.size(); }
+
+  inline Config  getConfig() const noexcept { return cfg; }
+  inline Config *getConfigPTR() noexcept { return &cfg; }
+
+  inline Config *operator->() noexcept { return &cfg; } //! \brief Allow config access via atlas->cfgField = 1;
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
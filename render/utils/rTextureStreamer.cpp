@@ -0,0 +1,363 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rTextureStreamer.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "rObjectBase.hpp"
+#include "rTexture.hpp"
+#include "rWorld.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace e_engine {
+
+rTextureStreamer::rTextureStreamer(vkuDevicePTR _device) : vDevice(_device), vTransfer(_device) {}
+
+rTextureStreamer::~rTextureStreamer() {
+  vTransfer.wait();
+
+  for (auto i : vInFlight)
+    i->cancelStream();
+
+  for (auto i : vReading)
+    i->cancelStream();
+}
+
+rTextureStreamer::Entry *rTextureStreamer::findEntry(rTexture *_tex) {
+  auto lIter = std::find_if(vTextures.begin(), vTextures.end(), [_tex](Entry const &i) { return i.texture == _tex; });
+  return lIter != vTextures.end() ? &*lIter : nullptr;
+}
+
+/*!
+ * \brief Registers a texture
+ * \note The texture keeps its current levels until it is requested
+ */
+void rTextureStreamer::addTexture(rTexture *_tex) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (!_tex || findEntry(_tex))
+    return;
+
+  Entry lEntry;
+  lEntry.texture  = _tex;
+  lEntry.target   = _tex->getBaseLevel();
+  lEntry.lastUsed = vUpdates;
+  vTextures.push_back(lEntry);
+}
+
+//! \brief Registers all textures of the materials of _obj
+void rTextureStreamer::addObject(rObjectBase *_obj) {
+  for (auto &i : _obj->getMaterials())
+    for (auto &j : i.getTextures())
+      addTexture(&j);
+}
+
+/*!
+ * \brief Unregisters a texture
+ * \note Waits for the upload if the texture is currently streamed
+ */
+void rTextureStreamer::removeTexture(rTexture *_tex) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  auto lInFlight = std::find(vInFlight.begin(), vInFlight.end(), _tex);
+  if (lInFlight != vInFlight.end()) {
+    vTransfer.wait();
+    _tex->cancelStream();
+    vInFlight.erase(lInFlight);
+  }
+
+  auto lReading = std::find(vReading.begin(), vReading.end(), _tex);
+  if (lReading != vReading.end()) {
+    _tex->cancelStream(); // The read only fills a buffer shared with its callback
+    vReading.erase(lReading);
+  }
+
+  vTextures.erase(
+      std::remove_if(vTextures.begin(), vTextures.end(), [_tex](Entry const &i) { return i.texture == _tex; }),
+      vTextures.end());
+}
+
+//! \brief Unregisters all textures of the materials of _obj
+void rTextureStreamer::removeObject(rObjectBase *_obj) {
+  for (auto &i : _obj->getMaterials())
+    for (auto &j : i.getTextures())
+      removeTexture(&j);
+}
+
+/*!
+ * \brief Requests the levels _level to getNumLevels() - 1 of the full mip chain of _tex
+ *
+ * All requests between two update() calls are combined (the most detailed level wins).
+ */
+void rTextureStreamer::requestLevel(rTexture *_tex, uint32_t _level) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  Entry *lEntry = findEntry(_tex);
+  if (lEntry)
+    lEntry->request = std::min(lEntry->request, _level);
+}
+
+/*!
+ * \brief Requests the levels needed to show _tex with a size of _pixels on the screen
+ * \sa getProjectedExtent
+ */
+void rTextureStreamer::requestExtent(rTexture *_tex, float _pixels) {
+  uint32_t lExtent = static_cast<uint32_t>(std::min(std::ceil(std::max(_pixels, 1.0f)), 65536.0f));
+  requestLevel(_tex, _tex->getLevelForExtent(lExtent));
+}
+
+//! \brief Requests the levels of all textures of _obj for a size of _pixels on the screen
+void rTextureStreamer::requestObject(rObjectBase *_obj, float _pixels) {
+  for (auto &i : _obj->getMaterials())
+    for (auto &j : i.getTextures())
+      requestExtent(&j, _pixels);
+}
+
+/*!
+ * \brief Returns the size of an object with the (world space) size _size in pixels
+ * \param _fovY         Vertical field of view of the camera (radians)
+ * \param _screenHeight Height of the window (GlobConf.win.height)
+ */
+float rTextureStreamer::getProjectedExtent(float _size, float _distance, float _fovY, uint32_t _screenHeight) {
+  if (_distance <= 0.0f)
+    return std::numeric_limits<float>::max();
+
+  return _size / (2.0f * _distance * std::tan(0.5f * _fovY)) * static_cast<float>(_screenHeight);
+}
+
+/*!
+ * \brief Returns the memory the textures may use
+ * \param _used Memory currently used by the textures
+ */
+VkDeviceSize rTextureStreamer::computeBudget(VkDeviceSize _used) {
+  if (cfg.budget > 0)
+    return cfg.budget;
+
+  VkDeviceSize lBudget;
+  VkDeviceSize lUsage;
+  bool         lFromDriver = vDevice->getMemoryBudget(lBudget, lUsage);
+  VkDeviceSize lLimit      = static_cast<VkDeviceSize>(static_cast<double>(lBudget) * cfg.budgetFraction);
+
+  if (!lFromDriver)
+    return lLimit;
+
+  // The usage of the driver includes the textures
+  VkDeviceSize lOther = lUsage > _used ? lUsage - _used : 0;
+  return lLimit > lOther ? lLimit - lOther : 0;
+}
+
+VkDeviceSize rTextureStreamer::getUsedMemory() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  VkDeviceSize lUsed = 0;
+  for (auto const &i : vTextures)
+    lUsed += i.texture->getMemorySize();
+
+  return lUsed;
+}
+
+VkDeviceSize rTextureStreamer::getBudget() { return computeBudget(getUsedMemory()); }
+
+/*!
+ * \brief Swaps in the finished streams and starts new ones
+ *
+ * Call this once per frame (not from the render loop thread). Nothing new is started while the
+ * last streams are still uploading.
+ *
+ * \param _world The world that renders the textures (the images are swapped with rWorld::updateTextures)
+ * \returns true if textures changed
+ */
+bool rTextureStreamer::update(rWorld *_world) {
+  if (!_world) {
+    eLOG(L"Invalid world");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lLock(vMutex);
+  vUpdates++;
+
+  bool lChanged = false;
+
+  if (!vInFlight.empty() && vTransfer.isDone()) {
+    _world->updateTextures([this]() {
+      for (auto i : vInFlight)
+        i->commitStream();
+    });
+
+    vInFlight.clear();
+    lChanged = true;
+  }
+
+  // Update the targets
+  VkDeviceSize         lUsed = 0;
+  std::vector<Entry *> lCandidates;
+
+  for (auto &i : vTextures) {
+    rTexture *lTex = i.texture;
+
+    // Streams in flight count with the larger of both images
+    if (lTex->isStreaming()) {
+      lUsed += std::max(lTex->getMemorySize(), lTex->estimateMemorySize(lTex->getStreamBaseLevel()));
+    } else {
+      lUsed += lTex->getMemorySize();
+    }
+
+    if (!lTex->isStreamable())
+      continue;
+
+    uint32_t lResident = lTex->getLevelForExtent(cfg.residentExtent);
+
+    if (i.request != UINT32_MAX) {
+      i.target   = std::min(i.request, lResident);
+      i.lastUsed = vUpdates;
+    } else if (vUpdates - i.lastUsed > cfg.evictAfter) {
+      i.target = std::max(i.target, lResident);
+    }
+
+    i.request = UINT32_MAX;
+
+    if (!lTex->isStreaming())
+      lCandidates.push_back(&i);
+  }
+
+  VkDeviceSize                              lBudget     = computeBudget(lUsed);
+  size_t                                    lNumStreams = vReading.size() + vInFlight.size();
+  std::vector<std::pair<Entry *, uint32_t>> lStreams;
+
+  auto lSchedule = [&](Entry *_entry, uint32_t _level) {
+    rTexture *lTex = _entry->texture;
+    lUsed          = lUsed - lTex->getMemorySize() + lTex->estimateMemorySize(_level);
+    lStreams.emplace_back(_entry, _level);
+  };
+
+  // Least recently used first
+  std::sort(lCandidates.begin(), lCandidates.end(), [](Entry *a, Entry *b) { return a->lastUsed < b->lastUsed; });
+
+  // Drop the levels that are no longer needed
+  for (auto i : lCandidates) {
+    if (lStreams.size() + lNumStreams >= cfg.maxStreams)
+      break;
+
+    if (i->texture->getBaseLevel() < i->target)
+      lSchedule(i, i->target);
+  }
+
+  // Over budget ==> drop the top level of the least recently used textures
+  bool lEvicted = false;
+  for (auto i : lCandidates) {
+    if (lUsed <= lBudget || lStreams.size() + lNumStreams >= cfg.maxStreams)
+      break;
+
+    rTexture *lTex      = i->texture;
+    uint32_t  lResident = lTex->getLevelForExtent(cfg.residentExtent);
+    uint32_t  lBase     = lTex->getBaseLevel();
+
+    if (lBase >= lResident || lBase < i->target)
+      continue;
+
+    i->target = lBase + 1;
+    lSchedule(i, lBase + 1);
+    lEvicted = true;
+  }
+
+  if (lUsed > lBudget && !lEvicted)
+    wLOG(L"Texture budget exceeded: ", lUsed, L" of ", lBudget, L" bytes used");
+
+  // Stream in the requested levels of the most recently used textures that fit into the budget
+  if (!lEvicted) {
+    for (auto lIter = lCandidates.rbegin(); lIter != lCandidates.rend(); ++lIter) {
+      Entry *   i    = *lIter;
+      rTexture *lTex = i->texture;
+
+      if (lStreams.size() + lNumStreams >= cfg.maxStreams)
+        break;
+
+      if (i->target >= lTex->getBaseLevel())
+        continue;
+
+      // Load as many levels as possible (graceful degradation)
+      for (uint32_t lLevel = i->target; lLevel < lTex->getBaseLevel(); ++lLevel) {
+        if (lUsed - lTex->getMemorySize() + lTex->estimateMemorySize(lLevel) > lBudget)
+          continue;
+
+        lSchedule(i, lLevel);
+        break;
+      }
+    }
+  }
+
+  // Start reading the levels, the upload is recorded once they arrived
+  for (auto &i : lStreams) {
+    rTexture *lTex = i.first->texture;
+    VkResult  lRes = lTex->readLevels(i.second);
+
+    if (lRes != VK_SUCCESS) {
+      wLOG(L"Failed to stream texture levels: ", uEnum2Str::toStr(lRes));
+      i.first->target = lTex->getBaseLevel(); // Do not try again until the next request
+      continue;
+    }
+
+    if (lTex->isStreaming())
+      vReading.push_back(lTex);
+  }
+
+  // Upload the arrived levels (one transfer in flight)
+  if (!vInFlight.empty() || vReading.empty())
+    return lChanged;
+
+  auto lArrived = std::partition(vReading.begin(), vReading.end(), [](rTexture *i) { return !i->isReadDone(); });
+  if (lArrived == vReading.end())
+    return lChanged;
+
+  if (vTransfer.begin() != VK_SUCCESS)
+    return lChanged;
+
+  for (auto i = lArrived; i != vReading.end(); ++i) {
+    rTexture *lTex = *i;
+    VkResult  lRes = lTex->streamLevels(vTransfer);
+
+    if (lRes != VK_SUCCESS) {
+      wLOG(L"Failed to stream texture levels: ", uEnum2Str::toStr(lRes));
+
+      Entry *lEntry = findEntry(lTex);
+      if (lEntry)
+        lEntry->target = lTex->getBaseLevel(); // Do not try again until the next request
+
+      continue;
+    }
+
+    vInFlight.push_back(lTex);
+  }
+
+  vReading.erase(lArrived, vReading.end());
+
+  VkResult lRes = vTransfer.submit();
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to submit the texture streams: ", uEnum2Str::toStr(lRes));
+    vTransfer.wait();
+
+    for (auto i : vInFlight)
+      i->cancelStream();
+
+    vInFlight.clear();
+  }
+
+  return lChanged;
+}
+
+} // namespace e_engine
@@ -0,0 +1,127 @@
+/*!
+ * \file rTextureStreamer.hpp
+ * \brief \b Classes: \a rTextureStreamer
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuDevice.hpp"
+#include "vkuTransfer.hpp"
+#include <mutex>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+class rObjectBase;
+class rTexture;
+class rWorld;
+
+/*!
+ * \brief Keeps the textures of scenes in a device memory budget and streams their levels on demand
+ *
+ * Textures with a full mip chain in their file start with only the small levels resident (up to
+ * Config::residentExtent, see rSceneBase::setTextureStreamer). The application reports how large a
+ * texture is on the screen with requestExtent() / requestObject() (e.g. with getProjectedExtent() from
+ * the distance) or directly with requestLevel(). update() is called once per frame and
+ *
+ *  - drops textures that were not requested for Config::evictAfter updates back to residentExtent
+ *  - drops the top level of the least recently used textures while the budget is exceeded
+ *  - streams in the requested levels of the most recently used textures as long as the budget allows
+ *
+ * The budget is Config::budget or Config::budgetFraction of the device local memory. With
+ * VK_EXT_memory_budget (vkuDevice::getMemoryBudget) the memory used by everything else is subtracted.
+ *
+ * The new levels are read asynchronously (rTexture::readLevels, uAsyncIO) and uploaded on the transfer
+ * queue (vkuTransfer) by the first update() after they arrived, while the rendering continues. The new
+ * images are swapped in with rWorld::updateTextures. Scenes larger than the device memory are
+ * rendered with less detailed textures instead of failing allocations.
+ *
+ * \note Textures without a full mip chain in the file (e.g. with generated mip maps) are always fully
+ * \note resident, but count towards the budget.
+ * \note Registered textures must be removed (removeTexture / removeObject) before they are destroyed.
+ */
+class rTextureStreamer final {
+ public:
+  struct Config {
+    VkDeviceSize budget         = 0;    //!< Device memory for the textures (0: derived from the device)
+    float        budgetFraction = 0.8f; //!< Part of the device local memory that is used if budget is 0
+    uint32_t     residentExtent = 128;  //!< The levels up to this width / height are always resident
+    uint32_t     maxStreams     = 8;    //!< Maximum number of textures that are read / uploaded at once
+    uint64_t     evictAfter     = 300;  //!< Updates without a request until a texture drops its levels
+  };
+
+ private:
+  struct Entry {
+    rTexture *texture;
+    uint32_t  request  = UINT32_MAX; //!< Most detailed requested level since the last update()
+    uint32_t  target   = UINT32_MAX; //!< Level the texture should be streamed to
+    uint64_t  lastUsed = 0;          //!< update() of the last request
+  };
+
+  vkuDevicePTR vDevice;
+  vkuTransfer  vTransfer;
+
+  std::vector<Entry>      vTextures;
+  std::vector<rTexture *> vReading;  //!< Textures with a read of rTexture::readLevels in flight
+  std::vector<rTexture *> vInFlight; //!< Textures streamed by the last submit of vTransfer
+
+  uint64_t   vUpdates = 0;
+  std::mutex vMutex;
+
+  Config cfg;
+
+  Entry *      findEntry(rTexture *_tex);
+  VkDeviceSize computeBudget(VkDeviceSize _used);
+
+ public:
+  rTextureStreamer() = delete;
+  rTextureStreamer(vkuDevicePTR _device);
+  ~rTextureStreamer();
+
+  rTextureStreamer(rTextureStreamer const &) = delete;
+  rTextureStreamer &operator=(const rTextureStreamer &) = delete;
+
+  void addTexture(rTexture *_tex);
+  void addObject(rObjectBase *_obj);
+  void removeTexture(rTexture *_tex);
+  void removeObject(rObjectBase *_obj);
+
+  void requestLevel(rTexture *_tex, uint32_t _level);
+  void requestExtent(rTexture *_tex, float _pixels);
+  void requestObject(rObjectBase *_obj, float _pixels);
+
+  bool update(rWorld *_world);
+
+  VkDeviceSize getUsedMemory();
+  VkDeviceSize getBudget();
+
+  static float getProjectedExtent(float _size, float _distance, float _fovY, uint32_t _screenHeight);
+
+  inline Config  getConfig() const noexcept { return cfg; }
+  inline Config *getConfigPTR() noexcept { return &cfg; }
+
+  inline Config *operator->() noexcept { return &cfg; } //! \brief Allow config access via streamer->cfgField = 1;
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
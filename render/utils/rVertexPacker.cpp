@@ -0,0 +1,109 @@
+/*!
+ * \file rVertexPacker.cpp
+ * \brief \b Classes: \a rVertexPacker
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rVertexPacker.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
+
+using namespace e_engine;
+using namespace glm;
+
+/*!
+ * \brief Packs interleaved POS_NORM_UV float data (8 floats per vertex)
+ * \param[in]  _data   The float vertex data
+ * \param[in]  _bounds The bounds of all positions in _data
+ * \param[out] _out    The packed vertices
+ * \returns the dequantization matrix (maps the [0, 1] positions back into object space)
+ */
+mat4 rVertexPacker::packPNUV(std::vector<float> const &_data, rAABB const &_bounds, std::vector<PackedPNUV> &_out) {
+  vec3 lMin  = _bounds.min;
+  vec3 lSize = _bounds.max - _bounds.min;
+
+  // Avoid division by zero for flat meshes
+  for (int i = 0; i < 3; ++i)
+    if (lSize[i] <= 0.0f)
+      lSize[i] = 1.0f;
+
+  _out.resize(_data.size() / 8);
+  for (size_t i = 0; i < _out.size(); ++i) {
+    float const *lV   = &_data[8 * i];
+    vec3         lPos = (vec3(lV[0], lV[1], lV[2]) - lMin) / lSize;
+    vec2         lNor = octEncode(vec3(lV[3], lV[4], lV[5]));
+
+    _out[i].pos[0]    = packUnorm1x16(lPos.x);
+    _out[i].pos[1]    = packUnorm1x16(lPos.y);
+    _out[i].pos[2]    = packUnorm1x16(lPos.z);
+    _out[i].pos[3]    = packUnorm1x16(1.0f);
+    _out[i].normal[0] = static_cast<int16_t>(packSnorm1x16(lNor.x));
+    _out[i].normal[1] = static_cast<int16_t>(packSnorm1x16(lNor.y));
+    _out[i].uv[0]     = packHalf1x16(lV[6]);
+    _out[i].uv[1]     = packHalf1x16(lV[7]);
+  }
+
+  return scale(translate(mat4(1.0f), lMin), lSize);
+}
+
+/*!
+ * \brief Converts _index to 16 bit indexes
+ * \returns false if an index does not fit into 16 bit (_out is undefined then)
+ */
+bool rVertexPacker::packIndex16(std::vector<uint32_t> const &_index, std::vector<uint16_t> &_out) {
+  _out.resize(_index.size());
+  for (size_t i = 0; i < _index.size(); ++i) {
+    if (_index[i] > UINT16_MAX)
+      return false;
+
+    _out[i] = static_cast<uint16_t>(_index[i]);
+  }
+
+  return true;
+}
+
+//! Octahedral normal encoding (Cigolle et al. 2014), returns values in [-1, 1]
+vec2 rVertexPacker::octEncode(vec3 _n) {
+  _n /= std::abs(_n.x) + std::abs(_n.y) + std::abs(_n.z);
+  vec2 lRes = vec2(_n.x, _n.y);
+
+  if (_n.z < 0.0f) {
+    lRes.x = (1.0f - std::abs(_n.y)) * (_n.x >= 0.0f ? 1.0f : -1.0f);
+    lRes.y = (1.0f - std::abs(_n.x)) * (_n.y >= 0.0f ? 1.0f : -1.0f);
+  }
+
+  return lRes;
+}
+
+//! Inverse of octEncode (the same code is needed in the vertex shader)
+vec3 rVertexPacker::octDecode(vec2 _e) {
+  vec3  lN = vec3(_e.x, _e.y, 1.0f - std::abs(_e.x) - std::abs(_e.y));
+  float lT = std::max(-lN.z, 0.0f);
+
+  lN.x += lN.x >= 0.0f ? -lT : lT;
+  lN.y += lN.y >= 0.0f ? -lT : lT;
+
+  return normalize(lN);
+}
+
+//! \returns the vertex input formats for rPipeline::setVertexInputFormats
+std::vector<VkFormat> rVertexPacker::getPNUVFormats() {
+  return {VK_FORMAT_R16G16B16A16_UNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SFLOAT};
+}
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
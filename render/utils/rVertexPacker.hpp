@@ -0,0 +1,70 @@
+/*!
+ * \file rVertexPacker.hpp
+ * \brief \b Classes: \a rVertexPacker
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "rAABB.hpp"
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Packs float vertex data into compact GPU formats
+ *
+ * Packed POS_NORM_UV vertex (16 instead of 32 bytes):
+ *
+ *   Attribute | Format                      | Encoding
+ *   --------- | --------------------------- | -----------------------------------------------
+ *   position  | VK_FORMAT_R16G16B16A16_UNORM | quantized relative to the mesh AABB (w = 1)
+ *   normal    | VK_FORMAT_R16G16_SNORM       | octahedral (decode with octDecode in the shader)
+ *   UV        | VK_FORMAT_R16G16_SFLOAT      | half float
+ *
+ * The position has to be transformed with the dequantization matrix (returned by packPNUV) before
+ * the model matrix. Normals are not affected by the dequantization.
+ */
+class rVertexPacker {
+ public:
+  struct PackedPNUV {
+    uint16_t pos[4];
+    int16_t  normal[2];
+    uint16_t uv[2];
+  };
+
+  static_assert(sizeof(PackedPNUV) == 16, "Unexpected padding in PackedPNUV");
+
+  static glm::mat4 packPNUV(std::vector<float> const &_data, rAABB const &_bounds, std::vector<PackedPNUV> &_out);
+  static bool      packIndex16(std::vector<uint32_t> const &_index, std::vector<uint16_t> &_out);
+
+  static glm::vec2 octEncode(glm::vec3 _n);
+  static glm::vec3 octDecode(glm::vec2 _e);
+
+  static std::vector<VkFormat> getPNUVFormats();
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
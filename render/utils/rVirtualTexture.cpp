@@ -0,0 +1,1122 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rVirtualTexture.hpp"
+#include "rShaderBase.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "uThreadPool.hpp"
+#include "vkuBarriers.hpp"
+#include "rWorld.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string.h>
+
+namespace e_engine {
+
+namespace {
+
+const uint32_t MAX_LEVELS = 16;             //!< 4 bits of the page ID
+const uint32_t MAX_PAGES  = 1 << 14;        //!< Pages per row / column of a level (14 bits of the page ID)
+const uint32_t TAIL_SLOT  = UINT32_MAX - 1; //!< Slot of the pages in the mip tail (sparse mode)
+
+inline uint32_t pageLevel(uint32_t _id) { return _id >> 28; }
+inline uint32_t pageX(uint32_t _id) { return _id & (MAX_PAGES - 1); }
+inline uint32_t pageY(uint32_t _id) { return (_id >> 14) & (MAX_PAGES - 1); }
+
+inline uint32_t nextPowerOfTwo(uint32_t _val) {
+  uint32_t lRes = 1;
+  while (lRes < _val)
+    lRes <<= 1;
+
+  return lRes;
+}
+
+bool isSupportedFormat(VkFormat _format) {
+  switch (_format) {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_R16G16_UNORM:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT: return true;
+    default: return false;
+  }
+}
+} // namespace
+
+const std::string rVirtualTexture::SAMPLER_NAME = "uVirtualTexture";
+const std::string rVirtualTexture::TABLE_NAME   = "uPageTable";
+const std::string rVirtualTexture::BLOCK_NAME   = "VTFeedback";
+
+rVirtualTexture::rVirtualTexture(vkuDevicePTR _device)
+    : vDevice(_device), vTransfer(_device), vAtlas(_device), vPageTable(_device) {}
+
+rVirtualTexture::~rVirtualTexture() { destroy(); }
+
+/*!
+ * \brief Returns the ID of a page (as written into the feedback buffer)
+ *
+ * Bits 28 - 31: level, bits 14 - 27: row, bits 0 - 13: column
+ */
+uint32_t rVirtualTexture::packPageID(uint32_t _level, uint32_t _x, uint32_t _y) noexcept {
+  return (_level << 28) | ((_y & (MAX_PAGES - 1)) << 14) | (_x & (MAX_PAGES - 1));
+}
+
+//! \brief Size of one page in the staging buffer (with the border)
+VkDeviceSize rVirtualTexture::getPageBytes() const noexcept {
+  VkDeviceSize lStride = vPageSize + 2 * vBorder;
+  return lStride * lStride * 4;
+}
+
+rVirtualTexture::Page &rVirtualTexture::getPage(uint32_t _id) {
+  Level &lLevel = vLevels[pageLevel(_id)];
+  return lLevel.pages[pageY(_id) * lLevel.pagesX + pageX(_id)];
+}
+
+//! \brief Checks whether the page exists and contains texels of the virtual texture
+bool rVirtualTexture::isValidPage(uint32_t _id) const noexcept {
+  if (pageLevel(_id) >= vLevels.size())
+    return false;
+
+  Level const &lLevel = vLevels[pageLevel(_id)];
+  return pageX(_id) * vPageSize < lLevel.width && pageY(_id) * vPageSize < lLevel.height;
+}
+
+/*!
+ * \brief Creates the images and loads the coarsest level
+ *
+ * \param _width  Width of level 0 of the virtual texture
+ * \param _height Height of level 0 of the virtual texture
+ * \param _source Loads the pages (must be thread safe)
+ *
+ * \note Changes of the config take effect here
+ * \note Call this before the texture is used by a renderer
+ */
+VkResult rVirtualTexture::init(uint32_t _width, uint32_t _height, PageSource _source) {
+  if (isCreated()) {
+    eLOG(L"Virtual texture already created");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (!vDevice || !*vDevice || !_source || _width == 0 || _height == 0 || cfg.pageSize == 0) {
+    eLOG(L"Invalid virtual texture parameters");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (!isSupportedFormat(cfg.format)) {
+    eLOG(L"Format ", uEnum2Str::toStr(cfg.format), L" not supported for virtual textures");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  vWidth          = _width;
+  vHeight         = _height;
+  vFeedbackFrames = std::max(cfg.feedbackFrames, 1u);
+  vFeedbackSize   = cfg.feedbackSize;
+  vUpdates        = 0;
+
+  VkResult lRes = VK_ERROR_FEATURE_NOT_PRESENT;
+  if (cfg.allowSparse && vDevice->hasSparseResidency()) {
+    lRes = initSparse();
+    if (lRes != VK_SUCCESS)
+      destroy();
+  }
+
+  if (lRes != VK_SUCCESS)
+    lRes = initSoftware();
+
+  vSource = _source;
+
+  if (lRes == VK_SUCCESS)
+    lRes = initCommon();
+
+  if (lRes != VK_SUCCESS)
+    destroy();
+
+  return lRes;
+}
+
+/*!
+ * \brief Computes the levels for vPageSize
+ *
+ * The number of pages of level 0 is rounded up to a power of two, so that every level has half the
+ * pages of the previous one (like the levels of the page table image).
+ */
+bool rVirtualTexture::setupLevels() {
+  uint32_t lPagesX = nextPowerOfTwo((vWidth + vPageSize - 1) / vPageSize);
+  uint32_t lPagesY = nextPowerOfTwo((vHeight + vPageSize - 1) / vPageSize);
+
+  if (lPagesX > MAX_PAGES || lPagesY > MAX_PAGES) {
+    eLOG(L"Virtual texture ", vWidth, L'x', vHeight, L" has too many pages of size ", vPageSize);
+    return false;
+  }
+
+  vLevels.clear();
+  VkDeviceSize lTableSize = 0;
+
+  for (uint32_t i = 0; i < MAX_LEVELS; ++i) {
+    Level lLevel;
+    lLevel.width       = std::max(vWidth >> i, 1u);
+    lLevel.height      = std::max(vHeight >> i, 1u);
+    lLevel.pagesX      = std::max(lPagesX >> i, 1u);
+    lLevel.pagesY      = std::max(lPagesY >> i, 1u);
+    lLevel.tableOffset = lTableSize;
+    lLevel.pages.resize(lLevel.pagesX * lLevel.pagesY);
+
+    lTableSize += lLevel.pages.size();
+    vLevels.emplace_back(std::move(lLevel));
+
+    if (vLevels.back().pages.size() == 1)
+      break;
+  }
+
+  if (vLevels.back().pages.size() != 1) {
+    eLOG(L"Virtual texture needs more than ", MAX_LEVELS, L" levels");
+    vLevels.clear();
+    return false;
+  }
+
+  vTable.assign(static_cast<size_t>(lTableSize) * 4, 0);
+  return true;
+}
+
+/*!
+ * \brief Creates the partially resident image and binds its mip tail
+ *
+ * The page size is the sparse block size of the format. Falls back to the software page table if the
+ * texture is too large for one image or the format can not be sparse resident.
+ */
+VkResult rVirtualTexture::initSparse() {
+  auto const &lLimits = vDevice->getProperties().limits;
+  if (vWidth > lLimits.maxImageDimension2D || vHeight > lLimits.maxImageDimension2D) {
+    iLOG(L"Virtual texture is larger than the maximum image size ==> using the software page table");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  VkImageUsageFlags lUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+  uint32_t lNumProps = 0;
+  vkGetPhysicalDeviceSparseImageFormatProperties(vDevice->getPhysicalDevice(),
+                                                 cfg.format,
+                                                 VK_IMAGE_TYPE_2D,
+                                                 VK_SAMPLE_COUNT_1_BIT,
+                                                 lUsage,
+                                                 VK_IMAGE_TILING_OPTIMAL,
+                                                 &lNumProps,
+                                                 nullptr);
+
+  std::vector<VkSparseImageFormatProperties> lProps(lNumProps);
+  vkGetPhysicalDeviceSparseImageFormatProperties(vDevice->getPhysicalDevice(),
+                                                 cfg.format,
+                                                 VK_IMAGE_TYPE_2D,
+                                                 VK_SAMPLE_COUNT_1_BIT,
+                                                 lUsage,
+                                                 VK_IMAGE_TILING_OPTIMAL,
+                                                 &lNumProps,
+                                                 lProps.data());
+
+  auto lColor = std::find_if(lProps.begin(), lProps.end(), [](VkSparseImageFormatProperties const &i) {
+    return (i.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) != 0;
+  });
+
+  if (lColor == lProps.end() || lColor->imageGranularity.width != lColor->imageGranularity.height) {
+    iLOG(L"Format ", uEnum2Str::toStr(cfg.format), L" can not be sparse resident ==> using the software page table");
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
+
+  vIsSparse = true;
+  vPageSize = lColor->imageGranularity.width;
+  vBorder   = 0;
+
+  if (!setupLevels())
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  VkImageCreateInfo lImageInfo     = {};
+  lImageInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  lImageInfo.pNext                 = nullptr;
+  lImageInfo.flags                 = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+  lImageInfo.imageType             = VK_IMAGE_TYPE_2D;
+  lImageInfo.format                = cfg.format;
+  lImageInfo.extent                = {vWidth, vHeight, 1};
+  lImageInfo.mipLevels             = getNumLevels();
+  lImageInfo.arrayLayers           = 1;
+  lImageInfo.samples               = VK_SAMPLE_COUNT_1_BIT;
+  lImageInfo.tiling                = VK_IMAGE_TILING_OPTIMAL;
+  lImageInfo.usage                 = lUsage;
+  lImageInfo.sharingMode           = VK_SHARING_MODE_EXCLUSIVE;
+  lImageInfo.queueFamilyIndexCount = 0;
+  lImageInfo.pQueueFamilyIndices   = nullptr;
+  lImageInfo.initialLayout         = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  VkResult lRes = vkCreateImage(**vDevice, &lImageInfo, nullptr, &vSparseImage);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"'vkCreateImage' returned ", uEnum2Str::toStr(lRes));
+    vSparseImage = VK_NULL_HANDLE;
+    return lRes;
+  }
+
+  VkMemoryRequirements lReqs;
+  vkGetImageMemoryRequirements(**vDevice, vSparseImage, &lReqs);
+
+  uint32_t lNumSparseReqs = 0;
+  vkGetImageSparseMemoryRequirements(**vDevice, vSparseImage, &lNumSparseReqs, nullptr);
+  std::vector<VkSparseImageMemoryRequirements> lSparseReqs(lNumSparseReqs);
+  vkGetImageSparseMemoryRequirements(**vDevice, vSparseImage, &lNumSparseReqs, lSparseReqs.data());
+
+  VkSparseImageMemoryRequirements const *lTail = nullptr;
+  for (auto const &i : lSparseReqs) {
+    if (i.formatProperties.aspectMask & VK_IMAGE_ASPECT_METADATA_BIT) {
+      iLOG(L"Sparse image needs metadata ==> using the software page table");
+      return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+
+    if (i.formatProperties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT)
+      lTail = &i;
+  }
+
+  if (!lTail) {
+    eLOG(L"No sparse memory requirements for the color aspect");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  uint32_t lType = vDevice->getMemoryTypeIndex(lReqs, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (lType == UINT32_MAX) {
+    eLOG(L"Unable to find memory type");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  vPageMemorySize = lReqs.alignment;
+  vTailFirstLevel = lTail->imageMipTailFirstLod;
+  vTailSize       = vTailFirstLevel < getNumLevels() ? lTail->imageMipTailSize : 0;
+  vSlots.assign(std::max(cfg.cachePages, 1u), UINT32_MAX);
+
+  VkMemoryAllocateInfo lAllocInfo = {};
+  lAllocInfo.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  lAllocInfo.pNext                = nullptr;
+  lAllocInfo.allocationSize       = vPageMemorySize * vSlots.size();
+  lAllocInfo.memoryTypeIndex      = lType;
+
+  lRes = vkAllocateMemory(**vDevice, &lAllocInfo, nullptr, &vPageMemory);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"'vkAllocateMemory' returned ", uEnum2Str::toStr(lRes));
+    vPageMemory = VK_NULL_HANDLE;
+    return lRes;
+  }
+
+  vSparseQueue = vDevice->getQueue(VK_QUEUE_SPARSE_BINDING_BIT, 1.0f);
+  if (!vSparseQueue) {
+    eLOG(L"No queue for sparse binding");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+
+  // The mip tail is always resident
+  if (vTailSize > 0) {
+    lAllocInfo.allocationSize = vTailSize;
+
+    lRes = vkAllocateMemory(**vDevice, &lAllocInfo, nullptr, &vTailMemory);
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"'vkAllocateMemory' returned ", uEnum2Str::toStr(lRes));
+      vTailMemory = VK_NULL_HANDLE;
+      return lRes;
+    }
+
+    VkSparseMemoryBind lTailBind;
+    lTailBind.resourceOffset = lTail->imageMipTailOffset;
+    lTailBind.size           = vTailSize;
+    lTailBind.memory         = vTailMemory;
+    lTailBind.memoryOffset   = 0;
+    lTailBind.flags          = 0;
+
+    VkSparseImageOpaqueMemoryBindInfo lOpaque;
+    lOpaque.image     = vSparseImage;
+    lOpaque.bindCount = 1;
+    lOpaque.pBinds    = &lTailBind;
+
+    VkBindSparseInfo lBindInfo     = {};
+    lBindInfo.sType                = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    lBindInfo.pNext                = nullptr;
+    lBindInfo.imageOpaqueBindCount = 1;
+    lBindInfo.pImageOpaqueBinds    = &lOpaque;
+
+    std::lock_guard<std::mutex> lLock(vDevice->getQueueMutex(vSparseQueue));
+    lRes = vkQueueBindSparse(vSparseQueue, 1, &lBindInfo, VK_NULL_HANDLE);
+    if (lRes == VK_SUCCESS)
+      lRes = vkQueueWaitIdle(vSparseQueue);
+
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"'vkQueueBindSparse' returned ", uEnum2Str::toStr(lRes));
+      return lRes;
+    }
+  }
+
+  VkImageViewCreateInfo lViewInfo = {};
+  lViewInfo.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  lViewInfo.pNext                 = nullptr;
+  lViewInfo.flags                 = 0;
+  lViewInfo.image                 = vSparseImage;
+  lViewInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+  lViewInfo.format                = cfg.format;
+  lViewInfo.components            = {VK_COMPONENT_SWIZZLE_IDENTITY,
+                          VK_COMPONENT_SWIZZLE_IDENTITY,
+                          VK_COMPONENT_SWIZZLE_IDENTITY,
+                          VK_COMPONENT_SWIZZLE_IDENTITY};
+  lViewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, getNumLevels(), 0, 1};
+
+  lRes = vkCreateImageView(**vDevice, &lViewInfo, nullptr, &vSparseView);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"'vkCreateImageView' returned ", uEnum2Str::toStr(lRes));
+    vSparseView = VK_NULL_HANDLE;
+    return lRes;
+  }
+
+  iLOG(L"Virtual texture ", vWidth, L'x', vHeight, L" uses sparse residency (page size ", vPageSize, L")");
+  return VK_SUCCESS;
+}
+
+//! \brief Creates the physical page atlas
+VkResult rVirtualTexture::initSoftware() {
+  vIsSparse = false;
+  vPageSize = cfg.pageSize;
+  vBorder   = cfg.border;
+
+  if (!setupLevels())
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  // The page table stores the atlas position in 8 bit
+  uint32_t lStride   = vPageSize + 2 * vBorder;
+  uint32_t lMaxPages = std::min(vDevice->getProperties().limits.maxImageDimension2D / lStride, 256u);
+
+  vAtlasPages = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(std::max(cfg.cachePages, 1u)))));
+  vAtlasPages = std::min(vAtlasPages, lMaxPages);
+
+  if (vAtlasPages == 0) {
+    eLOG(L"Page size ", vPageSize, L" is larger than the maximum image size");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  vSlots.assign(vAtlasPages * vAtlasPages, UINT32_MAX);
+
+  vAtlas->type             = VK_IMAGE_TYPE_2D;
+  vAtlas->format           = cfg.format;
+  vAtlas->extent           = {vAtlasPages * lStride, vAtlasPages * lStride, 1};
+  vAtlas->mipLevels        = 1;
+  vAtlas->usage            = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  vAtlas->subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  VkResult lRes = vAtlas.init(vDevice);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create the page atlas: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  iLOG(L"Virtual texture ", vWidth, L'x', vHeight, L" uses a ", vAtlasPages, L'x', vAtlasPages, L" page atlas");
+  return VK_SUCCESS;
+}
+
+//! \brief Creates the page table, staging / feedback buffers and samplers and loads the pinned pages
+VkResult rVirtualTexture::initCommon() {
+  uint32_t lNumLevels = getNumLevels();
+
+  vPageTable->type             = VK_IMAGE_TYPE_2D;
+  vPageTable->format           = VK_FORMAT_R8G8B8A8_UINT;
+  vPageTable->extent           = {vLevels[0].pagesX, vLevels[0].pagesY, 1};
+  vPageTable->mipLevels        = lNumLevels;
+  vPageTable->usage            = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  vPageTable->subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, lNumLevels, 0, 1};
+
+  VkResult lRes = vPageTable.init(vDevice);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create the page table: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  // The mip tail (sparse) or the coarsest page are always resident
+  std::vector<uint32_t> lPinned;
+  for (uint32_t i = std::min(vTailFirstLevel, lNumLevels - 1); i < lNumLevels; ++i)
+    for (uint32_t y = 0; y < vLevels[i].pagesY; ++y)
+      for (uint32_t x = 0; x < vLevels[i].pagesX; ++x)
+        if (isValidPage(packPageID(i, x, y)))
+          lPinned.push_back(packPageID(i, x, y));
+
+  size_t lStagingPages = std::max<size_t>(cfg.maxUploads, lPinned.size());
+
+  vStaging.reset(new vkuBuffer(vDevice));
+  (*vStaging)->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  (*vStaging)->usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+  lRes = vStaging->init(lStagingPages * getPageBytes() + vTable.size());
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create the staging buffer: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  vFeedback.reset(new vkuBuffer(vDevice));
+  (*vFeedback)->memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  (*vFeedback)->usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+  lRes = vFeedback->init(getFeedbackOffset(vFeedbackFrames));
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create the feedback buffer: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  {
+    auto lAccess = vFeedback->getBufferAccess();
+    if (lAccess) {
+      memset(*lAccess, 0, lAccess.size());
+
+      FeedbackHeader lHeader;
+      lHeader.slot         = getFeedbackSlot();
+      lHeader.feedbackSize = vFeedbackSize;
+      lHeader.width        = vWidth;
+      lHeader.height       = vHeight;
+      lHeader.pageSize     = vPageSize;
+      lHeader.border       = vBorder;
+      lHeader.atlasPages   = vAtlasPages;
+      lHeader.sparse       = vIsSparse ? 1 : 0;
+      memcpy(*lAccess, &lHeader, sizeof(lHeader));
+    }
+  }
+
+  // The atlas has no mip levels (the shader selects the level with the page table)
+  VkSamplerCreateInfo lSampler     = {};
+  lSampler.sType                   = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  lSampler.pNext                   = nullptr;
+  lSampler.flags                   = 0;
+  lSampler.magFilter               = VK_FILTER_LINEAR;
+  lSampler.minFilter               = VK_FILTER_LINEAR;
+  lSampler.mipmapMode              = vIsSparse ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  lSampler.addressModeU            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSampler.addressModeV            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSampler.addressModeW            = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  lSampler.mipLodBias              = 0.0f;
+  lSampler.anisotropyEnable        = VK_FALSE;
+  lSampler.maxAnisotropy           = 1.0f;
+  lSampler.compareEnable           = VK_FALSE;
+  lSampler.compareOp               = VK_COMPARE_OP_NEVER;
+  lSampler.minLod                  = 0.0f;
+  lSampler.maxLod                  = vIsSparse ? VK_LOD_CLAMP_NONE : 0.0f;
+  lSampler.borderColor             = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+  lSampler.unnormalizedCoordinates = VK_FALSE;
+
+  vSampler = vDevice->getSampler(lSampler);
+
+  lSampler.magFilter  = VK_FILTER_NEAREST;
+  lSampler.minFilter  = VK_FILTER_NEAREST;
+  lSampler.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  lSampler.maxLod     = VK_LOD_CLAMP_NONE;
+
+  vTableSampler = vDevice->getSampler(lSampler);
+
+  if (!vSampler || !vTableSampler)
+    return VK_ERROR_INITIALIZATION_FAILED;
+
+  for (auto i : lPinned)
+    startLoad(i);
+
+  std::vector<Upload>   lUploads;
+  std::vector<uint32_t> lEvicted;
+
+  for (auto &i : vLoads) {
+    Upload lUpload;
+    lUpload.id   = i.id;
+    lUpload.data = i.data.get();
+
+    Page &lPage   = getPage(i.id);
+    lPage.loading = false;
+    lPage.pinned  = true;
+
+    if (!lUpload.data) {
+      eLOG(L"Failed to load page ", pageX(i.id), L", ", pageY(i.id), L" of level ", pageLevel(i.id));
+      vLoads.clear();
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if (pageLevel(i.id) >= vTailFirstLevel) {
+      lPage.slot = TAIL_SLOT;
+    } else {
+      lPage.slot         = allocateSlot(lEvicted);
+      vSlots[lPage.slot] = i.id;
+    }
+
+    lUploads.emplace_back(std::move(lUpload));
+  }
+
+  vLoads.clear();
+  return commitPages(lUploads, lEvicted, true);
+}
+
+//! \brief Waits for the running loads and destroys all resources
+void rVirtualTexture::destroy() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  for (auto &i : vLoads)
+    i.data.wait();
+
+  vLoads.clear();
+  vRequests.clear();
+  vLevels.clear();
+  vSlots.clear();
+  vTable.clear();
+
+  vAtlas.destroy();
+  vPageTable.destroy();
+  vStaging.reset();
+  vFeedback.reset();
+
+  if (vSparseView)
+    vkDestroyImageView(**vDevice, vSparseView, nullptr);
+
+  if (vSparseImage)
+    vkDestroyImage(**vDevice, vSparseImage, nullptr);
+
+  if (vPageMemory)
+    vkFreeMemory(**vDevice, vPageMemory, nullptr);
+
+  if (vTailMemory)
+    vkFreeMemory(**vDevice, vTailMemory, nullptr);
+
+  vSparseView     = VK_NULL_HANDLE;
+  vSparseImage    = VK_NULL_HANDLE;
+  vPageMemory     = VK_NULL_HANDLE;
+  vTailMemory     = VK_NULL_HANDLE;
+  vPageMemorySize = 0;
+  vTailSize       = 0;
+  vTailFirstLevel = UINT32_MAX;
+  vSparseQueue    = VK_NULL_HANDLE;
+  vSampler        = VK_NULL_HANDLE;
+  vTableSampler   = VK_NULL_HANDLE;
+  vIsSparse       = false;
+  vAtlasPages     = 0;
+}
+
+//! \brief Requests page _x, _y of _level (its coarser pages are kept resident too)
+void rVirtualTexture::requestPage(uint32_t _level, uint32_t _x, uint32_t _y) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (_x >= MAX_PAGES || _y >= MAX_PAGES)
+    return;
+
+  uint32_t lID = packPageID(_level, _x, _y);
+  if (isValidPage(lID))
+    vRequests.push_back(lID);
+}
+
+/*!
+ * \brief Requests all pages of _level in the texture coordinate range _u0, _v0 to _u1, _v1
+ */
+void rVirtualTexture::requestRegion(uint32_t _level, float _u0, float _v0, float _u1, float _v1) {
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (_level >= vLevels.size())
+    return;
+
+  Level const &lLevel = vLevels[_level];
+
+  auto lToPage = [this](float _coord, uint32_t _size) {
+    float lPage = std::floor(std::min(std::max(_coord, 0.0f), 1.0f) * _size / vPageSize);
+    return std::min(static_cast<uint32_t>(lPage), (_size - 1) / vPageSize);
+  };
+
+  uint32_t lX0 = lToPage(std::min(_u0, _u1), lLevel.width);
+  uint32_t lX1 = lToPage(std::max(_u0, _u1), lLevel.width);
+  uint32_t lY0 = lToPage(std::min(_v0, _v1), lLevel.height);
+  uint32_t lY1 = lToPage(std::max(_v0, _v1), lLevel.height);
+
+  for (uint32_t y = lY0; y <= lY1; ++y)
+    for (uint32_t x = lX0; x <= lX1; ++x)
+      vRequests.push_back(packPageID(_level, x, y));
+}
+
+/*!
+ * \brief Moves the page IDs of the oldest feedback slot to vRequests and resets the slot
+ *
+ * The shaders write into the reset slot from now on (FeedbackHeader::slot).
+ */
+void rVirtualTexture::readFeedback() {
+  auto lAccess = vFeedback->getBufferAccess();
+  if (!lAccess)
+    return;
+
+  uint32_t  lSlot = (getFeedbackSlot() + 1) % vFeedbackFrames;
+  uint32_t *lData = reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(*lAccess) + getFeedbackOffset(lSlot));
+
+  uint32_t lCount = std::min(lData[0], vFeedbackSize);
+  for (uint32_t i = 1; i <= lCount; ++i)
+    if (isValidPage(lData[i]))
+      vRequests.push_back(lData[i]);
+
+  lData[0] = 0;
+  reinterpret_cast<FeedbackHeader *>(static_cast<uint8_t *>(*lAccess))->slot = lSlot;
+}
+
+//! \brief Loads a page with the source on the engine thread pool
+void rVirtualTexture::startLoad(uint32_t _id) {
+  getPage(_id).loading = true;
+
+  PageSource lSource = vSource;
+  uint32_t   lLevel  = pageLevel(_id);
+  uint32_t   lX      = pageX(_id);
+  uint32_t   lY      = pageY(_id);
+  uint32_t   lBorder = vBorder;
+  size_t     lBytes  = static_cast<size_t>(getPageBytes());
+
+  Load lLoad;
+  lLoad.id   = _id;
+  lLoad.data = uThreadPool::getPool().add([lSource, lLevel, lX, lY, lBorder, lBytes]() {
+    auto lData = std::make_shared<std::vector<uint8_t>>(lBytes);
+    if (!lSource(lLevel, lX, lY, lBorder, lData->data()))
+      return std::shared_ptr<std::vector<uint8_t>>();
+
+    return lData;
+  });
+
+  vLoads.emplace_back(std::move(lLoad));
+}
+
+/*!
+ * \brief Returns a free cache slot or evicts the least recently used page that was not requested in this update
+ * \param[out] _evicted The ID of the evicted page is added
+ * \returns UINT32_MAX if all pages are in use
+ */
+uint32_t rVirtualTexture::allocateSlot(std::vector<uint32_t> &_evicted) {
+  uint32_t lBest     = UINT32_MAX;
+  uint64_t lBestUsed = vUpdates;
+
+  for (uint32_t i = 0; i < vSlots.size(); ++i) {
+    if (vSlots[i] == UINT32_MAX)
+      return i;
+
+    Page const &lPage = getPage(vSlots[i]);
+    if (!lPage.pinned && lPage.lastUsed < lBestUsed) {
+      lBest     = i;
+      lBestUsed = lPage.lastUsed;
+    }
+  }
+
+  if (lBest == UINT32_MAX)
+    return UINT32_MAX;
+
+  getPage(vSlots[lBest]).slot = UINT32_MAX;
+  _evicted.push_back(vSlots[lBest]);
+  vSlots[lBest] = UINT32_MAX;
+  return lBest;
+}
+
+//! \brief Points every page table entry to the most detailed resident page that covers it
+void rVirtualTexture::rebuildPageTable() {
+  for (uint32_t i = getNumLevels(); i-- > 0;) {
+    Level const &lLevel = vLevels[i];
+    uint8_t *    lDst   = vTable.data() + lLevel.tableOffset * 4;
+
+    for (uint32_t y = 0; y < lLevel.pagesY; ++y) {
+      for (uint32_t x = 0; x < lLevel.pagesX; ++x) {
+        uint32_t lSlot  = lLevel.pages[y * lLevel.pagesX + x].slot;
+        uint8_t *lEntry = lDst + (y * lLevel.pagesX + x) * 4;
+
+        if (lSlot != UINT32_MAX) {
+          bool lInAtlas = !vIsSparse && lSlot != TAIL_SLOT;
+          lEntry[0]     = static_cast<uint8_t>(lInAtlas ? lSlot % vAtlasPages : 0);
+          lEntry[1]     = static_cast<uint8_t>(lInAtlas ? lSlot / vAtlasPages : 0);
+          lEntry[2]     = static_cast<uint8_t>(i);
+          lEntry[3]     = 1;
+        } else if (i + 1 < getNumLevels()) {
+          // The coarser level is already done
+          Level const &lParent = vLevels[i + 1];
+          uint32_t     lPX     = std::min(x / 2, lParent.pagesX - 1);
+          uint32_t     lPY     = std::min(y / 2, lParent.pagesY - 1);
+          memcpy(lEntry, vTable.data() + (lParent.tableOffset + lPY * lParent.pagesX + lPX) * 4, 4);
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Binds the memory of the cache slots to the uploaded pages and unbinds the evicted pages
+ */
+VkResult rVirtualTexture::bindSparsePages(std::vector<Upload> const &_uploads, std::vector<uint32_t> const &_evicted) {
+  auto lBind = [this](uint32_t _id, VkDeviceMemory _mem, uint32_t _slot) {
+    Level const &lLevel = vLevels[pageLevel(_id)];
+    uint32_t     lX     = pageX(_id) * vPageSize;
+    uint32_t     lY     = pageY(_id) * vPageSize;
+
+    VkSparseImageMemoryBind lBind;
+    lBind.subresource  = {VK_IMAGE_ASPECT_COLOR_BIT, pageLevel(_id), 0};
+    lBind.offset       = {static_cast<int32_t>(lX), static_cast<int32_t>(lY), 0};
+    lBind.extent       = {std::min(vPageSize, lLevel.width - lX), std::min(vPageSize, lLevel.height - lY), 1};
+    lBind.memory       = _mem;
+    lBind.memoryOffset = _mem ? _slot * vPageMemorySize : 0;
+    lBind.flags        = 0;
+    return lBind;
+  };
+
+  std::vector<VkSparseImageMemoryBind> lUnbinds;
+  std::vector<VkSparseImageMemoryBind> lBinds;
+
+  for (auto i : _evicted)
+    lUnbinds.push_back(lBind(i, VK_NULL_HANDLE, 0));
+
+  for (auto const &i : _uploads) {
+    uint32_t lSlot = getPage(i.id).slot;
+    if (lSlot != TAIL_SLOT)
+      lBinds.push_back(lBind(i.id, vPageMemory, lSlot));
+  }
+
+  // The evicted pages are unbound first, so that no memory is bound twice
+  for (auto *lList : {&lUnbinds, &lBinds}) {
+    if (lList->empty())
+      continue;
+
+    VkSparseImageMemoryBindInfo lImageBinds;
+    lImageBinds.image     = vSparseImage;
+    lImageBinds.bindCount = static_cast<uint32_t>(lList->size());
+    lImageBinds.pBinds    = lList->data();
+
+    VkBindSparseInfo lInfo = {};
+    lInfo.sType            = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    lInfo.pNext            = nullptr;
+    lInfo.imageBindCount   = 1;
+    lInfo.pImageBinds      = &lImageBinds;
+
+    std::lock_guard<std::mutex> lLock(vDevice->getQueueMutex(vSparseQueue));
+    VkResult                    lRes = vkQueueBindSparse(vSparseQueue, 1, &lInfo, VK_NULL_HANDLE);
+    if (lRes == VK_SUCCESS)
+      lRes = vkQueueWaitIdle(vSparseQueue);
+
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"'vkQueueBindSparse' returned ", uEnum2Str::toStr(lRes));
+      return lRes;
+    }
+  }
+
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Copies the uploaded pages and the page table into the images
+ *
+ * The images are only used on the graphics queue family, so all commands are recorded there
+ * (vkuTransfer::addDstCommands).
+ *
+ * \param _first The images have no content yet
+ * \note No frame may use the texture (rWorld::runWhileIdle)
+ */
+VkResult rVirtualTexture::commitPages(std::vector<Upload> const &  _uploads,
+                                      std::vector<uint32_t> const &_evicted,
+                                      bool                         _first) {
+  if (vIsSparse) {
+    VkResult lRes = bindSparsePages(_uploads, _evicted);
+    if (lRes != VK_SUCCESS)
+      return lRes;
+  }
+
+  rebuildPageTable();
+
+  auto lAccess = vStaging->getBufferAccess();
+  if (!lAccess) {
+    eLOG(L"Failed to map the staging buffer");
+    return VK_ERROR_MEMORY_MAP_FAILED;
+  }
+
+  uint8_t *    lDst       = static_cast<uint8_t *>(*lAccess);
+  VkDeviceSize lPageBytes = getPageBytes();
+  uint32_t     lStride    = vPageSize + 2 * vBorder;
+
+  std::vector<VkBufferImageCopy> lPageCopies;
+  std::vector<VkBufferImageCopy> lTableCopies;
+
+  for (size_t i = 0; i < _uploads.size(); ++i) {
+    uint32_t     lID     = _uploads[i].id;
+    VkDeviceSize lOffset = i * lPageBytes;
+    memcpy(lDst + lOffset, _uploads[i].data->data(), static_cast<size_t>(lPageBytes));
+
+    VkBufferImageCopy lRegion = {};
+    lRegion.bufferOffset      = lOffset;
+    lRegion.bufferRowLength   = lStride;
+    lRegion.bufferImageHeight = lStride;
+    lRegion.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+
+    if (vIsSparse) {
+      Level const &lLevel = vLevels[pageLevel(lID)];
+      uint32_t     lX     = pageX(lID) * vPageSize;
+      uint32_t     lY     = pageY(lID) * vPageSize;
+
+      lRegion.imageSubresource.mipLevel = pageLevel(lID);
+      lRegion.imageOffset               = {static_cast<int32_t>(lX), static_cast<int32_t>(lY), 0};
+      lRegion.imageExtent = {std::min(vPageSize, lLevel.width - lX), std::min(vPageSize, lLevel.height - lY), 1};
+    } else {
+      uint32_t lSlot      = getPage(lID).slot;
+      int32_t  lX         = static_cast<int32_t>((lSlot % vAtlasPages) * lStride);
+      int32_t  lY         = static_cast<int32_t>((lSlot / vAtlasPages) * lStride);
+      lRegion.imageOffset = {lX, lY, 0};
+      lRegion.imageExtent = {lStride, lStride, 1};
+    }
+
+    lPageCopies.push_back(lRegion);
+  }
+
+  // The whole page table is uploaded (one texel per page)
+  VkDeviceSize lTableOffset = _uploads.size() * lPageBytes;
+  memcpy(lDst + lTableOffset, vTable.data(), vTable.size());
+
+  for (uint32_t i = 0; i < getNumLevels(); ++i) {
+    VkBufferImageCopy lRegion = {};
+    lRegion.bufferOffset      = lTableOffset + vLevels[i].tableOffset * 4;
+    lRegion.imageSubresource  = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+    lRegion.imageOffset       = {0, 0, 0};
+    lRegion.imageExtent       = {vLevels[i].pagesX, vLevels[i].pagesY, 1};
+    lTableCopies.push_back(lRegion);
+  }
+
+  VkImage                 lImage      = vIsSparse ? vSparseImage : vAtlas.getImage();
+  VkImage                 lTable      = vPageTable.getImage();
+  VkBuffer                lStaging    = **vStaging;
+  VkImageLayout           lOldLayout  = _first ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  VkImageSubresourceRange lImageRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, vIsSparse ? getNumLevels() : 1, 0, 1};
+  VkImageSubresourceRange lTableRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, getNumLevels(), 0, 1};
+
+  VkResult lRes = vTransfer.begin();
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  vTransfer.addDstCommands([=](VkCommandBuffer _buf) {
+    vkuBarriers lBarriers;
+    lBarriers.addImage(lImage, lImageRange, lOldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    lBarriers.addImage(lTable, lTableRange, lOldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    lBarriers.cmdRecord(_buf);
+
+    if (!lPageCopies.empty())
+      vkCmdCopyBufferToImage(_buf,
+                             lStaging,
+                             lImage,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             static_cast<uint32_t>(lPageCopies.size()),
+                             lPageCopies.data());
+
+    vkCmdCopyBufferToImage(_buf,
+                           lStaging,
+                           lTable,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(lTableCopies.size()),
+                           lTableCopies.data());
+
+    lBarriers.clear();
+    lBarriers.addImage(
+        lImage, lImageRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    lBarriers.addImage(
+        lTable, lTableRange, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    lBarriers.cmdRecord(_buf);
+  });
+
+  lRes = vTransfer.submit();
+  if (lRes == VK_SUCCESS)
+    lRes = vTransfer.wait();
+
+  if (lRes != VK_SUCCESS)
+    eLOG(L"Failed to upload the virtual texture pages: ", uEnum2Str::toStr(lRes));
+
+  return lRes;
+}
+
+/*!
+ * \brief Starts loading the requested pages and swaps in the loaded ones
+ *
+ * Call this once per frame (not from the render loop thread). Coarse pages are loaded first. The
+ * pages are copied (and bound) with rWorld::runWhileIdle, pages that were not requested for the
+ * longest time are evicted if the cache is full.
+ *
+ * \returns true if pages changed
+ */
+bool rVirtualTexture::update(rWorld *_world) {
+  if (!_world) {
+    eLOG(L"Invalid world");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lLock(vMutex);
+
+  if (!isCreated())
+    return false;
+
+  readFeedback();
+  vUpdates++;
+
+  // Coarse levels first (the level is stored in the high bits)
+  std::sort(vRequests.begin(), vRequests.end(), [](uint32_t a, uint32_t b) { return a > b; });
+  vRequests.erase(std::unique(vRequests.begin(), vRequests.end()), vRequests.end());
+
+  for (auto i : vRequests) {
+    // Also keep the coarser pages (fallback of the page table)
+    for (uint32_t lLevel = pageLevel(i), lX = pageX(i), lY = pageY(i); lLevel < getNumLevels(); ++lLevel) {
+      uint32_t lID   = packPageID(lLevel, lX, lY);
+      Page &   lPage = getPage(lID);
+
+      lPage.lastUsed = vUpdates;
+      if (lPage.slot == UINT32_MAX && !lPage.loading && !lPage.failed && vLoads.size() < cfg.maxLoads)
+        startLoad(lID);
+
+      // Rounding of odd level sizes can move the parent outside of the coarser level
+      if (lLevel + 1 < getNumLevels()) {
+        lX = std::min(lX / 2, (vLevels[lLevel + 1].width - 1) / vPageSize);
+        lY = std::min(lY / 2, (vLevels[lLevel + 1].height - 1) / vPageSize);
+      }
+    }
+  }
+
+  vRequests.clear();
+
+  // Finished loads
+  std::vector<Upload> lUploads;
+  for (auto lIter = vLoads.begin(); lIter != vLoads.end() && lUploads.size() < cfg.maxUploads;) {
+    if (lIter->data.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++lIter;
+      continue;
+    }
+
+    Upload lUpload;
+    lUpload.id   = lIter->id;
+    lUpload.data = lIter->data.get();
+    lIter        = vLoads.erase(lIter);
+
+    Page &lPage   = getPage(lUpload.id);
+    lPage.loading = false;
+
+    if (!lUpload.data) {
+      wLOG(L"Failed to load page ", pageX(lUpload.id), L", ", pageY(lUpload.id), L" of level ", pageLevel(lUpload.id));
+      lPage.failed = true;
+      continue;
+    }
+
+    lUploads.emplace_back(std::move(lUpload));
+  }
+
+  // Pages requested in this update are never evicted
+  std::vector<uint32_t> lEvicted;
+  size_t                lNumAssigned = 0;
+
+  for (; lNumAssigned < lUploads.size(); ++lNumAssigned) {
+    uint32_t lSlot = allocateSlot(lEvicted);
+    if (lSlot == UINT32_MAX)
+      break;
+
+    vSlots[lSlot]                          = lUploads[lNumAssigned].id;
+    getPage(lUploads[lNumAssigned].id).slot = lSlot;
+  }
+
+  if (lNumAssigned < lUploads.size()) {
+    wLOG(L"Virtual texture cache too small: ", lUploads.size() - lNumAssigned, L" pages dropped");
+    lUploads.resize(lNumAssigned);
+  }
+
+  if (lUploads.empty())
+    return false;
+
+  VkResult lRes = VK_SUCCESS;
+  _world->runWhileIdle([&]() { lRes = commitPages(lUploads, lEvicted, false); });
+
+  return lRes == VK_SUCCESS;
+}
+
+/*!
+ * \brief Binds the texture, the page table and the feedback buffer to _shader
+ *
+ * Binds the sampler2D uniforms named SAMPLER_NAME (atlas or sparse image), the usampler2D uniforms
+ * named TABLE_NAME and the storage blocks named BLOCK_NAME (whole feedback buffer). The bindings
+ * must be written again after init().
+ *
+ * \returns false if nothing was bound or on errors
+ */
+bool rVirtualTexture::bindToShader(rShaderBase *_shader) {
+  if (!_shader || !isCreated()) {
+    eLOG(L"Virtual texture not initialized yet");
+    return false;
+  }
+
+  bool lFound = false;
+  for (auto i : {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT, VK_SHADER_STAGE_COMPUTE_BIT}) {
+    for (auto const &j : _shader->getStorageBuffers(i)) {
+      if (j.name != BLOCK_NAME)
+        continue;
+
+      if (!_shader->updateStorageBuffer(j, **vFeedback))
+        return false;
+
+      lFound = true;
+    }
+  }
+
+  for (auto const &i : _shader->getUniforms()) {
+    VkDescriptorImageInfo lImageInfo;
+    lImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    if (i.name == SAMPLER_NAME && i.type == "sampler2D") {
+      lImageInfo.sampler   = vSampler;
+      lImageInfo.imageView = getImageView();
+    } else if (i.name == TABLE_NAME && i.type == "usampler2D") {
+      lImageInfo.sampler   = vTableSampler;
+      lImageInfo.imageView = getPageTableView();
+    } else {
+      if (i.name == SAMPLER_NAME || i.name == TABLE_NAME)
+        wLOG("Uniform ", i.name, " in ", _shader->getName(), " has the wrong type ", i.type);
+
+      continue;
+    }
+
+    VkDescriptorSet lSet = _shader->getDescriptorSet(nullptr);
+    if (lSet == VK_NULL_HANDLE) {
+      eLOG(L"Failed to get descriptor set");
+      return false;
+    }
+
+    VkWriteDescriptorSet lWriteSet;
+    lWriteSet.sType            = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    lWriteSet.pNext            = nullptr;
+    lWriteSet.dstSet           = lSet;
+    lWriteSet.dstBinding       = i.binding;
+    lWriteSet.dstArrayElement  = 0;
+    lWriteSet.descriptorCount  = 1;
+    lWriteSet.descriptorType   = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    lWriteSet.pImageInfo       = &lImageInfo;
+    lWriteSet.pBufferInfo      = nullptr;
+    lWriteSet.pTexelBufferView = nullptr;
+
+    vkUpdateDescriptorSets(**vDevice, 1, &lWriteSet, 0, nullptr);
+    lFound = true;
+  }
+
+  return lFound;
+}
+
+//! \brief Returns the number of pages in the cache (without the mip tail)
+uint32_t rVirtualTexture::getNumResidentPages() {
+  std::lock_guard<std::mutex> lLock(vMutex);
+  return static_cast<uint32_t>(std::count_if(vSlots.begin(), vSlots.end(), [](uint32_t i) { return i != UINT32_MAX; }));
+}
+
+//! \brief Returns the device memory of the pages (the page table is not included)
+VkDeviceSize rVirtualTexture::getMemorySize() const noexcept {
+  if (vIsSparse)
+    return vSlots.size() * vPageMemorySize + vTailSize;
+
+  VkDeviceSize lExtent = vAtlasPages * (vPageSize + 2 * vBorder);
+  return lExtent * lExtent * 4;
+}
+
+} // namespace e_engine
@@ -0,0 +1,243 @@
+/*!
+ * \file rVirtualTexture.hpp
+ * \brief \b Classes: \a rVirtualTexture
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+
+#include "vkuBuffer.hpp"
+#include "vkuDevice.hpp"
+#include "vkuImageBuffer.hpp"
+#include "vkuTransfer.hpp"
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+class rShaderBase;
+class rWorld;
+
+/*!
+ * \brief Texture that is too large for the device memory (or one image) and only keeps the used pages resident
+ *
+ * Every mip level of the virtual texture is split into square pages of Config::pageSize texels. The
+ * pages are loaded with the PageSource callback on the engine thread pool (uThreadPool::getPool) and
+ * kept in a cache of Config::cachePages pages, the least recently used pages are replaced. The
+ * coarsest level (one page) is always resident.
+ *
+ * Devices with sparse residency (vkuDevice::hasSparseResidency) bind the pages directly into a
+ * partially resident image (vkQueueBindSparse), which is sampled with the normal texture coordinates.
+ * Otherwise (or if the texture is larger than the maximum image size) the pages are copied into a
+ * physical cache atlas with Config::border extra texels for filtering and the shader translates the
+ * coordinates with the page table.
+ *
+ * The page table (getPageTableView) is a VK_FORMAT_R8G8B8A8_UINT image with one level per level of
+ * the virtual texture and one texel per page, referencing the most detailed resident page that covers it:
+ *  - r, g: column and row of the page in the atlas (software mode)
+ *  - b:    level of the referenced page (clamp the LOD to it in sparse mode)
+ *  - a:    always 1
+ *
+ * Shaders report the pages they need in the feedback buffer (getFeedbackBuffer). It starts with a
+ * FeedbackHeader followed by Config::feedbackFrames slots (getFeedbackOffset) with an atomic uint32_t
+ * counter and Config::feedbackSize page IDs (packPageID). The shaders write into FeedbackHeader::slot,
+ * update() reads a slot Config::feedbackFrames - 1 updates after it was written. Pages can also be
+ * requested directly with requestPage() / requestRegion().
+ *
+ * bindToShader binds the texture, the page table and the feedback buffer to a shader. The GLSL side
+ * (lookup in the page table and feedback writes) is in virtualTexture.glsl of the test1 shaders.
+ *
+ * \note Only uncompressed formats with 4 bytes per texel are supported
+ */
+class rVirtualTexture final {
+ public:
+  static const std::string SAMPLER_NAME;
+  static const std::string TABLE_NAME;
+  static const std::string BLOCK_NAME;
+
+  //! std430 layout of the start of the feedback buffer (constant except slot)
+  struct FeedbackHeader {
+    uint32_t slot;         //!< Feedback slot of the current frames
+    uint32_t feedbackSize; //!< Page IDs per slot
+    uint32_t width;        //!< Size of level 0 of the virtual texture
+    uint32_t height;
+    uint32_t pageSize;
+    uint32_t border;
+    uint32_t atlasPages; //!< Pages per row of the atlas (software mode)
+    uint32_t sparse;     //!< 1: sparse mode
+  };
+
+  struct Config {
+    VkFormat format         = VK_FORMAT_R8G8B8A8_UNORM; //!< Format of the pages (4 bytes per texel)
+    uint32_t pageSize       = 128;  //!< Width / height of a page (sparse mode: the sparse block size)
+    uint32_t border         = 4;    //!< Texels around the pages in the atlas (software mode)
+    uint32_t cachePages     = 1024; //!< Pages in the cache (the atlas is at most 256 x 256 pages)
+    uint32_t maxUploads     = 32;   //!< Maximum number of pages swapped in per update()
+    uint32_t maxLoads       = 64;   //!< Maximum number of pages loaded at the same time
+    uint32_t feedbackSize   = 4096; //!< Page IDs per feedback slot
+    uint32_t feedbackFrames = 3;    //!< Feedback slots (must be larger than the number of frames in flight)
+    bool     allowSparse    = true; //!< Use sparse residency if the device supports it
+  };
+
+  /*!
+   * \brief Writes page _x, _y of _level with _border extra texels on each side to _out
+   *
+   * _out has (pageSize + 2 * _border)^2 tightly packed texels. Texels outside the level should be
+   * clamped to its edge. Called from worker threads.
+   */
+  using PageSource = std::function<bool(uint32_t _level, uint32_t _x, uint32_t _y, uint32_t _border, uint8_t *_out)>;
+
+ private:
+  struct Page {
+    uint32_t slot     = UINT32_MAX; //!< Cache slot (UINT32_MAX: not resident)
+    uint64_t lastUsed = 0;          //!< update() of the last request
+    bool     loading  = false;
+    bool     failed   = false; //!< The source failed (not requested again)
+    bool     pinned   = false; //!< Never evicted (coarsest level / mip tail)
+  };
+
+  struct Level {
+    uint32_t          width;
+    uint32_t          height;
+    uint32_t          pagesX;
+    uint32_t          pagesY;
+    VkDeviceSize      tableOffset; //!< Offset of the level in vTable (in texels)
+    std::vector<Page> pages;
+  };
+
+  struct Load {
+    uint32_t                                           id;
+    std::future<std::shared_ptr<std::vector<uint8_t>>> data; //!< nullptr if the source failed
+  };
+
+  struct Upload {
+    uint32_t                              id;
+    std::shared_ptr<std::vector<uint8_t>> data;
+  };
+
+  vkuDevicePTR vDevice;
+  vkuTransfer  vTransfer;
+  PageSource   vSource;
+
+  std::vector<Level>    vLevels;
+  std::vector<uint32_t> vSlots; //!< Page ID in every cache slot (UINT32_MAX: free)
+  std::vector<uint8_t>  vTable; //!< Content of the page table (all levels)
+  std::deque<Load>      vLoads;
+  std::vector<uint32_t> vRequests; //!< Page IDs requested since the last update()
+
+  uint32_t vWidth          = 0;
+  uint32_t vHeight         = 0;
+  uint32_t vPageSize       = 0;
+  uint32_t vBorder         = 0;
+  uint32_t vAtlasPages     = 0; //!< Pages per row of the atlas (software mode)
+  uint32_t vFeedbackFrames = 1;
+  uint32_t vFeedbackSize   = 0;
+  uint64_t vUpdates        = 0;
+  bool     vIsSparse       = false;
+
+  vkuImageBuffer             vAtlas;     //!< Physical pages (software mode)
+  vkuImageBuffer             vPageTable; //!< See class documentation
+  std::unique_ptr<vkuBuffer> vStaging;   //!< Pages and page table of one commit
+  std::unique_ptr<vkuBuffer> vFeedback;
+
+  VkImage        vSparseImage    = VK_NULL_HANDLE;
+  VkImageView    vSparseView     = VK_NULL_HANDLE;
+  VkDeviceMemory vPageMemory     = VK_NULL_HANDLE; //!< One sparse block per cache slot
+  VkDeviceMemory vTailMemory     = VK_NULL_HANDLE; //!< Mip tail (always bound)
+  VkDeviceSize   vPageMemorySize = 0;              //!< Size of one sparse block
+  VkDeviceSize   vTailSize       = 0;
+  uint32_t       vTailFirstLevel = UINT32_MAX;
+  VkQueue        vSparseQueue    = VK_NULL_HANDLE;
+  VkSampler      vSampler        = VK_NULL_HANDLE; //!< Owned by the device (vkuDevice::getSampler)
+  VkSampler      vTableSampler   = VK_NULL_HANDLE; //!< Owned by the device (vkuDevice::getSampler)
+
+  std::mutex vMutex;
+
+  Config cfg;
+
+  bool     setupLevels();
+  VkResult initSparse();
+  VkResult initSoftware();
+  VkResult initCommon();
+
+  Page &   getPage(uint32_t _id);
+  bool     isValidPage(uint32_t _id) const noexcept;
+  void     startLoad(uint32_t _id);
+  uint32_t allocateSlot(std::vector<uint32_t> &_evicted);
+  void     rebuildPageTable();
+  VkResult commitPages(std::vector<Upload> const &_uploads, std::vector<uint32_t> const &_evicted, bool _first);
+  VkResult bindSparsePages(std::vector<Upload> const &_uploads, std::vector<uint32_t> const &_evicted);
+  void     readFeedback();
+
+  VkDeviceSize getPageBytes() const noexcept;
+
+ public:
+  rVirtualTexture() = delete;
+  rVirtualTexture(vkuDevicePTR _device);
+  ~rVirtualTexture();
+
+  rVirtualTexture(rVirtualTexture const &) = delete;
+  rVirtualTexture &operator=(const rVirtualTexture &) = delete;
+
+  VkResult init(uint32_t _width, uint32_t _height, PageSource _source);
+  void     destroy();
+
+  void requestPage(uint32_t _level, uint32_t _x, uint32_t _y);
+  void requestRegion(uint32_t _level, float _u0, float _v0, float _u1, float _v1);
+
+  bool update(rWorld *_world);
+  bool bindToShader(rShaderBase *_shader);
+
+  uint32_t     getNumResidentPages();
+  VkDeviceSize getMemorySize() const noexcept;
+
+  static uint32_t packPageID(uint32_t _level, uint32_t _x, uint32_t _y) noexcept;
+
+  inline uint32_t     getNumLevels() const noexcept { return static_cast<uint32_t>(vLevels.size()); }
+  inline uint32_t     getPageSize() const noexcept { return vPageSize; }
+  inline uint32_t     getBorder() const noexcept { return vBorder; }
+  inline uint32_t     getAtlasPages() const noexcept { return vAtlasPages; }
+  inline bool         isSparse() const noexcept { return vIsSparse; }
+  inline bool         isCreated() const noexcept { return !vLevels.empty(); }
+  inline VkImageView  getImageView() const noexcept { return vIsSparse ? vSparseView : *vAtlas; }
+  inline VkImageView  getPageTableView() const noexcept { return *vPageTable; }
+  inline VkSampler    getSampler() const noexcept { return vSampler; }
+  inline VkSampler    getPageTableSampler() const noexcept { return vTableSampler; }
+  inline VkBuffer     getFeedbackBuffer() const noexcept { return vFeedback ? **vFeedback : VK_NULL_HANDLE; }
+  inline uint32_t     getFeedbackSlot() const noexcept { return static_cast<uint32_t>(vUpdates % vFeedbackFrames); }
+  inline VkDeviceSize getFeedbackOffset(uint32_t _slot) const noexcept {
+    return sizeof(FeedbackHeader) + static_cast<VkDeviceSize>(_slot) * (vFeedbackSize + 1) * sizeof(uint32_t);
+  }
+
+  inline Config  getConfig() const noexcept { return cfg; }
+  inline Config *getConfigPTR() noexcept { return &cfg; }
+
+  inline Config *operator->() noexcept { return &cfg; } //! \brief Allow config access via texture->cfgField = 1;
+};
+
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
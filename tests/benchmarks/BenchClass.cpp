@@ -16,11 +16,14 @@
 
 #include "BenchClass.hpp"
 #include "cmdANDinit.hpp"
+#include <cmath>
 #include <engine.hpp>
+#include <random>
 
 BenchBaseVirtual::~BenchBaseVirtual() {}
 
 using namespace std;
+using namespace e_engine;
 
 #define START(__VarName__) std::chrono::system_clock::time_point __VarName__ = std::chrono::system_clock::now();
 #define STOP(__VarName__)                                                                                              \
@@ -35,8 +38,10 @@ BenchClass::BenchClass(cmdANDinit *_cmd)
 
   bool lDoFunctionBench = false;
   bool lDoMutexBench    = false;
+  bool lDoBVHBench      = false;
   _cmd->getFunctionInf(vLoopsToDo, lDoFunctionBench);
   _cmd->getMutexInf(vLoopsToDoMutex, lDoMutexBench);
+  _cmd->getBVHInf(vBVHObjects, lDoBVHBench);
 
   if (lDoFunctionBench) {
     vTheSignal.connect(&vTheSlot);
@@ -54,6 +59,9 @@ BenchClass::BenchClass(cmdANDinit *_cmd)
 
   if (lDoMutexBench)
     doMutex();
+
+  if (lDoBVHBench)
+    doBVH();
 }
 
 void BenchClass::doFunction() {
@@ -286,4 +294,133 @@ void BenchClass::doMutex() {
 }
 
 
+/*!
+ * \brief Measures the query cost of rBVH for growing scene sizes
+ *
+ * The object density is kept constant (the world grows with the number of objects), so every query
+ * returns roughly the same number of hits and the query time should only grow with log(n). A
+ * linear scan over all boxes is measured as reference.
+ */
+void BenchClass::doBVH() {
+  const unsigned int lQueries = 10000;
+
+  iLOG("==== BEGIN BVH BENCHMARK ====");
+  iLOG("");
+  iLOG("  - Max objects: ", vBVHObjects);
+  iLOG("  - Queries:     ", lQueries);
+
+  std::mt19937 lRNG(42);
+
+  string lTable =
+      "\n   |==========|========|============|============|============|============|============|============|"
+      "\n   | Objects  | Height | Build [ms] | Move [ms]  | Overlap    | Ray        | Frustum    | Linear     |"
+      "\n   |----------|--------|------------|------------|------------|------------|------------|------------|";
+
+  auto lCell = [](string _str, size_t _width) -> string {
+    _str.resize(_width, ' ');
+    return _str;
+  };
+
+  for (unsigned int lNum = 1000; lNum <= vBVHObjects; lNum *= 2) {
+    // ~1 object per 1000 cubic units
+    float lWorldSize = std::cbrt(static_cast<float>(lNum) * 1000.0f) * 0.5f;
+
+    std::uniform_real_distribution<float> lPos(-lWorldSize, lWorldSize);
+    std::uniform_real_distribution<float> lSize(0.5f, 2.0f);
+    std::uniform_real_distribution<float> lDir(-1.0f, 1.0f);
+
+    std::vector<rAABB>    lBoxes(lNum);
+    std::vector<uint32_t> lProxies(lNum);
+    std::vector<uint32_t> lRes;
+    lRes.reserve(1024);
+
+    for (auto &i : lBoxes) {
+      glm::vec3 lCenter(lPos(lRNG), lPos(lRNG), lPos(lRNG));
+      i = rAABB(lCenter - glm::vec3(lSize(lRNG)), lCenter + glm::vec3(lSize(lRNG)));
+    }
+
+    rBVH lBVH;
+
+    START(build);
+    for (uint32_t i = 0; i < lNum; ++i)
+      lProxies[i] = lBVH.insert(lBoxes[i], i);
+    uint64_t lBuild = STOP(build);
+
+    // Move 10% of the objects (small steps, mostly handled by the fat boxes)
+    START(move);
+    for (uint32_t i = 0; i < lNum; i += 10) {
+      glm::vec3 lDelta(lDir(lRNG), lDir(lRNG), lDir(lRNG));
+      lBoxes[i] = rAABB(lBoxes[i].min + lDelta * 0.2f, lBoxes[i].max + lDelta * 0.2f);
+      lBVH.update(lProxies[i], lBoxes[i]);
+    }
+    uint64_t lMove = STOP(move);
+
+    std::vector<rAABB>    lQueryBoxes(lQueries);
+    std::vector<rRay>     lRays(lQueries);
+    std::vector<rFrustum> lFrustums(lQueries);
+    glm::mat4             lProj = glm::perspective(glm::radians(45.0f), 1.0f, 0.1f, 25.0f);
+
+    for (unsigned int i = 0; i < lQueries; ++i) {
+      glm::vec3 lCenter(lPos(lRNG), lPos(lRNG), lPos(lRNG));
+      glm::vec3 lDirection(lDir(lRNG), lDir(lRNG), lDir(lRNG) + 0.01f);
+
+      lDirection           = glm::normalize(lDirection);
+      lQueryBoxes[i]       = rAABB(lCenter - glm::vec3(5.0f), lCenter + glm::vec3(5.0f));
+      lRays[i]             = rRay(lCenter, lDirection);
+      lFrustums[i]         = rFrustum(lProj * glm::lookAt(lCenter, lCenter + lDirection, glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+
+    size_t lHits = 0;
+
+    START(overlap);
+    for (auto const &i : lQueryBoxes) {
+      lRes.clear();
+      lBVH.queryOverlap(i, lRes);
+      lHits += lRes.size();
+    }
+    uint64_t lOverlap = STOP(overlap);
+
+    START(ray);
+    for (auto const &i : lRays) {
+      uint32_t lData;
+      float    lT;
+      lHits += lBVH.queryRayClosest(i, lWorldSize, lData, lT) ? 1 : 0;
+    }
+    uint64_t lRay = STOP(ray);
+
+    START(frustum);
+    for (auto const &i : lFrustums) {
+      lRes.clear();
+      lBVH.queryFrustum(i, lRes);
+      lHits += lRes.size();
+    }
+    uint64_t lFrustum = STOP(frustum);
+
+    // Reference: linear scan (only a subset of the queries, this gets slow)
+    unsigned int lLinearQueries = std::max(1u, lQueries / 10);
+    START(linear);
+    for (unsigned int i = 0; i < lLinearQueries; ++i) {
+      for (auto const &j : lBoxes)
+        lHits += lQueryBoxes[i].overlaps(j) ? 1 : 0;
+    }
+    uint64_t lLinear = STOP(linear);
+
+    double lToNs = 1000.0 / static_cast<double>(lQueries);
+
+    lTable += "\n   | " + lCell(std::to_string(lNum), 8) + " | " + lCell(std::to_string(lBVH.getHeight()), 6) + " | " +
+              lCell(std::to_string(lBuild / 1000.0), 10) + " | " + lCell(std::to_string(lMove / 1000.0), 10) + " | " +
+              lCell(std::to_string(lOverlap * lToNs), 10) + " | " + lCell(std::to_string(lRay * lToNs), 10) + " | " +
+              lCell(std::to_string(lFrustum * lToNs), 10) + " | " +
+              lCell(std::to_string(lLinear * 1000.0 / lLinearQueries), 10) + " |";
+
+    iLOG("  = ", lNum, " objects done (", lHits, " hits)");
+  }
+
+  lTable += "\n   |==========|========|============|============|============|============|============|============|";
+  lTable += "\n   Query times in nanoseconds per query";
+
+  dLOG(lTable);
+}
+
+
 // kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -72,8 +72,11 @@ class BenchClass : public BenchBaseVirtual {
 
   unsigned int vLoopsToDoCast;
 
+  unsigned int vBVHObjects;
+
   void doFunction();
   void doMutex();
+  void doBVH();
 
  public:
   BenchClass() = delete;
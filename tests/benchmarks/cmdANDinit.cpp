@@ -59,6 +59,9 @@ cmdANDinit::cmdANDinit(int argc, char *argv[], bool _color) {
 
   vDoMutex    = false;
   vMutexLoops = 10000000;
+
+  vDoBVH      = false;
+  vBVHObjects = 256000;
 }
 
 
@@ -78,11 +81,13 @@ void cmdANDinit::usage() {
       "MODES:"
       "\nall            : do all benchmarks"
       "\nfunc           : do the functions benchmark"
-      "\nmutex          : do the mutex benchmark");
+      "\nmutex          : do the mutex benchmark"
+      "\nbvh            : do the BVH (scene spatial queries) benchmark");
   iLOG("");
   iLOG("BENCHMARK OPTIONS:");
   dLOG("    --funcLoops=<loops>  : ammount of loops to do in function benchmark (default: ", vFunctionLoops, ")");
   dLOG("    --mutexLoops=<loops> : ammount of loops to do in mutex benchmark    (default: ", vMutexLoops, ")");
+  dLOG("    --bvhObjects=<num>   : max number of objects in the BVH benchmark   (default: ", vBVHObjects, ")");
   wLOG("You MUST define one ore more modes\n\n");
 }
 
@@ -122,6 +127,7 @@ bool cmdANDinit::parseArgsAndInit() {
     if (arg == "all") {
       vDoFunction = true;
       vDoMutex    = true;
+      vDoBVH      = true;
       continue;
     }
 
@@ -135,6 +141,11 @@ bool cmdANDinit::parseArgsAndInit() {
       continue;
     }
 
+    if (arg == "bvh") {
+      vDoBVH = true;
+      continue;
+    }
+
 
 
     std::regex lFuncRegex("^\\-\\-funcLoops=[0-9 ]*$");
@@ -155,10 +166,19 @@ bool cmdANDinit::parseArgsAndInit() {
       continue;
     }
 
+    std::regex lBVHRegex("^\\-\\-bvhObjects=[0-9 ]*$");
+    if (std::regex_match(arg, lBVHRegex)) {
+      std::regex  lBVHRegexRep("^\\-\\-bvhObjects=");
+      const char *lRep      = "";
+      string      bvhString = std::regex_replace(arg, lBVHRegexRep, lRep);
+      vBVHObjects           = static_cast<unsigned>(atoi(bvhString.c_str()));
+      continue;
+    }
+
     eLOG("Unkonwn option '", arg, "'");
   }
 
-  if (vDoFunction == false && vDoMutex == false) {
+  if (vDoFunction == false && vDoMutex == false && vDoBVH == false) {
     postInit();
     usage();
     return false;
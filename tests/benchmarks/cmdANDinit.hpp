@@ -34,6 +34,9 @@ class cmdANDinit {
   bool         vDoMutex;
   unsigned int vMutexLoops;
 
+  bool         vDoBVH;
+  unsigned int vBVHObjects;
+
   cmdANDinit() {}
 
   void postInit();
@@ -53,6 +56,10 @@ class cmdANDinit {
     _loops = vMutexLoops;
     _doIt  = vDoMutex;
   }
+  void getBVHInf(unsigned int &_objects, bool &_doIt) {
+    _objects = vBVHObjects;
+    _doIt    = vDoBVH;
+  }
 };
 
 #endif // CMDANDINIT_H
@@ -12,7 +12,7 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 
-set( SHADERS_TO_COMPILE_T1 triangle1 deferred1 deferred2 )
+set( SHADERS_TO_COMPILE_T1 triangle1 triangle1c indirect cull deferred1 deferred2 shadow virtual )
 
 foreach( I IN LISTS SHADERS_TO_COMPILE_T1 )
    createSPIRV( ${I} "${ENGINE_TEST_ROOT}/test1/data/shaders" "${ENGINE_TEST_ROOT}/test1/shaders" )
@@ -89,6 +89,10 @@ void cmdANDinit::usage() {
       dataRoot);
   dLOG("    --mesh=<name>      : set the mesh to render IN the data dir (default: ", meshToRender, ")");
   dLOG("    -N | --normals     : Visulize mesh normals");
+  dLOG("    --compressed       : use compressed vertex data (triangle1c shader)");
+  dLOG("    --gpu-culling      : cull on the GPU and use indirect draws (indirect shader)");
+  dLOG("    --deferred         : use the deferred renderer with tiled lighting (deferred1/2 shaders)");
+  dLOG("    --virtual          : texture the meshes with a generated virtual texture (virtual shader)");
   dLOG("    --shader=<shader>  : set the shader to use (default: ", vShader, ")");
   dLOG("    --Nshader=<shader> : set the shader to use for rendering normals (default: ", vNormalShader, ")");
   dLOG("    -n | --nocolor     : disable colored output");
@@ -132,6 +136,30 @@ bool cmdANDinit::parseArgsAndInit() {
       continue;
     }
 
+    if (arg == "--compressed") {
+      iLOG("Using compressed vertex data");
+      vCompressed = true;
+      continue;
+    }
+
+    if (arg == "--gpu-culling") {
+      iLOG("Using GPU culling");
+      vGPUCulling = true;
+      continue;
+    }
+
+    if (arg == "--deferred") {
+      iLOG("Using deferred rendering");
+      vDeferred = true;
+      continue;
+    }
+
+    if (arg == "--virtual") {
+      iLOG("Using a virtual texture");
+      vVirtual = true;
+      continue;
+    }
+
     std::regex lLogRegex("^\\-\\-log=.+$");
     if (std::regex_match(arg, lLogRegex)) {
       std::regex  lLogRegexRep("^\\-\\-log=");
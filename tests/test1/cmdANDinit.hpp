@@ -33,6 +33,10 @@ class cmdANDinit {
 
   bool vCanUseColor;
   bool vRenderNormals = false;
+  bool vCompressed    = false;
+  bool vGPUCulling    = false;
+  bool vDeferred      = false;
+  bool vVirtual       = false;
 
   float vNearZ = 0.1f;
   float vFarZ  = 100.0f;
@@ -54,6 +58,10 @@ class cmdANDinit {
   float getFarZ() const { return vFarZ; }
 
   bool getRenderNormals() const { return vRenderNormals; }
+  bool getCompressed() const { return vCompressed; }
+  bool getGPUCulling() const { return vGPUCulling; }
+  bool getDeferred() const { return vDeferred; }
+  bool getVirtual() const { return vVirtual; }
 
   bool parseArgsAndInit();
 };
@@ -19,17 +19,28 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-layout (location = 10) in vec4 vPosition;
-layout (location = 11) in vec4 vNormal;
-layout (location = 12) in vec4 vColor;
+layout (binding = 1) uniform sampler2D samplerDiffuse;
 
-layout (location = 0) out vec4 oPosition;
-layout (location = 1) out vec4 oNormal;
-layout (location = 2) out vec4 oColor;
+layout (location = 0) in vec3 vNormal;
+layout (location = 1) in vec2 vUV;
+
+layout (location = 0) out vec2 oNormal;
+layout (location = 1) out vec4 oColor;
+
+const float SPECULAR_INTENSITY = 0.5; // Stored in the albedo alpha channel
+
+vec2 signNotZero(vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Octahedral normal encoding (unit vector --> [-1, 1]^2)
+vec2 encodeNormal(vec3 n) {
+  n.xy /= abs(n.x) + abs(n.y) + abs(n.z);
+  return n.z >= 0.0 ? n.xy : (1.0 - abs(n.yx)) * signNotZero(n.xy);
+}
 
 void main()
 {
-  oPosition = vPosition;
-  oNormal   = vNormal;
-  oColor    = vColor;
+  oNormal = encodeNormal(normalize(vNormal));
+  oColor  = vec4(texture(samplerDiffuse, vUV).rgb, SPECULAR_INTENSITY);
 }
@@ -21,23 +21,19 @@
 
 layout (location = 0) in vec3 iVertex;
 layout (location = 1) in vec3 iNormals;
+layout (location = 2) in vec2 iUV;
 
 layout (binding = 0) uniform UBuffer {
-   mat4 view;
+   mat4 mvp;
+   mat4 modelView;
 } uBuff;
 
-layout(push_constant) uniform PBlock {
-   mat4 model;
-} pConst;
-
-layout (location = 10) out vec4 vPosition;
-layout (location = 11) out vec4 vNormal;
-layout (location = 12) out vec4 vColor;
+layout (location = 0) out vec3 vNormal;
+layout (location = 1) out vec2 vUV;
 
 void main() {
-   vPosition = uBuff.view * pConst.model * vec4(iVertex, 1.0);
-   vNormal = vec4(iNormals, 1.0);
-   vColor = vec4(iNormals, 1.0);
+   vNormal = mat3(uBuff.modelView) * iNormals;
+   vUV     = iUV;
 
-   gl_Position = vPosition;
+   gl_Position = uBuff.mvp * vec4(iVertex, 1.0);
 }
@@ -19,8 +19,14 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-layout (location = 0) in vec2 iPos;
+layout (set = 0, binding = 1) uniform sampler2D samplerDiffuse;
 
-void main() {
-   gl_Position = vec4(iPos, 0.0, 1.0);
+layout (location = 0) in vec3 vNormals;
+layout (location = 1) in vec2 vUV;
+layout (location = 2) in float vLodBias;
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+  outFragColor = texture(samplerDiffuse, vUV, vLodBias);
 }
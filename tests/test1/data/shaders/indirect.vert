@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2015 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+// Vertex shader for objects drawn by rGPUCulling (the object index is gl_InstanceIndex)
+
+layout (location = 0) in vec3 iVertex;
+layout (location = 1) in vec3 iNormals;
+layout (location = 2) in vec2 iUV;
+
+struct ObjectData {
+  mat4  model;
+  vec4  boundsMin;
+  vec4  boundsMax;
+  uint  indexCount;
+  uint  firstIndex;
+  int   vertexOffset;
+  uint  padding;
+};
+
+layout (set = 0, binding = 0) uniform UBuffer {
+  mat4 viewProject;
+} uBuff;
+
+layout (std430, set = 0, binding = 2) readonly buffer Objects {
+  ObjectData objects[];
+};
+
+layout (location = 0) out vec3  vNormals;
+layout (location = 1) out vec2  vUV;
+layout (location = 2) out float vLodBias;
+
+void main() {
+   mat4 model = objects[gl_InstanceIndex].model;
+
+   vLodBias = 0.0;
+   vNormals = mat3(model) * iNormals;
+   vUV = iUV;
+   gl_Position = uBuff.viewProject * model * vec4(iVertex, 1.0);
+}
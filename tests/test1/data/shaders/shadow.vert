@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+// Depth only vertex shader for rRendererShadow (no fragment stage)
+
+layout (location = 0) in vec3 iVertex;
+layout (location = 1) in vec3 iNormals;
+layout (location = 2) in vec2 iUV;
+
+layout (push_constant) uniform PushConsts {
+  mat4 uMVP;
+} pConst;
+
+void main() {
+   gl_Position = pConst.uMVP * vec4(iVertex, 1.0);
+}
@@ -19,17 +19,14 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-layout (input_attachment_index = 0, binding = 0) uniform subpassInput uPos;
-layout (input_attachment_index = 1, binding = 1) uniform subpassInput uNormal;
-layout (input_attachment_index = 2, binding = 2) uniform subpassInput uColor;
+layout (set = 0, binding = 1) uniform sampler2D samplerDiffuse;
 
+layout (location = 0) in vec3 vNormals;
+layout (location = 1) in vec2 vUV;
+layout (location = 2) in float vLodBias;
 layout (location = 0) out vec4 outFragColor;
 
 void main()
 {
-   vec4 lPos        = subpassLoad( uPos );
-   vec4 lTempNormal = subpassLoad( uNormal );
-   vec4 lTempColor  = subpassLoad( uColor );
-
-   outFragColor = lPos;
+  outFragColor = texture(samplerDiffuse, vUV, vLodBias);
 }
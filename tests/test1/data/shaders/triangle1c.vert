@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+// Compressed vertex input (rVertexPacker::PackedPNUV), positions are mapped to the mesh bounds by dequantize
+layout (location = 0) in vec4 iVertex;
+layout (location = 1) in vec2 iNormals;
+layout (location = 2) in vec2 iUV;
+
+layout (set = 0, binding = 0) uniform UBuffer {
+  mat4 mvp;
+  mat4 dequantize;
+  float lodBias;
+  mat3 normal;
+} uBuff;
+
+layout (location = 0) out vec3  vNormals;
+layout (location = 1) out vec2  vUV;
+layout (location = 2) out float vLodBias;
+
+vec3 octDecode(vec2 e) {
+   vec3  n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+   float t = max(-n.z, 0.0);
+   n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+   return normalize(n);
+}
+
+void main() {
+   vLodBias = uBuff.lodBias;
+   vNormals = uBuff.normal * octDecode(iNormals);
+   vUV = iUV;
+   gl_Position = uBuff.mvp * (uBuff.dequantize * vec4(iVertex.xyz, 1.0));
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+#extension GL_GOOGLE_include_directive : require
+
+// Forward shading with a rVirtualTexture as the diffuse color (--virtual)
+
+layout (set = 0, binding = 1) uniform sampler2D  uVirtualTexture;
+layout (set = 0, binding = 2) uniform usampler2D uPageTable;
+
+layout (std430, set = 0, binding = 3) buffer VTFeedback {
+  uint vtSlot;
+  uint vtFeedbackSize;
+  uint vtWidth;
+  uint vtHeight;
+  uint vtPageSize;
+  uint vtBorder;
+  uint vtAtlasPages;
+  uint vtSparse;
+  uint vtFeedback[];
+};
+
+#include "virtualTexture.glsl"
+
+layout (location = 0) in vec3 vNormals;
+layout (location = 1) in vec2 vUV;
+layout (location = 2) in float vLodBias;
+layout (location = 0) out vec4 outFragColor;
+
+void main()
+{
+  outFragColor = vtSample(vUV);
+}
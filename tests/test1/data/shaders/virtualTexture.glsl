@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Page table lookup and feedback writes of rVirtualTexture (see rVirtualTexture::bindToShader).
+// The including shader declares the bindings (the SPIR-V class generator only parses the shader itself):
+//
+//   layout (set = 0, binding = X) uniform sampler2D  uVirtualTexture;
+//   layout (set = 0, binding = Y) uniform usampler2D uPageTable;
+//
+//   layout (std430, set = 0, binding = Z) buffer VTFeedback {
+//     uint vtSlot;         // rVirtualTexture::FeedbackHeader
+//     uint vtFeedbackSize;
+//     uint vtWidth;
+//     uint vtHeight;
+//     uint vtPageSize;
+//     uint vtBorder;
+//     uint vtAtlasPages;
+//     uint vtSparse;
+//     uint vtFeedback[];   // Feedback slots (counter + page IDs)
+//   };
+//
+// Requires GL_GOOGLE_include_directive and is only usable in fragment shaders (derivatives)
+
+#define VT_FEEDBACK_STEP 8u // Only every VT_FEEDBACK_STEP-th pixel in x and y writes feedback
+
+// Level of detail at _uv (level 0 texels per pixel)
+float vtComputeLOD(vec2 _uv) {
+   vec2 t  = _uv * vec2(vtWidth, vtHeight);
+   vec2 dx = dFdx(t);
+   vec2 dy = dFdy(t);
+   return max(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0);
+}
+
+// Page of _level that contains _uv (clamped to the page table)
+uvec2 vtPage(vec2 _uv, uint _level) {
+   vec2  size  = vec2(max(vtWidth >> _level, 1u), max(vtHeight >> _level, 1u));
+   ivec2 pages = textureSize(uPageTable, int(_level));
+   return uvec2(clamp(ivec2(floor(_uv * size / float(vtPageSize))), ivec2(0), pages - 1));
+}
+
+// Appends the page to the current feedback slot (rVirtualTexture::packPageID)
+void vtWriteFeedback(uvec2 _page, uint _level) {
+   uvec2 pixel = uvec2(gl_FragCoord.xy);
+   if (pixel.x % VT_FEEDBACK_STEP != 0u || pixel.y % VT_FEEDBACK_STEP != 0u)
+      return;
+
+   uint base  = vtSlot * (vtFeedbackSize + 1u);
+   uint index = atomicAdd(vtFeedback[base], 1u);
+   if (index < vtFeedbackSize)
+      vtFeedback[base + 1u + index] = (_level << 28) | (_page.y << 14) | _page.x;
+}
+
+// Samples the most detailed resident page at _uv and requests the page of the needed level
+vec4 vtSample(vec2 _uv) {
+   float lod   = min(vtComputeLOD(_uv), float(textureQueryLevels(uPageTable) - 1));
+   uint  level = uint(lod);
+   uvec2 page  = vtPage(_uv, level);
+
+   vtWriteFeedback(page, level);
+
+   // b: level of the resident page (coarser than level if the page is not loaded yet)
+   uvec4 entry = texelFetch(uPageTable, ivec2(page), int(level));
+   if (vtSparse != 0u)
+      return textureLod(uVirtualTexture, _uv, max(lod, float(entry.b)));
+
+   // Position in the resident page ==> texel in the atlas (the border is skipped)
+   vec2  size   = vec2(max(vtWidth >> entry.b, 1u), max(vtHeight >> entry.b, 1u));
+   vec2  inPage = clamp(_uv * size / float(vtPageSize) - vec2(vtPage(_uv, entry.b)), 0.0, 1.0);
+   float stride = float(vtPageSize + 2u * vtBorder);
+   vec2  texel  = vec2(entry.rg) * stride + float(vtBorder) + inPage * float(vtPageSize);
+
+   return textureLod(uVirtualTexture, texel / (float(vtAtlasPages) * stride), 0.0);
+}
@@ -19,6 +19,43 @@
 using namespace glm;
 using namespace e_engine;
 
+namespace {
+
+const uint32_t VIRTUAL_SIZE      = 32768; //!< Width / height of the generated virtual texture
+const uint32_t VIRTUAL_PAGE_SIZE = 128;
+
+/*!
+ * \brief Generates the pages of the virtual texture (checkerboard, tinted per level)
+ *
+ * The tint shows which level is resident where.
+ */
+bool generatePage(uint32_t _level, uint32_t _x, uint32_t _y, uint32_t _border, uint8_t *_out) {
+  static const uint8_t TINTS[][3] = {
+      {255, 255, 255}, {255, 128, 128}, {128, 255, 128}, {128, 128, 255}, {255, 255, 128}, {255, 128, 255}};
+
+  uint32_t       lStride = VIRTUAL_PAGE_SIZE + 2 * _border;
+  int64_t        lMax    = static_cast<int64_t>(std::max(VIRTUAL_SIZE >> _level, 1u)) - 1;
+  uint8_t const *lTint   = TINTS[_level % (sizeof(TINTS) / sizeof(TINTS[0]))];
+
+  for (uint32_t y = 0; y < lStride; ++y) {
+    for (uint32_t x = 0; x < lStride; ++x) {
+      // Clamped to the edge of the level, cells of 256 level 0 texels
+      int64_t lTX  = std::min(std::max(static_cast<int64_t>(_x * VIRTUAL_PAGE_SIZE + x) - _border, int64_t(0)), lMax);
+      int64_t lTY  = std::min(std::max(static_cast<int64_t>(_y * VIRTUAL_PAGE_SIZE + y) - _border, int64_t(0)), lMax);
+      bool    lOdd = (((lTX << _level) >> 8) + ((lTY << _level) >> 8)) % 2 != 0;
+
+      uint8_t *lTexel = _out + (y * lStride + x) * 4;
+      for (uint32_t i = 0; i < 3; ++i)
+        lTexel[i] = static_cast<uint8_t>(lOdd ? lTint[i] / 4 : lTint[i]);
+
+      lTexel[3] = 255;
+    }
+  }
+
+  return true;
+}
+} // namespace
+
 myScene::~myScene() {
   vRunMovementThread = false;
   if (vMovementThread.joinable())
@@ -30,10 +67,47 @@ int myScene::init() {
   calculateProjectionPerspective(GlobConf.win.width, GlobConf.win.height, 0.01f, 256.0f, glm::radians(60.0f));
 
   vPipeline.setDynamicViewports(1)->setDynamicScissors(1)->enableDepthTest()->enableCulling(VK_FRONT_FACE_CLOCKWISE);
-  vPipeline.setShader(&vShader);
 
-  //   vLightPipeline.setDynamicViewports(1)->setDynamicScissors(1); //->enableDepthTest();
-  //   vLightPipeline.setShader(&vLightShader);
+  if (vGPUCulling && vCompressed) {
+    wLOG("The indirect shader does not support compressed vertex data ==> disabling compression");
+    vCompressed = false;
+  }
+
+  if (vDeferred && (vCompressed || vGPUCulling)) {
+    wLOG("The deferred renderer does not support compressed vertex data and GPU culling ==> disabling them");
+    vCompressed = false;
+    vGPUCulling = false;
+  }
+
+  if (vVirtual && (vDeferred || vCompressed || vGPUCulling)) {
+    wLOG("The virtual shader only supports forward rendering of uncompressed meshes ==> disabling the virtual texture");
+    vVirtual = false;
+  }
+
+  if (vVirtual) {
+    vVirtualTexture->pageSize = VIRTUAL_PAGE_SIZE;
+    if (vVirtualTexture.init(VIRTUAL_SIZE, VIRTUAL_SIZE, &generatePage) != VK_SUCCESS) {
+      eLOG("Failed to create the virtual texture");
+      return 3;
+    }
+
+    if (!vVirtualTexture.bindToShader(&vShaderVirtual)) {
+      eLOG("Failed to bind the virtual texture");
+      return 3;
+    }
+
+    vPipeline.setShader(&vShaderVirtual);
+  } else if (vDeferred) {
+    vPipeline.setShader(&vShaderDeferred);
+    vPipeline.setNumColorAttachments(2);
+  } else if (vGPUCulling) {
+    vPipeline.setShader(&vShaderIndirect);
+  } else if (vCompressed) {
+    vPipeline.setShader(&vShaderCompressed);
+    vPipeline.setVertexInputFormats(rSimpleMesh::getCompressedInputFormats());
+  } else {
+    vPipeline.setShader(&vShader);
+  }
 
   beginInitObject();
 
@@ -42,7 +116,7 @@ int myScene::init() {
     if (i.type != MESH_3D)
       continue;
 
-    vObjects.emplace_back(std::make_shared<rSimpleMesh>(this, getWorldPTR()->getDevice(), i.name));
+    vObjects.emplace_back(std::make_shared<rSimpleMesh>(this, getWorldPTR()->getDevice(), i.name, vCompressed));
 
     initObject(vObjects.back(), i.index);
     vObjects.back()->setPosition(vec3(0, 0, -5));
@@ -50,36 +124,32 @@ int myScene::init() {
 
   endInitObject();
 
-  //    vPointLights.emplace_back(std::make_shared<rPointLightF>(this, "L1"));
-  //    vPointLights.emplace_back( std::make_shared<rPointLightF>( this, "L2" ) );
-  //    vDirectionalLights.emplace_back(
-  //          std::make_shared<rDirectionalLightF>( "L3", vec3( 0.5, -1, 0.5 ) ) );
+  if (vDeferred) {
+    vPointLights.emplace_back(std::make_shared<rPointLightF>(this, "L1"));
+    vPointLights.emplace_back(std::make_shared<rPointLightF>(this, "L2"));
+    vDirectionalLights.emplace_back(std::make_shared<rDirectionalLightF>("L3", vec3(0.5, -1, 0.5)));
 
-  //    vPointLights[0]->setPosition(vec3(1, 1, -4));
-  //    vPointLights[1]->setPosition( vec3( -1, -1, -4 ) );
+    vPointLights[0]->setPosition(vec3(1, 1, -4));
+    vPointLights[1]->setPosition(vec3(-1, -1, -4));
 
-  //    vPointLights[0]->setColor(vec3(1.0f, 0.2f, 0.2f), vec3(0.1f, 0.0f, 0.0f));
-  //    vPointLights[1]->setColor( vec3( 0.2f, 0.2f, 1.0f ), vec3( 0.0, 0.0f, 0.1f ) );
-  //    vPointLights[2]->setColor( vec3( 0.9f, 0.9f, 0.9f ), vec3( 0.05f, 0.05f, 0.05f ) );
-
-  //    vPointLights[0]->setAttenuation(0.1f, 0.01f, 0.1f);
-  //    vPointLights[1]->setAttenuation( 0.1f, 0.02f, 0.2f );
+    vPointLights[0]->setColor(vec3(1.0f, 0.2f, 0.2f), vec3(0.1f, 0.0f, 0.0f));
+    vPointLights[1]->setColor(vec3(0.2f, 0.2f, 1.0f), vec3(0.0, 0.0f, 0.1f));
+    vDirectionalLights[0]->setColor(vec3(0.3f, 0.3f, 0.3f), vec3(0.05f, 0.05f, 0.05f));
 
+    vPointLights[0]->setAttenuation(0.1f, 0.01f, 0.1f);
+    vPointLights[1]->setAttenuation(0.1f, 0.02f, 0.2f);
+  }
 
   for (auto &i : vObjects) {
     i->setPipeline(&vPipeline);
     addObject(i);
   }
 
-  //   for (auto &i : vPointLights) {
-  //     i->setPipeline(&vLightPipeline);
-  //     addObject(i);
-  //   }
+  for (auto &i : vPointLights)
+    addObject(i);
 
-  //    for ( auto &i : vDirectionalLights ) {
-  //       i->setPipeline( &vLightPipeline );
-  //       addObject( i );
-  //    }
+  for (auto &i : vDirectionalLights)
+    addObject(i);
 
   if (!canRenderScene()) {
     eLOG("Cannot render scene!");
@@ -94,14 +164,19 @@ int myScene::init() {
 void myScene::destroy() {
   vRunMovementThread = false;
   vPipeline.destroy();
-  //   vLightPipeline.destroy();
   vShader.destroy();
-  //   vLightShader.destroy();
+  vShaderCompressed.destroy();
+  vShaderIndirect.destroy();
+  vShaderDeferred.destroy();
+  vShaderVirtual.destroy();
+  vVirtualTexture.destroy();
 
   for (auto i : vObjects)
     i->destroy();
 
   vObjects.clear();
+  vPointLights.clear();
+  vDirectionalLights.clear();
 }
 
 void myScene::objectMoveLoop() {
@@ -121,6 +196,10 @@ void myScene::objectMoveLoop() {
 
     float lRotDeg = lDuration.count() / 50.0f;
 
+    // Loads the pages reported by the last frames
+    if (vVirtual)
+      vVirtualTexture.update(getWorldPtr());
+
     std::lock_guard<std::mutex> lLock(vObjAccesMut);
     for (auto &i : vObjects)
       i->setRotation(lAxis, glm::radians(lRotDeg));
@@ -151,9 +230,6 @@ void myScene::keySlot(const iEventInfo &_inf) {
 void myScene::afterCameraUpdate() {
   for (auto &i : vObjects)
     i->updateFinalMatrix();
-
-  //    vLight1.updateFinalMatrix();
-  //    vLight2.updateFinalMatrix();
 }
 
 
@@ -21,14 +21,18 @@
 #define MY_SCENE_HPP
 
 #include "SPIRV_triangle1.hpp"
+#include "SPIRV_triangle1c.hpp"
+#include "SPIRV_indirect.hpp"
 #include "cmdANDinit.hpp"
 #include <engine.hpp>
 #include "SPIRV_deferred1.hpp"
-#include "SPIRV_deferred2.hpp"
+#include "SPIRV_virtual.hpp"
 
 using e_engine::SPIRV_deferred1;
-using e_engine::SPIRV_deferred2;
+using e_engine::SPIRV_indirect;
 using e_engine::SPIRV_triangle1;
+using e_engine::SPIRV_triangle1c;
+using e_engine::SPIRV_virtual;
 using e_engine::iEventInfo;
 using e_engine::iInit;
 using e_engine::rCameraHandler;
@@ -37,6 +41,7 @@ using e_engine::rPipeline;
 using e_engine::rPointLightF;
 using e_engine::rScene;
 using e_engine::rSimpleMesh;
+using e_engine::rVirtualTexture;
 using e_engine::rWorld;
 using e_engine::uSlot;
 
@@ -48,10 +53,14 @@ class myScene final : public rScene<float>, public rCameraHandler<float> {
   OBJECTS<rPointLightF>       vPointLights;
   OBJECTS<rDirectionalLightF> vDirectionalLights;
 
-  rPipeline vPipeline;
-  //   rPipeline       vLightPipeline;
-  SPIRV_triangle1 vShader;
-  //   SPIRV_deferred2 vLightShader;
+  rPipeline        vPipeline;
+  SPIRV_triangle1  vShader;
+  SPIRV_triangle1c vShaderCompressed;
+  SPIRV_indirect   vShaderIndirect;
+  SPIRV_deferred1  vShaderDeferred;
+  SPIRV_virtual    vShaderVirtual;
+
+  rVirtualTexture vVirtualTexture; //!< Generated pages (--virtual)
 
   std::string vShader_str;
   std::string vNormalShader_str;
@@ -65,6 +74,10 @@ class myScene final : public rScene<float>, public rCameraHandler<float> {
   float  vRotationAngle;
   bool   vRenderNormals;
   bool   vRunMovementThread = true;
+  bool   vCompressed;
+  bool   vGPUCulling;
+  bool   vDeferred;
+  bool   vVirtual;
 
   void objectMoveLoop();
 
@@ -76,13 +89,21 @@ class myScene final : public rScene<float>, public rCameraHandler<float> {
       : rScene("MAIN SCENE", _world),
         rCameraHandler(this, _world->getInitPtr()),
         vShader(_world->getDevice()),
-        //         vLightShader(_world),
+        vShaderCompressed(_world->getDevice()),
+        vShaderIndirect(_world->getDevice()),
+        vShaderDeferred(_world->getDevice()),
+        vShaderVirtual(_world->getDevice()),
+        vVirtualTexture(_world->getDevice()),
         vShader_str(_cmd.getShader()),
         vNormalShader_str(_cmd.getNormalShader()),
         vFilePath(_cmd.getMesh()),
         vKeySlot(&myScene::keySlot, this),
         vRotationAngle(0),
-        vRenderNormals(_cmd.getRenderNormals()) {
+        vRenderNormals(_cmd.getRenderNormals()),
+        vCompressed(_cmd.getCompressed()),
+        vGPUCulling(_cmd.getGPUCulling()),
+        vDeferred(_cmd.getDeferred()),
+        vVirtual(_cmd.getVirtual()) {
     _world->getInitPtr()->addKeySlot(&vKeySlot);
   }
 
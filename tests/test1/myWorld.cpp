@@ -94,6 +94,13 @@ int myWorld::initGL() {
   int lReturn = vScene.init();
   updateClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   vRenderer->renderScene(&vScene);
+
+  // The shadow maps must be initialized before the deferred renderer binds them
+  if (vShadows) {
+    vShadows->renderScene(&vScene);
+    addRenderer(vShadows);
+  }
+
   addRenderer(vRenderer);
   init(); // Initializes everything
   getRenderLoop()->start();
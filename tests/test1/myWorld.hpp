@@ -21,16 +21,23 @@
 #include "cmdANDinit.hpp"
 #include <engine.hpp>
 #include "myScene.hpp"
+#include "SPIRV_cull.hpp"
+#include "SPIRV_deferred2.hpp"
+#include "SPIRV_shadow.hpp"
 
 #ifndef HANDLER_HPP
 #define HANDLER_HPP
 
 using e_engine::GlobConf;
+using e_engine::SPIRV_cull;
+using e_engine::SPIRV_deferred2;
+using e_engine::SPIRV_shadow;
 using e_engine::iDisplayBasic;
 using e_engine::rFrameCounter;
 using e_engine::rRendererBase;
 using e_engine::rRendererBasic;
 using e_engine::rRendererDeferred;
+using e_engine::rRendererShadow;
 using e_engine::rWorld;
 
 class myWorld final : public rWorld, public rFrameCounter {
@@ -40,7 +47,11 @@ class myWorld final : public rWorld, public rFrameCounter {
   float vAlpha;
 
   std::vector<std::shared_ptr<iDisplayBasic>> vDisp_RandR;
+  SPIRV_cull                                  vCullShader;
+  SPIRV_deferred2                             vLightShader;
+  SPIRV_shadow                                vShadowShader;
   std::shared_ptr<rRendererBase>              vRenderer;
+  std::shared_ptr<rRendererShadow>            vShadows; //!< Only used by the deferred renderer
 
   myScene          vScene;
   e_engine::iInit *vInitPointer;
@@ -63,7 +74,9 @@ class myWorld final : public rWorld, public rFrameCounter {
   myWorld(cmdANDinit &_cmd, e_engine::iInit *_init)
       : rWorld(_init),
         rFrameCounter(this, true),
-        vRenderer(std::make_shared<rRendererBasic>(this, L"R1")),
+        vCullShader(getDevice()),
+        vLightShader(getDevice()),
+        vShadowShader(getDevice()),
         vScene(this, _cmd),
         vInitPointer(_init),
         vNearZ(_cmd.getNearZ()),
@@ -72,6 +85,15 @@ class myWorld final : public rWorld, public rFrameCounter {
         slotResize(&myWorld::resize, this),
         slotKey(&myWorld::key, this) {
 
+    if (_cmd.getDeferred()) {
+      auto lDeferred = std::make_shared<rRendererDeferred>(this, L"R1", &vLightShader);
+      vShadows       = std::make_shared<rRendererShadow>(this, L"S1", &vShadowShader);
+      lDeferred->setShadowRenderer(vShadows.get());
+      vRenderer = lDeferred;
+    } else {
+      vRenderer = std::make_shared<rRendererBasic>(this, L"R1", _cmd.getGPUCulling() ? &vCullShader : nullptr);
+    }
+
     _init->addWindowCloseSlot(&slotWindowClose);
     _init->addResizeSlot(&slotResize);
     _init->addKeySlot(&slotKey);
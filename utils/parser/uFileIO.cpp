@@ -33,8 +33,11 @@ namespace e_engine {
 
 void uFileIO::clear() {
   vFileRead_B = false;
-  vData.clear();
-  vData.resize(0);
+  vFile.close();
+  vBuffer.clear();
+  vBuffer.shrink_to_fit();
+  vData = nullptr;
+  vSize = 0;
 }
 
 std::string uFileIO::getFilePath() { return vFilePath_str; }
@@ -44,6 +47,8 @@ void uFileIO::setFilePath(std::string _file) { vFilePath_str = _file; }
 /*!
  * \brief Reads the file
  *
+ * MAPPED maps the file (see uMappedFile), BUFFERED reads it with one bulk read.
+ *
  * \param[in] _autoReload when true, runns clear(); when file is already read (default: false)
  *
  * \returns 1 if everything went fine
@@ -56,6 +61,8 @@ int uFileIO::read(bool _autoReload) {
   if (vFileRead_B == true && _autoReload == false)
     return 2;
 
+  clear();
+
   fs::path lFilePath_BFS(vFilePath_str.c_str());
 
   if (!fs::exists(lFilePath_BFS)) {
@@ -68,41 +75,65 @@ int uFileIO::read(bool _autoReload) {
     return 4;
   }
 
+  if (vMode == MAPPED) {
+    if (!vFile.open(vFilePath_str, true))
+      return 5;
+
+    vData = static_cast<char const *>(vFile.data());
+    vSize = vFile.size();
+  } else {
+    int lRet = readBuffered();
+    if (lRet != 1)
+      return lRet;
+  }
+
+  vFileRead_B = true;
+
+  return 1;
+}
+
+int uFileIO::readBuffered() {
   FILE *lFile = fopen(vFilePath_str.c_str(), "rb");
   if (lFile == nullptr) {
     eLOG("Unable to open ", vFilePath_str);
     return 5;
   }
 
-  int  c;
-  auto lSize = fs::file_size(lFilePath_BFS);
-
-  if (lSize != static_cast<uintmax_t>(-1)) {
-    vData.resize(lSize);
-
-    for (auto &i : vData) {
-      if ((c = fgetc(lFile)) == EOF) {
-        wLOG("File size missmatch (to small)! File: '", vFilePath_str, "'");
-        break;
-      }
+  std::error_code lError;
+  auto            lSize = fs::file_size(vFilePath_str, lError);
 
-      i = static_cast<char>(c);
-    }
+  if (lError) {
+    wLOG("Unable to obtain the file size!");
+    lSize = 0;
+  }
 
-    if ((c = fgetc(lFile)) != EOF)
-      wLOG("File size missmatch (to large)! File: '", vFilePath_str, "'");
+  // The size is only a hint (the file may change while it is read)
+  vBuffer.resize(static_cast<size_t>(lSize) + 1);
+  size_t lRead = 0;
 
-  } else {
-    wLOG("Unable to obtain the file size!");
+  while (true) {
+    lRead += fread(&vBuffer[lRead], 1, vBuffer.size() - lRead, lFile);
+    if (lRead < vBuffer.size())
+      break;
 
-    while ((c = fgetc(lFile)) != EOF)
-      vData += static_cast<char>(c);
+    vBuffer.resize(vBuffer.size() * 2);
   }
 
+  bool lFailed = ferror(lFile) != 0;
   fclose(lFile);
 
-  vFileRead_B = true;
+  if (lFailed) {
+    eLOG("Failed to read ", vFilePath_str);
+    vBuffer.clear();
+    return 5;
+  }
+
+  if (lRead != static_cast<size_t>(lSize))
+    wLOG("File size missmatch! File: '", vFilePath_str, "'");
 
+  vBuffer.resize(lRead);
+  vData = vBuffer.data();
+  vSize = vBuffer.size();
   return 1;
 }
 
@@ -146,11 +177,14 @@ int uFileIO::write(const uFileIO::TYPE &_data, bool _overWrite) {
     return 5;
   }
 
-  for (char ch : _data)
-    fputc(ch, lFile);
-
+  size_t lWritten = fwrite(_data.data(), 1, _data.size(), lFile);
   fclose(lFile);
 
+  if (lWritten != _data.size()) {
+    eLOG("Failed to write '", vFilePath_str, "'");
+    return 5;
+  }
+
   return 1;
 }
 } // namespace e_engine
@@ -21,42 +21,67 @@
 #pragma once
 
 #include "defines.hpp"
+#include "uMappedFile.hpp"
 #include <string>
 #include <vector>
 
 namespace e_engine {
 
+/*!
+ * \brief Reads and writes whole files
+ *
+ * In the default mode MAPPED the file is mapped into memory (uMappedFile, with sequential read ahead)
+ * and the data is accessed without copying it. BUFFERED reads the file with one bulk read into memory.
+ * Use uFileStream to read large files in chunks.
+ *
+ * \note The data (begin() / end() / data()) is valid until clear(), the next read() or the destructor
+ */
 class uFileIO final {
  public:
-  typedef std::string::const_iterator C_ITERATOR;
-  typedef std::string::iterator       ITERATOR;
+  enum MODE {
+    MAPPED,  //!< Map the file (falls back to BUFFERED if mapping is not possible)
+    BUFFERED //!< Read the file into memory
+  };
+
+  typedef char const *C_ITERATOR;
 
   typedef std::string TYPE;
 
  private:
   std::string vFilePath_str;
-  TYPE        vData;
+  MODE        vMode = MAPPED;
+
+  uMappedFile vFile;
+  std::string vBuffer; //!< Data of BUFFERED
+  char const *vData = nullptr;
+  size_t      vSize = 0;
   bool        vFileRead_B;
 
+  int readBuffered();
+
  public:
   uFileIO() : vFileRead_B(false) {}
-  uFileIO(std::string _file) : vFilePath_str(_file), vFileRead_B(false) {}
+  uFileIO(std::string _file, MODE _mode = MAPPED) : vFilePath_str(_file), vMode(_mode), vFileRead_B(false) {}
   void        setFilePath(std::string _file);
   std::string getFilePath();
 
-  C_ITERATOR begin() const { return vData.begin(); }
-  ITERATOR   begin() { return vData.begin(); }
+  C_ITERATOR begin() const { return vData; }
+  C_ITERATOR end() const { return vData + vSize; }
 
-  C_ITERATOR end() const { return vData.end(); }
-  ITERATOR   end() { return vData.end(); }
+  char const *data() const { return vData; }
+  size_t      size() const { return vSize; }
 
   bool isFileRead() { return vFileRead_B; }
+  bool isMapped() { return vFile.isMapped(); }
+
+  void setMode(MODE _mode) { vMode = _mode; }
+  MODE getMode() const { return vMode; }
 
   int  read(bool _autoReload = true);
   int  write(TYPE const &_data, bool _overWrite = false);
   void clear();
 
-  TYPE *getData() { return &vData; }
+  TYPE getString() const { return TYPE(vData, vSize); }
 
   int operator()(bool _autoReload = true) { return read(_autoReload); }
 };
@@ -0,0 +1,104 @@
+/*!
+ * \file uFileStream.cpp
+ * \brief \b Classes: \a uFileStream
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uFileStream.hpp"
+#include "uLog.hpp"
+#include <string.h>
+
+#if UNIX
+#include <fcntl.h>
+#endif
+
+namespace e_engine {
+
+uFileStream::~uFileStream() { close(); }
+
+/*!
+ * \brief Opens _path (the first chunk is read with next())
+ * \returns true on success
+ */
+bool uFileStream::open(std::string const &_path) {
+  close();
+
+  vFile = fopen(_path.c_str(), "rb");
+  if (vFile == nullptr) {
+    eLOG("Unable to open '", _path, "'");
+    return false;
+  }
+
+#if UNIX
+  posix_fadvise(fileno(vFile), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  // The chunks are read into vBuffer directly
+  setvbuf(vFile, nullptr, _IONBF, 0);
+  vBuffer.resize(vChunkSize);
+  return true;
+}
+
+/*!
+ * \brief Replaces the data with the next chunk of the file
+ *
+ * \param _keep The last _keep bytes of the current data are moved to the front of the new data (i.e.
+ *              a token that continues in the next chunk)
+ * \returns false at the end of the file or on errors (only the kept bytes are left)
+ */
+bool uFileStream::next(size_t _keep) {
+  if (vFile == nullptr)
+    return false;
+
+  _keep = _keep < vSize ? _keep : vSize;
+
+  if (_keep > 0)
+    memmove(vBuffer.data(), vBuffer.data() + vSize - _keep, _keep);
+
+  vSize = _keep;
+
+  if (vEOF)
+    return false;
+
+  if (vBuffer.size() < _keep + vChunkSize)
+    vBuffer.resize(_keep + vChunkSize);
+
+  size_t lRead = fread(vBuffer.data() + _keep, 1, vChunkSize, vFile);
+
+  if (lRead < vChunkSize) {
+    vEOF = true;
+
+    if (ferror(vFile) != 0)
+      eLOG("Failed to read file");
+  }
+
+  vSize += lRead;
+  return lRead > 0;
+}
+
+void uFileStream::close() {
+  if (vFile != nullptr)
+    fclose(vFile);
+
+  vFile = nullptr;
+  vSize = 0;
+  vEOF  = false;
+  vBuffer.clear();
+  vBuffer.shrink_to_fit();
+}
+} // namespace e_engine
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
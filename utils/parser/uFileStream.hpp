@@ -0,0 +1,64 @@
+/*!
+ * \file uFileStream.hpp
+ * \brief \b Classes: \a uFileStream
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <stddef.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Reads a file sequentially in chunks of a fixed size
+ *
+ * Only one chunk (plus the bytes kept with next()) is in memory, so files of any size can be parsed
+ * incrementally (uParserHelper::parse with _stream). Every chunk is read with one bulk read.
+ */
+class uFileStream final {
+ private:
+  FILE *            vFile = nullptr;
+  std::vector<char> vBuffer;
+  size_t            vChunkSize;
+  size_t            vSize = 0; //!< Valid bytes in vBuffer
+  bool              vEOF  = false;
+
+ public:
+  uFileStream(size_t _chunkSize = 64 * 1024) : vChunkSize(_chunkSize > 0 ? _chunkSize : 1) {}
+  ~uFileStream();
+
+  uFileStream(uFileStream const &) = delete;
+  uFileStream &operator=(const uFileStream &) = delete;
+
+  bool open(std::string const &_path);
+  bool next(size_t _keep = 0);
+  void close();
+
+  inline char const *data() const noexcept { return vBuffer.data(); }
+  inline size_t      size() const noexcept { return vSize; }
+  inline bool        isOpen() const noexcept { return vFile != nullptr; }
+  inline bool        isEOF() const noexcept { return vEOF; }
+};
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,127 @@
+/*!
+ * \file uMappedFile.cpp
+ * \brief \b Classes: \a uMappedFile
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uMappedFile.hpp"
+#include "uLog.hpp"
+#include <stdio.h>
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace e_engine {
+
+uMappedFile::~uMappedFile() { close(); }
+
+/*!
+ * \brief Maps the file _path
+ * \param _sequential Hint that the file is read from the beginning to the end (otherwise the whole file is needed)
+ * \returns true on success
+ */
+bool uMappedFile::open(std::string const &_path, bool _sequential) {
+  close();
+
+#if UNIX
+  int lFD = ::open(_path.c_str(), O_RDONLY);
+  if (lFD < 0) {
+    eLOG("Unable to open '", _path, "'");
+    return false;
+  }
+
+  struct stat lStat;
+  if (fstat(lFD, &lStat) != 0 || !S_ISREG(lStat.st_mode)) {
+    eLOG("'", _path, "' is not a file!");
+    ::close(lFD);
+    return false;
+  }
+
+  vSize = static_cast<size_t>(lStat.st_size);
+  if (vSize == 0) {
+    ::close(lFD);
+    vBuffer.push_back(0); // Empty files can not be mapped
+    vData = vBuffer.data();
+    return true;
+  }
+
+  void *lMap = mmap(nullptr, vSize, PROT_READ, MAP_PRIVATE, lFD, 0);
+  ::close(lFD); // The mapping keeps the file open
+
+  if (lMap != MAP_FAILED) {
+    madvise(lMap, vSize, _sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+    vData     = lMap;
+    vIsMapped = true;
+    return true;
+  }
+
+  wLOG("Failed to map '", _path, "' ==> reading it");
+#else
+  (void)_sequential;
+#endif
+
+  return readFallback(_path);
+}
+
+bool uMappedFile::readFallback(std::string const &_path) {
+  FILE *lFile = fopen(_path.c_str(), "rb");
+  if (lFile == nullptr) {
+    eLOG("Unable to open '", _path, "'");
+    return false;
+  }
+
+  vBuffer.clear();
+
+  char   lChunk[65536];
+  size_t lRead;
+  while ((lRead = fread(lChunk, 1, sizeof(lChunk), lFile)) > 0)
+    vBuffer.insert(vBuffer.end(), lChunk, lChunk + lRead);
+
+  bool lError = ferror(lFile) != 0;
+  fclose(lFile);
+
+  if (lError) {
+    eLOG("Failed to read '", _path, "'");
+    vBuffer.clear();
+    return false;
+  }
+
+  vBuffer.push_back(0); // vData must not be nullptr for empty files
+  vData = vBuffer.data();
+  vSize = vBuffer.size() - 1;
+  return true;
+}
+
+//! \brief Unmaps the file
+void uMappedFile::close() {
+#if UNIX
+  if (vIsMapped)
+    munmap(const_cast<void *>(vData), vSize);
+#endif
+
+  vBuffer.clear();
+  vBuffer.shrink_to_fit();
+  vData     = nullptr;
+  vSize     = 0;
+  vIsMapped = false;
+}
+} // namespace e_engine
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
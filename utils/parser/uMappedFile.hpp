@@ -0,0 +1,67 @@
+/*!
+ * \file uMappedFile.hpp
+ * \brief \b Classes: \a uMappedFile
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Read only view of a whole file
+ *
+ * The file is mapped into memory (mmap) on UNIX systems, so reading it only copies the pages the
+ * kernel already has in its page cache. Other systems (or failed mappings) read the file into a
+ * buffer with one bulk read.
+ *
+ * \note The data is valid until close() / the destructor
+ */
+class uMappedFile final {
+ private:
+  void const *vData     = nullptr;
+  size_t      vSize     = 0;
+  bool        vIsMapped = false;
+
+  std::vector<char> vBuffer; //!< Data of the fallback
+
+  bool readFallback(std::string const &_path);
+
+ public:
+  uMappedFile() = default;
+  ~uMappedFile();
+
+  uMappedFile(uMappedFile const &) = delete;
+  uMappedFile &operator=(const uMappedFile &) = delete;
+
+  bool open(std::string const &_path, bool _sequential = true);
+  void close();
+
+  inline void const *data() const noexcept { return vData; }
+  inline size_t      size() const noexcept { return vSize; }
+  inline bool        isOpen() const noexcept { return vData != nullptr; }
+  inline bool        isMapped() const noexcept { return vIsMapped; }
+};
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
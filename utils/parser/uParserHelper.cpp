@@ -51,6 +51,11 @@ void uParserHelper::setFile(std::string _file) { vFilePath_str = _file; }
 
 /*!
  * \brief loads the content of the JSON file
+ *
+ * The whole file is mapped into memory (uFileIO::MAPPED) and parsed without copying it. With _stream
+ * the file is read in chunks of _chunkSize bytes (uFileStream) and parsed incrementally, so only one
+ * chunk is in memory.
+ *
  * \returns 1 on success
  * \returns 2 if there was a parsing error
  * \returns 3 if the file file doesn't exists
@@ -58,19 +63,38 @@ void uParserHelper::setFile(std::string _file) { vFilePath_str = _file; }
  * \returns 5 if the file file is not readable
  * \returns 6 if already parsed
  */
-int uParserHelper::parse() {
+int uParserHelper::parse(bool _stream, size_t _chunkSize) {
   if (vIsParsed)
     return 6;
 
-  uFileIO lFile(vFilePath_str);
-  int     lRet = lFile();
-  if (lRet != 1)
-    return lRet;
+  uFileIO     lFile(vFilePath_str);
+  uFileStream lStream(_chunkSize);
+
+  if (_stream) {
+    if (!lStream.open(vFilePath_str))
+      return 5;
+
+    vStream = &lStream;
+    vIter   = lStream.data();
+    vEnd    = vIter;
+  } else {
+    int lRet = lFile();
+    if (lRet != 1)
+      return lRet;
 
-  vIter = lFile.begin();
-  vEnd  = lFile.end();
+    vIter = lFile.begin();
+    vEnd  = lFile.end();
+  }
+
+  vMark     = nullptr;
+  bool lRes = load_IMPL();
 
-  if (!load_IMPL()) {
+  vStream = nullptr;
+  vIter   = nullptr;
+  vEnd    = nullptr;
+  vMark   = nullptr;
+
+  if (!lRes) {
     eLOG("Failed parsing '", vFilePath_str, "'");
     return 2;
   }
@@ -84,10 +108,17 @@ int uParserHelper::parseString(std::string _data) {
   if (vIsParsed)
     return 6;
 
-  vIter = _data.begin();
-  vEnd  = _data.end();
+  vIter = _data.data();
+  vEnd  = _data.data() + _data.size();
+  vMark = nullptr;
+
+  bool lRes = load_IMPL();
 
-  if (!load_IMPL()) {
+  vIter = nullptr;
+  vEnd  = nullptr;
+  vMark = nullptr;
+
+  if (!lRes) {
     eLOG("Failed parsing '", vFilePath_str, "'");
     return 2;
   }
@@ -97,10 +128,28 @@ int uParserHelper::parseString(std::string _data) {
   return 1;
 }
 
+/*!
+ * \brief Reads the next chunk of the stream (everything after the mark is kept)
+ * \returns false if there is no data left
+ */
+bool uParserHelper::refill() {
+  if (!vStream)
+    return false;
+
+  size_t lKeep = vMark ? static_cast<size_t>(vEnd - vMark) : 0;
+  bool   lRes  = vStream->next(lKeep);
+
+  // The data was moved (the kept bytes are at the front)
+  char const *lData = vStream->data();
+  vMark             = vMark ? lData : nullptr;
+  vIter             = lData + lKeep;
+  vEnd              = lData + vStream->size();
 
+  return lRes && vIter != vEnd;
+}
 
 bool uParserHelper::continueWhitespace(bool _quiet) {
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '\n': ++vCurrentLine; FALLTHROUGH
       case '\t':
@@ -143,6 +192,9 @@ bool uParserHelper::expect(std::string _str, bool _continueWhitespace, bool _qui
     return false;
 
   for (char c : _str) {
+    if (!hasData())
+      return _quiet ? false : eofError();
+
     if (*vIter != c) {
       if (!_quiet) {
         eLOG("Expected '", _str, "' at line ", vCurrentLine, ", but got a '", *vIter, "' [", vFilePath_str, "]");
@@ -168,12 +220,12 @@ bool uParserHelper::getString(std::string &_str, bool _continueWhitespace, bool
 
   _str.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '\\':
         ++vIter;
 
-        if (vIter == vEnd)
+        if (!hasData())
           return eofError();
 
         switch (*vIter) {
@@ -212,7 +264,7 @@ bool uParserHelper::getNum(double &_num, bool _quiet) {
   static std::string lNum;
   lNum.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '-':
       case '.':
@@ -255,7 +307,7 @@ bool uParserHelper::getNum(float &_num, bool _quiet) {
   static std::string lNum;
   lNum.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '-':
       case '.':
@@ -298,7 +350,7 @@ bool uParserHelper::getNum(int &_num, bool _quiet) {
   static std::string lNum;
   lNum.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '-':
       case '0':
@@ -339,7 +391,7 @@ bool uParserHelper::getNum(unsigned int &_num, bool _quiet) {
   static std::string lNum;
   lNum.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '0':
       case '1':
@@ -378,7 +430,7 @@ bool uParserHelper::getNum(unsigned short &_num, bool _quiet) {
   static std::string lNum;
   lNum.clear();
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '0':
       case '1':
@@ -22,6 +22,7 @@
 
 #include "defines.hpp"
 
+#include "uFileStream.hpp"
 #include <string>
 
 namespace e_engine {
@@ -32,11 +33,27 @@ class uParserHelper {
   std::string vFilePath_str;
   bool        vIsParsed = false;
 
-  std::string::const_iterator vIter;
-  std::string::const_iterator vEnd;
+  char const *vIter = nullptr;
+  char const *vEnd  = nullptr;
+  char const *vMark = nullptr; //!< Kept when the next chunk is read (setMark())
+
+  uFileStream *vStream = nullptr; //!< Source of the next chunks (parse() with _stream)
 
   unsigned int vCurrentLine = 1;
 
+  bool refill();
+
+  //! \brief Returns true if there is data left (reads the next chunk when streaming)
+  inline bool hasData() { return vIter != vEnd || refill(); }
+
+  //! \brief The parser can go back to the current position with resetToMark()
+  inline void setMark() { vMark = vIter; }
+  inline void resetToMark() {
+    vIter = vMark;
+    vMark = nullptr;
+  }
+  inline void clearMark() { vMark = nullptr; }
+
   bool continueWhitespace(bool _quiet = false);
   bool expect(char _c, bool _continueWhitespace = true, bool _quiet = false);
   bool expect(std::string _str, bool _continueWhitespace = true, bool _quiet = false);
@@ -57,7 +74,7 @@ class uParserHelper {
   uParserHelper() {}
   uParserHelper(std::string _file) : vFilePath_str(_file) {}
 
-  int parse();
+  int parse(bool _stream = false, size_t _chunkSize = 64 * 1024);
   int parseString(std::string _data);
 
   int operator()() { return parse(); }
@@ -104,14 +104,15 @@ bool uParserJSON::parseValue(e_engine::uJSON_data &_currentObject, const std::st
     // Number
     default: {
       _currentObject.value_obj.emplace_back(_name, JSON_NUMBER);
-      auto lTempIter = vIter;
+      setMark();
       if (getNum(_currentObject.value_obj.back().value_int, true)) {
+        clearMark();
         _currentObject.value_obj.back().type      = JSON_INT;
         _currentObject.value_obj.back().value_num = static_cast<double>(_currentObject.value_obj.back().value_int);
         break;
       }
 
-      vIter = lTempIter;
+      resetToMark();
       if (!getNum(_currentObject.value_obj.back().value_num))
         return false;
 
@@ -187,7 +188,7 @@ bool uParserJSON::load_IMPL() {
   if (!parseObject(vData))
     return false;
 
-  while (vIter != vEnd) {
+  while (hasData()) {
     switch (*vIter) {
       case '\n': vCurrentLine++; FALLTHROUGH;
       case '\t':
@@ -0,0 +1,727 @@
+/*!
+ * \file uAsyncIO.cpp
+ * \brief \b Classes: \a uAsyncIO
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uAsyncIO.hpp"
+#include "uLog.hpp"
+#include "uThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#if UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+// io_uring is used with the raw system calls (no liburing needed)
+#if defined(IORING_OFF_SQ_RING) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define E_ASYNC_IO_URING 1
+#else
+#define E_ASYNC_IO_URING 0
+#endif
+
+namespace e_engine {
+
+namespace {
+
+const size_t   MIN_BLOCK_SIZE   = 64 * 1024; //!< Smallest size class of the pool
+const uint32_t NUM_SIZE_CLASSES = 11;        //!< Size classes (powers of two) up to 64 MiB
+const int      MAX_BACKOFF      = 7;         //!< Longest wait after io_uring_enter errors: 2^7 ms
+
+//! \returns the size class of _size or UINT32_MAX if the size is too large for the pool
+uint32_t sizeClass(size_t _size) {
+  uint32_t lClass = 0;
+  for (size_t lBlock = MIN_BLOCK_SIZE; lBlock < _size; lBlock <<= 1)
+    lClass++;
+
+  return lClass < NUM_SIZE_CLASSES ? lClass : UINT32_MAX;
+}
+} // namespace
+
+//! \brief Unused memory of finished reads, sorted by size class
+struct uAsyncIO::Pool {
+  std::mutex                           mutex;
+  std::vector<std::unique_ptr<char[]>> free[NUM_SIZE_CLASSES];
+  size_t                               pooled = 0; //!< Bytes in free
+  size_t                               maxPooled;
+
+  Pool(size_t _maxPooled) : maxPooled(_maxPooled) {}
+};
+
+//! \brief Takes a block of at least _size bytes from the pool (allocated if the pool has none)
+uAsyncIO::Block::Block(std::shared_ptr<Pool> _pool, size_t _size)
+    : vSize(_size), vClass(sizeClass(_size)), vPool(std::move(_pool)) {
+  if (vClass == UINT32_MAX) {
+    vData.reset(new char[std::max<size_t>(_size, 1)]);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lLock(vPool->mutex);
+    auto &                      lFree = vPool->free[vClass];
+    if (!lFree.empty()) {
+      vData = std::move(lFree.back());
+      lFree.pop_back();
+      vPool->pooled -= MIN_BLOCK_SIZE << vClass;
+      return;
+    }
+  }
+
+  vData.reset(new char[MIN_BLOCK_SIZE << vClass]); // Not initialized (overwritten by the read)
+}
+
+//! \brief Returns the memory to the pool (freed if the pool is full)
+uAsyncIO::Block::~Block() {
+  if (vClass == UINT32_MAX || !vData)
+    return;
+
+  std::lock_guard<std::mutex> lLock(vPool->mutex);
+  if (vPool->pooled + (MIN_BLOCK_SIZE << vClass) > vPool->maxPooled)
+    return;
+
+  vPool->pooled += MIN_BLOCK_SIZE << vClass;
+  vPool->free[vClass].emplace_back(std::move(vData));
+}
+
+struct uAsyncIO::Request {
+  std::string path;
+  uint64_t    offset;
+  size_t      size; //!< 0 until openRequest(): read until the end of the file
+  PRIORITY    priority;
+  CallBack    callback;
+
+  Buffer data;
+  size_t done = 0; //!< Bytes read
+
+#if UNIX
+  int          fd = -1;
+  struct iovec iov; //!< Target of the io_uring read (must live until the read is completed)
+#else
+  FILE *file = nullptr;
+#endif
+
+  Request(std::string _path, CallBack _callback, PRIORITY _priority, uint64_t _offset, size_t _size)
+      : path(std::move(_path)),
+        offset(_offset),
+        size(_size),
+        priority(_priority == VISIBLE ? VISIBLE : PREFETCH),
+        callback(std::move(_callback)) {}
+};
+
+#if E_ASYNC_IO_URING
+
+/*!
+ * \brief The submission and completion queues of an io_uring (mapped from the kernel)
+ *
+ * Only the I/O thread (ringWorker()) accesses the ring, other threads only write to eventFD (wake()).
+ * Every request in flight has at most one submission queue entry, so the queues can not overflow as
+ * long as at most numEntries - 1 requests are in flight (one entry polls eventFD).
+ */
+struct uAsyncIO::Ring {
+  int    fd         = -1;
+  int    eventFD    = -1;
+  void * sqRing     = MAP_FAILED;
+  void * cqRing     = MAP_FAILED;
+  void * sqeMap     = MAP_FAILED;
+  size_t sqRingSize = 0;
+  size_t cqRingSize = 0;
+  size_t sqeMapSize = 0;
+
+  unsigned *    sqTail  = nullptr;
+  unsigned *    sqMask  = nullptr;
+  unsigned *    sqArray = nullptr;
+  io_uring_sqe *sqes    = nullptr;
+  unsigned *    cqHead  = nullptr;
+  unsigned *    cqTail  = nullptr;
+  unsigned *    cqMask  = nullptr;
+  io_uring_cqe *cqes    = nullptr;
+
+  unsigned               numEntries = 0;
+  bool                   wakeArmed  = false; //!< A poll of eventFD is in the ring
+  bool                   canWake    = true;  //!< false if the kernel does not support the poll
+  std::vector<Request *> pending;            //!< Entries not taken by the kernel yet (nullptr: poll)
+
+  ~Ring();
+
+  bool                   init(uint32_t _entries);
+  void                   push(Request &_request);
+  void                   pushWake();
+  void                   wake();
+  int                    enter(unsigned _minComplete);
+  std::vector<Request *> dropPending();
+};
+
+uAsyncIO::Ring::~Ring() {
+  if (sqeMap != MAP_FAILED)
+    munmap(sqeMap, sqeMapSize);
+
+  if (cqRing != MAP_FAILED)
+    munmap(cqRing, cqRingSize);
+
+  if (sqRing != MAP_FAILED)
+    munmap(sqRing, sqRingSize);
+
+  if (fd >= 0)
+    ::close(fd);
+
+  if (eventFD >= 0)
+    ::close(eventFD);
+}
+
+//! \returns false if the kernel does not support io_uring (errno is set)
+bool uAsyncIO::Ring::init(uint32_t _entries) {
+  io_uring_params lParams;
+  memset(&lParams, 0, sizeof(lParams));
+
+  eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (eventFD < 0)
+    return false;
+
+  fd = static_cast<int>(syscall(__NR_io_uring_setup, _entries, &lParams));
+  if (fd < 0)
+    return false;
+
+  numEntries = lParams.sq_entries;
+  sqRingSize = lParams.sq_off.array + lParams.sq_entries * sizeof(unsigned);
+  cqRingSize = lParams.cq_off.cqes + lParams.cq_entries * sizeof(io_uring_cqe);
+  sqeMapSize = lParams.sq_entries * sizeof(io_uring_sqe);
+
+  int lProt  = PROT_READ | PROT_WRITE;
+  int lFlags = MAP_SHARED | MAP_POPULATE;
+
+  sqRing = mmap(nullptr, sqRingSize, lProt, lFlags, fd, IORING_OFF_SQ_RING);
+  cqRing = mmap(nullptr, cqRingSize, lProt, lFlags, fd, IORING_OFF_CQ_RING);
+  sqeMap = mmap(nullptr, sqeMapSize, lProt, lFlags, fd, IORING_OFF_SQES);
+
+  if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqeMap == MAP_FAILED)
+    return false;
+
+  auto *lSQ = static_cast<uint8_t *>(sqRing);
+  auto *lCQ = static_cast<uint8_t *>(cqRing);
+
+  sqTail  = reinterpret_cast<unsigned *>(lSQ + lParams.sq_off.tail);
+  sqMask  = reinterpret_cast<unsigned *>(lSQ + lParams.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned *>(lSQ + lParams.sq_off.array);
+  sqes    = static_cast<io_uring_sqe *>(sqeMap);
+  cqHead  = reinterpret_cast<unsigned *>(lCQ + lParams.cq_off.head);
+  cqTail  = reinterpret_cast<unsigned *>(lCQ + lParams.cq_off.tail);
+  cqMask  = reinterpret_cast<unsigned *>(lCQ + lParams.cq_off.ring_mask);
+  cqes    = reinterpret_cast<io_uring_cqe *>(lCQ + lParams.cq_off.cqes);
+
+  return true;
+}
+
+//! \brief Queues a read of the remaining bytes of _request (submitted with enter())
+void uAsyncIO::Ring::push(Request &_request) {
+  unsigned lTail  = *sqTail; // Only written by this thread
+  unsigned lIndex = lTail & *sqMask;
+
+  _request.iov.iov_base = _request.data->data() + _request.done;
+  _request.iov.iov_len  = _request.size - _request.done;
+
+  io_uring_sqe *lSQE = &sqes[lIndex];
+  memset(lSQE, 0, sizeof(io_uring_sqe));
+  lSQE->opcode    = IORING_OP_READV;
+  lSQE->fd        = _request.fd;
+  lSQE->off       = _request.offset + _request.done;
+  lSQE->addr      = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&_request.iov));
+  lSQE->len       = 1;
+  lSQE->user_data = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&_request));
+
+  sqArray[lIndex] = lIndex;
+  __atomic_store_n(sqTail, lTail + 1, __ATOMIC_RELEASE);
+  pending.push_back(&_request);
+}
+
+//! \brief Queues a poll of eventFD, which completes (user_data 0) once wake() was called
+void uAsyncIO::Ring::pushWake() {
+  unsigned lTail  = *sqTail;
+  unsigned lIndex = lTail & *sqMask;
+
+  io_uring_sqe *lSQE = &sqes[lIndex];
+  memset(lSQE, 0, sizeof(io_uring_sqe));
+  lSQE->opcode      = IORING_OP_POLL_ADD;
+  lSQE->fd          = eventFD;
+  lSQE->poll_events = POLLIN;
+  lSQE->user_data   = 0;
+
+  sqArray[lIndex] = lIndex;
+  __atomic_store_n(sqTail, lTail + 1, __ATOMIC_RELEASE);
+  pending.push_back(nullptr);
+  wakeArmed = true;
+}
+
+//! \brief Wakes the I/O thread from enter() (thread safe)
+void uAsyncIO::Ring::wake() {
+  if (eventfd_write(eventFD, 1) != 0)
+    wLOG("Failed to wake the I/O thread: ", strerror(errno));
+}
+
+/*!
+ * \brief Submits all pending entries and waits for _minComplete completions
+ * \returns the number of submitted entries or -1 on errors (errno is set, EINTR is no error)
+ */
+int uAsyncIO::Ring::enter(unsigned _minComplete) {
+  unsigned lFlags   = _minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  unsigned lPending = static_cast<unsigned>(pending.size());
+  int      lRes     = static_cast<int>(syscall(__NR_io_uring_enter, fd, lPending, _minComplete, lFlags, nullptr, 0));
+
+  if (lRes < 0)
+    return errno == EINTR ? 0 : -1;
+
+  pending.erase(pending.begin(), pending.begin() + std::min(lPending, static_cast<unsigned>(lRes)));
+  return lRes;
+}
+
+/*!
+ * \brief Removes the entries the kernel did not take from the submission queue
+ * \returns the requests of the removed entries
+ */
+std::vector<uAsyncIO::Request *> uAsyncIO::Ring::dropPending() {
+  std::vector<Request *> lDropped;
+  for (auto i : pending) {
+    if (i)
+      lDropped.push_back(i);
+    else
+      wakeArmed = false;
+  }
+
+  __atomic_store_n(sqTail, *sqTail - static_cast<unsigned>(pending.size()), __ATOMIC_RELEASE);
+  pending.clear();
+  return lDropped;
+}
+
+#else
+struct uAsyncIO::Ring {
+  bool init(uint32_t) {
+    errno = ENOSYS;
+    return false;
+  }
+
+  void wake() {}
+};
+#endif
+
+/*!
+ * \param _queueDepth Maximum number of reads in flight
+ * \param _useIOUring Use io_uring if the system supports it (otherwise the thread pool)
+ * \param _poolSize   Maximum memory of finished reads that is kept for later reads
+ */
+uAsyncIO::uAsyncIO(uint32_t _queueDepth, bool _useIOUring, size_t _poolSize)
+    : vPool(std::make_shared<Pool>(_poolSize)), vQueueDepth(std::max(_queueDepth, 1u)) {
+  uThreadPool::getPool(); // Create the pool first, so that it is destroyed after this object
+
+  if (_useIOUring) {
+    vRing.reset(new Ring);
+    if (vRing->init(vQueueDepth + 1)) {
+      dLOG("Asynchronous file I/O: io_uring with ", vQueueDepth, " entries");
+      vThread = std::thread(&uAsyncIO::ringWorker, this);
+      return;
+    }
+
+    wLOG("io_uring is not available (", strerror(errno), "); reading files with the thread pool");
+    vRing.reset();
+  }
+
+  vQueueDepth = std::min(vQueueDepth, uThreadPool::getPool().getNumThreads());
+}
+
+//! \brief Finishes all reads
+uAsyncIO::~uAsyncIO() {
+  {
+    std::unique_lock<std::mutex> lLock(vMutex);
+    vStop = true;
+
+    if (!vRing)
+      vCond.wait(lLock, [this]() { return vRunning == 0 && !hasRequests(); });
+  }
+
+  vCond.notify_all();
+
+  if (vThread.joinable())
+    vThread.join();
+}
+
+/*!
+ * \brief Queues a read
+ *
+ * \param _path     The file
+ * \param _callback Called with the data (nullptr on errors) once the read is completed
+ * \param _priority VISIBLE reads are always submitted before PREFETCH reads
+ * \param _offset   First byte to read
+ * \param _size     Number of bytes to read (0: until the end of the file)
+ */
+void uAsyncIO::read(std::string _path, CallBack _callback, PRIORITY _priority, uint64_t _offset, size_t _size) {
+  std::unique_ptr<Request> lRequest(new Request(std::move(_path), std::move(_callback), _priority, _offset, _size));
+
+  {
+    std::lock_guard<std::mutex> lLock(vMutex);
+    push(std::move(lRequest));
+  }
+
+  vCond.notify_one();
+  wakeRing();
+}
+
+/*!
+ * \brief Queues a read
+ * \returns a future for the data (nullptr on errors)
+ */
+std::future<uAsyncIO::Buffer> uAsyncIO::read(std::string _path, PRIORITY _priority, uint64_t _offset, size_t _size) {
+  auto lPromise = std::make_shared<std::promise<Buffer>>();
+  auto lFuture  = lPromise->get_future();
+
+  CallBack lCallBack = [lPromise](Buffer _data) { lPromise->set_value(std::move(_data)); };
+  read(std::move(_path), std::move(lCallBack), _priority, _offset, _size);
+  return lFuture;
+}
+
+/*!
+ * \brief Queues reads of the whole files _paths at once (submitted together)
+ * \returns futures for the data (nullptr on errors) in the order of _paths
+ */
+std::vector<std::future<uAsyncIO::Buffer>> uAsyncIO::readBatch(std::vector<std::string> const &_paths,
+                                                               PRIORITY                        _priority) {
+  std::vector<std::future<Buffer>>      lFutures;
+  std::vector<std::unique_ptr<Request>> lRequests;
+  lFutures.reserve(_paths.size());
+  lRequests.reserve(_paths.size());
+
+  for (auto const &i : _paths) {
+    auto lPromise = std::make_shared<std::promise<Buffer>>();
+    lFutures.emplace_back(lPromise->get_future());
+    lRequests.emplace_back(
+        new Request(i, [lPromise](Buffer _data) { lPromise->set_value(std::move(_data)); }, _priority, 0, 0));
+  }
+
+  {
+    std::lock_guard<std::mutex> lLock(vMutex);
+    for (auto &i : lRequests)
+      push(std::move(i));
+  }
+
+  vCond.notify_one();
+  wakeRing();
+  return lFutures;
+}
+
+//! \brief Queues _request (vMutex must be locked)
+void uAsyncIO::push(std::unique_ptr<Request> _request) {
+  PRIORITY lPriority = _request->priority;
+  vQueues[lPriority].emplace_back(std::move(_request));
+
+  if (!vRing)
+    pump();
+}
+
+//! \brief Takes the next request with the highest priority (without _prefetch only VISIBLE, vMutex must be locked)
+bool uAsyncIO::pop(std::unique_ptr<Request> &_out, bool _prefetch) {
+  for (auto &i : vQueues) {
+    if (i.empty() || (!_prefetch && &i != &vQueues[VISIBLE]))
+      continue;
+
+    _out = std::move(i.front());
+    i.pop_front();
+    return true;
+  }
+
+  return false;
+}
+
+bool uAsyncIO::hasRequests() const noexcept {
+  for (auto const &i : vQueues)
+    if (!i.empty())
+      return true;
+
+  return false;
+}
+
+//! \brief Hands queued requests to the thread pool (fallback, vMutex must be locked)
+void uAsyncIO::pump() {
+  std::unique_ptr<Request> lRequest;
+
+  while (vRunning < vQueueDepth && pop(lRequest)) {
+    vRunning++;
+    uThreadPool::getPool().add([this, lReq = std::move(lRequest)]() {
+      complete(*lReq, readBlocking(*lReq));
+
+      std::lock_guard<std::mutex> lLock(vMutex);
+      vRunning--;
+      pump();
+      vCond.notify_all();
+    });
+  }
+}
+
+//! \brief Lets the I/O thread submit new requests while it waits for reads in flight
+void uAsyncIO::wakeRing() {
+  if (vRing)
+    vRing->wake();
+}
+
+/*!
+ * \brief Submits the queued requests to the io_uring and completes them
+ *
+ * All requests that fit into the ring are submitted with one system call. Files are opened by this
+ * thread; only the reads are asynchronous. Short reads are submitted again for the remaining bytes.
+ *
+ * A quarter of the queue depth is reserved for VISIBLE requests. New requests complete the poll of
+ * the eventfd (wakeRing()), so they are submitted while older reads are still in flight. If the kernel
+ * rejects the submissions, the rejected requests fail and the thread backs off.
+ */
+void uAsyncIO::ringWorker() {
+#if E_ASYNC_IO_URING
+  std::vector<std::unique_ptr<Request>> lNew;
+  uint32_t                              lInFlight    = 0; // Requests owned by the ring
+  uint32_t                              lPrefetching = 0; // PREFETCH requests in lInFlight
+  uint32_t                              lReserved    = std::min(std::max(vQueueDepth / 4, 1u), vQueueDepth - 1);
+  uint32_t                              lMaxPrefetch = vQueueDepth - lReserved; // lReserved only for VISIBLE
+  int                                   lErrors      = 0;                       // Consecutive enter() errors
+
+  // Takes the ownership of a request of the ring back
+  auto lFinish = [&](Request *_req, bool _success) {
+    std::unique_ptr<Request> lOwner(_req);
+    lInFlight--;
+    if (lOwner->priority == PREFETCH)
+      lPrefetching--;
+
+    complete(*lOwner, _success);
+  };
+
+  while (true) {
+    lNew.clear();
+
+    {
+      std::unique_lock<std::mutex> lLock(vMutex);
+      if (lInFlight == 0) {
+        vCond.wait(lLock, [this]() { return vStop || hasRequests(); });
+
+        if (!hasRequests())
+          return; // vStop
+      }
+
+      std::unique_ptr<Request> lRequest;
+      uint32_t                 lNewPrefetch = 0;
+      while (lInFlight + lNew.size() < vQueueDepth && pop(lRequest, lPrefetching + lNewPrefetch < lMaxPrefetch)) {
+        lNewPrefetch += lRequest->priority == PREFETCH ? 1 : 0;
+        lNew.emplace_back(std::move(lRequest));
+      }
+    }
+
+    for (auto &i : lNew) {
+      bool lOpened = openRequest(*i);
+      if (!lOpened || i->size == 0) {
+        complete(*i, lOpened);
+        continue;
+      }
+
+      vRing->push(*i);
+      lInFlight++;
+      lPrefetching += i->priority == PREFETCH ? 1 : 0;
+      i.release(); // Deleted after the read is completed
+    }
+
+    if (lInFlight == 0)
+      continue;
+
+    if (!vRing->wakeArmed && vRing->canWake)
+      vRing->pushWake();
+
+    if (vRing->enter(1) < 0) {
+      eLOG("Failed to submit reads: ", strerror(errno));
+
+      // The kernel did not take the pending entries ==> fail them (submitted reads still complete)
+      for (auto i : vRing->dropPending())
+        lFinish(i, false);
+
+      lErrors = std::min(lErrors + 1, MAX_BACKOFF);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1 << lErrors));
+    } else {
+      lErrors = 0;
+    }
+
+    unsigned lHead = *vRing->cqHead;
+    unsigned lTail = __atomic_load_n(vRing->cqTail, __ATOMIC_ACQUIRE);
+
+    for (; lHead != lTail; ++lHead) {
+      io_uring_cqe const &lCQE = vRing->cqes[lHead & *vRing->cqMask];
+      Request *           lReq = reinterpret_cast<Request *>(static_cast<uintptr_t>(lCQE.user_data));
+
+      // New requests (wakeRing())
+      if (!lReq) {
+        eventfd_t lValue;
+        eventfd_read(vRing->eventFD, &lValue);
+        vRing->wakeArmed = false;
+
+        if (lCQE.res < 0) {
+          wLOG("Unable to wake the I/O thread (", strerror(-lCQE.res), "); new reads wait for the reads in flight");
+          vRing->canWake = false;
+        }
+
+        continue;
+      }
+
+      if (lCQE.res > 0)
+        lReq->done += static_cast<size_t>(lCQE.res);
+
+      if ((lCQE.res > 0 && lReq->done < lReq->size) || lCQE.res == -EINTR || lCQE.res == -EAGAIN) {
+        vRing->push(*lReq); // Short read
+        continue;
+      }
+
+      if (lCQE.res < 0)
+        eLOG("Failed to read '", lReq->path, "': ", strerror(-lCQE.res));
+      else if (lCQE.res == 0)
+        eLOG("Failed to read '", lReq->path, "': unexpected end of file");
+
+      lFinish(lReq, lCQE.res > 0);
+    }
+
+    __atomic_store_n(vRing->cqHead, lHead, __ATOMIC_RELEASE);
+  }
+#endif
+}
+
+//! \brief Opens the file of _request and allocates the buffer
+bool uAsyncIO::openRequest(Request &_request) {
+  uint64_t lFileSize = 0;
+
+#if UNIX
+  _request.fd = ::open(_request.path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (_request.fd < 0) {
+    eLOG("Unable to open '", _request.path, "'");
+    return false;
+  }
+
+  struct stat lStat;
+  if (fstat(_request.fd, &lStat) != 0 || !S_ISREG(lStat.st_mode)) {
+    eLOG("'", _request.path, "' is not a file!");
+    return false;
+  }
+
+  lFileSize = static_cast<uint64_t>(lStat.st_size);
+#else
+  _request.file = fopen(_request.path.c_str(), "rb");
+  if (_request.file == nullptr) {
+    eLOG("Unable to open '", _request.path, "'");
+    return false;
+  }
+
+  long lEnd = -1;
+  if (fseek(_request.file, 0, SEEK_END) == 0)
+    lEnd = ftell(_request.file);
+
+  if (lEnd < 0) {
+    eLOG("Unable to get the size of '", _request.path, "'");
+    return false;
+  }
+
+  lFileSize = static_cast<uint64_t>(lEnd);
+#endif
+
+  if (_request.offset > lFileSize || _request.size > lFileSize - _request.offset) {
+    eLOG("Read of ", _request.size, " bytes at ", _request.offset, " is outside of '", _request.path, "'");
+    return false;
+  }
+
+  if (_request.size == 0)
+    _request.size = static_cast<size_t>(lFileSize - _request.offset);
+
+  _request.data = std::make_shared<Block>(vPool, _request.size);
+  return true;
+}
+
+//! \brief Reads _request on the calling thread (thread pool fallback)
+bool uAsyncIO::readBlocking(Request &_request) {
+  if (!openRequest(_request))
+    return false;
+
+#if UNIX
+  while (_request.done < _request.size) {
+    ssize_t lRes = pread(_request.fd,
+                         _request.data->data() + _request.done,
+                         _request.size - _request.done,
+                         static_cast<off_t>(_request.offset + _request.done));
+
+    if (lRes < 0 && errno == EINTR)
+      continue;
+
+    if (lRes <= 0) {
+      eLOG("Failed to read '", _request.path, "'");
+      return false;
+    }
+
+    _request.done += static_cast<size_t>(lRes);
+  }
+#else
+  if (fseek(_request.file, static_cast<long>(_request.offset), SEEK_SET) != 0 ||
+      fread(_request.data->data(), 1, _request.size, _request.file) != _request.size) {
+    eLOG("Failed to read '", _request.path, "'");
+    return false;
+  }
+
+  _request.done = _request.size;
+#endif
+
+  return true;
+}
+
+//! \brief Closes the file and calls the callback (with nullptr if not _success)
+void uAsyncIO::complete(Request &_request, bool _success) {
+#if UNIX
+  if (_request.fd >= 0)
+    ::close(_request.fd);
+
+  _request.fd = -1;
+#else
+  if (_request.file != nullptr)
+    fclose(_request.file);
+
+  _request.file = nullptr;
+#endif
+
+  if (!_success)
+    _request.data = nullptr;
+
+  if (_request.callback)
+    _request.callback(std::move(_request.data));
+}
+
+//! \brief Returns the service shared by the engine (created on the first call)
+uAsyncIO &uAsyncIO::get() {
+  static uAsyncIO sIO;
+  return sIO;
+}
+} // namespace e_engine
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
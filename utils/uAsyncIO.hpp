@@ -0,0 +1,139 @@
+/*!
+ * \file uAsyncIO.hpp
+ * \brief \b Classes: \a uAsyncIO
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Reads files asynchronously
+ *
+ * Reads are queued with read() / readBatch() and completed with a future or a callback. On Linux all
+ * queued reads are submitted together to an io_uring (up to the queue depth), so the storage sees many
+ * requests at once and no thread blocks on a single read. Without io_uring the reads are executed by
+ * uThreadPool::getPool() (at most one read per worker at once).
+ *
+ * Requests with the priority VISIBLE (needed for the current frame) are always submitted before
+ * PREFETCH requests (data that is likely needed soon). With io_uring a part of the queue depth is
+ * reserved for VISIBLE requests and new requests wake the I/O thread (eventfd), so they do not wait
+ * behind PREFETCH reads in flight.
+ *
+ * The data is read into Blocks from a pool of the service (no allocation and zero fill per read). The
+ * memory returns to the pool when the last Buffer of a read is released.
+ *
+ * get() returns the service shared by the engine (e.g. rTexture::initParallel).
+ *
+ * \note Callbacks are executed by the I/O thread / the pool workers and should be short (hand heavy
+ *       work to uThreadPool). They must not wait for other reads.
+ */
+class uAsyncIO final {
+ public:
+  enum PRIORITY { VISIBLE = 0, PREFETCH, __LAST__ };
+
+ private:
+  struct Pool;
+
+ public:
+  //! \brief Memory of one read (from the pool of the service)
+  class Block final {
+    std::unique_ptr<char[]> vData;
+    size_t                  vSize;
+    uint32_t                vClass; //!< Size class in the pool (UINT32_MAX: not pooled)
+    std::shared_ptr<Pool>   vPool;
+
+   public:
+    Block(std::shared_ptr<Pool> _pool, size_t _size);
+    ~Block();
+
+    Block(Block const &) = delete;
+    Block &operator=(const Block &) = delete;
+
+    inline char *      data() noexcept { return vData.get(); }
+    inline char const *data() const noexcept { return vData.get(); }
+    inline size_t      size() const noexcept { return vSize; }
+  };
+
+  typedef std::shared_ptr<Block>            Buffer;   //!< nullptr if the read failed
+  typedef std::function<void(Buffer _data)> CallBack; //!< Called once the read is completed (or failed)
+
+ private:
+  struct Request;
+  struct Ring;
+
+  std::deque<std::unique_ptr<Request>> vQueues[PRIORITY::__LAST__];
+  std::unique_ptr<Ring>                vRing; //!< nullptr: thread pool fallback
+  std::shared_ptr<Pool>                vPool;
+  std::thread                          vThread;
+
+  std::mutex              vMutex;
+  std::condition_variable vCond;
+  uint32_t                vQueueDepth;
+  uint32_t                vRunning = 0; //!< Reads executed by the thread pool
+  bool                    vStop    = false;
+
+  void push(std::unique_ptr<Request> _request);
+  bool pop(std::unique_ptr<Request> &_out, bool _prefetch = true);
+  bool hasRequests() const noexcept;
+  void pump();
+  void wakeRing();
+  void ringWorker();
+
+  bool openRequest(Request &_request);
+  bool readBlocking(Request &_request);
+
+  static void complete(Request &_request, bool _success);
+
+ public:
+  uAsyncIO(uint32_t _queueDepth = 64, bool _useIOUring = true, size_t _poolSize = 64 * 1024 * 1024);
+  ~uAsyncIO();
+
+  uAsyncIO(uAsyncIO const &) = delete;
+  uAsyncIO &operator=(const uAsyncIO &) = delete;
+
+  void read(std::string _path,
+            CallBack    _callback,
+            PRIORITY    _priority = VISIBLE,
+            uint64_t    _offset   = 0,
+            size_t      _size     = 0);
+
+  std::future<Buffer> read(std::string _path, PRIORITY _priority = VISIBLE, uint64_t _offset = 0, size_t _size = 0);
+  std::vector<std::future<Buffer>> readBatch(std::vector<std::string> const &_paths, PRIORITY _priority = VISIBLE);
+
+  inline bool     isUsingIOUring() const noexcept { return vRing != nullptr; }
+  inline uint32_t getQueueDepth() const noexcept { return vQueueDepth; }
+
+  static uAsyncIO &get();
+};
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
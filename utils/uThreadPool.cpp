@@ -0,0 +1,84 @@
+/*!
+ * \file uThreadPool.cpp
+ * \brief \b Classes: \a uThreadPool
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uThreadPool.hpp"
+#include <algorithm>
+
+namespace e_engine {
+
+/*!
+ * \param _numThreads Number of workers (0: one per CPU core)
+ */
+uThreadPool::uThreadPool(uint32_t _numThreads) {
+  if (_numThreads == 0)
+    _numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  for (uint32_t i = 0; i < _numThreads; ++i)
+    vWorkers.emplace_back(&uThreadPool::worker, this);
+}
+
+//! \brief Finishes all jobs and joins the workers
+uThreadPool::~uThreadPool() {
+  {
+    std::lock_guard<std::mutex> lLock(vMutex);
+    vStop = true;
+  }
+
+  vCond.notify_all();
+
+  for (auto &i : vWorkers)
+    i.join();
+}
+
+void uThreadPool::push(std::function<void()> _job) {
+  {
+    std::lock_guard<std::mutex> lLock(vMutex);
+    vJobs.emplace_back(std::move(_job));
+  }
+
+  vCond.notify_one();
+}
+
+void uThreadPool::worker() {
+  while (true) {
+    std::function<void()> lJob;
+
+    {
+      std::unique_lock<std::mutex> lLock(vMutex);
+      vCond.wait(lLock, [this]() { return vStop || !vJobs.empty(); });
+
+      if (vJobs.empty())
+        return; // vStop
+
+      lJob = std::move(vJobs.front());
+      vJobs.pop_front();
+    }
+
+    lJob();
+  }
+}
+
+//! \brief Returns the pool shared by the engine (created on the first call)
+uThreadPool &uThreadPool::getPool() {
+  static uThreadPool sPool;
+  return sPool;
+}
+} // namespace e_engine
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
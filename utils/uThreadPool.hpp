@@ -0,0 +1,81 @@
+/*!
+ * \file uThreadPool.hpp
+ * \brief \b Classes: \a uThreadPool
+ */
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace e_engine {
+
+/*!
+ * \brief Fixed number of worker threads that execute jobs in the order they were added
+ *
+ * Jobs are added with add(), which returns a future for the result of the job. getPool() returns a
+ * pool with one thread per CPU core that is shared by the engine (e.g. for loading textures).
+ *
+ * \note Jobs must not wait for jobs added after them (dead lock with all workers waiting)
+ */
+class uThreadPool final {
+ private:
+  std::vector<std::thread>          vWorkers;
+  std::deque<std::function<void()>> vJobs;
+
+  std::mutex              vMutex;
+  std::condition_variable vCond;
+  bool                    vStop = false;
+
+  void worker();
+  void push(std::function<void()> _job);
+
+ public:
+  uThreadPool(uint32_t _numThreads = 0);
+  ~uThreadPool();
+
+  uThreadPool(uThreadPool const &) = delete;
+  uThreadPool &operator=(const uThreadPool &) = delete;
+
+  /*!
+   * \brief Adds a job
+   * \returns a future for the result (or exception) of _job
+   */
+  template <class F>
+  auto add(F _job) -> std::future<decltype(_job())> {
+    auto lTask   = std::make_shared<std::packaged_task<decltype(_job())()>>(std::move(_job));
+    auto lFuture = lTask->get_future();
+    push([lTask]() { (*lTask)(); });
+    return lFuture;
+  }
+
+  inline uint32_t getNumThreads() const noexcept { return static_cast<uint32_t>(vWorkers.size()); }
+
+  static uThreadPool &getPool();
+};
+} // namespace e_engine
+
+
+// kate: indent-mode cstyle; indent-width 2; replace-tabs on; line-numbers on;
@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this File except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "defines.hpp"
+#include "vkuBarriers.hpp"
+
+using namespace e_engine;
+
+namespace {
+const VkPipelineStageFlags cDepthTests =
+    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+}
+
+/*!
+ * \brief Stages that may still use an image in _layout (the source scope of a transition away from it)
+ */
+VkPipelineStageFlags vkuBarriers::getLayoutSrcStages(VkImageLayout        _layout,
+                                                     VkPipelineStageFlags _shaderStages) noexcept {
+  switch (_layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED: return VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    case VK_IMAGE_LAYOUT_PREINITIALIZED: return VK_PIPELINE_STAGE_HOST_BIT;
+    case VK_IMAGE_LAYOUT_GENERAL: return _shaderStages | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return cDepthTests;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return cDepthTests | _shaderStages;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return _shaderStages;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    default: return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT; // Unknown layout ==> stay safe
+  }
+}
+
+/*!
+ * \brief Stages that use an image in _layout (the destination scope of a transition into it)
+ */
+VkPipelineStageFlags vkuBarriers::getLayoutDstStages(VkImageLayout        _layout,
+                                                     VkPipelineStageFlags _shaderStages) noexcept {
+  switch (_layout) {
+    case VK_IMAGE_LAYOUT_UNDEFINED: return VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    case VK_IMAGE_LAYOUT_PREINITIALIZED: return VK_PIPELINE_STAGE_HOST_BIT;
+    case VK_IMAGE_LAYOUT_GENERAL: return _shaderStages | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return cDepthTests;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return cDepthTests | _shaderStages;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return _shaderStages;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_PIPELINE_STAGE_TRANSFER_BIT;
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    default: return VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  }
+}
+
+/*!
+ * \brief Writes that can happen in _layout (reads only need an execution dependency)
+ */
+VkAccessFlags vkuBarriers::getLayoutSrcAccess(VkImageLayout _layout) noexcept {
+  switch (_layout) {
+    case VK_IMAGE_LAYOUT_PREINITIALIZED: return VK_ACCESS_HOST_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_GENERAL: return VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_ACCESS_TRANSFER_WRITE_BIT;
+    default: return 0;
+  }
+}
+
+/*!
+ * \brief All accesses that can happen in _layout
+ */
+VkAccessFlags vkuBarriers::getLayoutDstAccess(VkImageLayout _layout) noexcept {
+  switch (_layout) {
+    case VK_IMAGE_LAYOUT_GENERAL:
+      return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT |
+             VK_ACCESS_TRANSFER_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+      return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+      return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+      return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return VK_ACCESS_SHADER_READ_BIT;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return VK_ACCESS_TRANSFER_READ_BIT;
+    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return VK_ACCESS_TRANSFER_WRITE_BIT;
+    default: return 0;
+  }
+}
+
+
+/*!
+ * \brief Adds a layout transition with stages and access masks derived from the layouts
+ * \param _shaderStages Shader stages that use the image in shader accessible layouts
+ */
+void vkuBarriers::addImage(VkImage                 _img,
+                           VkImageSubresourceRange _range,
+                           VkImageLayout           _oldLayout,
+                           VkImageLayout           _newLayout,
+                           VkPipelineStageFlags    _shaderStages,
+                           uint32_t                _srcQueue,
+                           uint32_t                _dstQueue) {
+  VkImageMemoryBarrier lBarrier;
+  lBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  lBarrier.pNext               = nullptr;
+  lBarrier.srcAccessMask       = getLayoutSrcAccess(_oldLayout);
+  lBarrier.dstAccessMask       = getLayoutDstAccess(_newLayout);
+  lBarrier.oldLayout           = _oldLayout;
+  lBarrier.newLayout           = _newLayout;
+  lBarrier.srcQueueFamilyIndex = _srcQueue;
+  lBarrier.dstQueueFamilyIndex = _dstQueue;
+  lBarrier.image               = _img;
+  lBarrier.subresourceRange    = _range;
+
+  addImage(lBarrier, getLayoutSrcStages(_oldLayout, _shaderStages), getLayoutDstStages(_newLayout, _shaderStages));
+}
+
+//! \brief Adds a fully specified image barrier
+void vkuBarriers::addImage(VkImageMemoryBarrier _barrier,
+                           VkPipelineStageFlags _srcStages,
+                           VkPipelineStageFlags _dstStages) {
+  vImages.push_back(_barrier);
+  vSrcStages |= _srcStages;
+  vDstStages |= _dstStages;
+}
+
+void vkuBarriers::addBuffer(VkBuffer             _buffer,
+                            VkPipelineStageFlags _srcStages,
+                            VkAccessFlags        _srcAccess,
+                            VkPipelineStageFlags _dstStages,
+                            VkAccessFlags        _dstAccess,
+                            VkDeviceSize         _offset,
+                            VkDeviceSize         _size,
+                            uint32_t             _srcQueue,
+                            uint32_t             _dstQueue) {
+  VkBufferMemoryBarrier lBarrier;
+  lBarrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  lBarrier.pNext               = nullptr;
+  lBarrier.srcAccessMask       = _srcAccess;
+  lBarrier.dstAccessMask       = _dstAccess;
+  lBarrier.srcQueueFamilyIndex = _srcQueue;
+  lBarrier.dstQueueFamilyIndex = _dstQueue;
+  lBarrier.buffer              = _buffer;
+  lBarrier.offset              = _offset;
+  lBarrier.size                = _size;
+
+  vBuffers.push_back(lBarrier);
+  vSrcStages |= _srcStages;
+  vDstStages |= _dstStages;
+}
+
+/*!
+ * \brief Records all added barriers with one vkCmdPipelineBarrier and clears the list
+ *
+ * The union of all stages is used for both sides, so barriers with very different stages should be
+ * recorded separately.
+ */
+void vkuBarriers::cmdRecord(VkCommandBuffer _buf, VkDependencyFlags _flags) {
+  if (empty())
+    return;
+
+  vkCmdPipelineBarrier(_buf,
+                       vSrcStages != 0 ? vSrcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       vDstStages != 0 ? vDstStages : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       _flags,
+                       0,
+                       nullptr,
+                       static_cast<uint32_t>(vBuffers.size()),
+                       vBuffers.data(),
+                       static_cast<uint32_t>(vImages.size()),
+                       vImages.data());
+
+  clear();
+}
+
+void vkuBarriers::clear() {
+  vImages.clear();
+  vBuffers.clear();
+  vSrcStages = 0;
+  vDstStages = 0;
+}
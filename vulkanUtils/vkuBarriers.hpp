@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this File except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Collects image and buffer barriers and records them with a single vkCmdPipelineBarrier
+ *
+ * For image layout transitions the stage and access masks are derived from the layouts: the source side
+ * waits for the stages that can use the image in the old layout and only flushes writes, the destination
+ * side blocks only the stages that use the image in the new layout.
+ *
+ * Layouts that can be used by shaders (GENERAL, SHADER_READ_ONLY_OPTIMAL, DEPTH_STENCIL_READ_ONLY_OPTIMAL)
+ * are used by the stages in _shaderStages (vertex + fragment + compute by default).
+ *
+ * The presentation engine is synchronized with semaphores: PRESENT_SRC_KHR as old layout maps to the
+ * COLOR_ATTACHMENT_OUTPUT stage (use it as the wait stage of the acquire semaphore) and PRESENT_SRC_KHR
+ * as new layout to BOTTOM_OF_PIPE.
+ */
+class vkuBarriers final {
+ public:
+  static const VkPipelineStageFlags DEFAULT_SHADER_STAGES = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                                                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+ private:
+  std::vector<VkImageMemoryBarrier>  vImages;
+  std::vector<VkBufferMemoryBarrier> vBuffers;
+
+  VkPipelineStageFlags vSrcStages = 0;
+  VkPipelineStageFlags vDstStages = 0;
+
+ public:
+  static VkPipelineStageFlags getLayoutSrcStages(VkImageLayout        _layout,
+                                                 VkPipelineStageFlags _shaderStages = DEFAULT_SHADER_STAGES) noexcept;
+  static VkPipelineStageFlags getLayoutDstStages(VkImageLayout        _layout,
+                                                 VkPipelineStageFlags _shaderStages = DEFAULT_SHADER_STAGES) noexcept;
+  static VkAccessFlags        getLayoutSrcAccess(VkImageLayout _layout) noexcept;
+  static VkAccessFlags        getLayoutDstAccess(VkImageLayout _layout) noexcept;
+
+  void addImage(VkImage                 _img,
+                VkImageSubresourceRange _range,
+                VkImageLayout           _oldLayout,
+                VkImageLayout           _newLayout,
+                VkPipelineStageFlags    _shaderStages = DEFAULT_SHADER_STAGES,
+                uint32_t                _srcQueue     = VK_QUEUE_FAMILY_IGNORED,
+                uint32_t                _dstQueue     = VK_QUEUE_FAMILY_IGNORED);
+
+  void addImage(VkImageMemoryBarrier _barrier, VkPipelineStageFlags _srcStages, VkPipelineStageFlags _dstStages);
+
+  void addBuffer(VkBuffer             _buffer,
+                 VkPipelineStageFlags _srcStages,
+                 VkAccessFlags        _srcAccess,
+                 VkPipelineStageFlags _dstStages,
+                 VkAccessFlags        _dstAccess,
+                 VkDeviceSize         _offset   = 0,
+                 VkDeviceSize         _size     = VK_WHOLE_SIZE,
+                 uint32_t             _srcQueue = VK_QUEUE_FAMILY_IGNORED,
+                 uint32_t             _dstQueue = VK_QUEUE_FAMILY_IGNORED);
+
+  void cmdRecord(VkCommandBuffer _buf, VkDependencyFlags _flags = 0);
+  void clear();
+
+  inline bool                 empty() const noexcept { return vImages.empty() && vBuffers.empty(); }
+  inline VkPipelineStageFlags getSrcStages() const noexcept { return vSrcStages; }
+  inline VkPipelineStageFlags getDstStages() const noexcept { return vDstStages; }
+};
+
+} // namespace e_engine
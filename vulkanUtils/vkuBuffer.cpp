@@ -19,8 +19,7 @@
 #include "vkuBuffer.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
-#include "vkuCommandPoolManager.hpp"
-#include "vkuFence.hpp"
+#include "vkuTransfer.hpp"
 
 using namespace e_engine;
 
@@ -299,6 +298,9 @@ void vkuBuffer::cmdSync(vkuCommandBuffer &_buff) {
 /*!
  * \brief Synchronizes the internal staging with the main buffer
  *
+ * The copy runs on the transfer queue family. Exclusive buffers are then transferred to the graphics
+ * family, concurrent buffers must include both families in Config::queueFamilyIndices.
+ *
  * \note Does nothing if the staging buffer is not required (== the main buffer is host visible)
  */
 VkResult vkuBuffer::sync() {
@@ -308,37 +310,53 @@ VkResult vkuBuffer::sync() {
   if (!vDevice || !*vDevice)
     return VK_ERROR_DEVICE_LOST;
 
-  VkResult lRes = VK_SUCCESS;
+  vkuTransfer lTransfer(vDevice);
+
+  VkResult lRes = lTransfer.begin();
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  cmdSync(lTransfer.getBuffer());
 
-  uint32_t         lQueueFamily = 0;
-  VkQueue          lQueue       = vDevice->getQueue(VK_QUEUE_TRANSFER_BIT, 0.25, &lQueueFamily);
-  vkuCommandPool * lPool        = vkuCommandPoolManager::get(**vDevice, lQueueFamily);
-  vkuCommandBuffer lBuff        = lPool->getBuffer();
-  vkuFence_t       lFence(**vDevice);
+  // Derive the scope of the graphics family from the usage
+  VkPipelineStageFlags lStages = 0;
+  VkAccessFlags        lAccess = 0;
 
-  lBuff.begin();
-  cmdSync(lBuff);
-  lRes = lBuff.end();
+  if (cfg.usage & (VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+    lStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    lAccess |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  }
+
+  if (cfg.usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+    lStages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    lAccess |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  }
+
+  if (cfg.usage & (VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+    lStages |= vkuBarriers::DEFAULT_SHADER_STAGES;
+    lAccess |= VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  }
+
+  if (cfg.usage & (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)) {
+    lStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+    lAccess |= VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  }
+
+  if (lStages == 0)
+    lStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+
+  lTransfer.releaseBuffer(
+      vMainBuffer, lStages, lAccess, 0, VK_WHOLE_SIZE, cfg.sharingMode == VK_SHARING_MODE_CONCURRENT);
+
+  lRes = lTransfer.submit();
+  if (lRes == VK_SUCCESS)
+    lRes = lTransfer.wait();
 
   if (lRes != VK_SUCCESS) {
-    eLOG(L"Failed to record command buffer: ", uEnum2Str::toStr(lRes));
+    eLOG(L"Failed to sync buffer: ", uEnum2Str::toStr(lRes));
     return lRes;
   }
 
-  VkSubmitInfo lSubmit;
-  lSubmit.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-  lSubmit.pNext                = nullptr;
-  lSubmit.waitSemaphoreCount   = 0;
-  lSubmit.pWaitSemaphores      = nullptr;
-  lSubmit.pWaitDstStageMask    = nullptr;
-  lSubmit.commandBufferCount   = 1;
-  lSubmit.pCommandBuffers      = &lBuff.get();
-  lSubmit.signalSemaphoreCount = 0;
-  lSubmit.pSignalSemaphores    = nullptr;
-
-  vkQueueSubmit(lQueue, 1, &lSubmit, lFence[0]);
-  lFence();
-
   if (cfg.deleteStagingBufferAfterUse)
     destroyStagingBufferMemory();
 
@@ -19,9 +19,26 @@
 #include "vkuDevice.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include <algorithm>
+#include <string.h>
 
 using namespace e_engine;
 
+namespace {
+//! \brief Bitwise float compare (exact match for the sampler cache, no -Wfloat-equal)
+bool isSameFloat(float _a, float _b) noexcept { return memcmp(&_a, &_b, sizeof(float)) == 0; }
+
+bool isSameSampler(VkSamplerCreateInfo const &_a, VkSamplerCreateInfo const &_b) noexcept {
+  return _a.pNext == _b.pNext && _a.flags == _b.flags && _a.magFilter == _b.magFilter &&
+         _a.minFilter == _b.minFilter && _a.mipmapMode == _b.mipmapMode && _a.addressModeU == _b.addressModeU &&
+         _a.addressModeV == _b.addressModeV && _a.addressModeW == _b.addressModeW &&
+         isSameFloat(_a.mipLodBias, _b.mipLodBias) && _a.anisotropyEnable == _b.anisotropyEnable &&
+         isSameFloat(_a.maxAnisotropy, _b.maxAnisotropy) && _a.compareEnable == _b.compareEnable &&
+         _a.compareOp == _b.compareOp && isSameFloat(_a.minLod, _b.minLod) && isSameFloat(_a.maxLod, _b.maxLod) &&
+         _a.borderColor == _b.borderColor && _a.unnormalizedCoordinates == _b.unnormalizedCoordinates;
+}
+} // namespace
+
 #if D_LOG_VULKAN_UTILS
 #define dVkLOG(...) dLOG(__VA_ARGS__)
 #else
@@ -179,12 +196,16 @@ vkuDevice::vkuDevice(VkPhysicalDevice         _device,
   dVkLOG(L"  -- Created Queues:");
   for (auto &i : vQueues) {
     vkGetDeviceQueue(vDevice, i.familyIndex, i.index, &i.queue);
+    vQueueMutexMap[i.queue]; // Create all mutexes now, so that getQueueMutex never modifies the map
     dVkLOG(L"    - family: ", i.familyIndex, L"; index: ", i.index, L"; priority: ", i.priority);
   }
 }
 
 vkuDevice::~vkuDevice() {
   if (vDevice != VK_NULL_HANDLE) {
+    for (auto &i : vSamplers)
+      vkDestroySampler(vDevice, i.second, nullptr);
+
     vkDestroyDevice(vDevice, nullptr);
   }
 }
@@ -288,6 +309,244 @@ VkQueue vkuDevice::getQueue(VkQueueFlags _flags, float _priority, uint32_t *_que
 std::mutex &vkuDevice::getQueueMutex(VkQueue _queue) { return vQueueMutexMap[_queue]; }
 
 
+/*!
+ * \brief Returns the first queue family that supports all of _flags and none of _exclude
+ * \returns the queue family index (UINT32_MAX if there is none)
+ */
+uint32_t vkuDevice::findQueueFamily(VkQueueFlags _flags, VkQueueFlags _exclude) {
+  for (uint32_t i = 0; i < vQueueFamilyProperties.size(); ++i) {
+    auto lFlags = vQueueFamilyProperties[i].queueFlags;
+    if ((lFlags & _flags) == _flags && (lFlags & _exclude) == 0)
+      return i;
+  }
+
+  return UINT32_MAX;
+}
+
+/*!
+ * \brief Returns the queue of _family with the priority closest to _priority
+ * \returns the queue; nullptr if none found
+ */
+VkQueue vkuDevice::getFamilyQueue(uint32_t _family, float _priority) {
+  float   lMinDiff = 100.0f;
+  VkQueue lQueue   = nullptr;
+
+  for (auto const &i : vQueues) {
+    if (i.familyIndex != _family)
+      continue;
+
+    auto lTemp = i.priority - _priority;
+    lTemp      = lTemp < 0 ? -lTemp : lTemp; // Make positive
+    if (lTemp < lMinDiff) {
+      lMinDiff = lTemp;
+      lQueue   = i.queue;
+    }
+  }
+
+  return lQueue;
+}
+
+/*!
+ * \brief Returns the index of a compute queue family without graphics support
+ * \returns the dedicated compute family or the first family with compute and graphics support if there is none
+ *
+ * \vkIntern
+ */
+uint32_t vkuDevice::getComputeQueueFamily() {
+  if (!isCreated())
+    return UINT32_MAX;
+
+  uint32_t lFamily = findQueueFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+  if (lFamily == UINT32_MAX)
+    lFamily = findQueueFamily(VK_QUEUE_COMPUTE_BIT | VK_QUEUE_GRAPHICS_BIT);
+
+  return lFamily;
+}
+
+/*!
+ * \brief Selects a queue for asynchronous compute work
+ *
+ * Prefers a queue of a dedicated compute family (getComputeQueueFamily), so that compute work can overlap
+ * the graphics work. Falls back to a graphics queue (with compute support) on devices without such a family.
+ *
+ * \param _priority    Queue target priority
+ * \param _queueFamily Family index of the returned queue
+ * \returns the best matching queue; nullptr if none found
+ *
+ * \vkIntern
+ */
+VkQueue vkuDevice::getComputeQueue(float _priority, uint32_t *_queueFamily) {
+  uint32_t lFamily = getComputeQueueFamily();
+  if (lFamily == UINT32_MAX)
+    return nullptr;
+
+  if (_queueFamily)
+    *_queueFamily = lFamily;
+
+  return getFamilyQueue(lFamily, _priority);
+}
+
+/*!
+ * \brief Checks whether the device has a compute queue family without graphics support
+ * \vkIntern
+ */
+bool vkuDevice::hasAsyncCompute() {
+  return isCreated() && findQueueFamily(VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT) != UINT32_MAX;
+}
+
+/*!
+ * \brief Returns the index of a transfer only queue family (DMA engine)
+ * \returns the transfer only family or the first graphics family if there is none
+ *
+ * \note Graphics and compute families always support transfer commands, even without VK_QUEUE_TRANSFER_BIT
+ * \vkIntern
+ */
+uint32_t vkuDevice::getTransferQueueFamily() {
+  if (!isCreated())
+    return UINT32_MAX;
+
+  uint32_t lFamily = findQueueFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+  if (lFamily == UINT32_MAX)
+    lFamily = findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
+
+  return lFamily;
+}
+
+/*!
+ * \brief Selects a queue for uploads (see getTransferQueueFamily)
+ *
+ * \param _priority    Queue target priority
+ * \param _queueFamily Family index of the returned queue
+ * \returns the best matching queue; nullptr if none found
+ *
+ * \vkIntern
+ */
+VkQueue vkuDevice::getTransferQueue(float _priority, uint32_t *_queueFamily) {
+  uint32_t lFamily = getTransferQueueFamily();
+  if (lFamily == UINT32_MAX)
+    return nullptr;
+
+  if (_queueFamily)
+    *_queueFamily = lFamily;
+
+  return getFamilyQueue(lFamily, _priority);
+}
+
+/*!
+ * \brief Checks whether the device has a transfer only queue family
+ * \vkIntern
+ */
+bool vkuDevice::hasDedicatedTransfer() {
+  return isCreated() &&
+         findQueueFamily(VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) != UINT32_MAX;
+}
+
+/*!
+ * \brief Checks whether 2D images can be partially resident (sparse binding + residency)
+ *
+ * The features are enabled on device creation if they are supported. Sparse binds are submitted to
+ * getQueue(VK_QUEUE_SPARSE_BINDING_BIT, ...).
+ */
+bool vkuDevice::hasSparseResidency() {
+  return isCreated() && vFeatures.sparseBinding && vFeatures.sparseResidencyImage2D &&
+         findQueueFamily(VK_QUEUE_SPARSE_BINDING_BIT) != UINT32_MAX;
+}
+
+
+/*!
+ * \brief Enables the memory budget queries of VK_EXT_memory_budget
+ *
+ * The device must be created with VK_EXT_memory_budget and the instance with
+ * VK_KHR_get_physical_device_properties2.
+ *
+ * \returns true if getMemoryBudget() now returns the values of the driver
+ */
+bool vkuDevice::enableMemoryBudget(VkInstance _instance) {
+#ifdef VK_EXT_memory_budget
+  if (std::find(vExtensions.begin(), vExtensions.end(), VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == vExtensions.end())
+    return false;
+
+  vGetMemoryProperties2 = vkGetInstanceProcAddr(_instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+  return vGetMemoryProperties2 != nullptr;
+#else
+  (void)_instance;
+  return false;
+#endif
+}
+
+/*!
+ * \brief Returns the budget and the usage of the device local memory heaps (of this process)
+ *
+ * Without VK_EXT_memory_budget (see enableMemoryBudget()) the budget is the size of the heaps and the
+ * usage is 0.
+ *
+ * \returns true if the values are from VK_EXT_memory_budget
+ * \vkIntern
+ */
+bool vkuDevice::getMemoryBudget(VkDeviceSize &_budget, VkDeviceSize &_usage) {
+  _budget = 0;
+  _usage  = 0;
+
+#ifdef VK_EXT_memory_budget
+  if (vGetMemoryProperties2) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT lBudget = {};
+    lBudget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2KHR lProps = {};
+    lProps.sType                                = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+    lProps.pNext                                = &lBudget;
+
+    reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(vGetMemoryProperties2)(vPhysicalDevice, &lProps);
+
+    for (uint32_t i = 0; i < lProps.memoryProperties.memoryHeapCount; ++i) {
+      if (!(lProps.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+        continue;
+
+      _budget += lBudget.heapBudget[i];
+      _usage += lBudget.heapUsage[i];
+    }
+
+    return true;
+  }
+#endif
+
+  for (uint32_t i = 0; i < vMemoryProperties.memoryHeapCount; ++i)
+    if (vMemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+      _budget += vMemoryProperties.memoryHeaps[i].size;
+
+  return false;
+}
+
+
+/*!
+ * \brief Returns a sampler for _info (created on the first request)
+ *
+ * Samplers with the same create info are shared, so the number of samplers depends on the number of
+ * different configurations and not on the number of textures (maxSamplerAllocationCount).
+ *
+ * \returns VK_NULL_HANDLE on error
+ * \note The sampler is owned by the device and destroyed with it. Do NOT call vkDestroySampler on it.
+ * \note Extension structs in pNext are only compared by their address.
+ */
+VkSampler vkuDevice::getSampler(VkSamplerCreateInfo const &_info) {
+  std::lock_guard<std::mutex> lLock(vSamplerMutex);
+
+  for (auto const &i : vSamplers)
+    if (isSameSampler(i.first, _info))
+      return i.second;
+
+  VkSampler lSampler;
+  VkResult  lRes = vkCreateSampler(vDevice, &_info, nullptr, &lSampler);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to create sampler: ", uEnum2Str::toStr(lRes));
+    return VK_NULL_HANDLE;
+  }
+
+  vSamplers.emplace_back(_info, lSampler);
+  dVkLOG(L"Created sampler ", vSamplers.size(), L" of ", vProperties.limits.maxSamplerAllocationCount);
+  return lSampler;
+}
+
 /*!
  * \brief Checks whether a format is supported on the device
  * \vkIntern
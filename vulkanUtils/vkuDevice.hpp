@@ -22,6 +22,7 @@
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 #include <vulkan.h>
 
@@ -73,6 +74,14 @@ class vkuDevice {
   std::vector<std::string>                vExtensions;
   std::unordered_map<VkQueue, std::mutex> vQueueMutexMap;
 
+  PFN_vkVoidFunction vGetMemoryProperties2 = nullptr; //!< vkGetPhysicalDeviceMemoryProperties2KHR (memory budget)
+
+  std::vector<std::pair<VkSamplerCreateInfo, VkSampler>> vSamplers; //!< Sampler cache (see getSampler)
+  std::mutex                                             vSamplerMutex;
+
+  uint32_t findQueueFamily(VkQueueFlags _flags, VkQueueFlags _exclude = 0);
+  VkQueue  getFamilyQueue(uint32_t _family, float _priority);
+
  public:
   vkuDevice() = delete;
   vkuDevice(VkPhysicalDevice         _device,
@@ -92,9 +101,24 @@ class vkuDevice {
   VkQueue getQueue(VkQueueFlags _flags, float _priority, uint32_t *_queueFamily = nullptr, bool _presentSupport = false);
   std::mutex &getQueueMutex(VkQueue _queue);
 
+  uint32_t getComputeQueueFamily();
+  VkQueue  getComputeQueue(float _priority, uint32_t *_queueFamily = nullptr);
+  bool     hasAsyncCompute();
+
+  uint32_t getTransferQueueFamily();
+  VkQueue  getTransferQueue(float _priority, uint32_t *_queueFamily = nullptr);
+  bool     hasDedicatedTransfer();
+
+  bool hasSparseResidency();
+
   uint32_t getMemoryTypeIndexFromBitfield(uint32_t _bits, VkMemoryPropertyFlags _flags = 0);
   uint32_t getMemoryTypeIndex(VkMemoryRequirements _requirements, VkMemoryPropertyFlags _flags = 0);
 
+  bool enableMemoryBudget(VkInstance _instance);
+  bool getMemoryBudget(VkDeviceSize &_budget, VkDeviceSize &_usage);
+
+  VkSampler getSampler(VkSamplerCreateInfo const &_info);
+
   bool isFormatSupported(VkFormat _format);
   bool formatSupportsFeature(VkFormat _format, VkFormatFeatureFlagBits _flags, VkImageTiling _type);
 
@@ -102,7 +126,12 @@ class vkuDevice {
 
   SurfaceInfo getSurfaceInfo(VkSurfaceKHR _surface);
 
-  inline VkDevice get() const noexcept { return vDevice; }
+  inline VkPhysicalDeviceFeatures const &  getFeatures() const noexcept { return vFeatures; }
+  inline VkPhysicalDeviceProperties const &getProperties() const noexcept { return vProperties; }
+  inline bool                              hasMemoryBudget() const noexcept { return vGetMemoryProperties2 != nullptr; }
+
+  inline VkDevice         get() const noexcept { return vDevice; }
+  inline VkPhysicalDevice getPhysicalDevice() const noexcept { return vPhysicalDevice; }
 
   inline bool isCreated() const noexcept { return vDevice != VK_NULL_HANDLE; }
 
@@ -19,6 +19,7 @@
 #include "vkuImageBuffer.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include "vkuBarriers.hpp"
 #include "vkuCommandPoolManager.hpp"
 #include "vkuFence.hpp"
 
@@ -156,7 +157,15 @@ VkResult vkuImageBuffer::init(vkuDevicePTR _device) {
   lMemoryAlloc.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   lMemoryAlloc.pNext           = nullptr;
   lMemoryAlloc.allocationSize  = lRequirements.size;
-  lMemoryAlloc.memoryTypeIndex = vDevice->getMemoryTypeIndex(lRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  lMemoryAlloc.memoryTypeIndex = UINT32_MAX;
+
+  // Transient attachments may never need real memory (tile based GPUs) ==> use lazily allocated memory if possible
+  if (cfg.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+    lMemoryAlloc.memoryTypeIndex = vDevice->getMemoryTypeIndex(
+        lRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+  if (lMemoryAlloc.memoryTypeIndex == UINT32_MAX)
+    lMemoryAlloc.memoryTypeIndex = vDevice->getMemoryTypeIndex(lRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
 #if D_LOG_VULKAN_UTILS
   dLOG(L"  -- Allocating Memory:");
@@ -247,8 +256,8 @@ VkImageMemoryBarrier vkuImageBuffer::generateLayoutChangeBarrier(VkImage
   VkImageMemoryBarrier lBarrier;
   lBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
   lBarrier.pNext               = nullptr;
-  lBarrier.srcAccessMask       = 0; // set further down
-  lBarrier.dstAccessMask       = 0; // set further down
+  lBarrier.srcAccessMask       = vkuBarriers::getLayoutSrcAccess(_oldLayout);
+  lBarrier.dstAccessMask       = vkuBarriers::getLayoutDstAccess(_newLayout);
   lBarrier.oldLayout           = _oldLayout;
   lBarrier.newLayout           = _newLayout;
   lBarrier.srcQueueFamilyIndex = _srcQueue;
@@ -256,43 +265,6 @@ VkImageMemoryBarrier vkuImageBuffer::generateLayoutChangeBarrier(VkImage
   lBarrier.image               = _img;
   lBarrier.subresourceRange    = _subResRange;
 
-  switch (_oldLayout) {
-    case VK_IMAGE_LAYOUT_PREINITIALIZED:
-      lBarrier.srcAccessMask = VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: lBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; break;
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-      lBarrier.srcAccessMask =
-          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-      lBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: lBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT; break;
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: lBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT; break;
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: lBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; break;
-    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: lBarrier.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT; break;
-    default: lBarrier.srcAccessMask = 0; break;
-  }
-
-  switch (_newLayout) {
-    case VK_IMAGE_LAYOUT_PREINITIALIZED:
-      lBarrier.dstAccessMask = VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: lBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT; break;
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
-      lBarrier.dstAccessMask =
-          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
-      lBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-      break;
-    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: lBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT; break;
-    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: lBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT; break;
-    case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: lBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT; break;
-    default: lBarrier.dstAccessMask = 0; break;
-  }
-
   return lBarrier;
 }
 
@@ -318,6 +290,13 @@ void vkuImageBuffer::cmdChangeLayout(vkuCommandBuffer *   _buff,
 
   VkImageMemoryBarrier lBarrier = generateLayoutChangeBarrier(_oldLayout, _newLayout, _srcQueue, _dstQueue);
 
+  // Derive the stages from the layouts if not set
+  if (_srcFlags == 0)
+    _srcFlags = vkuBarriers::getLayoutSrcStages(_oldLayout);
+
+  if (_dstFlags == 0)
+    _dstFlags = vkuBarriers::getLayoutDstStages(_newLayout);
+
   vkCmdPipelineBarrier(**_buff, _srcFlags, _dstFlags, 0, 0, nullptr, 0, nullptr, 1, &lBarrier);
 }
 
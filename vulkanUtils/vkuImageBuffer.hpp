@@ -91,15 +91,15 @@ class vkuImageBuffer {
                        VkImageLayout        _newLayout,
                        uint32_t             _srcQueue = VK_QUEUE_FAMILY_IGNORED,
                        uint32_t             _dstQueue = VK_QUEUE_FAMILY_IGNORED,
-                       VkPipelineStageFlags _srcFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                       VkPipelineStageFlags _dstFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT) noexcept;
+                       VkPipelineStageFlags _srcFlags = 0,
+                       VkPipelineStageFlags _dstFlags = 0) noexcept;
 
   VkResult changeLayout(VkImageLayout        _oldLayout,
                         VkImageLayout        _newLayout,
                         uint32_t             _srcQueue = VK_QUEUE_FAMILY_IGNORED,
                         uint32_t             _dstQueue = VK_QUEUE_FAMILY_IGNORED,
-                        VkPipelineStageFlags _srcFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                        VkPipelineStageFlags _dstFlags = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT) noexcept;
+                        VkPipelineStageFlags _srcFlags = 0,
+                        VkPipelineStageFlags _dstFlags = 0) noexcept;
 
   inline VkImageView  get() const noexcept { return vImageView; }
   inline VkImage      getImage() const noexcept { return vImage; }
@@ -19,6 +19,7 @@
 #include "vkuSwapChain.hpp"
 #include "uEnum2Str.hpp"
 #include "uLog.hpp"
+#include "vkuBarriers.hpp"
 #include "vkuCommandPoolManager.hpp"
 #include "vkuFence.hpp"
 
@@ -109,16 +110,16 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
       lExtentToUse.height > lSInfo.surfaceInfo.maxImageExtent.height)
     lExtentToUse = lSInfo.surfaceInfo.maxImageExtent;
 
-  auto lUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
-  if ((lSInfo.surfaceInfo.supportedUsageFlags & static_cast<VkImageUsageFlags>(lUsageFlags)) == 0) {
-    lUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-  }
-
-  if ((lSInfo.surfaceInfo.supportedUsageFlags & static_cast<VkImageUsageFlags>(lUsageFlags)) == 0) {
+  if ((lSInfo.surfaceInfo.supportedUsageFlags & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) == 0) {
     eLOG("Surface does not support requierd image usage flags");
     return {std::move(lLock), VK_ERROR_INITIALIZATION_FAILED};
   }
 
+  // Transfer usage is optional (TRANSFER_DST is needed by renderers blitting their result into the image)
+  vUsageFlags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  vUsageFlags |= lSInfo.surfaceInfo.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  vUsageFlags |= lSInfo.surfaceInfo.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
 
   VkSwapchainKHR lOldSwapchain = vSwapChain;
 
@@ -132,7 +133,7 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
   lCreateInfo.imageColorSpace       = vSwapchainFormat.colorSpace;
   lCreateInfo.imageExtent           = lExtentToUse;
   lCreateInfo.imageArrayLayers      = 1; //!< \todo stereo rendering
-  lCreateInfo.imageUsage            = static_cast<VkImageUsageFlags>(lUsageFlags);
+  lCreateInfo.imageUsage            = vUsageFlags;
   lCreateInfo.imageSharingMode      = VK_SHARING_MODE_EXCLUSIVE;
   lCreateInfo.queueFamilyIndexCount = 0;
   lCreateInfo.pQueueFamilyIndices   = nullptr;
@@ -142,18 +143,6 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
   lCreateInfo.clipped               = VK_TRUE;
   lCreateInfo.oldSwapchain          = lOldSwapchain;
 
-  VkImageMemoryBarrier lBarrier;
-  lBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-  lBarrier.pNext               = nullptr;
-  lBarrier.srcAccessMask       = 0;
-  lBarrier.dstAccessMask       = VK_ACCESS_MEMORY_READ_BIT;
-  lBarrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-  lBarrier.newLayout           = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-  lBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  lBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  lBarrier.image               = VK_NULL_HANDLE;
-  lBarrier.subresourceRange    = cfg.subResRange;
-
 // clang-format off
 #if D_LOG_VULKAN_UTILS
   auto lSupUsageFlags = lSInfo.surfaceInfo.supportedUsageFlags;
@@ -243,10 +232,10 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
 
   dVkLOG("  -- Final number of swapchain images: ", lNum);
 
-  std::vector<VkImageMemoryBarrier> lBarriers;
+  vkuBarriers lBarriers;
   for (auto &i : vSwapchainImages) {
     vSwapchainViews.emplace_back();
-    lBarriers.push_back(lBarrier);
+    lBarriers.addImage(i, cfg.subResRange, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
     VkImageViewCreateInfo lInfo;
     lInfo.sType      = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -260,8 +249,6 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
     };
     lInfo.subresourceRange = cfg.subResRange;
 
-    lBarriers.back().image = i;
-
     lRes = vkCreateImageView(**vDevice, &lInfo, nullptr, &vSwapchainViews.back());
     if (lRes) {
       eLOG("'vkCreateImageView' returned ", uEnum2Str::toStr(lRes));
@@ -271,8 +258,9 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
 
   // We are techincally done now, but we should chanche the layout of the images
 
+  // The images are used by the graphics family (a transfer only family would take the ownership)
   uint32_t         lQueueFamily;
-  VkQueue          lQueue = vDevice->getQueue(VK_QUEUE_TRANSFER_BIT, 0.0, &lQueueFamily);
+  VkQueue          lQueue = vDevice->getQueue(VK_QUEUE_GRAPHICS_BIT, 0.0, &lQueueFamily);
   vkuCommandBuffer lBuf   = vkuCommandPoolManager::getBuffer(**vDevice, lQueueFamily);
   vkuFence_t       lFence(**vDevice);
 
@@ -286,16 +274,7 @@ vkuSwapChain::LockAndResult vkuSwapChain::init(vkuDevicePTR _device, VkSurfaceKH
     return {std::move(lLock), VK_SUBOPTIMAL_KHR};
   }
 
-  vkCmdPipelineBarrier(*lBuf,
-                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-                       0,
-                       0,
-                       nullptr,
-                       0,
-                       nullptr,
-                       static_cast<uint32_t>(lBarriers.size()),
-                       lBarriers.data());
+  lBarriers.cmdRecord(*lBuf);
 
   lBuf.end();
 
@@ -78,6 +78,7 @@ class vkuSwapChain final {
   std::vector<VkImageView> vSwapchainViews;
 
   VkSurfaceFormatKHR vSwapchainFormat;
+  VkImageUsageFlags  vUsageFlags = 0;
 
   std::mutex vSwapChainCreateMutex;
 
@@ -101,6 +102,7 @@ class vkuSwapChain final {
 
   inline VkSwapchainKHR     get() const noexcept { return vSwapChain; }
   inline VkSurfaceFormatKHR getFormat() const noexcept { return vSwapchainFormat; }
+  inline VkImageUsageFlags  getUsageFlags() const noexcept { return vUsageFlags; }
   inline vkuDevicePTR       getDevice() const noexcept { return vDevice; }
   inline Config             getConfig() const noexcept { return cfg; }
   inline bool               isCreated() const noexcept { return vSwapChain != VK_NULL_HANDLE; }
@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this File except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "defines.hpp"
+#include "vkuTransfer.hpp"
+#include "uEnum2Str.hpp"
+#include "uLog.hpp"
+#include "vkuCommandPoolManager.hpp"
+#include <mutex>
+
+using namespace e_engine;
+
+/*!
+ * \param _device   The device
+ * \param _dstFlags Flags of the queue family that uses the uploaded resources
+ */
+vkuTransfer::vkuTransfer(vkuDevicePTR _device, VkQueueFlags _dstFlags)
+    : vDevice(_device), vSemaphore(**_device), vFence(**_device) {
+  vTransferQueue = vDevice->getTransferQueue(0.25f, &vTransferFamily);
+  vDstQueue      = vDevice->getQueue(_dstFlags, 0.25f, &vDstFamily);
+
+  if (!vTransferQueue) {
+    wLOG(L"No transfer queue found ==> uploading with the destination queue");
+    vTransferQueue  = vDstQueue;
+    vTransferFamily = vDstFamily;
+  }
+}
+
+vkuTransfer::~vkuTransfer() {
+  if (vIsSubmitted)
+    wait();
+}
+
+/*!
+ * \brief Starts recording a new batch of uploads
+ * \note The previous batch must be done
+ */
+VkResult vkuTransfer::begin() {
+  if (vIsRecording) {
+    eLOG(L"Transfer already recording");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (!vTransferQueue || !vDstQueue) {
+    eLOG(L"No queue for the upload");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  if (vIsSubmitted) {
+    VkResult lRes = wait();
+    if (lRes != VK_SUCCESS)
+      return lRes;
+  }
+
+  vTransferBuff = vkuCommandPoolManager::getBuffer(**vDevice, vTransferFamily);
+  vAcquireBuff.destroy();
+  vRelease.clear();
+  vAcquire.clear();
+  vDstCommands.clear();
+  vWaitStages = 0;
+
+  VkResult lRes = vTransferBuff.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to begin the transfer command buffer: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  vIsRecording = true;
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Makes the transfer writes to a buffer available to _dstStages / _dstAccess of the destination family
+ */
+void vkuTransfer::releaseBuffer(VkBuffer             _buffer,
+                                VkPipelineStageFlags _dstStages,
+                                VkAccessFlags        _dstAccess,
+                                VkDeviceSize         _offset,
+                                VkDeviceSize         _size,
+                                bool                 _concurrent) {
+  if (!needsOwnershipTransfer()) {
+    vRelease.addBuffer(_buffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_ACCESS_TRANSFER_WRITE_BIT,
+                       _dstStages,
+                       _dstAccess,
+                       _offset,
+                       _size);
+    return;
+  }
+
+  // Concurrent buffers only need the semaphore (written in the wait stages) and a barrier for visibility
+  if (_concurrent) {
+    vAcquire.addBuffer(_buffer, _dstStages, 0, _dstStages, _dstAccess, _offset, _size);
+    vWaitStages |= _dstStages;
+    return;
+  }
+
+  // The dst scope of the release and the src scope of the acquire are ignored (semaphore dependency)
+  vRelease.addBuffer(_buffer,
+                     VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                     0,
+                     _offset,
+                     _size,
+                     vTransferFamily,
+                     vDstFamily);
+
+  vAcquire.addBuffer(_buffer, _dstStages, 0, _dstStages, _dstAccess, _offset, _size, vTransferFamily, vDstFamily);
+  vWaitStages |= _dstStages;
+}
+
+/*!
+ * \brief Transitions an uploaded image into _newLayout and hands it over to the destination family
+ * \param _oldLayout Layout of the image during the upload (usually TRANSFER_DST_OPTIMAL)
+ */
+void vkuTransfer::releaseImage(VkImage                 _img,
+                               VkImageSubresourceRange _range,
+                               VkImageLayout           _oldLayout,
+                               VkImageLayout           _newLayout,
+                               VkPipelineStageFlags    _shaderStages) {
+  VkPipelineStageFlags lDstStages = vkuBarriers::getLayoutDstStages(_newLayout, _shaderStages);
+
+  VkImageMemoryBarrier lBarrier;
+  lBarrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  lBarrier.pNext               = nullptr;
+  lBarrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+  lBarrier.dstAccessMask       = vkuBarriers::getLayoutDstAccess(_newLayout);
+  lBarrier.oldLayout           = _oldLayout;
+  lBarrier.newLayout           = _newLayout;
+  lBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  lBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  lBarrier.image               = _img;
+  lBarrier.subresourceRange    = _range;
+
+  if (!needsOwnershipTransfer()) {
+    vRelease.addImage(lBarrier, VK_PIPELINE_STAGE_TRANSFER_BIT, lDstStages);
+    return;
+  }
+
+  // Release and acquire must describe the same layout transition
+  lBarrier.srcQueueFamilyIndex = vTransferFamily;
+  lBarrier.dstQueueFamilyIndex = vDstFamily;
+
+  VkImageMemoryBarrier lAcquire = lBarrier;
+  lBarrier.dstAccessMask        = 0;
+  lAcquire.srcAccessMask        = 0;
+
+  vRelease.addImage(lBarrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+  vAcquire.addImage(lAcquire, lDstStages, lDstStages);
+  vWaitStages |= lDstStages;
+}
+
+/*!
+ * \brief Adds commands that are recorded for the destination family after all releases / acquires
+ * \note The callback is executed in submit()
+ */
+void vkuTransfer::addDstCommands(std::function<void(VkCommandBuffer)> _record) {
+  vDstCommands.emplace_back(std::move(_record));
+}
+
+/*!
+ * \brief Submits all recorded uploads (and the acquire barriers)
+ */
+VkResult vkuTransfer::submit() {
+  if (!vIsRecording) {
+    eLOG(L"begin() was not called");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  vIsRecording = false;
+  vRelease.cmdRecord(*vTransferBuff);
+
+  if (!needsOwnershipTransfer())
+    for (auto &i : vDstCommands)
+      i(*vTransferBuff);
+
+  VkResult lRes = vTransferBuff.end();
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"Failed to record the transfer command buffer: ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  bool lAcquire = needsOwnershipTransfer() && (!vAcquire.empty() || !vDstCommands.empty());
+
+  if (lAcquire) {
+    if (vWaitStages == 0)
+      vWaitStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    vAcquireBuff = vkuCommandPoolManager::getBuffer(**vDevice, vDstFamily);
+    vAcquireBuff.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vAcquire.cmdRecord(*vAcquireBuff);
+
+    for (auto &i : vDstCommands)
+      i(*vAcquireBuff);
+
+    lRes = vAcquireBuff.end();
+
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"Failed to record the acquire command buffer: ", uEnum2Str::toStr(lRes));
+      return lRes;
+    }
+  }
+
+  VkSubmitInfo lInfo         = {};
+  lInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  lInfo.pNext                = nullptr;
+  lInfo.waitSemaphoreCount   = 0;
+  lInfo.pWaitSemaphores      = nullptr;
+  lInfo.pWaitDstStageMask    = nullptr;
+  lInfo.commandBufferCount   = 1;
+  lInfo.pCommandBuffers      = &vTransferBuff.get();
+  lInfo.signalSemaphoreCount = lAcquire ? 1 : 0;
+  lInfo.pSignalSemaphores    = lAcquire ? &vSemaphore.at() : nullptr;
+
+  {
+    std::lock_guard<std::mutex> lLock(vDevice->getQueueMutex(vTransferQueue));
+    lRes = vkQueueSubmit(vTransferQueue, 1, &lInfo, lAcquire ? VK_NULL_HANDLE : vFence[0]);
+  }
+
+  if (lRes != VK_SUCCESS) {
+    eLOG(L"'vkQueueSubmit' returned ", uEnum2Str::toStr(lRes));
+    return lRes;
+  }
+
+  if (lAcquire) {
+    lInfo.waitSemaphoreCount   = 1;
+    lInfo.pWaitSemaphores      = &vSemaphore.at();
+    lInfo.pWaitDstStageMask    = &vWaitStages;
+    lInfo.pCommandBuffers      = &vAcquireBuff.get();
+    lInfo.signalSemaphoreCount = 0;
+    lInfo.pSignalSemaphores    = nullptr;
+
+    std::lock_guard<std::mutex> lLock(vDevice->getQueueMutex(vDstQueue));
+    lRes = vkQueueSubmit(vDstQueue, 1, &lInfo, vFence[0]);
+
+    if (lRes != VK_SUCCESS) {
+      eLOG(L"'vkQueueSubmit' returned ", uEnum2Str::toStr(lRes));
+      return lRes;
+    }
+  }
+
+  vIsSubmitted = true;
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Waits until all uploads of the last submit() are done
+ */
+VkResult vkuTransfer::wait(uint64_t _timeout) {
+  if (!vIsSubmitted)
+    return VK_SUCCESS;
+
+  VkResult lRes = vFence(0, 1, _timeout);
+  if (lRes != VK_SUCCESS)
+    return lRes;
+
+  vIsSubmitted = false;
+  return VK_SUCCESS;
+}
+
+/*!
+ * \brief Checks (without blocking) whether all uploads of the last submit() are done
+ */
+bool vkuTransfer::isDone() {
+  if (!vIsSubmitted)
+    return !vIsRecording;
+
+  return wait(0) == VK_SUCCESS;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2017 EEnginE project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this File except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+
+#include "defines.hpp"
+#include "vkuBarriers.hpp"
+#include "vkuCommandBuffer.hpp"
+#include "vkuDevice.hpp"
+#include "vkuFence.hpp"
+#include "vkuSemaphore.hpp"
+#include <functional>
+#include <vector>
+#include <vulkan.h>
+
+namespace e_engine {
+
+/*!
+ * \brief Records uploads for the transfer queue and hands the resources over to the destination queue family
+ *
+ * Usage:
+ *  - begin()
+ *  - record copies into getBuffer()
+ *  - releaseBuffer() / releaseImage() for every written resource that is used by the destination family
+ *  - submit() and later isDone() / wait()
+ *
+ * On devices with a transfer only queue family (vkuDevice::getTransferQueueFamily) the copies run on that
+ * family, in parallel to the rendering. Exclusive resources are then transferred to the destination family
+ * with a release barrier in the transfer command buffer and a matching acquire barrier in a second command
+ * buffer, which is submitted to the destination family and waits for the transfer with a semaphore.
+ * Otherwise both families are the same and only a normal barrier is recorded.
+ *
+ * Commands that need the destination family (e.g. blits for mip maps) can be added with addDstCommands().
+ * They are recorded after the acquire barriers.
+ *
+ * All uploads between begin() and submit() complete together (one fence).
+ *
+ * \note Buffers with VK_SHARING_MODE_CONCURRENT (for both families) are released with _concurrent = true
+ * \note (no ownership transfer, only the memory dependency).
+ * \note Staging data must be kept until the transfer is done.
+ */
+class vkuTransfer final {
+ private:
+  vkuDevicePTR vDevice;
+
+  VkQueue  vTransferQueue  = VK_NULL_HANDLE;
+  VkQueue  vDstQueue       = VK_NULL_HANDLE;
+  uint32_t vTransferFamily = UINT32_MAX;
+  uint32_t vDstFamily      = UINT32_MAX;
+
+  vkuCommandBuffer vTransferBuff;
+  vkuCommandBuffer vAcquireBuff;
+  vkuBarriers      vRelease;
+  vkuBarriers      vAcquire;
+
+  vkSemaphore_t vSemaphore;
+  vkuFence_t    vFence;
+
+  std::vector<std::function<void(VkCommandBuffer)>> vDstCommands;
+
+  VkPipelineStageFlags vWaitStages = 0;
+
+  bool vIsRecording = false;
+  bool vIsSubmitted = false;
+
+ public:
+  vkuTransfer() = delete;
+  vkuTransfer(vkuDevicePTR _device, VkQueueFlags _dstFlags = VK_QUEUE_GRAPHICS_BIT);
+  ~vkuTransfer();
+
+  vkuTransfer(vkuTransfer const &) = delete;
+  vkuTransfer &operator=(const vkuTransfer &) = delete;
+
+  VkResult begin();
+
+  void releaseBuffer(VkBuffer             _buffer,
+                     VkPipelineStageFlags _dstStages,
+                     VkAccessFlags        _dstAccess,
+                     VkDeviceSize         _offset     = 0,
+                     VkDeviceSize         _size       = VK_WHOLE_SIZE,
+                     bool                 _concurrent = false);
+
+  void releaseImage(VkImage                 _img,
+                    VkImageSubresourceRange _range,
+                    VkImageLayout           _oldLayout,
+                    VkImageLayout           _newLayout,
+                    VkPipelineStageFlags    _shaderStages = vkuBarriers::DEFAULT_SHADER_STAGES);
+
+  void addDstCommands(std::function<void(VkCommandBuffer)> _record);
+
+  VkResult submit();
+  VkResult wait(uint64_t _timeout = UINT64_MAX);
+  bool     isDone();
+
+  inline vkuCommandBuffer &getBuffer() noexcept { return vTransferBuff; }
+  inline uint32_t          getTransferQueueFamily() const noexcept { return vTransferFamily; }
+  inline uint32_t          getDstQueueFamily() const noexcept { return vDstFamily; }
+  inline bool              needsOwnershipTransfer() const noexcept { return vTransferFamily != vDstFamily; }
+  inline bool              isRecording() const noexcept { return vIsRecording; }
+};
+
+} // namespace e_engine